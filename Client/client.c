@@ -83,6 +83,42 @@ static int32_t assignedFactionId = -1;
 // Will be NULL if no faction is assigned or if the level is not initialized.
 static const Faction *localFaction = NULL;
 
+// Revision of the lobby state we last received, so lobby deltas are only applied on top of the state they build upon.
+// Not valid until the full lobby state has been received.
+static uint32_t lobbyRevision = 0;
+static bool lobbyRevisionValid = false;
+
+// Whether the starting level we laid out ourselves did not match the server's (or we never got to lay it out,
+// having missed the start game packet), so we are waiting on the full level instead, along with the time
+// since we last asked for it and the hash of the level we laid out, or 0 if none, which is sent along for the server to log.
+static bool fullRequestPending = false;
+static float fullRequestTimer = 0.0f;
+static uint64_t fullRequestLayoutHash = 0;
+
+// -- Map file variables --
+
+// The map file the lobby's matches are played on, once we have it.
+// Left closed (data is NULL) while levels are generated instead, or while the map is still downloading.
+static MapFile lobbyMap = {0};
+
+// Hash and size of the lobby's map file as announced by the server, or 0 if levels are generated.
+static uint64_t lobbyMapHash = 0;
+static uint32_t lobbyMapSize = 0;
+
+// Path the lobby's map file is kept at in the map cache.
+static char lobbyMapPath[MAX_PATH] = {0};
+
+// The lobby's map file as it is being downloaded, and which of its chunks have arrived so far.
+// mapDownloadData is NULL unless a download is in progress.
+static uint8_t *mapDownloadData = NULL;
+static uint8_t *mapDownloadChunkReceived = NULL;
+static size_t mapDownloadChunkCount = 0;
+static size_t mapDownloadChunksReceived = 0;
+
+// Time since missing chunks of the map were last asked for, and since the server was last told we have the map.
+static float mapRequestTimer = 0.0f;
+static float mapReadyTimer = 0.0f;
+
 // -- Player interaction state variables --
 
 // Tracks the player's current planet selection state.
@@ -97,6 +133,21 @@ static PlayerControlGroups controlGroups = {0};
 // Tracks the camera used for rendering and interaction.
 static CameraState cameraState = {0};
 
+// Indices of the planets, trail effects and starships found visible this frame.
+// Kept around between frames so their memory is reused rather than reallocated.
+static CullingIndexList visiblePlanets = {0};
+static CullingIndexList visibleTrails = {0};
+static CullingIndexList visibleStarships = {0};
+
+// Visible versus total object counts from the most recent frame, shown in the debug overlay.
+static CullingStats cullingStats = {0};
+
+// The background and settled planets, kept in a texture and only drawn again where they change.
+static StaticLayer staticLayer = {0};
+
+// Whether the profiler's frame timing overlay is shown. Toggled with F3.
+static bool profilerOverlayVisible = false;
+
 // Indicates whether box selection mode is active.
 static bool boxSelectActive = false;
 
@@ -129,19 +180,55 @@ static int64_t previousTicks = 0;
 // Used to convert tick counts to seconds.
 static int64_t tickFrequency = 1;
 
+// -- Threading variables --
+
+// Network messages are processed and the level is updated on a thread of their own,
+// at a fixed CLIENT_SIMULATION_TICK_RATE, while the window thread handles input and drawing.
+// The client state above is shared between the two threads, so it is only touched with this lock held.
+// The exception is the level drawn each frame, which comes from levelSnapshots instead,
+// so that however long a frame takes to draw, the simulation is never kept waiting.
+static CRITICAL_SECTION clientStateLock;
+
+// Handle to the simulation thread, or NULL if it is not running.
+static HANDLE simulationThread = NULL;
+
+// Copies of the level handed from the simulation thread to the window thread after every tick.
+static LevelSnapshotBuffer levelSnapshots = {0};
+
+// The window thread's own copy of the level, taken from the latest snapshot every frame,
+// with its starships moved to where they are at the time the frame is drawn.
+// Only the window thread ever touches it, so it is drawn without holding any lock.
+static Level renderLevel;
+
 // Forward declarations of static functions.
 
 static LRESULT CALLBACK WindowProcessMessage(HWND window_handle, UINT msg, WPARAM wParam, LPARAM lParam);
-static void DrawSelectionHighlights(void);
+static LRESULT HandleWindowMessage(HWND window_handle, UINT msg, WPARAM wParam, LPARAM lParam);
+static DWORD WINAPI SimulationThreadMain(LPVOID parameter);
+static void SimulationTick(float deltaTime);
+static void DrawSelectionHighlights(const Level *drawnLevel);
 static Planet *PickPlanetAt(Vec2 position, size_t *outIndex);
 static void RefreshLocalFaction(void);
 static void HandleFullPacketMessage(const uint8_t *data, size_t length);
+static void EnterGameWithLevel(void);
+static bool LayOutStartingLevel(const uint8_t *data, size_t length, uint64_t *outLayoutHash);
 static void HandleSnapshotPacketMessage(const uint8_t *data, size_t length);
 static void HandleAssignmentPacketMessage(const uint8_t *data, size_t length);
 static void HandleFleetLaunchPacketMessage(const uint8_t *data, size_t length);
 static void HandleServerDisconnectPacketMessage(const uint8_t *data, size_t length);
 static void HandleLobbyStatePacketMessage(const uint8_t *data, size_t length);
+static void HandleLobbyDeltaPacketMessage(const uint8_t *data, size_t length);
+static void ApplyLobbySlotInfo(size_t index, const LevelLobbySlotInfo *slot);
 static void HandleStartGamePacketMessage(const uint8_t *data, size_t length);
+static void HandleMapChunkPacketMessage(const uint8_t *data, size_t length);
+static void SetLobbyMap(uint64_t mapHash, uint32_t mapSize);
+static void ReleaseLobbyMap(void);
+static void ReleaseMapDownload(void);
+static void FinishMapDownload(void);
+static void RefreshMapDownloadStatus(void);
+static void UpdateLobbyMap(float deltaTime);
+static void SendMapRequests(void);
+static void SendMapReady(void);
 static void ResetConnectionToMenu(const char *statusMessage);
 static const Faction *ResolveFactionById(int32_t factionId);
 static void ProcessNetworkMessages(void);
@@ -150,6 +237,8 @@ static void SendDisconnectNotice(void);
 static void SendLobbyColorUpdate(int factionId, uint8_t r, uint8_t g, uint8_t b);
 static void SendLobbyTeamUpdate(int factionId, int teamNumber);
 static void SendLobbySharedControlUpdate(int factionId, int sharedControlNumber);
+static void SendLobbyResyncRequest(void);
+static void SendFullRequest(void);
 static void ProcessMenuConnectRequest(void);
 static void RenderFrame(float fps);
 static void DrawSelectionBox(void);
@@ -158,21 +247,24 @@ static void HandleClickSelection(Vec2 mousePos, bool additive);
 static int ControlGroupIndexFromKey(WPARAM key);
 static void UpdateCamera(HWND window_handle, float deltaTime);
 static void ClampCameraToLevel(void);
-static void ApplyCameraTransform(void);
+static void ApplyCameraTransform(const CameraState *camera);
 static Vec2 ScreenToWorld(Vec2 screen);
 static Vec2 WorldToScreen(Vec2 world);
 static void RefreshCameraBounds(void);
 static bool IsServerFullMessage(const uint8_t *data, size_t length);
 static bool GameOverOverlayConsumesInput(void);
 static void UpdateGameOverOverlay(void);
+static SoundBackend *SelectSoundBackend(const char *commandLine, char *outPath, size_t outPathSize);
+static void RunSoundBenchmark(void);
 
 /**
  * Helper function to draw selection highlights
  * around planets selected by the player.
+ * @param drawnLevel The copy of the level being drawn, whose planets line up with the selection.
  */
-static void DrawSelectionHighlights(void) {
+static void DrawSelectionHighlights(const Level *drawnLevel) {
     // If the level is not initialized or there is no selection state, do nothing.
-    if (!levelInitialized || selectionState.selectedPlanets == NULL) {
+    if (!levelInitialized || drawnLevel == NULL || selectionState.selectedPlanets.words == NULL) {
         return;
     }
 
@@ -182,16 +274,13 @@ static void DrawSelectionHighlights(void) {
     // Limit the count to the smaller of planetCount and selectionState.capacity.
     // selectionState.capacity should always be equal to planetCount,
     // but this check ensures we don't read out of bounds.
-    size_t count = level.planetCount < selectionState.capacity ? level.planetCount : selectionState.capacity;
-
-    // Iterate through all planets and draw highlights for selected ones.
-    for (size_t i = 0; i < count; ++i) {
-        if (!selectionState.selectedPlanets[i]) {
-            continue;
-        }
+    size_t count = drawnLevel->planetCount < selectionState.capacity ? drawnLevel->planetCount : selectionState.capacity;
 
-        float radius = PlanetGetOuterRadius(&level.planets[i]);
-        DrawFeatheredRing(level.planets[i].position.x, level.planets[i].position.y,
+    // Iterate through only the selected planets and draw highlights for them.
+    const Bitset *selected = &selectionState.selectedPlanets;
+    for (size_t i = BitsetNextSet(selected, 0); i < count; i = BitsetNextSet(selected, i + 1)) {
+        float radius = PlanetGetOuterRadius(&drawnLevel->planets[i]);
+        DrawFeatheredRing(drawnLevel->planets[i].position.x, drawnLevel->planets[i].position.y,
             radius + 2.0f, radius + 5.0f, 1.2f, highlightColor);
     }
 }
@@ -315,7 +404,7 @@ static void ApplyBoxSelection(bool additive) {
     }
 
     // If there is no selection state, do nothing.
-    if (selectionState.selectedPlanets == NULL || selectionState.capacity == 0) {
+    if (selectionState.selectedPlanets.words == NULL || selectionState.capacity == 0) {
         return;
     }
 
@@ -513,19 +602,20 @@ static bool IsServerFullMessage(const uint8_t *data, size_t length) {
  * to the current OpenGL modelview matrix.
  * Sets up the scaling and translation based on the camera state.
  * Used when panning or zooming the view.
+ * @param camera The camera to apply, normally a copy of cameraState taken for the frame being drawn.
  */
-static void ApplyCameraTransform(void) {
+static void ApplyCameraTransform(const CameraState *camera) {
     // If the camera zoom is less than zero,
     // there's nothing to see.
-    if (cameraState.zoom <= 0.0f) {
+    if (camera == NULL || camera->zoom <= 0.0f) {
         return;
     }
 
     // Scale the view according to the zoom level,
-    glScalef(cameraState.zoom, cameraState.zoom, 1.0f);
+    glScalef(camera->zoom, camera->zoom, 1.0f);
 
     // Then translate the view to center on the camera position.
-    glTranslatef(-cameraState.position.x, -cameraState.position.y, 0.0f);
+    glTranslatef(-camera->position.x, -camera->position.y, 0.0f);
 }
 
 /**
@@ -743,6 +833,20 @@ static void UpdateGameOverOverlay(void) {
  * @param length Length of the packet data.
  */
 static void HandleFullPacketMessage(const uint8_t *data, size_t length) {
+    // A level laid out from a map file leaves the planets out of the packet,
+    // so they have to be laid out from our own copy of the map before the packet can be applied.
+    if (data != NULL && length >= sizeof(LevelFullPacket)) {
+        const LevelFullPacket *header = (const LevelFullPacket *)data;
+        if (header->type == LEVEL_PACKET_TYPE_FULL && header->mapHash != 0u) {
+            if (lobbyMap.data == NULL || lobbyMap.hash != header->mapHash
+                || !LevelConfigure(&level, (size_t)header->factionCount, (size_t)header->planetCount, 16u)
+                || !MapFileApplyToLevel(&lobbyMap, &level, 0)) {
+                printf("Failed to lay out the level from the map file.\n");
+                return;
+            }
+        }
+    }
+
     // Delegate to LevelApplyFullPacket to handle the actual data.
     if (!LevelApplyFullPacket(&level, data, length)) {
         printf("Failed to apply full packet.\n");
@@ -754,10 +858,21 @@ static void HandleFullPacketMessage(const uint8_t *data, size_t length) {
         return;
     }
 
+    EnterGameWithLevel();
+}
+
+/**
+ * Starts playing on the level now in place, whether it came in a full packet
+ * or was laid out locally at the start of a match.
+ * Marks the level as initialized, resets player selection, control groups, and camera state,
+ * and sets the client stage to the game stage.
+ */
+static void EnterGameWithLevel(void) {
     // Mark the level as initialized and reset selection state,
     // in case of a reinitialization.
     levelInitialized = true;
     awaitingFull = false;
+    fullRequestPending = false;
 
     // Reset the player's selection state in case they
     // had any selections prior to the full packet.
@@ -835,6 +950,21 @@ static void HandleFullPacketMessage(const uint8_t *data, size_t length) {
 static void HandleSnapshotPacketMessage(const uint8_t *data, size_t length) {
     // If the level is not initialized, cannot apply a snapshot.
     if (!levelInitialized) {
+        // Snapshots are only sent during a match, so one reaching us in the lobby means
+        // the start game packet was lost on its way here. Nothing else would ever start the match for us,
+        // so we ask for the full level, and keep asking until it arrives (see SimulationTick).
+        if (currentStage == CLIENT_STAGE_LOBBY && !fullRequestPending) {
+            printf("Received a snapshot for a match we never started, requesting the full level.\n");
+
+            // Tidy the lobby away just as the start game packet would have.
+            LobbyMenuUISetPreviewOpen(&lobbyMenuUI, false);
+            LobbyPreviewReset(&lobbyPreview);
+            LobbyMenuUISetStatusMessage(&lobbyMenuUI, "Loading game...");
+
+            fullRequestPending = true;
+            fullRequestLayoutHash = 0;
+            SendFullRequest();
+        }
         return;
     }
 
@@ -903,6 +1033,9 @@ static void ResetConnectionToMenu(const char *statusMessage) {
     assignedFactionId = -1;
     localFaction = NULL;
     timeSinceLastServerPacket = 0.0f;
+    lobbyRevision = 0;
+    lobbyRevisionValid = false;
+    fullRequestPending = false;
 
     // Clear any player interaction state so we start fresh when reconnecting.
     PlayerSelectionReset(&selectionState, 0);
@@ -913,6 +1046,9 @@ static void ResetConnectionToMenu(const char *statusMessage) {
     // Release the level data so stale state is not reused.
     LevelRelease(&level);
 
+    // Whichever server we connect to next announces its own map, if any.
+    ReleaseLobbyMap();
+
     // Reset preview state so the next lobby session starts clean.
     LobbyPreviewReset(&lobbyPreview);
 
@@ -1025,6 +1161,25 @@ static void HandleFleetLaunchPacketMessage(const uint8_t *data, size_t length) {
     }
 }
 
+/**
+ * Updates a single slot of the lobby UI from the slot info the server sent for it.
+ * @param index Index of the slot in the lobby UI.
+ * @param slot The slot info to apply.
+ */
+static void ApplyLobbySlotInfo(size_t index, const LevelLobbySlotInfo *slot) {
+    if (slot == NULL) {
+        return;
+    }
+
+    bool occupied = slot->occupied != 0u;
+    const char *slotName = occupied ? slot->playerName : "";
+    LobbyMenuUISetSlotInfo(&lobbyMenuUI, index, slot->factionId, occupied, slotName);
+    LobbyMenuUISetSlotAI(&lobbyMenuUI, index, slot->aiIndex);
+    LobbyMenuUISetSlotTeam(&lobbyMenuUI, index, slot->teamNumber);
+    LobbyMenuUISetSlotSharedControl(&lobbyMenuUI, index, slot->sharedControlNumber);
+    LobbyMenuUISetSlotColor(&lobbyMenuUI, index, slot->color);
+}
+
 /**
  * Handles a lobby state packet message received from the server.
  * Updates the local lobby UI state with settings and slot occupancy.
@@ -1081,21 +1236,24 @@ static void HandleLobbyStatePacketMessage(const uint8_t *data, size_t length) {
     // Update each slot's information based on the packet data.
     const LevelLobbySlotInfo *slots = (const LevelLobbySlotInfo *)(data + sizeof(LevelLobbyStatePacket));
     for (size_t i = 0; i < slotCount; ++i) {
-        bool occupied = slots[i].occupied != 0u;
-        const char *slotName = occupied ? slots[i].playerName : "";
-        LobbyMenuUISetSlotInfo(&lobbyMenuUI, i, slots[i].factionId, occupied, slotName);
-        LobbyMenuUISetSlotAI(&lobbyMenuUI, i, slots[i].aiIndex);
-        LobbyMenuUISetSlotTeam(&lobbyMenuUI, i, slots[i].teamNumber);
-        LobbyMenuUISetSlotSharedControl(&lobbyMenuUI, i, slots[i].sharedControlNumber);
-        LobbyMenuUISetSlotColor(&lobbyMenuUI, i, slots[i].color);
+        ApplyLobbySlotInfo(i, &slots[i]);
     }
 
+    // Any lobby deltas from here on build upon this revision.
+    lobbyRevision = packet->revision;
+    lobbyRevisionValid = true;
+
     // Highlight our assigned faction slot and update status message,
     // and enable color editing for our assigned faction.
     LobbyMenuUISetHighlightedFactionId(&lobbyMenuUI, assignedFactionId);
     LobbyMenuUISetColorEditAuthority(&lobbyMenuUI, false, assignedFactionId);
     LobbyMenuUISetStatusMessage(&lobbyMenuUI, "Waiting for host to start game.");
 
+    // Find the lobby's map file in the cache, or start downloading it.
+    // Either way, the status message says how the download is going, should there be one.
+    SetLobbyMap(packet->mapHash, packet->mapSize);
+    RefreshMapDownloadStatus();
+
     // Restore focus only for the local slot so client input remains stable during updates.
     if (focusedFactionId >= 0 && focusedFactionId == assignedFactionId && (focusedTeam || focusedShared)) {
         int restoreIndex = -1;
@@ -1113,6 +1271,10 @@ static void HandleLobbyStatePacketMessage(const uint8_t *data, size_t length) {
     // Mark the preview dirty so it regenerates with the new lobby state.
     LobbyPreviewMarkDirty(&lobbyPreview);
 
+    // The server only sends the full lobby state from the lobby, so whatever match
+    // we were still asking for the level of is over.
+    fullRequestPending = false;
+
     // If we are not already in the lobby stage, switch to it.
     if (currentStage != CLIENT_STAGE_LOBBY) {
         // Clean up any existing level state.
@@ -1136,9 +1298,130 @@ static void HandleLobbyStatePacketMessage(const uint8_t *data, size_t length) {
     }
 }
 
+/**
+ * Handles a lobby delta packet message received from the server.
+ * Updates only the lobby slots that changed since the previous lobby revision.
+ * If we are not at the revision the delta builds upon, we missed something,
+ * so the delta is dropped and the full lobby state asked for instead.
+ * @param data Pointer to the packet data.
+ * @param length Length of the packet data.
+ */
+static void HandleLobbyDeltaPacketMessage(const uint8_t *data, size_t length) {
+    // Basic validation of input parameters.
+    if (data == NULL || length < sizeof(LevelLobbyDeltaPacket)) {
+        return;
+    }
+
+    // Cast the data to a LevelLobbyDeltaPacket and verify the type.
+    const LevelLobbyDeltaPacket *packet = (const LevelLobbyDeltaPacket *)data;
+    if (packet->type != LEVEL_PACKET_TYPE_LOBBY_DELTA) {
+        return;
+    }
+
+    // A delta for a revision we already have arrived late, or twice, and can safely be ignored.
+    // The subtraction keeps this working even once the revision wraps around.
+    if (lobbyRevisionValid && (int32_t)(packet->revision - lobbyRevision) <= 0) {
+        return;
+    }
+
+    // Without the state the delta builds upon, there is nothing to apply it to.
+    if (currentStage != CLIENT_STAGE_LOBBY || !lobbyRevisionValid || packet->baseRevision != lobbyRevision) {
+        SendLobbyResyncRequest();
+        return;
+    }
+
+    // Verify that the packet length is sufficient for the slots it claims to hold.
+    size_t slotCount = (size_t)packet->slotCount;
+    if (slotCount > LOBBY_MENU_MAX_SLOTS) {
+        return;
+    }
+
+    size_t expectedSize = sizeof(LevelLobbyDeltaPacket) + slotCount * sizeof(LevelLobbySlotInfo);
+    if (length < expectedSize) {
+        return;
+    }
+
+    // Every slot must be one the lobby UI actually has, otherwise our state does not match the server's.
+    const LevelLobbySlotInfo *slots = (const LevelLobbySlotInfo *)(data + sizeof(LevelLobbyDeltaPacket));
+    for (size_t i = 0; i < slotCount; ++i) {
+        if (slots[i].factionId < 0 || (size_t)slots[i].factionId >= lobbyMenuUI.slotCount) {
+            SendLobbyResyncRequest();
+            return;
+        }
+    }
+
+    // Replace each changed slot. Unlike the full state, the slots are updated in place,
+    // so whatever slot field is being typed into keeps its focus.
+    for (size_t i = 0; i < slotCount; ++i) {
+        ApplyLobbySlotInfo((size_t)slots[i].factionId, &slots[i]);
+    }
+
+    lobbyRevision = packet->revision;
+
+    // Mark the preview dirty so it regenerates with the new lobby state.
+    LobbyPreviewMarkDirty(&lobbyPreview);
+}
+
+/**
+ * Lays out the starting level of a match from a start game packet, exactly as the server did:
+ * with the faction roster from the packet, and the planets either generated from the packet's
+ * settings and seed or laid out from the lobby's map file.
+ * @param data Pointer to the start game packet data.
+ * @param length Length of the packet data.
+ * @param outLayoutHash Receives the LevelComputeLayoutHash of the level laid out, or 0 if none could be.
+ * @return true if the level was laid out and matches the server's, false otherwise.
+ */
+static bool LayOutStartingLevel(const uint8_t *data, size_t length, uint64_t *outLayoutHash) {
+    *outLayoutHash = 0;
+
+    const LevelStartGamePacket *packet = (const LevelStartGamePacket *)data;
+    size_t factionCount = (size_t)packet->factionCount;
+    size_t planetCount = (size_t)packet->planetCount;
+    if (factionCount == 0 || planetCount == 0) {
+        return false;
+    }
+
+    // Verify that the packet length is sufficient for the faction roster.
+    size_t expectedSize = sizeof(LevelStartGamePacket) + factionCount * sizeof(LevelPacketFactionInfo);
+    if (length < expectedSize) {
+        return false;
+    }
+
+    // Configure the level just as the server does before laying it out,
+    // with room for as many starships as the starting planets could launch at once.
+    size_t initialStarshipCapacity = factionCount *
+        (size_t)((packet->minFleetCapacity + packet->maxFleetCapacity) / 2.0f);
+    if (!LevelConfigure(&level, factionCount, planetCount, initialStarshipCapacity)) {
+        return false;
+    }
+
+    // The roster has to be in place first, since laying the level out hands the factions their starting planets.
+    LevelReadFactionInfo(&level, (const LevelPacketFactionInfo *)(data + sizeof(LevelStartGamePacket)), factionCount);
+
+    if (packet->mapHash != 0u) {
+        if (lobbyMap.data == NULL || lobbyMap.hash != packet->mapHash
+            || !MapFileApplyToLevel(&lobbyMap, &level, factionCount)) {
+            return false;
+        }
+    } else if (!GenerateRandomLevel(&level,
+            planetCount,
+            factionCount,
+            packet->minFleetCapacity,
+            packet->maxFleetCapacity,
+            packet->width,
+            packet->height,
+            (unsigned int)packet->seed)) {
+        return false;
+    }
+
+    *outLayoutHash = LevelComputeLayoutHash(&level);
+    return *outLayoutHash == packet->layoutHash;
+}
+
 /**
  * Handles a start game packet message received from the server.
- * Prepares the client to receive a new full state for gameplay.
+ * Lays the starting level out locally and starts playing on it,
+ * or, should it not match the server's, asks for the full level instead.
  * @param data Pointer to the packet data.
  * @param length Length of the packet data.
  */
@@ -1176,6 +1459,277 @@ static void HandleStartGamePacketMessage(const uint8_t *data, size_t length) {
 
     // Reset game over state so the upcoming match can trigger a fresh overlay.
     GameOverUIReset(&gameOverUI);
+
+    // Lay the level out ourselves from what the packet carries. Should that fail, or not come out
+    // exactly like the server's level (a different libm could round a planet's position differently, say),
+    // the full level is asked for instead, and the match starts once it arrives.
+    uint64_t layoutHash = 0;
+    if (!LayOutStartingLevel(data, length, &layoutHash)) {
+        printf("Starting level did not match the server's (hash %016llx, expected %016llx), requesting it.\n",
+            (unsigned long long)layoutHash, (unsigned long long)packet->layoutHash);
+        fullRequestPending = true;
+        fullRequestLayoutHash = layoutHash;
+        SendFullRequest();
+        return;
+    }
+
+    EnterGameWithLevel();
+}
+
+/**
+ * Frees the lobby's map file as it was being downloaded, if it was.
+ */
+static void ReleaseMapDownload(void) {
+    free(mapDownloadData);
+    free(mapDownloadChunkReceived);
+    mapDownloadData = NULL;
+    mapDownloadChunkReceived = NULL;
+    mapDownloadChunkCount = 0;
+    mapDownloadChunksReceived = 0;
+}
+
+/**
+ * Forgets the lobby's map file, closing it or abandoning its download,
+ * and goes back to previewing generated levels.
+ */
+static void ReleaseLobbyMap(void) {
+    MapFileClose(&lobbyMap);
+    ReleaseMapDownload();
+    lobbyMapHash = 0;
+    lobbyMapSize = 0;
+    lobbyMapPath[0] = '\0';
+    mapRequestTimer = 0.0f;
+    mapReadyTimer = 0.0f;
+    LobbyPreviewSetMapPath(&lobbyPreview, NULL);
+}
+
+/**
+ * Takes note of the map file the server announced for the lobby.
+ * If we have it cached already, it is opened and the server told so.
+ * Otherwise, downloading it from the server begins.
+ * @param mapHash Hash of the lobby's map file, or 0 if levels are generated.
+ * @param mapSize Size in bytes of the lobby's map file, or 0 if levels are generated.
+ */
+static void SetLobbyMap(uint64_t mapHash, uint32_t mapSize) {
+    // Lobby state arrives over and over, but the map rarely changes.
+    if (mapHash == lobbyMapHash && mapSize == lobbyMapSize) {
+        return;
+    }
+
+    ReleaseLobbyMap();
+    if (mapHash == 0u || mapSize == 0u) {
+        return;
+    }
+
+    lobbyMapHash = mapHash;
+    lobbyMapSize = mapSize;
+    if (!MapFileGetCachePath(mapHash, lobbyMapPath, sizeof(lobbyMapPath))) {
+        printf("Failed to find a place to keep map %016llx.\n", (unsigned long long)mapHash);
+        return;
+    }
+
+    // Cached maps are named after their hash, but a file can always have been
+    // changed or damaged since, so the hash is checked again rather than trusted.
+    if (MapFileOpen(lobbyMapPath, &lobbyMap) && lobbyMap.hash == mapHash && lobbyMap.size == (size_t)mapSize) {
+        LobbyPreviewSetMapPath(&lobbyPreview, lobbyMapPath);
+        SendMapReady();
+        return;
+    }
+    MapFileClose(&lobbyMap);
+
+    // We do not have the map, so ask the server for it, chunk by chunk.
+    mapDownloadChunkCount = ((size_t)mapSize + LEVEL_MAP_CHUNK_SIZE - 1u) / LEVEL_MAP_CHUNK_SIZE;
+    mapDownloadData = (uint8_t *)malloc((size_t)mapSize);
+    mapDownloadChunkReceived = (uint8_t *)calloc(mapDownloadChunkCount, sizeof(uint8_t));
+    if (mapDownloadData == NULL || mapDownloadChunkReceived == NULL) {
+        printf("Failed to allocate %u bytes to download map %016llx.\n", mapSize, (unsigned long long)mapHash);
+        ReleaseMapDownload();
+        return;
+    }
+
+    printf("Downloading map %016llx (%u bytes).\n", (unsigned long long)mapHash, mapSize);
+    SendMapRequests();
+}
+
+/**
+ * Shows how far along downloading the lobby's map file is in the lobby status message.
+ * Does nothing if no download is in progress.
+ */
+static void RefreshMapDownloadStatus(void) {
+    if (mapDownloadData == NULL || mapDownloadChunkCount == 0) {
+        return;
+    }
+
+    char status[64];
+    snprintf(status, sizeof(status), "Downloading map (%zu%%)...",
+        mapDownloadChunksReceived * 100u / mapDownloadChunkCount);
+    LobbyMenuUISetStatusMessage(&lobbyMenuUI, status);
+}
+
+/**
+ * Handles a map chunk packet message received from the server,
+ * storing the chunk and finishing the download once every chunk has arrived.
+ * @param data Pointer to the packet data.
+ * @param length Length of the packet data.
+ */
+static void HandleMapChunkPacketMessage(const uint8_t *data, size_t length) {
+    // Basic validation of input parameters.
+    if (data == NULL || length < sizeof(LevelMapChunkPacket)) {
+        return;
+    }
+
+    // Cast the data to a LevelMapChunkPacket and verify the type.
+    const LevelMapChunkPacket *packet = (const LevelMapChunkPacket *)data;
+    if (packet->type != LEVEL_PACKET_TYPE_MAP_CHUNK) {
+        return;
+    }
+
+    // Chunks may still trickle in for a map we have since finished, or that the lobby moved on from.
+    if (mapDownloadData == NULL || packet->mapHash != lobbyMapHash || packet->mapSize != lobbyMapSize
+        || (size_t)packet->chunkIndex >= mapDownloadChunkCount) {
+        return;
+    }
+
+    // Every chunk is full length, apart from possibly the last one.
+    size_t offset = (size_t)packet->chunkIndex * LEVEL_MAP_CHUNK_SIZE;
+    size_t expectedLength = (size_t)lobbyMapSize - offset;
+    if (expectedLength > LEVEL_MAP_CHUNK_SIZE) {
+        expectedLength = LEVEL_MAP_CHUNK_SIZE;
+    }
+    if ((size_t)packet->length != expectedLength || length < sizeof(LevelMapChunkPacket) + expectedLength) {
+        return;
+    }
+
+    // The same chunk can arrive twice if it was asked for again before it first arrived.
+    if (mapDownloadChunkReceived[packet->chunkIndex] != 0u) {
+        return;
+    }
+    memcpy(mapDownloadData + offset, packet->data, expectedLength);
+    mapDownloadChunkReceived[packet->chunkIndex] = 1u;
+    ++mapDownloadChunksReceived;
+
+    RefreshMapDownloadStatus();
+    if (mapDownloadChunksReceived == mapDownloadChunkCount) {
+        FinishMapDownload();
+    }
+}
+
+/**
+ * Checks the downloaded map file against its hash, then adds it to the map cache and opens it.
+ * A map that does not match its hash is thrown away and downloaded all over again.
+ */
+static void FinishMapDownload(void) {
+    size_t size = (size_t)lobbyMapSize;
+    if (MapFileHash(mapDownloadData, size) != lobbyMapHash || !MapFileValidate(mapDownloadData, size)) {
+        printf("Downloaded map %016llx does not match its hash; downloading it again.\n", (unsigned long long)lobbyMapHash);
+        memset(mapDownloadChunkReceived, 0, mapDownloadChunkCount);
+        mapDownloadChunksReceived = 0;
+        return;
+    }
+
+    // The map is opened from the cache rather than used from memory, so that it is
+    // laid out exactly the same way as a map that was already cached.
+    bool opened = MapFileWriteBytes(lobbyMapPath, mapDownloadData, size) && MapFileOpen(lobbyMapPath, &lobbyMap);
+    ReleaseMapDownload();
+    if (!opened) {
+        printf("Failed to keep downloaded map %016llx at %s.\n", (unsigned long long)lobbyMapHash, lobbyMapPath);
+        LobbyMenuUISetStatusMessage(&lobbyMenuUI, "Failed to save the map.");
+        return;
+    }
+
+    printf("Downloaded map %016llx.\n", (unsigned long long)lobbyMapHash);
+    LobbyMenuUISetStatusMessage(&lobbyMenuUI, "Waiting for host to start game.");
+    LobbyPreviewSetMapPath(&lobbyPreview, lobbyMapPath);
+    SendMapReady();
+}
+
+/**
+ * Keeps the lobby's map file downloading, asking again for chunks that have not arrived,
+ * and once we have it, keeps telling the server so.
+ * Must be called with the client state lock held.
+ * @param deltaTime The time elapsed since the last call, in seconds.
+ */
+static void UpdateLobbyMap(float deltaTime) {
+    if (mapDownloadData != NULL) {
+        mapRequestTimer += deltaTime;
+        if (mapRequestTimer >= CLIENT_MAP_REQUEST_INTERVAL) {
+            SendMapRequests();
+        }
+    } else if (lobbyMap.data != NULL) {
+        mapReadyTimer += deltaTime;
+        if (mapReadyTimer >= CLIENT_MAP_READY_INTERVAL) {
+            SendMapReady();
+        }
+    }
+}
+
+/**
+ * Asks the server for the chunks of the lobby's map file which have not arrived yet,
+ * in up to CLIENT_MAP_REQUEST_RUNS runs of up to LEVEL_MAP_MAX_CHUNKS_PER_REQUEST chunks each.
+ */
+static void SendMapRequests(void) {
+    mapRequestTimer = 0.0f;
+    if (!serverAddressValid || clientSocket == INVALID_SOCKET || mapDownloadData == NULL) {
+        return;
+    }
+
+    size_t chunk = 0;
+    for (int run = 0; run < CLIENT_MAP_REQUEST_RUNS; ++run) {
+        // Each run starts at the next chunk still missing.
+        while (chunk < mapDownloadChunkCount && mapDownloadChunkReceived[chunk] != 0u) {
+            ++chunk;
+        }
+        if (chunk >= mapDownloadChunkCount) {
+            break;
+        }
+
+        // Chunks in the run that did arrive are sent again, which is simpler than
+        // splitting the run up, and costs little since losses are rare.
+        LevelMapRequestPacket packet = {0};
+        packet.type = LEVEL_PACKET_TYPE_MAP_REQUEST;
+        packet.mapHash = lobbyMapHash;
+        packet.firstChunk = (uint32_t)chunk;
+        packet.chunkCount = LEVEL_MAP_MAX_CHUNKS_PER_REQUEST;
+
+        int result = sendto(clientSocket,
+            (const char *)&packet,
+            (int)sizeof(packet),
+            0,
+            (struct sockaddr *)&serverAddress,
+            (int)sizeof(serverAddress));
+
+        if (result == SOCKET_ERROR) {
+            printf("map request sendto failed: %d\n", WSAGetLastError());
+            return;
+        }
+
+        chunk += LEVEL_MAP_MAX_CHUNKS_PER_REQUEST;
+    }
+}
+
+/**
+ * Tells the server that we have the lobby's map file.
+ */
+static void SendMapReady(void) {
+    mapReadyTimer = 0.0f;
+    if (!serverAddressValid || clientSocket == INVALID_SOCKET || lobbyMap.data == NULL) {
+        return;
+    }
+
+    LevelMapReadyPacket packet = {0};
+    packet.type = LEVEL_PACKET_TYPE_MAP_READY;
+    packet.mapHash = lobbyMap.hash;
+
+    int result = sendto(clientSocket,
+        (const char *)&packet,
+        (int)sizeof(packet),
+        0,
+        (struct sockaddr *)&serverAddress,
+        (int)sizeof(serverAddress));
+
+    if (result == SOCKET_ERROR) {
+        printf("map ready sendto failed: %d\n", WSAGetLastError());
+    }
 }
 
 /**
@@ -1257,8 +1811,12 @@ static void ProcessNetworkMessages(void) {
             HandleFleetLaunchPacketMessage(payload, payloadSize);
         } else if (packetType == LEVEL_PACKET_TYPE_LOBBY_STATE) {
             HandleLobbyStatePacketMessage(payload, payloadSize);
+        } else if (packetType == LEVEL_PACKET_TYPE_LOBBY_DELTA) {
+            HandleLobbyDeltaPacketMessage(payload, payloadSize);
         } else if (packetType == LEVEL_PACKET_TYPE_START_GAME) {
             HandleStartGamePacketMessage(payload, payloadSize);
+        } else if (packetType == LEVEL_PACKET_TYPE_MAP_CHUNK) {
+            HandleMapChunkPacketMessage(payload, payloadSize);
         } else if (packetType == LEVEL_PACKET_TYPE_SERVER_DISCONNECT) {
             HandleServerDisconnectPacketMessage(payload, payloadSize);
             break;
@@ -1432,6 +1990,58 @@ static void SendLobbySharedControlUpdate(int factionId, int sharedControlNumber)
     }
 }
 
+/**
+ * Asks the server for the full lobby state,
+ * used when a lobby delta arrives that we cannot apply.
+ */
+static void SendLobbyResyncRequest(void) {
+    if (!serverAddressValid || clientSocket == INVALID_SOCKET) {
+        return;
+    }
+
+    LevelLobbyResyncPacket packet = {0};
+    packet.type = LEVEL_PACKET_TYPE_LOBBY_RESYNC;
+    packet.revision = lobbyRevision;
+
+    int result = sendto(clientSocket,
+        (const char *)&packet,
+        (int)sizeof(packet),
+        0,
+        (struct sockaddr *)&serverAddress,
+        (int)sizeof(serverAddress));
+
+    if (result == SOCKET_ERROR) {
+        printf("lobby resync sendto failed: %d\n", WSAGetLastError());
+    }
+}
+
+/**
+ * Asks the server for the full level state,
+ * used when the starting level we laid out ourselves does not match the server's,
+ * or when a match has started without us ever receiving the start game packet.
+ */
+static void SendFullRequest(void) {
+    fullRequestTimer = 0.0f;
+    if (!serverAddressValid || clientSocket == INVALID_SOCKET) {
+        return;
+    }
+
+    LevelFullRequestPacket packet = {0};
+    packet.type = LEVEL_PACKET_TYPE_FULL_REQUEST;
+    packet.layoutHash = fullRequestLayoutHash;
+
+    int result = sendto(clientSocket,
+        (const char *)&packet,
+        (int)sizeof(packet),
+        0,
+        (struct sockaddr *)&serverAddress,
+        (int)sizeof(serverAddress));
+
+    if (result == SOCKET_ERROR) {
+        printf("full request sendto failed: %d\n", WSAGetLastError());
+    }
+}
+
 /**
  * Processes a connect request from the menu UI.
  * Validates the input IP address and port,
@@ -1565,6 +2175,9 @@ static void ProcessMenuConnectRequest(void) {
 /**
  * Renders a single frame of the client.
  * Draws the background, planets, starships, trails, and UI elements.
+ * The level is drawn from the latest snapshot published by the simulation thread,
+ * without holding the client state lock, which is only taken for the small parts
+ * of the frame drawn straight from the shared client state, like the menus.
  * @param fps The current frames per second, used for the FPS display.
  */
 static void RenderFrame(float fps) {
@@ -1573,6 +2186,9 @@ static void RenderFrame(float fps) {
         return;
     }
 
+    // Start counting draw calls and vertices for this frame.
+    RenderBatchBeginFrame();
+
     // Clear the screen to the background color.
     glClearColor(BACKGROUND_COLOR_R, BACKGROUND_COLOR_G, BACKGROUND_COLOR_B, BACKGROUND_COLOR_A);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -1581,42 +2197,140 @@ static void RenderFrame(float fps) {
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
 
+    // Take what we need to draw the level from the shared client state up front,
+    // so that the lock is not held while the level itself is drawn.
+    EnterCriticalSection(&clientStateLock);
+    bool drawingLevel = currentStage == CLIENT_STAGE_GAME && levelInitialized;
+    CameraState camera = cameraState;
+    LeaveCriticalSection(&clientStateLock);
+
+    // Bring our copy of the level up to date with the latest tick of the simulation,
+    // then move each starship to where it would be right now, between the last two ticks.
+    // This has the level drawn a single tick behind the simulation, in exchange for starships
+    // moving smoothly however the frame rate and the tick rate happen to line up.
+    if (drawingLevel) {
+        int64_t snapshotTicks = 0;
+        drawingLevel = LevelSnapshotBufferAcquire(&levelSnapshots, &renderLevel, &snapshotTicks);
+        if (drawingLevel) {
+            float ticksPerSimulationTick = (float)tickFrequency / (float)CLIENT_SIMULATION_TICK_RATE;
+            LevelInterpolateStarships(&renderLevel, (float)(GetTicks() - snapshotTicks) / ticksPerSimulationTick);
+        }
+    }
+
     // If we have a valid window size, draw the game elements.
     if (openglContext.width > 0 && openglContext.height > 0) {
-        // Add a soft glow gradient to the background.
-        DrawBackgroundGradient(openglContext.width, openglContext.height);
+        bool culled = false;
+        bool layered = false;
+
+        if (drawingLevel) {
+            // Tessellate world shapes for the size they appear on screen,
+            // and pick how much detail starships and trails are drawn with.
+            RenderSetDetailScale(camera.zoom);
+
+            // Culling and bringing the static layer up to date count toward drawing planets,
+            // since that is mostly what both of them are spent on.
+            ProfilerMarker planetMarker = ProfilerBegin(PROFILER_ZONE_DRAW_PLANETS);
+
+            // Work out what is actually inside the camera's view,
+            // so that we only draw the planets, trails and ships the player can see.
+            // Should culling fail for whatever reason, we fall back to drawing everything.
+            CullingRect viewRect = CullingRectFromCamera(&camera,
+                (float)openglContext.width, (float)openglContext.height);
+            culled = CullLevel(&renderLevel, &viewRect, &visiblePlanets, &visibleTrails, &visibleStarships, &cullingStats);
+            if (!culled) {
+                cullingStats.visiblePlanets = cullingStats.totalPlanets = renderLevel.planetCount;
+                cullingStats.visibleTrails = cullingStats.totalTrails = renderLevel.trailEffectCount;
+                cullingStats.visibleStarships = cullingStats.totalStarships = renderLevel.starshipCount;
+            }
+
+            // The background and every planet that has not changed in a while come from the static layer,
+            // which only draws again what changed since the last frame.
+            layered = StaticLayerCompose(&staticLayer, &renderLevel, &camera, openglContext.width, openglContext.height,
+                culled ? visiblePlanets.indices : NULL, cullingStats.visiblePlanets);
+            ProfilerEnd(&planetMarker);
+        }
+
+        // Add a soft glow gradient to the background, unless the static layer already holds it.
+        if (!layered) {
+            DrawBackgroundGradient(openglContext.width, openglContext.height);
+        }
 
         // Depending on the current stage, draw either the game or the menu UI.
-        if (currentStage == CLIENT_STAGE_GAME && levelInitialized) {
+        if (drawingLevel) {
             // Save the current matrix state.
             glPushMatrix();
 
             // Then apply the current camera settings to update the view.
-            ApplyCameraTransform();
-
-            // Draw each planet in the level.
-            for (size_t i = 0; i < level.planetCount; ++i) {
-                PlanetDraw(&level.planets[i]);
+            ApplyCameraTransform(&camera);
+
+            // Everything in the world is drawn in a sorted pass, so that objects switching back
+            // and forth between blend modes (such as ship glows and ship discs) only cost
+            // one state change per layer and mode rather than one per object.
+            RenderBatchBeginSortedPass();
+            StarshipDetailLevel shipDetail = StarshipDetailLevelForZoom(camera.zoom);
+            size_t trailStride = StarshipTrailStrideForZoom(camera.zoom);
+
+            // Draw each visible planet in the level that is not already part of the static layer.
+            ProfilerMarker planetMarker = ProfilerBegin(PROFILER_ZONE_DRAW_PLANETS);
+            for (size_t n = 0; n < cullingStats.visiblePlanets; ++n) {
+                size_t i = culled ? visiblePlanets.indices[n] : n;
+                if (layered && StaticLayerIsPlanetBaked(&staticLayer, i)) {
+                    continue;
+                }
+                PlanetDrawCached(&renderLevel.planets[i], renderLevel.planetRenderCaches != NULL ? &renderLevel.planetRenderCaches[i] : NULL);
             }
 
             // Draw selection highlights around selected planets.
-            DrawSelectionHighlights();
-
-            // Draw each starship trail effect.
-            for (size_t i = 0; i < level.trailEffectCount; ++i) {
-                StarshipTrailEffectDraw(&level.trailEffects[i]);
+            // The selection is shared with the simulation thread, which resets it when a new level arrives.
+            EnterCriticalSection(&clientStateLock);
+            DrawSelectionHighlights(&renderLevel);
+            LeaveCriticalSection(&clientStateLock);
+            ProfilerEnd(&planetMarker);
+
+            // Draw every visible trail, both those left behind by destroyed ships
+            // and those of ships still flying, in a single pass with one set of render state.
+            // Blobs have no trails, so ship trails are skipped when zoomed that far out.
+            ProfilerMarker trailMarker = ProfilerBegin(PROFILER_ZONE_DRAW_TRAILS);
+            StarshipDrawTrails(renderLevel.starships, renderLevel.fleets, culled ? visibleStarships.indices : NULL,
+                shipDetail == STARSHIP_DETAIL_BLOB ? 0 : cullingStats.visibleStarships,
+                renderLevel.trailEffects, culled ? visibleTrails.indices : NULL,
+                cullingStats.visibleTrails, trailStride);
+            ProfilerEnd(&trailMarker);
+
+            // Draw each visible starship in the level.
+            // When zoomed far out, ships of the same fleet are merged into blobs instead.
+            ProfilerMarker shipMarker = ProfilerBegin(PROFILER_ZONE_DRAW_SHIPS);
+            if (shipDetail == STARSHIP_DETAIL_BLOB) {
+                StarshipDrawFleetBlobs(renderLevel.starships, renderLevel.fleets, culled ? visibleStarships.indices : NULL,
+                    cullingStats.visibleStarships, camera.zoom);
+            } else {
+                for (size_t n = 0; n < cullingStats.visibleStarships; ++n) {
+                    size_t i = culled ? visibleStarships.indices[n] : n;
+                    const Starship *ship = &renderLevel.starships[i];
+                    StarshipDrawHull(ship, &renderLevel.fleets[ship->fleetIndex], shipDetail, camera.zoom);
+                }
             }
+            ProfilerEnd(&shipMarker);
 
-            // Draw each starship in the level.
-            for (size_t i = 0; i < level.starshipCount; ++i) {
-                StarshipDraw(&level.starships[i]);
-            }
+            // Submit everything batched so far while the camera transform is still applied.
+            // Everything above only filled the batch; this is where it actually goes to OpenGL.
+            ProfilerMarker submitMarker = ProfilerBegin(PROFILER_ZONE_DRAW_SUBMIT);
+            RenderBatchEndSortedPass();
+            RenderBatchFlush();
+            ProfilerEnd(&submitMarker);
+
+            // Anything drawn from here on is in screen space, so back to full detail.
+            RenderSetDetailScale(1.0f);
 
             // Restore the previous matrix state.
             glPopMatrix();
         }
     }
 
+    // The rest of the frame is drawn straight from the shared client state.
+    ProfilerMarker uiMarker = ProfilerBegin(PROFILER_ZONE_DRAW_UI);
+    EnterCriticalSection(&clientStateLock);
+
     // What we draw depends on the current client stage.
     if (currentStage == CLIENT_STAGE_GAME) {
         // In case we are doing box selection, draw the selection box.
@@ -1626,14 +2340,23 @@ static void RenderFrame(float fps) {
         int textPositionFromTop = 20;
         int textPositionFromLeft = 10;
         if (levelInitialized && openglContext.width >= textPositionFromLeft && openglContext.height >= textPositionFromTop) {
-            char infoString[160];
+            char infoString[384];
             int selectionCount = selectionState.count;
             int factionId = assignedFactionId >= 0 ? assignedFactionId : -1;
+
+            // The batch counters cover everything drawn before the overlay.
+            RenderBatchStats batchStats = RenderBatchGetStats();
             snprintf(infoString, sizeof(infoString),
-                "FPS: %.0f\nFaction ID: %d\nNumber of Selected Planets: %d",
+                "FPS: %.0f\nFaction ID: %d\nNumber of Selected Planets: %d\nDraw Calls: %zu\nVertices: %zu"
+                "\nVisible Planets: %zu/%zu\nVisible Ships: %zu/%zu\nVisible Trails: %zu/%zu",
                 fps,
                 factionId,
-                selectionCount);
+                selectionCount,
+                batchStats.drawCalls,
+                batchStats.vertexCount,
+                cullingStats.visiblePlanets, cullingStats.totalPlanets,
+                cullingStats.visibleStarships, cullingStats.totalStarships,
+                cullingStats.visibleTrails, cullingStats.totalTrails);
 
             float textColor[4] = {1.0f, 1.0f, 1.0f, 1.0f};
             float textSize = 16.0f;
@@ -1653,15 +2376,152 @@ static void RenderFrame(float fps) {
         GameOverUIDraw(&gameOverUI, &openglContext, openglContext.width, openglContext.height);
     }
 
+    LeaveCriticalSection(&clientStateLock);
+
+    // The profiler overlay goes over absolutely everything else.
+    if (profilerOverlayVisible) {
+        ProfilerDrawOverlay(&openglContext, (float)openglContext.width - PROFILER_OVERLAY_WIDTH - 10.0f, 10.0f);
+    }
+
+    // Make sure nothing is left waiting in the render batch.
+    RenderBatchFlush();
+    ProfilerEnd(&uiMarker);
+
     // Swap the front and back buffers to display the rendered frame.
     // There's two buffers, one being displayed while the other is drawn to.
     // Swapping them makes the newly drawn frame visible, while taking the
     // previously displayed buffer off-screen for the next frame's drawing.
+    ProfilerMarker swapMarker = ProfilerBegin(PROFILER_ZONE_SWAP_BUFFERS);
     SwapBuffers(openglContext.deviceContext);
+    ProfilerEnd(&swapMarker);
+}
+
+/**
+ * Runs a single tick of the simulation.
+ * Keeps track of how long the server has been silent, updates the level,
+ * and checks whether the match has ended.
+ * Must be called with the client state lock held.
+ * @param deltaTime The length of a tick, in seconds.
+ */
+static void SimulationTick(float deltaTime) {
+    // Update the time since we last received a packet from the server.
+    if (clientSocket != INVALID_SOCKET && serverAddressValid) {
+        timeSinceLastServerPacket += deltaTime;
+        if (timeSinceLastServerPacket >= SERVER_TIMEOUT_SECONDS) {
+            ResetConnectionToMenu("Disconnected: server timed out.");
+        }
+    }
+
+    // Keep the lobby's map file downloading, or keep telling the server we have it.
+    if (currentStage == CLIENT_STAGE_LOBBY) {
+        UpdateLobbyMap(deltaTime);
+    }
+
+    // Keep asking for the full level until it arrives, in case the request or the level itself was lost.
+    if (fullRequestPending) {
+        fullRequestTimer += deltaTime;
+        if (fullRequestTimer >= CLIENT_FULL_REQUEST_INTERVAL) {
+            SendFullRequest();
+        }
+    }
+
+    // We only have a level to update in the game stage.
+    if (currentStage == CLIENT_STAGE_GAME) {
+        // If we have a level, we must update the level state.
+        // However, if the game is over, we stop updating the level
+        // to freeze the final state for player inspection.
+        if (!gameOverActive && levelInitialized) {
+            ProfilerMarker updateMarker = ProfilerBegin(PROFILER_ZONE_LEVEL_UPDATE);
+            LevelUpdate(&level, deltaTime);
+            ProfilerEnd(&updateMarker);
+
+            // One cue per planet for whatever arrived there this tick.
+            LevelPlayAudioEvents(&level);
+        }
+
+        // Detect match completion after applying the latest updates.
+        UpdateGameOverOverlay();
+    }
+}
+
+/**
+ * Entry point of the simulation thread.
+ * Processes network messages and runs simulation ticks at a fixed CLIENT_SIMULATION_TICK_RATE,
+ * sleeping in between, and publishes a snapshot of the level for the window thread to draw
+ * each time it wakes up. Because the tick length never changes, the simulation behaves the same
+ * no matter how quickly or slowly frames are drawn.
+ * Runs until running is set to false.
+ * @param parameter Unused.
+ * @return Always 0.
+ */
+static DWORD WINAPI SimulationThreadMain(LPVOID parameter) {
+    (void)parameter;
+
+    // Length of a single tick, both in performance counter ticks and in seconds.
+    int64_t ticksPerSimulationTick = tickFrequency / CLIENT_SIMULATION_TICK_RATE;
+    if (ticksPerSimulationTick < 1) {
+        ticksPerSimulationTick = 1;
+    }
+    float simulationTickSeconds = 1.0f / (float)CLIENT_SIMULATION_TICK_RATE;
+
+    // Performance counter value at which the next tick is due.
+    int64_t nextTickTicks = GetTicks();
+
+    for (;;) {
+        // Sleep until the next tick is due.
+        // Should less than a millisecond remain, Sleep(0) just gives up the rest of our time slice.
+        int64_t currentTicks = GetTicks();
+        if (currentTicks < nextTickTicks) {
+            Sleep((DWORD)((nextTickTicks - currentTicks) * 1000 / tickFrequency));
+            continue;
+        }
+
+        // If we have fallen far behind, we skip the ticks we missed rather than
+        // running all of them back to back, which would only put us further behind.
+        if (currentTicks - nextTickTicks > ticksPerSimulationTick * CLIENT_SIMULATION_MAX_CATCHUP_TICKS) {
+            nextTickTicks = currentTicks;
+        }
+
+        EnterCriticalSection(&clientStateLock);
+        bool keepRunning = running;
+        if (keepRunning) {
+            // Process any incoming network messages from the server.
+            ProfilerMarker networkMarker = ProfilerBegin(PROFILER_ZONE_NETWORK);
+            ProcessNetworkMessages();
+            ProfilerEnd(&networkMarker);
+
+            // Run every tick that is due by now.
+            int64_t lastTickTicks = nextTickTicks;
+            while (nextTickTicks <= currentTicks) {
+                SimulationTick(simulationTickSeconds);
+                lastTickTicks = nextTickTicks;
+                nextTickTicks += ticksPerSimulationTick;
+            }
+
+            // Hand the result to the window thread, stamped with the time of the tick it belongs to,
+            // so that it can tell how far past that tick it is when it draws.
+            ProfilerMarker snapshotMarker = ProfilerBegin(PROFILER_ZONE_SNAPSHOT);
+            bool hasLevel = currentStage == CLIENT_STAGE_GAME && levelInitialized;
+            LevelSnapshotBufferPublish(&levelSnapshots, hasLevel ? &level : NULL, lastTickTicks);
+            ProfilerEnd(&snapshotMarker);
+        }
+        LeaveCriticalSection(&clientStateLock);
+
+        if (!keepRunning) {
+            break;
+        }
+    }
+
+    return 0;
 }
 
 /**
  * Window procedure that handles messages sent to the window.
+ * The messages the client handles itself read and change state shared with the simulation thread,
+ * so they are handled by HandleWindowMessage with the client state lock held.
+ * Every other message goes straight to DefWindowProc without the lock, because some of them
+ * (such as the user grabbing the title bar to move the window) run a loop inside DefWindowProc
+ * lasting until the user lets go, and the simulation should keep running in the meantime.
  * @param window_handle Handle to the window.
  * @param msg The message.
  * @param wParam Additional message information.
@@ -1669,6 +2529,40 @@ static void RenderFrame(float fps) {
  * @return The result of the message processing and depends on the message sent.
 */
 LRESULT CALLBACK WindowProcessMessage(HWND window_handle, UINT msg, WPARAM wParam, LPARAM lParam) {
+    switch (msg) {
+        case WM_CLOSE:
+        case WM_DESTROY:
+        case WM_PAINT:
+        case WM_SIZE:
+        case WM_LBUTTONDOWN:
+        case WM_MOUSEMOVE:
+        case WM_LBUTTONUP:
+        case WM_RBUTTONDOWN:
+        case WM_MOUSEWHEEL:
+        case WM_KEYDOWN:
+        case WM_CHAR: {
+            // The lock may be entered again by the same thread, as happens when
+            // WM_CLOSE destroys the window and WM_DESTROY is handled before WM_CLOSE returns.
+            EnterCriticalSection(&clientStateLock);
+            LRESULT result = HandleWindowMessage(window_handle, msg, wParam, lParam);
+            LeaveCriticalSection(&clientStateLock);
+            return result;
+        }
+        default:
+            return DefWindowProc(window_handle, msg, wParam, lParam);
+    }
+}
+
+/**
+ * Handles the messages sent to the window that the client cares about.
+ * Must be called with the client state lock held, see WindowProcessMessage.
+ * @param window_handle Handle to the window.
+ * @param msg The message.
+ * @param wParam Additional message information.
+ * @param lParam Additional message information.
+ * @return The result of the message processing and depends on the message sent.
+*/
+static LRESULT HandleWindowMessage(HWND window_handle, UINT msg, WPARAM wParam, LPARAM lParam) {
     switch (msg) {
         // WM_CLOSE is sent when the user tries to close the window.
         // Compared to WM_DESTROY, this message can be ignored or canceled.
@@ -2018,6 +2912,21 @@ LRESULT CALLBACK WindowProcessMessage(HWND window_handle, UINT msg, WPARAM wPara
         // lParam contains additional information about the key event.
         case WM_KEYDOWN: {
 
+            // The profiler keys work everywhere, even over the game-over overlay.
+            // F3 shows or hides the frame timing overlay, and F4 writes out a trace of recent frames.
+            if (wParam == VK_F3) {
+                profilerOverlayVisible = !profilerOverlayVisible;
+                return 0;
+            }
+            if (wParam == VK_F4) {
+                if (ProfilerWriteChromeTrace(CLIENT_PROFILER_TRACE_PATH)) {
+                    printf("Wrote profiler trace to %s.\n", CLIENT_PROFILER_TRACE_PATH);
+                } else {
+                    printf("Failed to write profiler trace to %s.\n", CLIENT_PROFILER_TRACE_PATH);
+                }
+                return 0;
+            }
+
             // Ignore gameplay hotkeys while the game-over overlay is visible.
             if (GameOverOverlayConsumesInput()) {
                 return 0;
@@ -2127,6 +3036,66 @@ LRESULT CALLBACK WindowProcessMessage(HWND window_handle, UINT msg, WPARAM wPara
     }
 }
 
+/**
+ * Picks the sound backend asked for on the command line.
+ * See CLIENT_NO_SOUND_OPTION and CLIENT_SOUND_FILE_OPTION for the options understood.
+ * @param commandLine The command line, excluding the program name. May be NULL.
+ * @param outPath Receives the WAV file path if the WAV file backend is picked, or an empty string otherwise.
+ * @param outPathSize The size of outPath in bytes.
+ * @return The backend to play sound through.
+ */
+static SoundBackend *SelectSoundBackend(const char *commandLine, char *outPath, size_t outPathSize) {
+    if (outPath != NULL && outPathSize > 0) {
+        outPath[0] = '\0';
+    }
+    if (commandLine == NULL) {
+        return &SOUND_WAVE_OUT_BACKEND;
+    }
+
+    if (strstr(commandLine, CLIENT_NO_SOUND_OPTION) != NULL) {
+        return &SOUND_NULL_BACKEND;
+    }
+
+    const char *fileOption = strstr(commandLine, CLIENT_SOUND_FILE_OPTION);
+    if (fileOption != NULL && outPath != NULL && outPathSize > 0) {
+        // The path is whatever follows the option, up to the next space.
+        const char *path = fileOption + strlen(CLIENT_SOUND_FILE_OPTION);
+        while (*path == ' ') {
+            ++path;
+        }
+        size_t length = strcspn(path, " ");
+        if (length > 0 && length < outPathSize) {
+            memcpy(outPath, path, length);
+            outPath[length] = '\0';
+            return &SOUND_WAV_FILE_BACKEND;
+        }
+        printf("Ignoring %s without a usable path; playing sound normally.\n", CLIENT_SOUND_FILE_OPTION);
+    }
+
+    return &SOUND_WAVE_OUT_BACKEND;
+}
+
+/**
+ * Runs the sound synthesis benchmark, once dry and once with reverb, and prints the results.
+ * See CLIENT_SOUND_BENCHMARK_OPTION.
+ */
+static void RunSoundBenchmark(void) {
+    printf("Rendering %.0f seconds of sound cues, dry and with reverb...\n", CLIENT_SOUND_BENCHMARK_SECONDS);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        bool withReverb = pass == 1;
+        SoundSynthesisBenchmark result;
+        if (!SoundManagerBenchmarkSynthesis(CLIENT_SOUND_BENCHMARK_SECONDS, withReverb, &result)) {
+            printf("%-7s benchmark failed.\n", withReverb ? "Reverb" : "Dry");
+            continue;
+        }
+
+        printf("%-7s %llu samples in %.3f s: %.0f samples/s, %.1fx real time\n",
+            withReverb ? "Reverb" : "Dry", (unsigned long long)result.samplesRendered,
+            result.elapsedSeconds, result.samplesPerSecond, result.realTimeFactor);
+    }
+}
+
 /**
  * Starting point for the program.
  * @param hInstance Handle to the current instance of the program.
@@ -2140,14 +3109,39 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
     // Force printf to flush immediately
     setvbuf(stdout, NULL, _IONBF, 0);
 
-    // Suppresses -Wunused-parameter warning for hPrevInstance and pCmdLine
+    // Suppresses -Wunused-parameter warning for hPrevInstance
     (void)hPrevInstance;
-    (void)pCmdLine;
+
+    // The sound benchmark needs no window, server, or anything else, so it runs and exits right away.
+    if (pCmdLine != NULL && strstr(pCmdLine, CLIENT_SOUND_BENCHMARK_OPTION) != NULL) {
+        RunSoundBenchmark();
+        return EXIT_SUCCESS;
+    }
+
+    // So does the determinism replay, whose hashes must match the server's.
+    if (pCmdLine != NULL && strstr(pCmdLine, CLIENT_DETERMINISM_REPLAY_OPTION) != NULL) {
+        return RunDeterminismReplay(false, NULL) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (pCmdLine != NULL && strstr(pCmdLine, CLIENT_DETERMINISM_RECORD_OPTION) != NULL) {
+        return RunDeterminismReplay(true, NULL) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Start the profiler before anything it times, including the simulation thread, gets going.
+    ProfilerInitialize();
+
+    // Initialize the lock guarding the client state before anything can use it.
+    // The window procedure takes it, and the window starts receiving messages as soon as it is created.
+    InitializeCriticalSection(&clientStateLock);
 
     // Initialize the level structure
     // so that it is ready to be used when we receive data from the server.
     LevelInit(&level);
 
+    // Likewise for the snapshots handed from the simulation thread to the window thread,
+    // and the window thread's own copy of the level which it draws.
+    LevelSnapshotBufferInitialize(&levelSnapshots);
+    LevelInit(&renderLevel);
+
     // Initialize the camera state.
     CameraInitialize(&cameraState);
     cameraState.minZoom = CAMERA_MIN_ZOOM;
@@ -2240,13 +3234,28 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
         return EXIT_FAILURE;
     }
 
-    // Initialize the sound manager so gameplay cues can be played.
-    SoundManagerInitialize();
+    // Initialize the sound manager so gameplay cues can be played,
+    // through whichever backend the command line asked for.
+    char soundFilePath[MAX_PATH];
+    SoundBackend *soundBackend = SelectSoundBackend(pCmdLine, soundFilePath, sizeof(soundFilePath));
+    SoundManagerInitialize(soundBackend, soundFilePath);
 
     // Set up timing variables for the main loop's delta time calculation.
     previousTicks = GetTicks();
     tickFrequency = GetTickFrequency();
 
+    // Ask Windows for timers accurate to a millisecond, so the simulation thread wakes up
+    // close to when its next tick is due rather than up to 16 milliseconds late.
+    timeBeginPeriod(1);
+
+    // Start simulating on a thread of our own, see SimulationThreadMain.
+    // If the thread cannot be created, there is no point in opening the main loop either.
+    simulationThread = CreateThread(NULL, 0, SimulationThreadMain, NULL, 0, NULL);
+    if (simulationThread == NULL) {
+        printf("CreateThread failed: %lu\n", (unsigned long)GetLastError());
+        running = false;
+    }
+
     // Set the cursor to be a regular arrow cursor.
     SetCursor(LoadCursor(NULL, IDC_ARROW));
 
@@ -2264,13 +3273,20 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
             DispatchMessage(&message);
         }
 
+        // Calculate delta time since the last frame.
+        int64_t currentTicks = GetTicks();
+        float deltaTime = (float)(currentTicks - previousTicks) / (float)tickFrequency;
+        previousTicks = currentTicks;
+
+        // Everything up until drawing touches client state shared with the simulation thread.
+        // Network messages, the server timeout and level updates are all handled over there,
+        // see SimulationThreadMain.
+        EnterCriticalSection(&clientStateLock);
+
         // Process any connect requests from the menu UI.
         // If we are not in the menu stage, this will do essentially nothing
         ProcessMenuConnectRequest();
 
-        // Process any incoming network messages from the server.
-        ProcessNetworkMessages();
-
         // Send any committed lobby color updates.
         if (currentStage == CLIENT_STAGE_LOBBY) {
             int factionId = -1;
@@ -2302,35 +3318,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
             }
         }
 
-        // Calculate delta time since the last frame.
-        int64_t currentTicks = GetTicks();
-        float deltaTime = (float)(currentTicks - previousTicks) / (float)tickFrequency;
-        previousTicks = currentTicks;
-
-        // Update the time since we last received a packet from the server.
-        if (clientSocket != INVALID_SOCKET && serverAddressValid && deltaTime > 0.0f) {
-            timeSinceLastServerPacket += deltaTime;
-            if (timeSinceLastServerPacket >= SERVER_TIMEOUT_SECONDS) {
-                ResetConnectionToMenu("Disconnected: server timed out.");
-            }
-        }
-
-        // We only have the concept of a camera in the game stage,
-        // and likewise we only have a level to update in the game stage.
+        // We only have the concept of a camera in the game stage.
         if (currentStage == CLIENT_STAGE_GAME) {
             // Always update the camera so players can inspect the final state.
             UpdateCamera(window_handle, deltaTime);
 
-            // If we have a level and time has passed, we must update the level state.
-            // However, if the game is over, we stop updating the level
-            // to freeze the final state for player inspection.
-            if (!gameOverActive && levelInitialized && deltaTime > 0.0f) {
-                LevelUpdate(&level, deltaTime);
-            }
-
-            // Detect match completion after applying the latest updates.
-            UpdateGameOverOverlay();
-
             // Consume the overlay action so the player can dismiss it.
             GameOverUIConsumeAction(&gameOverUI);
         } else if (currentStage == CLIENT_STAGE_LOBBY) {
@@ -2353,6 +3345,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
                 &openglContext);
         }
 
+        LeaveCriticalSection(&clientStateLock);
+
         // Calculate frames per second (FPS) for display.
         float fps = 0.0f;
         if (deltaTime > 0.0001f) {
@@ -2361,13 +3355,34 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
 
         // Now that we've updated and processed everything, its time to render the frame.
         RenderFrame(fps);
+
+        // With the frame on screen, its timings are complete.
+        ProfilerEndFrame();
     }
 
     // At this point, we are exiting the main loop and need to clean up resources.
+    // The simulation thread stops at its next tick now that running is false,
+    // after which this is the only thread left touching the client state.
+    if (simulationThread != NULL) {
+        WaitForSingleObject(simulationThread, INFINITE);
+        CloseHandle(simulationThread);
+        simulationThread = NULL;
+    }
+    timeEndPeriod(1);
+
     PlayerSelectionFree(&selectionState);
     PlayerControlGroupsFree(&controlGroups);
     LevelRelease(&level);
+    LevelRelease(&renderLevel);
+    LevelSnapshotBufferRelease(&levelSnapshots);
+    ReleaseLobbyMap();
     LobbyPreviewRelease(&lobbyPreview);
+    CullingIndexListRelease(&visiblePlanets);
+    CullingIndexListRelease(&visibleTrails);
+    CullingIndexListRelease(&visibleStarships);
+    RenderBatchRelease();
+    RenderReleaseTextCache();
+    StaticLayerRelease(&staticLayer);
 
     // Disable sound playback before releasing other OS resources.
     SoundManagerShutdown();
@@ -2378,5 +3393,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
     WSACleanup();
 
     OpenGLShutdownForWindow(&openglContext, window_handle);
+    DeleteCriticalSection(&clientStateLock);
+    ProfilerShutdown();
     return EXIT_SUCCESS;
 }
@@ -21,6 +21,7 @@
 #include <ctype.h>
 
 #include "Utilities/networkUtilities.h"
+#include "Utilities/mapFileUtilities.h"
 #include "Objects/level.h"
 #include "Utilities/gameUtilities.h"
 #include "Utilities/renderUtilities.h"
@@ -29,6 +30,11 @@
 #include "Utilities/openglUtilities.h"
 #include "Utilities/playerInterfaceUtilities.h"
 #include "Utilities/cameraUtilities.h"
+#include "Utilities/cullingUtilities.h"
+#include "Utilities/staticLayerUtilities.h"
+#include "Utilities/levelSnapshotUtilities.h"
+#include "Utilities/profilerUtilities.h"
+#include "Utilities/profilerOverlayUtilities.h"
 #include "Utilities/MenuUtilities/loginMenuUtilities.h"
 #include "Utilities/MenuUtilities/lobbyMenuUtilities.h"
 #include "Objects/player.h"
@@ -63,6 +69,52 @@
 // Time in milliseconds to wait before considering the server unresponsive.
 #define SERVER_TIMEOUT_MS 60000
 
+// Number of times per second the simulation thread processes network messages and updates the level.
+// Drawing happens on its own thread at whatever rate it manages, in between these ticks.
+#define CLIENT_SIMULATION_TICK_RATE 60
+
+// Most ticks the simulation thread will run back to back to catch up after falling behind,
+// for instance after the process was suspended. Any ticks beyond this are skipped.
+#define CLIENT_SIMULATION_MAX_CATCHUP_TICKS 5
+
+// File the profiler trace is written to when F4 is pressed, relative to the working directory.
+#define CLIENT_PROFILER_TRACE_PATH "client_trace.json"
+
+// Command line options picking where the client's sound goes.
+// By default it plays through the audio device. "--no-sound" turns sound off entirely,
+// and "--sound-file <path>" writes everything that would have been heard to a WAV file instead.
+#define CLIENT_NO_SOUND_OPTION "--no-sound"
+#define CLIENT_SOUND_FILE_OPTION "--sound-file"
+
+// Command line option which, rather than starting the game, measures how quickly sound cues
+// can be rendered, prints the results, and exits. See SoundManagerBenchmarkSynthesis.
+// The benchmark renders this many seconds of audio, once dry and once with reverb.
+#define CLIENT_SOUND_BENCHMARK_OPTION "--sound-benchmark"
+#define CLIENT_SOUND_BENCHMARK_SECONDS 60.0f
+
+// Command line options which, rather than starting the game, run the determinism replay and exit.
+// See RunDeterminismReplay. "--determinism-replay" checks the state hashes the replay produces
+// against the expected ones and exits with a failure code should any differ,
+// while "--determinism-record" prints them, for updating the expected hashes after an intended change.
+#define CLIENT_DETERMINISM_REPLAY_OPTION "--determinism-replay"
+#define CLIENT_DETERMINISM_RECORD_OPTION "--determinism-record"
+
+// While downloading the lobby's map file, how often in seconds the chunks still missing are asked for.
+// Chunks lost on the way are simply asked for again, so this is also how long a lost chunk holds things up.
+#define CLIENT_MAP_REQUEST_INTERVAL 0.25f
+
+// How many separate runs of missing chunks are asked for each CLIENT_MAP_REQUEST_INTERVAL,
+// each run being up to LEVEL_MAP_MAX_CHUNKS_PER_REQUEST chunks long.
+#define CLIENT_MAP_REQUEST_RUNS 4
+
+// Once the client has the lobby's map file, how often in seconds it tells the server so.
+// Repeated for as long as the client is in the lobby, in case any of them are lost.
+#define CLIENT_MAP_READY_INTERVAL 1.0f
+
+// When the starting level the client laid out itself does not match the server's,
+// how often in seconds the full level is asked for until it arrives.
+#define CLIENT_FULL_REQUEST_INTERVAL 1.0f
+
 // Defines the various stages the client application can be in.
 // Used to determine which logic and rendering to perform.
 typedef enum ClientStage {
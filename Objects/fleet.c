@@ -0,0 +1,43 @@
+/**
+ * Implements a fleet object.
+ * A fleet represents every starship sent out in a single launch from one planet to another,
+ * and holds what those starships have in common: their owner, origin, target and launch tick.
+ * The starships themselves only remember which fleet they belong to.
+ * @file Objects/fleet.c
+ * @author abmize
+ */
+
+#include "Objects/fleet.h"
+
+/**
+ * Creates a new fleet with no starships in it yet.
+ * @param id The ID of the fleet.
+ * @param owner A pointer to the Faction that owns the fleet.
+ * @param origin A pointer to the Planet the fleet was launched from, or NULL if it has none.
+ * @param target A pointer to the Planet the fleet is bound for.
+ * @param launchTick The level tick the fleet was launched on.
+ * @return The created Fleet object.
+ */
+Fleet CreateFleet(uint32_t id, const Faction *owner, const struct Planet *origin, struct Planet *target, uint32_t launchTick) {
+    Fleet fleet;
+    fleet.id = id;
+    fleet.owner = owner;
+    fleet.origin = origin;
+    fleet.target = target;
+    fleet.launchTick = launchTick;
+
+    // Starships are counted in as they are spawned into the fleet.
+    fleet.liveCount = 0;
+    fleet.liveWeight = 0;
+    return fleet;
+}
+
+/**
+ * Determines if a fleet still has any starships flying.
+ * @param fleet A pointer to the Fleet to check.
+ * @return true if the fleet has at least one starship left, false otherwise.
+ */
+bool FleetIsActive(const Fleet *fleet) {
+    return fleet != NULL && fleet->liveCount > 0;
+}
+
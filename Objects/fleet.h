@@ -0,0 +1,61 @@
+/**
+ * Header file for the fleet object.
+ * @file Objects/fleet.h
+ * @author abmize
+ */
+
+#ifndef _FLEET_H_
+#define _FLEET_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Objects/faction.h"
+
+// Forward declaration in order to avoid circular dependency.
+struct Planet;
+
+// Fleet index used to say that something does not belong to any fleet.
+#define FLEET_INDEX_NONE UINT32_MAX
+
+// A fleet represents every starship sent out in a single launch from one planet to another.
+// Everything the starships of a launch have in common is kept here once,
+// rather than once per starship: who owns them, where they came from, where they are going,
+// and the level tick they were launched on.
+// Starships refer to their fleet by its index in the level's fleets array (see Starship.fleetIndex).
+// liveCount is the number of starships still flying in the fleet. Once it drops to 0,
+// the fleet is over, and its slot in the fleets array may be reused by a later launch.
+// liveWeight is the number of ships those starships stand for, adding up their weights,
+// which is the fleet's actual strength however few starships it is simulated with.
+// id, unlike the index, is never reused within a match, so it tells launches apart
+// even after their slots have been handed on.
+typedef struct Fleet {
+    uint32_t id;
+    const Faction *owner;
+    const struct Planet *origin;
+    struct Planet *target;
+    uint32_t launchTick;
+    uint32_t liveCount;
+    uint32_t liveWeight;
+} Fleet;
+
+/**
+ * Creates a new fleet with no starships in it yet.
+ * @param id The ID of the fleet.
+ * @param owner A pointer to the Faction that owns the fleet.
+ * @param origin A pointer to the Planet the fleet was launched from, or NULL if it has none.
+ * @param target A pointer to the Planet the fleet is bound for.
+ * @param launchTick The level tick the fleet was launched on.
+ * @return The created Fleet object.
+ */
+Fleet CreateFleet(uint32_t id, const Faction *owner, const struct Planet *origin, struct Planet *target, uint32_t launchTick);
+
+/**
+ * Determines if a fleet still has any starships flying.
+ * @param fleet A pointer to the Fleet to check.
+ * @return true if the fleet has at least one starship left, false otherwise.
+ */
+bool FleetIsActive(const Fleet *fleet);
+
+#endif // _FLEET_H_
@@ -12,6 +12,8 @@
  */
 
 #include "Objects/level.h"
+#include "Utilities/gameUtilities.h"
+#include "Utilities/simMathUtilities.h"
 
 /**
  * Initializes a Level object to default values.
@@ -31,14 +33,25 @@ void LevelInit(Level *level) {
     level->factionCount = 0;
     level->planets = NULL;
     level->planetCount = 0;
+    level->planetRenderCaches = NULL;
+    memset(&level->planetCullingGrid, 0, sizeof(level->planetCullingGrid));
     level->starships = NULL;
     level->starshipCount = 0;
     level->starshipCapacity = 0;
+    level->fleets = NULL;
+    level->fleetCount = 0;
+    level->fleetCapacity = 0;
+    level->nextFleetId = 0;
+    level->tick = 0;
     level->trailEffects = NULL;
     level->trailEffectCount = 0;
     level->trailEffectCapacity = 0;
+    level->audioEvents = NULL;
+    level->audioEventCount = 0;
+    level->audioEventCapacity = 0;
     level->width = 0.0f;
     level->height = 0.0f;
+    level->mapHash = 0u;
 }
 
 /**
@@ -58,25 +71,46 @@ void LevelRelease(Level *level) {
     // is that according to the C standard, it is safe to call free() with a NULL pointer.
     // This means we do not need to check if each pointer is NULL before calling free().
     // It also means that it is safe to call free() on a Level that has not been fully configured.
+    // Planet render caches own memory of their own, so they are released one by one first.
+    if (level->planetRenderCaches != NULL) {
+        for (size_t i = 0; i < level->planetCount; ++i) {
+            PlanetRenderCacheRelease(&level->planetRenderCaches[i]);
+        }
+    }
+
     free(level->factions);
     free(level->planets);
+    free(level->planetRenderCaches);
+    PlanetCullingGridRelease(&level->planetCullingGrid);
     free(level->starships);
+    free(level->fleets);
     free(level->trailEffects);
+    free(level->audioEvents);
 
     // After freeing, we set all members to NULL or zero
     // to avoid dangling pointers and stale data.
     level->factions = NULL;
     level->planets = NULL;
+    level->planetRenderCaches = NULL;
     level->starships = NULL;
+    level->fleets = NULL;
     level->trailEffects = NULL;
+    level->audioEvents = NULL;
     level->factionCount = 0;
     level->planetCount = 0;
     level->starshipCount = 0;
     level->starshipCapacity = 0;
+    level->fleetCount = 0;
+    level->fleetCapacity = 0;
+    level->nextFleetId = 0;
+    level->tick = 0;
     level->trailEffectCount = 0;
     level->trailEffectCapacity = 0;
+    level->audioEventCount = 0;
+    level->audioEventCapacity = 0;
     level->width = 0.0f;
     level->height = 0.0f;
+    level->mapHash = 0u;
 }
 
 /**
@@ -146,6 +180,12 @@ bool LevelConfigure(Level *level, size_t factionCount, size_t planetCount, size_
         return false;
     }
 
+    // Each planet gets a render cache, which starts out zeroed and therefore invalid.
+    if (!AllocateArray((void **)&level->planetRenderCaches, sizeof(PlanetRenderCache), planetCount)) {
+        LevelRelease(level);
+        return false;
+    }
+
     // And finally if we need starships, we allocate them here.
     if (starshipCapacity > 0) {
         level->starships = (Starship *)malloc(sizeof(Starship) * starshipCapacity);
@@ -253,6 +293,71 @@ static bool EnsureTrailEffectCapacity(Level *level, size_t minCapacity) {
     return true;
 }
 
+/**
+ * Helper function to ensure the fleets array has enough capacity
+ * to hold at least minCapacity fleets.
+ * Grows the array the same way EnsureStarshipCapacity grows the starship array.
+ * @param level A pointer to the Level object.
+ * @param minCapacity The minimum required capacity for fleets.
+ * @return true if the fleets array has enough capacity, false otherwise.
+ */
+static bool EnsureFleetCapacity(Level *level, size_t minCapacity) {
+    // We don't need to do anything if we already have enough capacity.
+    if (level->fleetCapacity >= minCapacity) {
+        return true;
+    }
+
+    // New capacity equals double the current capacity, or 16 if current capacity is zero.
+    size_t newCapacity = level->fleetCapacity == 0 ? 16 : level->fleetCapacity * 2;
+    while (newCapacity < minCapacity) {
+        newCapacity *= 2;
+    }
+
+    Fleet *resized = (Fleet *)realloc(level->fleets, sizeof(Fleet) * newCapacity);
+    if (resized == NULL) {
+        return false;
+    }
+
+    level->fleets = resized;
+    level->fleetCapacity = newCapacity;
+    return true;
+}
+
+/**
+ * Helper function to create a new, still empty, fleet in the level.
+ * The first free slot of the fleets array is reused if there is one,
+ * so the array only grows with the number of launches in flight at once, not with the length of the match.
+ * The caller must spawn the fleet's starships into it straight away (bumping its liveCount),
+ * since until then its slot still counts as free.
+ * @param level A pointer to the Level object.
+ * @param owner A pointer to the Faction that owns the fleet.
+ * @param origin A pointer to the Planet the fleet launches from, or NULL if it has none.
+ * @param target A pointer to the Planet the fleet is bound for.
+ * @return The index of the new fleet, or FLEET_INDEX_NONE if there was no room for it.
+ */
+static uint32_t LevelCreateFleet(Level *level, const Faction *owner, const Planet *origin, Planet *target) {
+    // Look for a slot freed by a fleet that has since run out of starships.
+    size_t index = level->fleetCount;
+    for (size_t i = 0; i < level->fleetCount; ++i) {
+        if (!FleetIsActive(&level->fleets[i])) {
+            index = i;
+            break;
+        }
+    }
+
+    // Fleet indices must fit in a starship's fleetIndex, with FLEET_INDEX_NONE left over.
+    if (index >= (size_t)FLEET_INDEX_NONE || !EnsureFleetCapacity(level, index + 1)) {
+        return FLEET_INDEX_NONE;
+    }
+
+    level->fleets[index] = CreateFleet(level->nextFleetId, owner, origin, target, level->tick);
+    level->nextFleetId += 1;
+    if (index == level->fleetCount) {
+        level->fleetCount += 1;
+    }
+    return (uint32_t)index;
+}
+
 /**
  * Spawns a trail effect for the given starship in the level.
  * This function creates a StarshipTrailEffect based on the starship's current trail data
@@ -275,8 +380,9 @@ static void LevelSpawnTrailEffect(Level *level, const Starship *ship) {
     // Create the trail effect based on the starship's trail data.
     float color[4] = {0.0f, 0.0f, 0.0f, 1.0f};
 
-    // Get the starship's color for the trail effect.
-    StarshipResolveColor(ship, color);
+    // Get the starship's color for the trail effect, which is that of its fleet.
+    const Fleet *fleet = ship->fleetIndex < level->fleetCount ? &level->fleets[ship->fleetIndex] : NULL;
+    StarshipResolveColor(fleet, color);
 
     // Initialize the trail effect.
     StarshipTrailEffect effect = {0};
@@ -292,6 +398,51 @@ static void LevelSpawnTrailEffect(Level *level, const Starship *ship) {
     level->trailEffectCount += 1;
 }
 
+/**
+ * Records that a starship arrived at a planet, and whether it captured it, for LevelPlayAudioEvents.
+ * Arrivals at a planet that already has an event are added to that event,
+ * so a whole fleet landing in one update still only adds up to a single event.
+ * @param level A pointer to the Level object.
+ * @param planetIndex The index of the planet the starship arrived at.
+ * @param weight The number of ships the starship stands for, each of which counts as an impact.
+ * @param captured true if the starship caused the planet to change owner.
+ */
+static void LevelRecordAudioEvent(Level *level, size_t planetIndex, uint32_t weight, bool captured) {
+    // Only a handful of planets see arrivals in any one update, so a linear search is plenty.
+    LevelAudioEvent *event = NULL;
+    for (size_t i = 0; i < level->audioEventCount; ++i) {
+        if (level->audioEvents[i].planetIndex == planetIndex) {
+            event = &level->audioEvents[i];
+            break;
+        }
+    }
+
+    if (event == NULL) {
+        // New capacity equals double the current capacity, or 16 if current capacity is zero.
+        if (level->audioEventCount == level->audioEventCapacity) {
+            size_t newCapacity = level->audioEventCapacity == 0 ? 16 : level->audioEventCapacity * 2;
+            LevelAudioEvent *resized = (LevelAudioEvent *)realloc(level->audioEvents, sizeof(LevelAudioEvent) * newCapacity);
+            if (resized == NULL) {
+                // Losing a sound is no reason to disturb the simulation.
+                return;
+            }
+            level->audioEvents = resized;
+            level->audioEventCapacity = newCapacity;
+        }
+
+        event = &level->audioEvents[level->audioEventCount];
+        event->planetIndex = planetIndex;
+        event->impactCount = 0;
+        event->captureCount = 0;
+        level->audioEventCount += 1;
+    }
+
+    event->impactCount += weight;
+    if (captured) {
+        event->captureCount += 1;
+    }
+}
+
 /**
  * Spawns a new starship in the level.
  * This function will first check if there is enough memory allocated for starships
@@ -316,10 +467,18 @@ Starship *LevelSpawnStarship(Level *level, Vec2 position, Vec2 velocity, const F
         return NULL;
     }
 
+    // Every starship belongs to a fleet, so a starship spawned on its own gets a fleet of its own.
+    uint32_t fleetIndex = LevelCreateFleet(level, owner, NULL, target);
+    if (fleetIndex == FLEET_INDEX_NONE) {
+        return NULL;
+    }
+
     // Now that we know we have enough memory, we can create the starship
     // and add it to the level's starship array.
     // See starship.c and starship.h for more details on starship creation.
-    Starship ship = CreateStarship(position, velocity, owner, target);
+    Starship ship = CreateStarship(position, velocity, fleetIndex);
+    level->fleets[fleetIndex].liveCount = 1;
+    level->fleets[fleetIndex].liveWeight = ship.weight;
 
     // We must add the ship to the Level's starship array,
     // to keep track of it, give it to a different variable
@@ -333,6 +492,107 @@ Starship *LevelSpawnStarship(Level *level, Vec2 position, Vec2 velocity, const F
     return stored;
 }
 
+/**
+ * Spawns a whole fleet of starships in the level at once, scattered randomly around the origin planet
+ * and heading away from it at STARSHIP_INITIAL_SPEED, all bound for the destination planet.
+ * At most LEVEL_MAX_STARSHIPS_PER_LAUNCH starships are spawned. If count is more than that,
+ * the ships are shared out between them as evenly as possible through their weights,
+ * with the first (count % LEVEL_MAX_STARSHIPS_PER_LAUNCH) starships standing for one ship more than the rest.
+ * Up to that limit, produces exactly the same starships, in the same order, from the same RNG state,
+ * as spawning them one by one with LevelSpawnStarship would, drawing a random angle
+ * and then a random offset from the spawn radius for each starship in turn,
+ * so the server and clients stay in sync whichever way they spawn fleets.
+ * Room for the whole fleet is made once up front, and the starships' trails are left empty
+ * rather than filled in with copies of their position, since no sample past a trail's count is ever read.
+ * @param level A pointer to the Level object.
+ * @param origin A pointer to the Planet the fleet launches from.
+ * @param destination A pointer to the Planet the fleet is bound for.
+ * @param count The number of ships to launch.
+ * @param owner A pointer to the Faction that owns the starships.
+ * @param rngState Pointer to the RNG state used to randomize the starships' spawn positions.
+ * @return The number of ships launched, adding up the starships' weights,
+ *         which is either count or, if room could not be made for them, 0.
+ */
+size_t LevelSpawnFleet(Level *level, const Planet *origin, Planet *destination, size_t count,
+    const Faction *owner, unsigned int *rngState) {
+    if (level == NULL || origin == NULL || destination == NULL || rngState == NULL || count == 0) {
+        return 0;
+    }
+
+    // A fleet's live weight has to be able to hold every ship in it.
+    if (count > UINT32_MAX) {
+        return 0;
+    }
+
+    // However many ships are launched, only so many starships are simulated for them.
+    // Every starship stands for baseWeight ships, and the first few one more,
+    // so that the weights add up to exactly count.
+    size_t starshipTotal = count < LEVEL_MAX_STARSHIPS_PER_LAUNCH ? count : LEVEL_MAX_STARSHIPS_PER_LAUNCH;
+    uint32_t baseWeight = (uint32_t)(count / starshipTotal);
+    size_t heavierCount = count % starshipTotal;
+
+    // Make room for the whole fleet in one go, rather than checking (and maybe growing) once per starship.
+    if (!EnsureStarshipCapacity(level, level->starshipCount + starshipTotal)) {
+        return 0;
+    }
+
+    // The fleet record is shared by every starship of the launch.
+    uint32_t fleetIndex = LevelCreateFleet(level, owner, origin, destination);
+    if (fleetIndex == FLEET_INDEX_NONE) {
+        return 0;
+    }
+    level->fleets[fleetIndex].liveCount = (uint32_t)starshipTotal;
+    level->fleets[fleetIndex].liveWeight = (uint32_t)count;
+
+    float spawnRadius = STARSHIP_RADIUS * 1.5f;
+    Vec2 center = origin->position;
+
+    // The random numbers for a batch of starships are drawn first, since each draw depends on the last,
+    // which leaves the second loop free of any dependency between starships, so the compiler can pipeline
+    // (or vectorize) the trigonometry and the writes into the starship array.
+    float angles[LEVEL_SPAWN_BATCH_SIZE];
+    float distances[LEVEL_SPAWN_BATCH_SIZE];
+
+    size_t spawned = 0;
+    while (spawned < starshipTotal) {
+        size_t batch = starshipTotal - spawned;
+        if (batch > LEVEL_SPAWN_BATCH_SIZE) {
+            batch = LEVEL_SPAWN_BATCH_SIZE;
+        }
+
+        // Random angle around the planet, then a random offset from the spawn radius
+        // to avoid perfect circle formation, in that order for each starship.
+        for (size_t i = 0; i < batch; ++i) {
+            angles[i] = RandomRange(rngState, 0.0f, 2.0f * (float)M_PI);
+            distances[i] = spawnRadius + RandomRange(rngState, -STARSHIP_RADIUS, STARSHIP_RADIUS);
+        }
+
+        // Fill in the starships. The arithmetic is done in exactly the order Vec2Scale and Vec2Add do it,
+        // and the direction comes from SimSinCos rather than cosf and sinf,
+        // so every position comes out bit for bit the same on the server and on every client.
+        Starship *ships = &level->starships[level->starshipCount];
+        for (size_t i = 0; i < batch; ++i) {
+            Vec2 direction;
+            SimSinCos(angles[i], &direction.y, &direction.x);
+            Vec2 position = {center.x + direction.x * distances[i], center.y + direction.y * distances[i]};
+            Starship *ship = &ships[i];
+            ship->position = position;
+            ship->previousPosition = position;
+            ship->velocity.x = direction.x * STARSHIP_INITIAL_SPEED;
+            ship->velocity.y = direction.y * STARSHIP_INITIAL_SPEED;
+            ship->fleetIndex = fleetIndex;
+            ship->weight = spawned + i < heavierCount ? baseWeight + 1u : baseWeight;
+            ship->trailCount = 0;
+            ship->trailTimeSinceLastEmit = 0.0f;
+        }
+
+        level->starshipCount += batch;
+        spawned += batch;
+    }
+
+    return count;
+}
+
 /**
  * Removes a starship from the level at the specified index.
  * This function will remove the starship by replacing it with the last starship
@@ -368,11 +628,25 @@ void LevelRemoveStarship(Level *level, size_t index) {
     // or freeing of internal resources.
     // Should any malloc'd or resource-owning members be added to the Starship struct in the future,
     // this function will need to be updated to properly release those resources
+    uint32_t fleetIndex = level->starships[index].fleetIndex;
+    uint32_t weight = level->starships[index].weight;
     size_t last = level->starshipCount - 1;
     if (index != last) {
         level->starships[index] = level->starships[last];
     }
     level->starshipCount -= 1;
+
+    // The fleet has one starship fewer. Once it has none left its slot is free to reuse,
+    // and any free slots at the end of the array are dropped from the count altogether,
+    // so whatever walks over the fleets does not have to walk over long-finished ones.
+    if (fleetIndex < level->fleetCount && level->fleets[fleetIndex].liveCount > 0) {
+        Fleet *fleet = &level->fleets[fleetIndex];
+        fleet->liveCount -= 1;
+        fleet->liveWeight = fleet->liveWeight > weight ? fleet->liveWeight - weight : 0;
+        while (level->fleetCount > 0 && !FleetIsActive(&level->fleets[level->fleetCount - 1])) {
+            level->fleetCount -= 1;
+        }
+    }
 }
 
 /**
@@ -464,22 +738,55 @@ void LevelUpdate(Level *level, float deltaTime) {
     // StarshipUpdate is primarily responsible for moving the starship towards its target planet,
     // while interactions between starships and planets are handled here in LevelUpdate.
     // If a starship collides with its target planet, we call PlanetHandleIncomingShip
-    // to let the planet process the incoming ship,
+    // to let the planet process the incoming ship (all of the ships it stands for at once),
+    // note down what that should sound like,
     // and then we remove the starship from the level.
     // See starship and planet implementations for more details on the behavior
     // of their functions during updates and collisions.
+    // Each starship finds its target (and owner) in the fleet it was launched with.
     size_t i = 0;
     while (i < level->starshipCount) {
         Starship *ship = &level->starships[i];
-        StarshipUpdate(ship, deltaTime);
-        if (StarshipCheckCollision(ship)) {
-            PlanetHandleIncomingShip(ship->target, ship);
+        const Fleet *fleet = ship->fleetIndex < level->fleetCount ? &level->fleets[ship->fleetIndex] : NULL;
+        StarshipUpdate(ship, fleet, deltaTime);
+        if (StarshipCheckCollision(ship, fleet)) {
+            Planet *target = fleet->target;
+            bool captured = PlanetHandleIncomingShip(target, fleet, ship->weight);
+            if (target != NULL && target >= level->planets && target < level->planets + level->planetCount) {
+                LevelRecordAudioEvent(level, (size_t)(target - level->planets), ship->weight, captured);
+            }
             LevelSpawnTrailEffect(level, ship);
             LevelRemoveStarship(level, i);
             continue;
         }
         ++i;
     }
+
+    // Fleets launched from here on out were launched during the next tick.
+    level->tick += 1;
+}
+
+/**
+ * Plays the sounds for everything gathered by LevelUpdate since the last call, then forgets them.
+ * Each planet gets at most one impact cue, however many ships arrived at it,
+ * played louder the more ships there were, and at most one capture cue.
+ * @param level A pointer to the Level whose audio events to play.
+ */
+void LevelPlayAudioEvents(Level *level) {
+    if (level == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < level->audioEventCount; ++i) {
+        const LevelAudioEvent *event = &level->audioEvents[i];
+        if (event->impactCount > 0) {
+            SoundManagerPlayShipImpacts(event->impactCount);
+        }
+        if (event->captureCount > 0) {
+            SoundManagerPlayPlanetCaptured();
+        }
+    }
+    level->audioEventCount = 0;
 }
 
 /**
@@ -527,10 +834,171 @@ bool LevelComputeFactionPlanetCentroid(const Level *level, const Faction *factio
     return true;
 }
 
+/**
+ * Helper function to find the faction in one level matching a faction in another.
+ * Matching is done by position in the factions array, since copies keep the same order.
+ * @param destination A pointer to the Level to find the matching faction in.
+ * @param source A pointer to the Level the faction belongs to.
+ * @param faction A pointer to a faction of the source level, or NULL.
+ * @return A pointer to the matching faction of the destination level, or NULL if there is none.
+ */
+static const Faction *RemapFaction(const Level *destination, const Level *source, const Faction *faction) {
+    if (faction == NULL || source->factions == NULL || destination->factions == NULL) {
+        return NULL;
+    }
+
+    if (faction < source->factions || faction >= source->factions + source->factionCount) {
+        return NULL;
+    }
+
+    return &destination->factions[faction - source->factions];
+}
+
+/**
+ * Helper function to find the planet in one level matching a planet in another.
+ * Matching is done by position in the planets array, since copies keep the same order.
+ * @param destination A pointer to the Level to find the matching planet in.
+ * @param source A pointer to the Level the planet belongs to.
+ * @param planet A pointer to a planet of the source level, or NULL.
+ * @return A pointer to the matching planet of the destination level, or NULL if there is none.
+ */
+static Planet *RemapPlanet(Level *destination, const Level *source, const Planet *planet) {
+    if (planet == NULL || source->planets == NULL || destination->planets == NULL) {
+        return NULL;
+    }
+
+    if (planet < source->planets || planet >= source->planets + source->planetCount) {
+        return NULL;
+    }
+
+    return &destination->planets[planet - source->planets];
+}
+
+/**
+ * Copies the game state of one level into another.
+ * Factions, planets, fleets, starships and trail effects are copied, and every pointer between them
+ * (such as a planet's owner or a fleet's target) is pointed at the destination's own copies.
+ * The destination's render caches and culling grid are kept as long as its planets
+ * are laid out exactly like the source's, so a level that is copied into over and over
+ * (for instance, once per frame for drawing) keeps its cached geometry.
+ * Otherwise the destination is configured again from scratch.
+ * @param destination A pointer to the Level to copy into. Must have been initialized.
+ * @param source A pointer to the Level to copy from.
+ * @return true if the state was copied, false otherwise.
+ */
+bool LevelCopyState(Level *destination, const Level *source) {
+    // Basic validation of parameters.
+    if (destination == NULL || source == NULL || destination == source) {
+        return false;
+    }
+
+    // Planets never move, so if the destination has the same planets in the same places,
+    // it must be a copy of the same level, and whatever was cached for drawing it is still good.
+    bool sameLayout = destination->factionCount == source->factionCount
+        && destination->planetCount == source->planetCount
+        && destination->width == source->width
+        && destination->height == source->height;
+    for (size_t i = 0; sameLayout && i < source->planetCount; ++i) {
+        if (destination->planets[i].position.x != source->planets[i].position.x
+            || destination->planets[i].position.y != source->planets[i].position.y) {
+            sameLayout = false;
+        }
+    }
+
+    // A different level means starting over with freshly allocated factions, planets and caches.
+    // Starships and trail effects are allocated below, once we know how many there are.
+    if (!sameLayout && !LevelConfigure(destination, source->factionCount, source->planetCount, 0)) {
+        return false;
+    }
+
+    // Make room for every fleet, starship and trail effect of the source.
+    if (!EnsureStarshipCapacity(destination, source->starshipCount)
+        || !EnsureFleetCapacity(destination, source->fleetCount)
+        || !EnsureTrailEffectCapacity(destination, source->trailEffectCount)) {
+        return false;
+    }
+
+    // Factions hold no pointers into the level, so they are copied as they are.
+    if (source->factionCount > 0) {
+        memcpy(destination->factions, source->factions, sizeof(Faction) * source->factionCount);
+    }
+
+    // Planets point at the factions owning and claiming them,
+    // which must now be the destination's factions rather than the source's.
+    for (size_t i = 0; i < source->planetCount; ++i) {
+        Planet planet = source->planets[i];
+        planet.owner = RemapFaction(destination, source, planet.owner);
+        planet.claimant = RemapFaction(destination, source, planet.claimant);
+        destination->planets[i] = planet;
+    }
+
+    // Likewise for the fleets' owners, origins and targets.
+    for (size_t i = 0; i < source->fleetCount; ++i) {
+        Fleet fleet = source->fleets[i];
+        fleet.owner = RemapFaction(destination, source, fleet.owner);
+        fleet.origin = RemapPlanet(destination, source, fleet.origin);
+        fleet.target = RemapPlanet(destination, source, fleet.target);
+        destination->fleets[i] = fleet;
+    }
+    destination->fleetCount = source->fleetCount;
+    destination->nextFleetId = source->nextFleetId;
+    destination->tick = source->tick;
+
+    // Starships only refer to their fleets by index, which is the same in both levels,
+    // so they hold no pointers and are copied as they are.
+    if (source->starshipCount > 0) {
+        memcpy(destination->starships, source->starships, sizeof(Starship) * source->starshipCount);
+    }
+    destination->starshipCount = source->starshipCount;
+
+    // Trail effects only hold their samples and color, so they too are copied as they are.
+    if (source->trailEffectCount > 0) {
+        memcpy(destination->trailEffects, source->trailEffects, sizeof(StarshipTrailEffect) * source->trailEffectCount);
+    }
+    destination->trailEffectCount = source->trailEffectCount;
+
+    destination->width = source->width;
+    destination->height = source->height;
+    destination->mapHash = source->mapHash;
+    return true;
+}
+
+/**
+ * Moves every starship in the level to a point between its previous and current positions.
+ * Meant for a copy of the level that is only drawn, since the starships' positions are overwritten.
+ * @param level A pointer to the Level whose starships to move.
+ * @param alpha How far between the previous (0) and current (1) position to place each starship.
+ *              Values outside of 0 to 1 are clamped.
+ */
+void LevelInterpolateStarships(Level *level, float alpha) {
+    if (level == NULL) {
+        return;
+    }
+
+    // We never extrapolate past the most recent update, nor go back further than the one before it.
+    if (alpha < 0.0f) {
+        alpha = 0.0f;
+    } else if (alpha > 1.0f) {
+        alpha = 1.0f;
+    }
+
+    // position = previous + (current - previous) * alpha
+    for (size_t i = 0; i < level->starshipCount; ++i) {
+        Starship *ship = &level->starships[i];
+        Vec2 travelled = Vec2Subtract(ship->position, ship->previousPosition);
+        ship->position = Vec2Add(ship->previousPosition, Vec2Scale(travelled, alpha));
+    }
+}
+
 /**
  * Applies a full level packet to the provided Level instance.
  * This populates factions, planets, and starships based on the packet data.
+ * The packet does not say which starships were launched together, so the starships
+ * are gathered back into fleets by owner and target, one fleet per pair.
  * Existing data in the level is replaced. The level must have been initialized.
+ * If the packet is for a level laid out from a map file, the level must already be
+ * configured with the packet's faction and planet counts and laid out from that same map
+ * (see MapFileApplyToLevel), since the packet does not carry the planets' positions or capacities.
  * @param level A pointer to the Level object to populate.
  * @param data A pointer to the packet data buffer.
  * @param size Size of the packet data buffer in bytes.
@@ -558,10 +1026,15 @@ bool LevelApplyFullPacket(Level *level, const void *data, size_t size) {
     size_t planetCount = (size_t)packet->planetCount;
     size_t starshipCount = (size_t)packet->starshipCount;
 
+    // A level laid out from a map file only carries the planets' dynamic state,
+    // the rest is already in the level, having been read from the map file itself.
+    bool fromMap = packet->mapHash != 0u;
+    size_t planetInfoSize = fromMap ? sizeof(LevelPacketPlanetSnapshotInfo) : sizeof(LevelPacketPlanetFullInfo);
+
     // Calculate the required size for the full packet data.
     size_t requiredSize = sizeof(LevelFullPacket)
         + factionCount * sizeof(LevelPacketFactionInfo)
-        + planetCount * sizeof(LevelPacketPlanetFullInfo)
+        + planetCount * planetInfoSize
         + starshipCount * sizeof(LevelPacketStarshipInfo);
     
     // If the provided size is less than the required size
@@ -570,13 +1043,22 @@ bool LevelApplyFullPacket(Level *level, const void *data, size_t size) {
         return false;
     }
 
-    // We initialize the capacity for the starships array to either
-    // the number of starships in the packet, or 16 if there are none.
-    size_t desiredStarshipCapacity = starshipCount > 0 ? starshipCount : 16u;
+    if (fromMap) {
+        // Reconfiguring would throw away the planets laid out from the map,
+        // so instead make sure they really are the planets of the map the packet was made from.
+        if (level->mapHash != packet->mapHash || level->factionCount != factionCount
+            || level->planetCount != planetCount || level->planets == NULL) {
+            return false;
+        }
+    } else {
+        // We initialize the capacity for the starships array to either
+        // the number of starships in the packet, or 16 if there are none.
+        size_t desiredStarshipCapacity = starshipCount > 0 ? starshipCount : 16u;
 
-    // Configure the level with the extracted counts.
-    if (!LevelConfigure(level, factionCount, planetCount, desiredStarshipCapacity)) {
-        return false;
+        // Configure the level with the extracted counts.
+        if (!LevelConfigure(level, factionCount, planetCount, desiredStarshipCapacity)) {
+            return false;
+        }
     }
 
     // Assign level dimensions from the packet.
@@ -587,36 +1069,32 @@ bool LevelApplyFullPacket(Level *level, const void *data, size_t size) {
     const uint8_t *cursor = bytes + sizeof(LevelFullPacket);
 
     // Populate factions.
-    const LevelPacketFactionInfo *factionInfo = (const LevelPacketFactionInfo *)cursor;
-    for (size_t i = 0; i < factionCount; ++i) {
-        level->factions[i].id = (int)factionInfo[i].id;
-        for (size_t c = 0; c < 4; ++c) {
-            level->factions[i].color[c] = factionInfo[i].color[c];
-        }
-
-        // Team metadata is required for friendly-fire and shared control rules.
-        // We route through setters so invalid values normalize to "none".
-        FactionSetTeamNumber(&level->factions[i], (int)factionInfo[i].teamNumber);
-        FactionSetSharedControlNumber(&level->factions[i], (int)factionInfo[i].sharedControlNumber);
-
-        // Network packets do not carry AI assignments, so we clear them here.
-        level->factions[i].aiPersonality = NULL;
-    }
+    LevelReadFactionInfo(level, (const LevelPacketFactionInfo *)cursor, factionCount);
 
     // Move the cursor past the faction data, to what better be planet data.
     cursor += factionCount * sizeof(LevelPacketFactionInfo);
-    const LevelPacketPlanetFullInfo *planetInfo = (const LevelPacketPlanetFullInfo *)cursor;
-    for (size_t i = 0; i < planetCount; ++i) {
-        Planet *planet = &level->planets[i];
-        planet->position = planetInfo[i].position;
-        planet->maxFleetCapacity = planetInfo[i].maxFleetCapacity;
-        planet->currentFleetSize = planetInfo[i].currentFleetSize;
-        planet->owner = FindFactionById(level, planetInfo[i].ownerId);
-        planet->claimant = FindFactionById(level, planetInfo[i].claimantId);
+    if (fromMap) {
+        const LevelPacketPlanetSnapshotInfo *planetInfo = (const LevelPacketPlanetSnapshotInfo *)cursor;
+        for (size_t i = 0; i < planetCount; ++i) {
+            Planet *planet = &level->planets[i];
+            planet->currentFleetSize = planetInfo[i].currentFleetSize;
+            planet->owner = FindFactionById(level, planetInfo[i].ownerId);
+            planet->claimant = FindFactionById(level, planetInfo[i].claimantId);
+        }
+    } else {
+        const LevelPacketPlanetFullInfo *planetInfo = (const LevelPacketPlanetFullInfo *)cursor;
+        for (size_t i = 0; i < planetCount; ++i) {
+            Planet *planet = &level->planets[i];
+            planet->position = planetInfo[i].position;
+            planet->maxFleetCapacity = planetInfo[i].maxFleetCapacity;
+            planet->currentFleetSize = planetInfo[i].currentFleetSize;
+            planet->owner = FindFactionById(level, planetInfo[i].ownerId);
+            planet->claimant = FindFactionById(level, planetInfo[i].claimantId);
+        }
     }
 
     // Move the cursor past the planet data, to what better be starship data.
-    cursor += planetCount * sizeof(LevelPacketPlanetFullInfo);
+    cursor += planetCount * planetInfoSize;
     const LevelPacketStarshipInfo *starshipInfo = (const LevelPacketStarshipInfo *)cursor;
 
     // Double check we have enough capacity for starships and trail effects 
@@ -631,12 +1109,16 @@ bool LevelApplyFullPacket(Level *level, const void *data, size_t size) {
     }
 
 
-    // Populate starships.
-    level->starshipCount = starshipCount;
+    // Populate starships, and the fleets they belong to.
+    level->starshipCount = 0;
     level->trailEffectCount = 0;
+    level->fleetCount = 0;
 
     // Iterate over each starship info and create the corresponding starship
     // using the provided data.
+    // Starships of the same launch tend to sit next to each other in the packet,
+    // so the fleet of the previous starship is checked first before looking through the rest.
+    uint32_t fleetIndex = FLEET_INDEX_NONE;
     for (size_t i = 0; i < starshipCount; ++i) {
         const LevelPacketStarshipInfo *info = &starshipInfo[i];
         const Faction *owner = FindFactionById(level, info->ownerId);
@@ -645,17 +1127,203 @@ bool LevelApplyFullPacket(Level *level, const void *data, size_t size) {
             target = FindPlanetByIndex(level, (size_t)info->targetPlanetIndex);
         }
 
-        Starship ship = CreateStarship(info->position, info->velocity, owner, target);
-        ship.position = info->position;
-        ship.velocity = info->velocity;
-        ship.owner = owner;
-        ship.target = target;
+        if (fleetIndex == FLEET_INDEX_NONE || level->fleets[fleetIndex].owner != owner
+            || level->fleets[fleetIndex].target != target) {
+            fleetIndex = FLEET_INDEX_NONE;
+            for (size_t f = 0; f < level->fleetCount; ++f) {
+                if (level->fleets[f].owner == owner && level->fleets[f].target == target) {
+                    fleetIndex = (uint32_t)f;
+                    break;
+                }
+            }
+        }
+
+        // Where the fleet came from is not known, only where it is going.
+        if (fleetIndex == FLEET_INDEX_NONE) {
+            fleetIndex = LevelCreateFleet(level, owner, NULL, target);
+            if (fleetIndex == FLEET_INDEX_NONE) {
+                return false;
+            }
+        }
+
+        // A weight of 0 would be a starship standing for no ships at all, so it is taken as 1.
+        Starship ship = CreateStarship(info->position, info->velocity, fleetIndex);
+        ship.weight = info->weight > 0u ? info->weight : 1u;
+        level->fleets[fleetIndex].liveCount += 1;
+        level->fleets[fleetIndex].liveWeight += ship.weight;
         level->starships[i] = ship;
+        level->starshipCount += 1;
     }
 
     return true;
 }
 
+/**
+ * Fills in the network representation of every faction in the level.
+ * @param level A pointer to the Level whose factions to describe.
+ * @param outInfo Receives level->factionCount faction info entries.
+ */
+void LevelWriteFactionInfo(const Level *level, LevelPacketFactionInfo *outInfo) {
+    // Basic validation of parameters.
+    if (level == NULL || outInfo == NULL || level->factions == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < level->factionCount; ++i) {
+        outInfo[i].id = (int32_t)level->factions[i].id;
+        for (size_t c = 0; c < 4; ++c) {
+            outInfo[i].color[c] = level->factions[i].color[c];
+        }
+
+        // Include team metadata so clients can enforce friendly and shared control behavior.
+        outInfo[i].teamNumber = (int32_t)level->factions[i].teamNumber;
+        outInfo[i].sharedControlNumber = (int32_t)level->factions[i].sharedControlNumber;
+    }
+}
+
+/**
+ * Sets the level's factions from their network representation.
+ * The level must already be configured with at least count factions.
+ * Network packets do not carry AI assignments, so those are cleared.
+ * @param level A pointer to the Level whose factions to set.
+ * @param info Array of faction info entries, in faction order.
+ * @param count The number of entries in info.
+ */
+void LevelReadFactionInfo(Level *level, const LevelPacketFactionInfo *info, size_t count) {
+    // Basic validation of parameters.
+    if (level == NULL || info == NULL || level->factions == NULL || count > level->factionCount) {
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        level->factions[i].id = (int)info[i].id;
+        for (size_t c = 0; c < 4; ++c) {
+            level->factions[i].color[c] = info[i].color[c];
+        }
+
+        // Team metadata is required for friendly-fire and shared control rules.
+        // We route through setters so invalid values normalize to "none".
+        FactionSetTeamNumber(&level->factions[i], (int)info[i].teamNumber);
+        FactionSetSharedControlNumber(&level->factions[i], (int)info[i].sharedControlNumber);
+
+        // Network packets do not carry AI assignments, so we clear them here.
+        level->factions[i].aiPersonality = NULL;
+    }
+}
+
+/**
+ * Mixes bytes into a running 64-bit FNV-1a hash.
+ * FNV-1a works byte by byte: xor the byte in, then multiply by the FNV prime.
+ * It is not cryptographic, but it is simple, fast, and spreads even single-bit changes across the whole hash.
+ * @param hash The hash so far, starting from the FNV-1a offset basis.
+ * @param data The bytes to mix in.
+ * @param size The number of bytes.
+ * @return The updated hash.
+ */
+static uint64_t LevelHashBytes(uint64_t hash, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= (uint64_t)bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+/**
+ * Computes a hash of the level's layout and state: its bounds, factions and planets.
+ * Two levels with the same hash were, for all practical purposes, laid out identically,
+ * which is how a client checks that the starting level it generated itself matches the server's.
+ * Every value is hashed by its exact bits, so even the slightest difference in a planet's position changes the hash.
+ * Starships are left out, since a level is only hashed before any have been launched.
+ * @param level A pointer to the Level to hash.
+ * @return The hash of the level, which is never 0.
+ */
+uint64_t LevelComputeLayoutHash(const Level *level) {
+    // The FNV-1a 64-bit offset basis.
+    uint64_t hash = 0xCBF29CE484222325ull;
+    if (level == NULL) {
+        return hash;
+    }
+
+    // Values are copied into fixed-size integers first, so the hash does not depend on
+    // the size of size_t, or on any padding between the fields of a struct.
+    uint32_t counts[2] = {(uint32_t)level->factionCount, (uint32_t)level->planetCount};
+    hash = LevelHashBytes(hash, &level->width, sizeof(level->width));
+    hash = LevelHashBytes(hash, &level->height, sizeof(level->height));
+    hash = LevelHashBytes(hash, counts, sizeof(counts));
+
+    for (size_t i = 0; i < level->factionCount && level->factions != NULL; ++i) {
+        const Faction *faction = &level->factions[i];
+        int32_t values[3] = {(int32_t)faction->id, (int32_t)faction->teamNumber, (int32_t)faction->sharedControlNumber};
+        hash = LevelHashBytes(hash, values, sizeof(values));
+        hash = LevelHashBytes(hash, faction->color, sizeof(faction->color));
+    }
+
+    for (size_t i = 0; i < level->planetCount && level->planets != NULL; ++i) {
+        const Planet *planet = &level->planets[i];
+        float values[4] = {planet->position.x, planet->position.y, planet->maxFleetCapacity, planet->currentFleetSize};
+        int32_t ids[2] = {
+            planet->owner != NULL ? (int32_t)planet->owner->id : -1,
+            planet->claimant != NULL ? (int32_t)planet->claimant->id : -1
+        };
+        hash = LevelHashBytes(hash, values, sizeof(values));
+        hash = LevelHashBytes(hash, ids, sizeof(ids));
+    }
+
+    // 0 is kept to mean "no hash", so it is never returned.
+    return hash != 0u ? hash : 1u;
+}
+
+/**
+ * Computes a hash of the level's simulation state as it stands: the planets' owners, claimants
+ * and fleet sizes, and every starship's position, velocity, weight, owner and target.
+ * Two runs of the simulation which produce the same hashes tick after tick agree on every bit of it,
+ * which is how the determinism replay checks that two builds simulate a match identically.
+ * Fleet indices and IDs are left out, since they are bookkeeping which may differ between
+ * a server and a client without the simulation differing at all.
+ * @param level A pointer to the Level to hash.
+ * @return The hash of the level's state, which is never 0.
+ */
+uint64_t LevelComputeStateHash(const Level *level) {
+    // The FNV-1a 64-bit offset basis.
+    uint64_t hash = 0xCBF29CE484222325ull;
+    if (level == NULL) {
+        return hash;
+    }
+
+    // As in LevelComputeLayoutHash, values are copied into fixed-size integers and floats first.
+    uint32_t counts[2] = {(uint32_t)level->planetCount, (uint32_t)level->starshipCount};
+    hash = LevelHashBytes(hash, counts, sizeof(counts));
+
+    for (size_t i = 0; i < level->planetCount && level->planets != NULL; ++i) {
+        const Planet *planet = &level->planets[i];
+        int32_t ids[2] = {
+            planet->owner != NULL ? (int32_t)planet->owner->id : -1,
+            planet->claimant != NULL ? (int32_t)planet->claimant->id : -1
+        };
+        hash = LevelHashBytes(hash, &planet->currentFleetSize, sizeof(planet->currentFleetSize));
+        hash = LevelHashBytes(hash, ids, sizeof(ids));
+    }
+
+    for (size_t i = 0; i < level->starshipCount && level->starships != NULL; ++i) {
+        const Starship *ship = &level->starships[i];
+        const Fleet *fleet = ship->fleetIndex < level->fleetCount ? &level->fleets[ship->fleetIndex] : NULL;
+        float values[4] = {ship->position.x, ship->position.y, ship->velocity.x, ship->velocity.y};
+
+        // The fleet is identified by what it means instead: who owns it and which planet it is bound for.
+        int32_t ids[3] = {
+            (int32_t)ship->weight,
+            fleet != NULL && fleet->owner != NULL ? (int32_t)fleet->owner->id : -1,
+            fleet != NULL && fleet->target != NULL ? (int32_t)(fleet->target - level->planets) : -1
+        };
+        hash = LevelHashBytes(hash, values, sizeof(values));
+        hash = LevelHashBytes(hash, ids, sizeof(ids));
+    }
+
+    // 0 is kept to mean "no hash", so it is never returned.
+    return hash != 0u ? hash : 1u;
+}
+
 /**
  * Applies a snapshot packet to the provided Level instance.
  * Static level data (positions, faction colors, etc.) must already be present.
@@ -762,6 +1430,8 @@ static int32_t ResolvePlanetIndex(const Level *level, const Planet *planet) {
  * Creates a full level packet buffer for network transmission.
  * This function allocates memory for the packet buffer and fills it with
  * the full state of the level, including factions, planets, and starships.
+ * If the level was laid out from a map file, only the planets' dynamic state is included,
+ * since whoever receives the packet is expected to already have the map.
  * The caller is responsible for releasing the packet buffer using
  * LevelPacketBufferRelease when done.
  * @param level A pointer to the Level object.
@@ -795,12 +1465,16 @@ bool LevelCreateFullPacketBuffer(const Level *level, LevelPacketBuffer *outBuffe
         return false;
     }
 
+    // A level laid out from a map file leaves out whatever the receiver can read from the map itself.
+    bool fromMap = level->mapHash != 0u;
+    size_t planetInfoSize = fromMap ? sizeof(LevelPacketPlanetSnapshotInfo) : sizeof(LevelPacketPlanetFullInfo);
+
     // Now we can calculate the total size of the packet buffer we need to allocate.
     // It's a simple sum of the sizes of the header and all the arrays,
     // with each array itself simply being the count of elements times the size of each element.
     size_t totalSize = sizeof(LevelFullPacket)
         + factionCount * sizeof(LevelPacketFactionInfo)
-        + planetCount * sizeof(LevelPacketPlanetFullInfo)
+        + planetCount * planetInfoSize
         + starshipCount * sizeof(LevelPacketStarshipInfo);
 
     // This will be the buffer that holds all our packet data.
@@ -818,45 +1492,48 @@ bool LevelCreateFullPacketBuffer(const Level *level, LevelPacketBuffer *outBuffe
     header->factionCount = (uint32_t)factionCount;
     header->planetCount = (uint32_t)planetCount;
     header->starshipCount = (uint32_t)starshipCount;
+    header->mapHash = level->mapHash;
 
     // Then we fill in the faction info array.
     // We use a cursor to keep track of where we are in the buffer.
     uint8_t *cursor = buffer + sizeof(LevelFullPacket);
-    LevelPacketFactionInfo *factionInfo = (LevelPacketFactionInfo *)cursor;
-    for (size_t i = 0; i < factionCount; ++i) {
-        factionInfo[i].id = (int32_t)level->factions[i].id;
-        for (size_t c = 0; c < 4; ++c) {
-            factionInfo[i].color[c] = level->factions[i].color[c];
-        }
-
-        // Include team metadata so clients can enforce friendly and shared control behavior.
-        factionInfo[i].teamNumber = (int32_t)level->factions[i].teamNumber;
-        factionInfo[i].sharedControlNumber = (int32_t)level->factions[i].sharedControlNumber;
-    }
+    LevelWriteFactionInfo(level, (LevelPacketFactionInfo *)cursor);
 
     // Now we advance the cursor past the faction info array
     // and fill in the planet info array.
     cursor += factionCount * sizeof(LevelPacketFactionInfo);
-    LevelPacketPlanetFullInfo *planetInfo = (LevelPacketPlanetFullInfo *)cursor;
-    for (size_t i = 0; i < planetCount; ++i) {
-        const Planet *planet = &level->planets[i];
-        planetInfo[i].position = planet->position;
-        planetInfo[i].maxFleetCapacity = planet->maxFleetCapacity;
-        planetInfo[i].currentFleetSize = planet->currentFleetSize;
-        planetInfo[i].ownerId = ResolveFactionId(planet->owner);
-        planetInfo[i].claimantId = ResolveFactionId(planet->claimant);
+    if (fromMap) {
+        LevelPacketPlanetSnapshotInfo *planetInfo = (LevelPacketPlanetSnapshotInfo *)cursor;
+        for (size_t i = 0; i < planetCount; ++i) {
+            const Planet *planet = &level->planets[i];
+            planetInfo[i].currentFleetSize = planet->currentFleetSize;
+            planetInfo[i].ownerId = ResolveFactionId(planet->owner);
+            planetInfo[i].claimantId = ResolveFactionId(planet->claimant);
+        }
+    } else {
+        LevelPacketPlanetFullInfo *planetInfo = (LevelPacketPlanetFullInfo *)cursor;
+        for (size_t i = 0; i < planetCount; ++i) {
+            const Planet *planet = &level->planets[i];
+            planetInfo[i].position = planet->position;
+            planetInfo[i].maxFleetCapacity = planet->maxFleetCapacity;
+            planetInfo[i].currentFleetSize = planet->currentFleetSize;
+            planetInfo[i].ownerId = ResolveFactionId(planet->owner);
+            planetInfo[i].claimantId = ResolveFactionId(planet->claimant);
+        }
     }
 
     // Finally, we advance the cursor past the planet info array
     // and fill in the starship info array.
-    cursor += planetCount * sizeof(LevelPacketPlanetFullInfo);
+    cursor += planetCount * planetInfoSize;
     LevelPacketStarshipInfo *starshipInfo = (LevelPacketStarshipInfo *)cursor;
     for (size_t i = 0; i < starshipCount; ++i) {
         const Starship *ship = &level->starships[i];
         starshipInfo[i].position = ship->position;
         starshipInfo[i].velocity = ship->velocity;
-        starshipInfo[i].ownerId = ResolveFactionId(ship->owner);
-        starshipInfo[i].targetPlanetIndex = ResolvePlanetIndex(level, ship->target);
+        const Fleet *fleet = ship->fleetIndex < level->fleetCount ? &level->fleets[ship->fleetIndex] : NULL;
+        starshipInfo[i].ownerId = ResolveFactionId(fleet != NULL ? fleet->owner : NULL);
+        starshipInfo[i].targetPlanetIndex = ResolvePlanetIndex(level, fleet != NULL ? fleet->target : NULL);
+        starshipInfo[i].weight = ship->weight;
     }
 
     // We've filled in the entire buffer now,
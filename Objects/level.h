@@ -16,7 +16,10 @@
 #include "Objects/player.h"
 #include "Objects/faction.h"
 #include "Objects/planet.h"
+#include "Objects/fleet.h"
 #include "Objects/starship.h"
+#include "Utilities/cullingUtilities.h"
+#include "Utilities/soundManagerUtilities.h"
 
 // Packet type identifiers
 // If the first 4 bytes of a packet equal one of these values,
@@ -61,6 +64,42 @@
 // Type value for a lobby shared control update packet (client -> server)
 #define LEVEL_PACKET_TYPE_LOBBY_SHARED_CONTROL 13u
 
+// Type value for a map chunk request packet (client -> server)
+#define LEVEL_PACKET_TYPE_MAP_REQUEST 14u
+
+// Type value for a map chunk packet (server -> client)
+#define LEVEL_PACKET_TYPE_MAP_CHUNK 15u
+
+// Type value for a map ready packet (client -> server)
+#define LEVEL_PACKET_TYPE_MAP_READY 16u
+
+// Type value for a lobby delta packet (server -> clients)
+#define LEVEL_PACKET_TYPE_LOBBY_DELTA 17u
+
+// Type value for a lobby resync request packet (client -> server)
+#define LEVEL_PACKET_TYPE_LOBBY_RESYNC 18u
+
+// Type value for a full level request packet (client -> server)
+#define LEVEL_PACKET_TYPE_FULL_REQUEST 19u
+
+// Number of bytes of a map file carried by each map chunk packet.
+// Small enough that a chunk always fits in a single datagram with room to spare.
+#define LEVEL_MAP_CHUNK_SIZE 1024u
+
+// The most map chunks a client may ask for in one map request packet,
+// so a single small request can never make the server send a flood of data.
+#define LEVEL_MAP_MAX_CHUNKS_PER_REQUEST 32u
+
+// How many starships LevelSpawnFleet draws random numbers for at a time,
+// which bounds the scratch space it keeps on the stack.
+#define LEVEL_SPAWN_BATCH_SIZE 256u
+
+// The most starships LevelSpawnFleet simulates for a single launch.
+// Launches of more ships than this are simulated with this many starships,
+// each standing for several ships through its weight, which keeps the number of starships
+// (and with it the cost of updating and drawing them) bounded however large planets get.
+#define LEVEL_MAX_STARSHIPS_PER_LAUNCH 128u
+
 // Definitions of packet structures used for network transmission.
 // We use #pragma pack(push, 1) to ensure there is no padding added by the compiler.
 // This translates to "pack the following structures with 1-byte alignment".
@@ -106,18 +145,24 @@ typedef struct LevelPacketPlanetSnapshotInfo {
 
 // A LevelPacketStarshipInfo represents the network representation of a starship.
 // It is used to communicate starship information over the network.
-// A starship has a position, velocity, owner faction ID, and target planet index.
+// A starship has a position, velocity, owner faction ID, target planet index,
+// and the number of ships it stands for.
 typedef struct LevelPacketStarshipInfo {
     Vec2 position;
     Vec2 velocity;
     int32_t ownerId;
     int32_t targetPlanetIndex;
+    uint32_t weight;
 } LevelPacketStarshipInfo;
 
 // A LevelFullPacket represents the header of a full level packet.
 // It contains the type, dimensions, and counts of factions, planets, and starships.
 // This should be followed by arrays of faction info, planet info, and starship info
 // in that order to communicate the full state of the level.
+// If mapHash is not 0, the level was laid out from the map file with that hash,
+// which the receiver already has. In that case the planets' positions and capacities
+// are not sent at all, and the planet info is LevelPacketPlanetSnapshotInfo rather than
+// LevelPacketPlanetFullInfo, which keeps even very large maps within a single packet.
 typedef struct LevelFullPacket {
     uint32_t type;
     float width;
@@ -125,6 +170,7 @@ typedef struct LevelFullPacket {
     uint32_t factionCount;
     uint32_t planetCount;
     uint32_t starshipCount;
+    uint64_t mapHash; /* Hash of the map file the level was laid out from, or 0 for a generated level. */
 } LevelFullPacket;
 
 // A LevelSnapshotPacket represents the header of a planet snapshot packet.
@@ -192,8 +238,12 @@ typedef struct LevelLobbySlotInfo {
 
 // A LevelLobbyStatePacket communicates the lobby configuration and slot occupancy.
 // It is followed by factionCount LevelLobbySlotInfo entries.
+// This is the full lobby state, sent when a player joins, when the settings change,
+// and whenever a client asks for it because it missed a LevelLobbyDeltaPacket.
+// revision is the revision of the lobby the following deltas build upon.
 typedef struct LevelLobbyStatePacket {
     uint32_t type;
+    uint32_t revision;
     uint32_t factionCount;
     uint32_t planetCount;
     float minFleetCapacity;
@@ -202,11 +252,48 @@ typedef struct LevelLobbyStatePacket {
     float levelHeight;
     uint32_t randomSeed;
     uint32_t occupiedCount;
+    uint64_t mapHash; /* Hash of the map file the match will be played on, or 0 for a generated level. */
+    uint32_t mapSize; /* Size in bytes of that map file, or 0 for a generated level. */
 } LevelLobbyStatePacket;
 
+// A LevelLobbyDeltaPacket communicates only the lobby slots that changed since the previous revision,
+// which is most changes, such as players joining or picking colors and teams.
+// It is followed by slotCount LevelLobbySlotInfo entries, each replacing the slot whose index is its factionId.
+// A client may only apply it if it is at baseRevision, otherwise it missed something
+// and must ask for the full state again with a LevelLobbyResyncPacket.
+typedef struct LevelLobbyDeltaPacket {
+    uint32_t type;
+    uint32_t baseRevision; /* Revision the client must be at to apply this delta. */
+    uint32_t revision; /* Revision the client is at after applying this delta. */
+    uint32_t occupiedCount;
+    uint32_t slotCount;
+} LevelLobbyDeltaPacket;
+
+// A LevelLobbyResyncPacket asks the server for the full lobby state,
+// sent by clients which received a delta they could not apply.
+typedef struct LevelLobbyResyncPacket {
+    uint32_t type;
+    uint32_t revision; /* Revision the client is currently at, for logging. */
+} LevelLobbyResyncPacket;
+
 // A LevelStartGamePacket notifies clients that the lobby is transitioning into gameplay.
+// It carries everything needed to lay the starting level out locally, exactly as the server did:
+// the generation settings and seed (or the hash of the map file the level is laid out from),
+// followed by factionCount LevelPacketFactionInfo entries for the faction roster.
+// Clients lay the level out themselves and compare LevelComputeLayoutHash of the result against layoutHash,
+// and only if the two differ ask for the whole level with a LevelFullRequestPacket,
+// so starting a match costs the same few bytes however large the level is.
 typedef struct LevelStartGamePacket {
     uint32_t type;
+    uint32_t factionCount;
+    uint32_t planetCount;
+    float minFleetCapacity;
+    float maxFleetCapacity;
+    float width;
+    float height;
+    uint32_t seed; /* Seed passed to GenerateRandomLevel, unused when laid out from a map file. */
+    uint64_t mapHash; /* Hash of the map file the level is laid out from, or 0 for a generated level. */
+    uint64_t layoutHash; /* LevelComputeLayoutHash of the starting level. */
 } LevelStartGamePacket;
 
 // A LevelLobbyColorPacket communicates a faction color selection change.
@@ -236,6 +323,41 @@ typedef struct LevelLobbySharedControlPacket {
     int32_t sharedControlNumber;
 } LevelLobbySharedControlPacket;
 
+// A LevelMapRequestPacket asks the server for chunkCount chunks of the map file with the given hash,
+// starting at chunk firstChunk. Sent by clients which do not have the lobby's map cached yet.
+typedef struct LevelMapRequestPacket {
+    uint32_t type;
+    uint64_t mapHash;
+    uint32_t firstChunk;
+    uint32_t chunkCount;
+} LevelMapRequestPacket;
+
+// A LevelMapChunkPacket carries one chunk of a map file, in answer to a map request.
+// It is followed by length bytes of the map file, starting at chunkIndex * LEVEL_MAP_CHUNK_SIZE.
+typedef struct LevelMapChunkPacket {
+    uint32_t type;
+    uint64_t mapHash;
+    uint32_t mapSize;
+    uint32_t chunkIndex;
+    uint32_t length;
+    uint8_t data[];
+} LevelMapChunkPacket;
+
+// A LevelMapReadyPacket tells the server that the client has the map file with the given hash,
+// whether it was cached already or has just finished downloading it.
+typedef struct LevelMapReadyPacket {
+    uint32_t type;
+    uint64_t mapHash;
+} LevelMapReadyPacket;
+
+// A LevelFullRequestPacket asks the server for the full level state,
+// sent by clients whose locally laid out starting level did not match the server's,
+// and by clients receiving snapshots of a match whose start game packet never reached them.
+typedef struct LevelFullRequestPacket {
+    uint32_t type;
+    uint64_t layoutHash; /* LevelComputeLayoutHash of the level the client laid out, for logging, or 0 if it never got the start game packet. */
+} LevelFullRequestPacket;
+
 // A LevelMoveOrderPacket communicates a set of origin planets and a destination
 // planet for fleet movement requests. It is sent by clients to the server.
 // The packet is followed by originCount 32-bit planet indices.
@@ -265,6 +387,15 @@ typedef struct LevelPacketBuffer {
 // It manages the lifecycle and interactions of these objects.
 // It provides functions to initialize, release, configure, spawn starships, remove starships, and update the level state.
 // That said, the level does not handle rendering or user input directly.
+// A LevelAudioEvent gathers up everything that happened to one planet during a level update
+// that should be heard: how many ships arrived at it, and how many times it changed hands.
+// A planet has at most one event until the events are played, however many ships arrive.
+typedef struct LevelAudioEvent {
+    size_t planetIndex;
+    uint32_t impactCount;
+    uint32_t captureCount;
+} LevelAudioEvent;
+
 typedef struct Level {
     Faction *factions;
     size_t factionCount;
@@ -272,15 +403,48 @@ typedef struct Level {
     Planet *planets;
     size_t planetCount;
 
+    // One render cache per planet, parallel to the planets array.
+    // Only used by whoever draws the level, but owned here so it
+    // is created and released alongside the planets it belongs to.
+    PlanetRenderCache *planetRenderCaches;
+
+    // Grid used to find the planets within the camera's view without checking all of them.
+    // Like the render caches, it is only used for drawing. It is built the first time the
+    // level is culled and thrown away whenever the level is released.
+    PlanetCullingGrid planetCullingGrid;
+
     Starship *starships;
     size_t starshipCount;
     size_t starshipCapacity;
+
+    // Every launch still in flight, which the starships refer to by index (see fleet.h).
+    // fleetCount is one past the highest slot in use; slots below it whose fleets
+    // have no starships left are free, and are handed out again to later launches.
+    // nextFleetId is the ID the next fleet created will get.
+    Fleet *fleets;
+    size_t fleetCount;
+    size_t fleetCapacity;
+    uint32_t nextFleetId;
+
+    // Number of times LevelUpdate has been run on the level, used to stamp fleets with their launch tick.
+    uint32_t tick;
+
     StarshipTrailEffect *trailEffects;
     size_t trailEffectCount;
     size_t trailEffectCapacity;
 
+    // Sounds to play for what happened during updates since the last LevelPlayAudioEvents.
+    // Filled in by LevelUpdate, so the simulation itself never has to call into the sound manager.
+    LevelAudioEvent *audioEvents;
+    size_t audioEventCount;
+    size_t audioEventCapacity;
+
     float width;
     float height;
+
+    // Hash of the map file the planets were laid out from, or 0 if they were generated.
+    // See mapFileUtilities.h.
+    uint64_t mapHash;
 } Level;
 
 /**
@@ -313,11 +477,12 @@ void LevelRelease(Level *level);
 bool LevelConfigure(Level *level, size_t factionCount, size_t planetCount, size_t starshipCapacity);
 
 /**
- * Spawns a new starship in the level.
+ * Spawns a new starship in the level, as a fleet of its own.
  * This function will first check if there is enough memory allocated for starships
  * to fit the new starship. If not, it will attempt to resize the starship array.
  * If resizing fails, the function will return NULL.
- * Otherwise, it will create the starship and add it to the level's starship array.
+ * Otherwise, it will create a fleet of one with no origin planet, create the starship in it,
+ * and add it to the level's starship array.
  * It will then return a pointer to the newly spawned starship.
  * @param level A pointer to the Level object.
  * @param position The initial position of the starship.
@@ -328,6 +493,31 @@ bool LevelConfigure(Level *level, size_t factionCount, size_t planetCount, size_
  */
 Starship *LevelSpawnStarship(Level *level, Vec2 position, Vec2 velocity, const Faction *owner, Planet *target);
 
+/**
+ * Spawns a whole fleet of starships in the level at once, scattered randomly around the origin planet
+ * and heading away from it at STARSHIP_INITIAL_SPEED, all bound for the destination planet.
+ * At most LEVEL_MAX_STARSHIPS_PER_LAUNCH starships are spawned. If count is more than that,
+ * the ships are shared out between them as evenly as possible through their weights,
+ * with the first (count % LEVEL_MAX_STARSHIPS_PER_LAUNCH) starships standing for one ship more than the rest.
+ * Up to that limit, produces exactly the same starships, in the same order, from the same RNG state,
+ * as spawning them one by one with LevelSpawnStarship would, drawing a random angle
+ * and then a random offset from the spawn radius for each starship in turn,
+ * so the server and clients stay in sync whichever way they spawn fleets.
+ * Room for the whole fleet is made once up front, and the starships' trails are left empty
+ * rather than filled in with copies of their position, since no sample past a trail's count is ever read.
+ * All of the starships belong to a single new Fleet, stamped with the level's current tick.
+ * @param level A pointer to the Level object.
+ * @param origin A pointer to the Planet the fleet launches from.
+ * @param destination A pointer to the Planet the fleet is bound for.
+ * @param count The number of ships to launch.
+ * @param owner A pointer to the Faction that owns the starships.
+ * @param rngState Pointer to the RNG state used to randomize the starships' spawn positions.
+ * @return The number of ships launched, adding up the starships' weights,
+ *         which is either count or, if room could not be made for them, 0.
+ */
+size_t LevelSpawnFleet(Level *level, const Planet *origin, Planet *destination, size_t count,
+    const Faction *owner, unsigned int *rngState);
+
 /**
  * Removes a starship from the level at the specified index.
  * This function will remove the starship by replacing it with the last starship
@@ -347,6 +537,7 @@ Starship *LevelSpawnStarship(Level *level, Vec2 position, Vec2 velocity, const F
  * [*], [*], [*], [ ], [ ], [ ]
  * ```
  * and the starship count will be decremented.
+ * The starship's fleet is told it has one starship fewer, and its slot is freed if that was its last.
  * @param level A pointer to the Level object.
  * @param index The index of the starship to remove.
  */
@@ -365,6 +556,14 @@ void LevelRemoveStarship(Level *level, size_t index);
  */
 void LevelUpdate(Level *level, float deltaTime);
 
+/**
+ * Plays the sounds for everything gathered by LevelUpdate since the last call, then forgets them.
+ * Each planet gets at most one impact cue, however many ships arrived at it,
+ * played louder the more ships there were, and at most one capture cue.
+ * @param level A pointer to the Level whose audio events to play.
+ */
+void LevelPlayAudioEvents(Level *level);
+
 /**
  * Computes the centroid of planets owned by the given faction.
  * This is useful for camera centering and other UI defaults that should
@@ -376,10 +575,35 @@ void LevelUpdate(Level *level, float deltaTime);
  */
 bool LevelComputeFactionPlanetCentroid(const Level *level, const Faction *faction, Vec2 *outCentroid);
 
+/**
+ * Copies the game state of one level into another.
+ * Factions, planets, fleets, starships and trail effects are copied, and every pointer between them
+ * (such as a planet's owner or a fleet's target) is pointed at the destination's own copies.
+ * The destination's render caches and culling grid are kept as long as its planets
+ * are laid out exactly like the source's, so a level that is copied into over and over
+ * (for instance, once per frame for drawing) keeps its cached geometry.
+ * Otherwise the destination is configured again from scratch.
+ * @param destination A pointer to the Level to copy into. Must have been initialized.
+ * @param source A pointer to the Level to copy from.
+ * @return true if the state was copied, false otherwise.
+ */
+bool LevelCopyState(Level *destination, const Level *source);
+
+/**
+ * Moves every starship in the level to a point between its previous and current positions.
+ * Meant for a copy of the level that is only drawn, since the starships' positions are overwritten.
+ * @param level A pointer to the Level whose starships to move.
+ * @param alpha How far between the previous (0) and current (1) position to place each starship.
+ *              Values outside of 0 to 1 are clamped.
+ */
+void LevelInterpolateStarships(Level *level, float alpha);
+
 /**
  * Creates a full level packet buffer for network transmission.
  * This function allocates memory for the packet buffer and fills it with
  * the full state of the level, including factions, planets, and starships.
+ * If the level was laid out from a map file, only the planets' dynamic state is included,
+ * since whoever receives the packet is expected to already have the map.
  * The caller is responsible for releasing the packet buffer using
  * LevelPacketBufferRelease when done.
  * @param level A pointer to the Level object.
@@ -413,7 +637,12 @@ void LevelPacketBufferRelease(LevelPacketBuffer *buffer);
 /**
  * Applies a full level packet to the provided Level instance.
  * This populates factions, planets, and starships based on the packet data.
+ * The packet does not say which starships were launched together, so the starships
+ * are gathered back into fleets by owner and target, one fleet per pair.
  * Existing data in the level is replaced. The level must have been initialized.
+ * If the packet is for a level laid out from a map file, the level must already be
+ * configured with the packet's faction and planet counts and laid out from that same map
+ * (see MapFileApplyToLevel), since the packet does not carry the planets' positions or capacities.
  * @param level A pointer to the Level object to populate.
  * @param data A pointer to the packet data buffer.
  * @param size Size of the packet data buffer in bytes.
@@ -421,6 +650,46 @@ void LevelPacketBufferRelease(LevelPacketBuffer *buffer);
  */
 bool LevelApplyFullPacket(Level *level, const void *data, size_t size);
 
+/**
+ * Fills in the network representation of every faction in the level.
+ * @param level A pointer to the Level whose factions to describe.
+ * @param outInfo Receives level->factionCount faction info entries.
+ */
+void LevelWriteFactionInfo(const Level *level, LevelPacketFactionInfo *outInfo);
+
+/**
+ * Sets the level's factions from their network representation.
+ * The level must already be configured with at least count factions.
+ * Network packets do not carry AI assignments, so those are cleared.
+ * @param level A pointer to the Level whose factions to set.
+ * @param info Array of faction info entries, in faction order.
+ * @param count The number of entries in info.
+ */
+void LevelReadFactionInfo(Level *level, const LevelPacketFactionInfo *info, size_t count);
+
+/**
+ * Computes a hash of the level's layout and state: its bounds, factions and planets.
+ * Two levels with the same hash were, for all practical purposes, laid out identically,
+ * which is how a client checks that the starting level it generated itself matches the server's.
+ * Every value is hashed by its exact bits, so even the slightest difference in a planet's position changes the hash.
+ * Starships are left out, since a level is only hashed before any have been launched.
+ * @param level A pointer to the Level to hash.
+ * @return The hash of the level, which is never 0.
+ */
+uint64_t LevelComputeLayoutHash(const Level *level);
+
+/**
+ * Computes a hash of the level's simulation state as it stands: the planets' owners, claimants
+ * and fleet sizes, and every starship's position, velocity, weight, owner and target.
+ * Two runs of the simulation which produce the same hashes tick after tick agree on every bit of it,
+ * which is how the determinism replay checks that two builds simulate a match identically.
+ * Fleet indices and IDs are left out, since they are bookkeeping which may differ between
+ * a server and a client without the simulation differing at all.
+ * @param level A pointer to the Level to hash.
+ * @return The hash of the level's state, which is never 0.
+ */
+uint64_t LevelComputeStateHash(const Level *level);
+
 /**
  * Applies a snapshot packet to the provided Level instance.
  * Static level data (positions, faction colors, etc.) must already be present.
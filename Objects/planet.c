@@ -40,6 +40,9 @@ static const float OWNED_GLOW_RADIUS_MULTIPLIER = 1.4f;
 static const float PLANET_RING_FEATHER = 1.5f;
 static const float PLANET_DISC_FEATHER = 1.2f;
 
+// Number of segments used for the planet glows at full detail.
+static const int PLANET_GLOW_SEGMENTS = 128;
+
 /**
  * Creates a new planet with the specified position, max fleet capacity, and owner.
  * The planet's current fleet size is initialized to 0.0f.
@@ -244,6 +247,27 @@ float PlanetGetCollisionRadius(const Planet *planet) {
     return fmaxf(outerRadius, innerRadius);
 }
 
+/**
+ * Gets the visual radius of the planet.
+ * This is the radius of the smallest circle around the planet's position
+ * that contains everything PlanetDraw may draw for it, glow included.
+ * Used to decide whether the planet is visible on screen.
+ * @param planet A pointer to the Planet object.
+ * @return The visual radius of the planet.
+ */
+float PlanetGetVisualRadius(const Planet *planet) {
+    if (planet == NULL) {
+        return 0.0f;
+    }
+
+    // The largest thing we draw is the white glow, which extends GLOW_RADIUS_MULTIPLIER
+    // times past the inner disc of an owned planet (or the claim highlight of a claimed one).
+    // Both of those are bounded by the larger of the two radii, and the ring
+    // itself never extends past the outer radius.
+    float glowMultiplier = fmaxf(GLOW_RADIUS_MULTIPLIER, OWNED_GLOW_RADIUS_MULTIPLIER);
+    return PlanetGetCollisionRadius(planet) * fmaxf(glowMultiplier, 1.0f);
+}
+
 /**
  * Helper function to draw the claim progress of an unowned planet.
  * This function draws a circle which is filled inwards up to a certain radius,
@@ -306,8 +330,10 @@ static void DrawClaimProgress(const Planet *planet) {
     float glowHighlightOuterColor[4] = {1.0f, 1.0f, 1.0f, 0.0f};
 
     // Must blending for the highlight effect.
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ALPHA);
+
+    // The glow is soft enough that fewer segments go unnoticed when zoomed out.
+    int glowSegments = ComputeDetailSegments(PLANET_GLOW_SEGMENTS);
 
     // We must again invert the inner radius ratio
     // since we are filling outwards from the center.
@@ -315,13 +341,11 @@ static void DrawClaimProgress(const Planet *planet) {
 
     // Draw the faction colored bits of the inner highlight.
     DrawRadialGradientRing(planet->position.x, planet->position.y,
-        0.0f, innerGlowRadius * GLOW_RADIUS_MULTIPLIER, 128, highlightInnerColor, highlightOuterColor);
+        0.0f, innerGlowRadius * GLOW_RADIUS_MULTIPLIER, glowSegments, highlightInnerColor, highlightOuterColor);
 
     // We also make it glow a bit.
     DrawRadialGradientRing(planet->position.x, planet->position.y,
-        0.0f, innerGlowRadius * OWNED_GLOW_RADIUS_MULTIPLIER, 128, glowHighlightInnerColor, glowHighlightOuterColor);
-    // Clean up blending state.
-    glDisable(GL_BLEND);
+        0.0f, innerGlowRadius * OWNED_GLOW_RADIUS_MULTIPLIER, glowSegments, glowHighlightInnerColor, glowHighlightOuterColor);
 }
 
 /**
@@ -374,8 +398,8 @@ void PlanetDraw(const Planet *planet) {
         // and we tinge this glow with the faction's color.
 
         // Enable blending for the glow effect.
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        // The render batch resets blending itself once the glow has been submitted.
+        RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ALPHA);
 
         // Controls the glow's color at the center of the planet.
         float innerGlowColor[4] = {1.0f, 1.0f, 1.0f, GLOW_ALPHA};
@@ -390,16 +414,16 @@ void PlanetDraw(const Planet *planet) {
         float factionGlowColorOuter[4] = {planet->owner->color[0], planet->owner->color[1],
             planet->owner->color[2], 0.0f};
 
+        // The glow is soft enough that fewer segments go unnoticed when zoomed out.
+        int glowSegments = ComputeDetailSegments(PLANET_GLOW_SEGMENTS);
+
         // Draw the faction colored glow.
         DrawRadialGradientRing(planet->position.x, planet->position.y,
-            0.0f, radius * OWNED_GLOW_RADIUS_MULTIPLIER, 128, factionGlowColorInner, factionGlowColorOuter);
+            0.0f, radius * OWNED_GLOW_RADIUS_MULTIPLIER, glowSegments, factionGlowColorInner, factionGlowColorOuter);
         
         // Draw the white glow.
         DrawRadialGradientRing(planet->position.x, planet->position.y,
-            0.0f, radius * GLOW_RADIUS_MULTIPLIER, 128, innerGlowColor, outerGlowColor);
-
-        // Reset blending after drawing the glow.
-        glDisable(GL_BLEND);
+            0.0f, radius * GLOW_RADIUS_MULTIPLIER, glowSegments, innerGlowColor, outerGlowColor);
     } else if (planet->claimant != NULL) {
         // If unowned but claimed, draw in claimant's color.
         DrawClaimProgress(planet);
@@ -456,30 +480,132 @@ static void SpawnShipCircle(Level *level, Planet *origin, Planet *destination, i
  * @param destination A pointer to the destination Planet object.
  * @param shipCount The number of starships to spawn.
  * @param shipSpawnRNGState Pointer to the RNG state used to randomize ship spawn positions.
+ * @return true if the starships were spawned, false if there was no room for them in the level,
+ *         in which case none were.
  */
-static void SpawnShipRandom(Level *level, Planet *origin, Planet *destination,
+static bool SpawnShipRandom(Level *level, Planet *origin, Planet *destination,
     int shipCount, unsigned int *shipSpawnRNGState) {
     if (shipCount <= 0) {
+        return false;
+    }
+
+    // The level spawns the whole fleet in one go, see LevelSpawnFleet.
+    return LevelSpawnFleet(level, origin, destination, (size_t)shipCount, origin->owner, shipSpawnRNGState) > 0;
+}
+
+/**
+ * Helper function to copy a faction's color into a cache key,
+ * recording whether there was a faction at all.
+ * @param faction The faction whose color to copy, or NULL.
+ * @param outPresent Set to whether faction was non-NULL.
+ * @param outColor An array of 4 floats to receive the color, zeroed when faction is NULL.
+ */
+static void CopyCacheKeyColor(const Faction *faction, bool *outPresent, float outColor[4]) {
+    *outPresent = faction != NULL;
+    for (int i = 0; i < 4; ++i) {
+        outColor[i] = faction != NULL ? faction->color[i] : 0.0f;
+    }
+}
+
+/**
+ * Checks whether the geometry held in a cache still matches how the planet currently looks.
+ * @param planet A pointer to the Planet object.
+ * @param cache A pointer to the planet's render cache.
+ * @return true if the cached geometry can be reused, false if it must be rebuilt.
+ */
+bool PlanetRenderCacheMatches(const Planet *planet, const PlanetRenderCache *cache) {
+    if (!cache->valid) {
+        return false;
+    }
+
+    // Segment counts depend on the detail scale, so a different scale means different geometry.
+    if (cache->detailScale != RenderGetDetailScale()) {
+        return false;
+    }
+
+    if (cache->position.x != planet->position.x || cache->position.y != planet->position.y
+        || cache->maxFleetCapacity != planet->maxFleetCapacity
+        || cache->currentFleetSize != planet->currentFleetSize) {
+        return false;
+    }
+
+    bool hasOwner;
+    float ownerColor[4];
+    CopyCacheKeyColor(planet->owner, &hasOwner, ownerColor);
+    bool hasClaimant;
+    float claimantColor[4];
+    CopyCacheKeyColor(planet->claimant, &hasClaimant, claimantColor);
+
+    if (hasOwner != cache->hasOwner || hasClaimant != cache->hasClaimant) {
+        return false;
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        if (ownerColor[i] != cache->ownerColor[i] || claimantColor[i] != cache->claimantColor[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Draws the planet the same way PlanetDraw does, but reuses the
+ * geometry held in the given cache whenever the planet's position,
+ * fleet size, capacity, owner color, claimant color and the detail scale are unchanged.
+ * The cache is rebuilt automatically when any of them change.
+ * @param planet A pointer to the Planet object to draw.
+ * @param cache A pointer to the planet's render cache, or NULL to draw without caching.
+ */
+void PlanetDrawCached(const Planet *planet, PlanetRenderCache *cache) {
+    if (planet == NULL) {
         return;
     }
-    
-    float spawnRadius = STARSHIP_RADIUS * 1.5f;
 
-    for (int i = 0; i < shipCount; ++i) {
-        // Random angle around the planet.
-        float angle = RandomRange(shipSpawnRNGState, 0.0f, 2.0f * (float)M_PI);
-        Vec2 direction = {cosf(angle), sinf(angle)};
-        
-        // Random offset from the spawn radius to avoid perfect circle formation.
-        float offset = RandomRange(shipSpawnRNGState, -STARSHIP_RADIUS, STARSHIP_RADIUS);
-        Vec2 position = Vec2Add(origin->position, Vec2Scale(direction, spawnRadius + offset));
-        Vec2 velocity = Vec2Scale(direction, STARSHIP_INITIAL_SPEED);
+    // Without a cache we simply tessellate from scratch.
+    if (cache == NULL) {
+        PlanetDraw(planet);
+        return;
+    }
 
-        // Spawn the starship at the given randomized position, heading towards the destination planet.
-        if (LevelSpawnStarship(level, position, velocity, origin->owner, destination) == NULL) {
-            break;
+    if (!PlanetRenderCacheMatches(planet, cache)) {
+        // Record a fresh tessellation into the cache.
+        // Every part of a planet is made of triangles, so a single recording holds all of it.
+        cache->valid = false;
+        if (!RenderBatchBeginRecording(&cache->geometry, RENDER_BATCH_PRIMITIVE_TRIANGLES)) {
+            PlanetDraw(planet);
+            return;
         }
+        PlanetDraw(planet);
+        RenderBatchEndRecording();
+
+        cache->detailScale = RenderGetDetailScale();
+        cache->position = planet->position;
+        cache->maxFleetCapacity = planet->maxFleetCapacity;
+        cache->currentFleetSize = planet->currentFleetSize;
+        CopyCacheKeyColor(planet->owner, &cache->hasOwner, cache->ownerColor);
+        CopyCacheKeyColor(planet->claimant, &cache->hasClaimant, cache->claimantColor);
+        cache->valid = true;
+    }
+
+    // Every piece of a planet is drawn with alpha blending,
+    // so the whole recording can be drawn in one go.
+    RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ALPHA);
+    RenderBatchDrawRecording(&cache->geometry);
+}
+
+/**
+ * Releases the memory held by a planet render cache
+ * and marks it as invalid so that it is rebuilt if used again.
+ * @param cache A pointer to the render cache to release.
+ */
+void PlanetRenderCacheRelease(PlanetRenderCache *cache) {
+    if (cache == NULL) {
+        return;
     }
+
+    RenderBatchRecordingRelease(&cache->geometry);
+    cache->valid = false;
 }
 
 /**
@@ -521,10 +647,15 @@ bool PlanetSendFleet(Planet *origin, Planet *destination, Level *level, unsigned
 
     // Reduce the origin planet's fleet size to 0.0f
     // since we are sending all available ships.
+    float previousFleetSize = origin->currentFleetSize;
     origin->currentFleetSize = 0.0f;
 
     // Actually spawn the starship objects into the level.
-    SpawnShipRandom(level, origin, destination, shipCount, shipSpawnRNGState);
+    // Should there be no room for them, the ships stay home rather than vanishing.
+    if (!SpawnShipRandom(level, origin, destination, shipCount, shipSpawnRNGState)) {
+        origin->currentFleetSize = previousFleetSize;
+        return false;
+    }
     return true;
 }
 
@@ -564,50 +695,85 @@ bool PlanetSimulateFleetLaunch(Planet *origin, Planet *destination, Level *level
     // This way, if a client has seriously lagged behind and the planet was unowned for them,
     // they can still correctly simulate the fleet launch as intended by the server,
     // and somewhat more accurately reflect the level's state (at least, that's the idea).
+    const Faction *previousOwner = origin->owner;
     if (origin->owner == NULL) {
         origin->owner = owner;
     }
 
     // Analogous to PlanetSendFleet, we reduce the origin planet's fleet size to 0.0f
-    // since we are sending all available ships.
+    // since we are sending all available ships, and put everything back should there be no room for them.
+    float previousFleetSize = origin->currentFleetSize;
     origin->currentFleetSize = 0.0f;
-    SpawnShipRandom(level, origin, destination, shipCount, shipSpawnRNGState);
+    if (!SpawnShipRandom(level, origin, destination, shipCount, shipSpawnRNGState)) {
+        origin->owner = previousOwner;
+        origin->currentFleetSize = previousFleetSize;
+        return false;
+    }
     return true;
 }
 
+/**
+ * Helper function to count how many whole ships it takes to make up at least the given amount
+ * of fleet size, for working out which of the ships a starship stands for is the one that changes
+ * the planet's situation. Since it is always the arrival of a ship that does so, this is never less than 1.
+ * @param amount The amount of fleet size the ships must make up.
+ * @return The number of ships needed, from 1 up to UINT32_MAX.
+ */
+static uint32_t PlanetShipsNeeded(float amount) {
+    if (amount <= 1.0f) {
+        return 1u;
+    }
+    if (amount >= (float)UINT32_MAX) {
+        return UINT32_MAX;
+    }
+    return (uint32_t)ceilf(amount);
+}
+
 /**
  * Handles an incoming starship to the planet.
  * This function processes the interaction between the incoming starship and the planet.
  * Depending on the ownership and claimant status of the planet,
  * it updates the planet's current fleet size, owner, and claimant accordingly.
+ * A starship standing for several ships (see Starship.weight) has exactly the same effect
+ * as that many ships arriving one after the other, so gameplay does not depend on
+ * how many starships a launch was simulated with.
+ * Nothing is played here; the caller decides what the arrival should sound like.
  * @param planet A pointer to the Planet object receiving the starship.
- * @param ship A pointer to the incoming Starship object.
+ * @param fleet A pointer to the Fleet the incoming starship belongs to.
+ * @param weight The number of ships the incoming starship stands for.
+ * @return true if the ship caused the planet to change owner, false otherwise.
  */
-void PlanetHandleIncomingShip(Planet *planet, const Starship *ship) {
-    if (planet == NULL || ship == NULL || ship->owner == NULL) {
-        return;
+bool PlanetHandleIncomingShip(Planet *planet, const Fleet *fleet, uint32_t weight) {
+    if (planet == NULL || fleet == NULL || fleet->owner == NULL) {
+        return false;
     }
 
-    // Play a lightweight impact cue so collisions feel more tactile.
-    SoundManagerPlayShipImpact();
-
-    // We assume that the ship has an owner faction.
-    const Faction *attacker = ship->owner;
+    // We assume that the ship's fleet has an owner faction.
+    const Faction *attacker = fleet->owner;
+    bool captured = false;
+
+    // The ships are handled in runs. Each pass through the loop lands as many of the remaining ships
+    // as land in the same way, which is all of them unless the planet changes hands (or claimants) partway,
+    // in which case the ships after that point land on what is now a different situation.
+    while (weight > 0) {
+        // Handle the interaction based on the planet's ownership status.
+        if (planet->owner != NULL) {
+            // Planet is owned.
+            if (FactionIsFriendly(planet->owner, attacker)) {
+                // Friendly reinforcements strengthen allied planets,
+                // allowing for more interesting cooperative team play.
+                planet->currentFleetSize += (float)weight;
+                break;
+            }
 
-    // Handle the interaction based on the planet's ownership status.
-    if (planet->owner != NULL) {
-        // Planet is owned.
-        if (FactionIsFriendly(planet->owner, attacker)) {
-            // Friendly reinforcements strengthen allied planets,
-            // allowing for more interesting cooperative team play.
-            planet->currentFleetSize += 1.0f;
-            return;
-        }
+            // Otherwise each ship from attacker decreases fleet size by 1.0f.
+            // It takes the first ship to bring the fleet size below zero to take the planet.
+            uint32_t needed = PlanetShipsNeeded(floorf(planet->currentFleetSize) + 1.0f);
+            if (weight < needed) {
+                planet->currentFleetSize -= (float)weight;
+                break;
+            }
 
-        // Otherwise one ship from attacker decreases fleet size
-        // by 1.0f.
-        planet->currentFleetSize -= 1.0f;
-        if (planet->currentFleetSize < 0.0f) {
             // In case of negative fleet size,
             // it indicates the defending forces have been
             // totally reduced, and the current owners are
@@ -616,49 +782,71 @@ void PlanetHandleIncomingShip(Planet *planet, const Starship *ship) {
 
             // We need to make sure that the leftovers from the attacker which finished
             // off the defending forces are carried over to the new ownership.
+            planet->currentFleetSize -= (float)needed;
             float surplus = -planet->currentFleetSize;
             planet->owner = attacker;
             planet->claimant = NULL;
             planet->currentFleetSize = fmaxf(surplus, 1.0f);
 
-            // Ownership changed as a result of combat, so play a capture cue.
-            SoundManagerPlayPlanetCaptured();
+            // Ownership changed as a result of combat, so let the caller know.
+            // Any ships left over now reinforce the planet they just took.
+            captured = true;
+            weight -= needed;
+            continue;
         }
-        return;
-    }
 
-    // Planet is unowned and unclaimed.
-    if (planet->claimant == NULL) {
-        // First ship from attacker claims the planet.
-        planet->claimant = attacker;
-        planet->currentFleetSize = 1.0f;
-        return;
-    }
+        // Planet is unowned and unclaimed.
+        if (planet->claimant == NULL) {
+            // First ship from attacker claims the planet.
+            // Any ships after it advance the claim below.
+            planet->claimant = attacker;
+            planet->currentFleetSize = 1.0f;
+            weight -= 1;
+            continue;
+        }
+
+        // Planet is unowned but claimed.
+        if (FactionIsFriendly(planet->claimant, attacker)) {
+            // Friendly ships should advance the existing claim
+            // so allied teams can capture planets cooperatively.
+            if (planet->maxFleetCapacity <= 0.0f) {
+                planet->currentFleetSize += (float)weight;
+                break;
+            }
 
-    // Planet is unowned but claimed.
-    if (FactionIsFriendly(planet->claimant, attacker)) {
-        // Friendly ships should advance the existing claim
-        // so allied teams can capture planets cooperatively.
-        planet->currentFleetSize += 1.0f;
-        if (planet->currentFleetSize >= planet->maxFleetCapacity && planet->maxFleetCapacity > 0.0f) {
             // If the claimant's fleet size meets or exceeds max capacity,
             // they successfully capture the planet.
+            uint32_t needed = PlanetShipsNeeded(planet->maxFleetCapacity - planet->currentFleetSize);
+            if (weight < needed) {
+                planet->currentFleetSize += (float)weight;
+                break;
+            }
+
             planet->owner = planet->claimant;
             planet->claimant = NULL;
             planet->currentFleetSize = planet->maxFleetCapacity;
 
-            // Claimant has become the owner, so play the ownership change cue.
-            SoundManagerPlayPlanetCaptured();
+            // Claimant has become the owner, so let the caller know.
+            // Any ships left over now reinforce the planet they just took.
+            captured = true;
+            weight -= needed;
+            continue;
+        }
+
+        // Ship is from a different faction than the claimant.
+        // Each ship from attacker decreases fleet size by 1.0f,
+        // thereby interrupting the claimant's progress towards capturing the planet.
+        // The ship which brings it to zero (or below) claims the planet for the attacker instead.
+        uint32_t needed = PlanetShipsNeeded(planet->currentFleetSize);
+        if (weight < needed) {
+            planet->currentFleetSize -= (float)weight;
+            break;
         }
-        return;
-    }
 
-    // Ship is from a different faction than the claimant.
-    // One ship from attacker decreases fleet size by 1.0f,
-    // thereby interrupting the claimant's progress towards capturing the planet.
-    planet->currentFleetSize -= 1.0f;
-    if (planet->currentFleetSize <= 0.0f) {
         planet->claimant = attacker;
         planet->currentFleetSize = 1.0f;
+        weight -= needed;
     }
+
+    return captured;
 }
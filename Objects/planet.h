@@ -8,18 +8,18 @@
 #define _PLANET_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <GL/gl.h>
 #include <math.h>
 
 #include "Utilities/renderUtilities.h"
 #include "Objects/faction.h"
 #include "Objects/vec2.h"
-#include "Utilities/soundManagerUtilities.h"
 
 // Forward declarations
 // of necessary structs to avoid circular dependencies.
 struct Level;
-struct Starship;
+struct Fleet;
 
 // Planet constants
 
@@ -64,6 +64,31 @@ typedef struct Planet {
     const Faction *claimant;
 } Planet;
 
+// Cached tessellation of a planet.
+// Tessellating a planet's feathered rings, disc and glows takes thousands of vertices,
+// yet on most frames nothing about how a planet looks has changed.
+// So we keep the vertices produced the last time the planet was drawn,
+// along with everything that went into producing them.
+// As long as none of that changes, drawing the planet is just a copy of those vertices.
+typedef struct PlanetRenderCache {
+    // Whether geometry holds a valid tessellation at all.
+    bool valid;
+
+    // The planet state the cached geometry was built from,
+    // along with the detail scale it was tessellated at.
+    float detailScale;
+    Vec2 position;
+    float maxFleetCapacity;
+    float currentFleetSize;
+    bool hasOwner;
+    float ownerColor[4];
+    bool hasClaimant;
+    float claimantColor[4];
+
+    // The cached vertices, all alpha blended triangles.
+    RenderBatchRecording geometry;
+} PlanetRenderCache;
+
 /**
  * Creates a new planet with the specified position, max fleet capacity, and owner.
  * The planet's current fleet size is initialized to 0.0f.
@@ -94,6 +119,31 @@ void PlanetUpdate(Planet *planet, float deltaTime);
  */
 void PlanetDraw(const Planet *planet);
 
+/**
+ * Checks whether the geometry held in a cache still matches how the planet currently looks.
+ * @param planet A pointer to the Planet object.
+ * @param cache A pointer to the planet's render cache.
+ * @return true if the cached geometry can be reused, false if it must be rebuilt.
+ */
+bool PlanetRenderCacheMatches(const Planet *planet, const PlanetRenderCache *cache);
+
+/**
+ * Draws the planet the same way PlanetDraw does, but reuses the
+ * geometry held in the given cache whenever the planet's position,
+ * fleet size, capacity, owner color, claimant color and the detail scale are unchanged.
+ * The cache is rebuilt automatically when any of them change.
+ * @param planet A pointer to the Planet object to draw.
+ * @param cache A pointer to the planet's render cache, or NULL to draw without caching.
+ */
+void PlanetDrawCached(const Planet *planet, PlanetRenderCache *cache);
+
+/**
+ * Releases the memory held by a planet render cache
+ * and marks it as invalid so that it is rebuilt if used again.
+ * @param cache A pointer to the render cache to release.
+ */
+void PlanetRenderCacheRelease(PlanetRenderCache *cache);
+
 /**
  * Sends a fleet from the origin planet to the destination planet.
  * This function checks if the origin planet is owned and has enough fleet size to send.
@@ -131,10 +181,15 @@ bool PlanetSimulateFleetLaunch(Planet *origin, Planet *destination, struct Level
  * This function processes the interaction between the incoming starship and the planet.
  * Depending on the ownership and claimant status of the planet,
  * it updates the planet's current fleet size, owner, and claimant accordingly.
+ * A starship standing for several ships (see Starship.weight) has exactly the same effect
+ * as that many ships arriving one after the other.
+ * Nothing is played here; the caller decides what the arrival should sound like.
  * @param planet A pointer to the Planet object receiving the starship.
- * @param ship A pointer to the incoming Starship object.
+ * @param fleet A pointer to the Fleet the incoming starship belongs to.
+ * @param weight The number of ships the incoming starship stands for.
+ * @return true if the ship caused the planet to change owner, false otherwise.
  */
-void PlanetHandleIncomingShip(Planet *planet, const struct Starship *ship);
+bool PlanetHandleIncomingShip(Planet *planet, const struct Fleet *fleet, uint32_t weight);
 
 /**
  * Gets the outer radius of the planet based on its max fleet capacity.
@@ -164,4 +219,14 @@ float PlanetGetInnerRadius(const Planet *planet);
  */
 float PlanetGetCollisionRadius(const Planet *planet);
 
+/**
+ * Gets the visual radius of the planet.
+ * This is the radius of the smallest circle around the planet's position
+ * that contains everything PlanetDraw may draw for it, glow included.
+ * Used to decide whether the planet is visible on screen.
+ * @param planet A pointer to the Planet object.
+ * @return The visual radius of the planet.
+ */
+float PlanetGetVisualRadius(const Planet *planet);
+
 #endif // _PLANET_H_
@@ -42,6 +42,9 @@ void PlayerInit(Player *player, const Faction *faction, const SOCKADDR_IN *addre
     // on the server side for the sake of inactivity timeouts.
     player->inactivitySeconds = 0.0f;
 
+    // A new player has not told us about any map they have yet.
+    player->mapHash = 0u;
+
     // Clear the player name so stale data is never rendered before a join request arrives.
     PlayerSetName(player, "");
 }
@@ -23,7 +23,8 @@
 // A player represents a user in the game.
 // Each player is uniquely associated with a network/IPv4 address,
 // a faction they uniquely control, whether they are awaiting full level data,
-// and an inactivity timer used for timeouts on the server side.
+// an inactivity timer used for timeouts on the server side,
+// and the hash of the map file they have told the server they have, if any.
 typedef struct Player {
     const Faction *faction;
     int factionId;
@@ -31,6 +32,7 @@ typedef struct Player {
     char name[PLAYER_NAME_MAX_LENGTH + 1];
     bool awaitingFullPacket;
     float inactivitySeconds;
+    uint64_t mapHash;
 } Player;
 
 /**
@@ -1,7 +1,8 @@
 /**
  * Implements a starship object.
  * A starship represents a unit that can be sent from one planet to another.
- * A starship has a position, velocity, owner faction, and target planet.
+ * A starship has a position and velocity, and belongs to a fleet,
+ * which holds the owner faction and target planet it shares with the rest of its launch.
  * A starship will always accelerate towards its target planet until it reaches its maximum speed.
  * This acceleration is constant, and defined by STARSHIP_ACCELERATION.
  * Upon reaching its target planet, the starship will be considered to have collided with it.
@@ -18,7 +19,7 @@
 // Controls the visual thickness of the starship trail lines.
 static const float STARSHIP_TRAIL_LINE_WIDTH = 1.5f;
 
-// Default/fallback color for starships without an owner.
+// Default/fallback color for starships whose fleet has no owner.
 static const float STARSHIP_DEFAULT_COLOR[4] = {0.7f, 0.7f, 0.7f, 1.0f};
 
 // Glow effect parameters for starships.
@@ -28,11 +29,38 @@ static const float STARSHIP_GLOW_ALPHA = 0.12f;
 // The bigger the radius, the larger the glow effect.
 static const float STARSHIP_GLOW_RADIUS = 3.0f;
 
+// Number of segments used for the glow and the disc at full detail.
+static const int STARSHIP_GLOW_SEGMENTS = 32;
+static const int STARSHIP_DISC_SEGMENTS = 20;
+
+// Number of segments used for each fleet blob. Blobs are only a few pixels across.
+static const int STARSHIP_BLOB_SEGMENTS = 12;
+
+// A blob of starships belonging to the same fleet and screen cell,
+// accumulated while drawing at STARSHIP_DETAIL_BLOB.
+// count is the number of ships in the blob, counting each starship as many times as its weight,
+// and sumX and sumY are likewise weighted, so a blob looks the same however its ships are simulated.
+typedef struct StarshipBlob {
+    bool used;
+    uint32_t fleetIndex;
+    long cellX;
+    long cellY;
+    float sumX;
+    float sumY;
+    size_t count;
+    const Fleet *fleet;
+} StarshipBlob;
+
+// Open addressing hash table of blobs, reused from frame to frame.
+// The capacity is always a power of two so we can wrap with a mask.
+static StarshipBlob *blobTable = NULL;
+static size_t blobTableCapacity = 0;
+
 // forward declarations of static helper functions
 
 static void StarshipTrailAdvanceAges(StarshipTrailSample *samples, size_t *count, float deltaTime);
-static void StarshipTrailDrawStrip(const StarshipTrailSample *samples, size_t count, const float baseColor[4]);
-static void StarshipDrawTrail(const Starship *ship, const float baseColor[4]);
+static void StarshipTrailDrawStrip(const StarshipTrailSample *samples, size_t count, const float baseColor[4], size_t stride);
+static void StarshipDrawTrail(const Starship *ship, const float baseColor[4], size_t stride);
 static void StarshipDrawGlow(const Starship *ship, const float baseColor[4]);
 
 /**
@@ -51,22 +79,36 @@ static float Clamp01(float value) {
 }
 
 /**
- * Resolves (that is, determines) the color of the starship based on its owner faction.
- * If the starship has an owner, returns the owner's color.
+ * Helper function to find the fleet a starship belongs to.
+ * @param fleets The fleets array the starship's fleet index refers to, or NULL.
+ * @param ship A pointer to the Starship.
+ * @return A pointer to the starship's Fleet, or NULL if there are no fleets to look in.
+ */
+static const Fleet *StarshipFleetOf(const Fleet *fleets, const Starship *ship) {
+    if (fleets == NULL || ship == NULL || ship->fleetIndex == FLEET_INDEX_NONE) {
+        return NULL;
+    }
+
+    return &fleets[ship->fleetIndex];
+}
+
+/**
+ * Resolves (that is, determines) the color of a fleet's starships based on the fleet's owner faction.
+ * If the fleet has an owner, returns the owner's color.
  * Otherwise, returns a default gray color.
- * @param ship A pointer to the Starship object.
+ * @param fleet A pointer to the Fleet the starships belong to, or NULL.
  * @param outColor An array of 4 floats to receive the RGBA color.
  */
-void StarshipResolveColor(const Starship *ship, float outColor[4]) {
+void StarshipResolveColor(const Fleet *fleet, float outColor[4]) {
     // Basic validation of parameters.
     if (outColor == NULL) {
         return;
     }
 
-    // If the ship has an owner, use the owner's color.
+    // If the fleet has an owner, use the owner's color.
     // Otherwise, use the default color.
-    if (ship != NULL && ship->owner != NULL) {
-        const float *source = ship->owner->color;
+    if (fleet != NULL && fleet->owner != NULL) {
+        const float *source = fleet->owner->color;
         outColor[0] = source[0];
         outColor[1] = source[1];
         outColor[2] = source[2];
@@ -159,19 +201,33 @@ void StarshipTrailEffectDraw(const StarshipTrailEffect *effect) {
     }
 
     // Now we delegate to the trail drawing helper.
-    StarshipTrailDrawStrip(effect->samples, effect->sampleCount, effect->color);
+    StarshipTrailDrawStrip(effect->samples, effect->sampleCount, effect->color, 1);
 }
 
 /**
- * Creates a new starship with the specified position, velocity, owner, and target.
+ * Draws the starship trail effect, only using every stride-th sample.
+ * The newest and oldest samples are always kept so the trail keeps its length.
+ * @param effect A pointer to the StarshipTrailEffect to draw.
+ * @param stride How many samples to step over at a time. 1 draws every sample.
+ */
+void StarshipTrailEffectDrawWithStride(const StarshipTrailEffect *effect, size_t stride) {
+    if (effect == NULL) {
+        return;
+    }
+
+    StarshipTrailDrawStrip(effect->samples, effect->sampleCount, effect->color, stride);
+}
+
+/**
+ * Creates a new starship with the specified position, velocity, and fleet.
+ * The starship stands for a single ship, that is, has a weight of 1.
  * @param position The initial position of the starship.
  * @param velocity The initial velocity of the starship. This value is not clamped,
  *                 allowing newly spawned ships to exceed STARSHIP_MAX_SPEED temporarily.
- * @param owner A pointer to the Faction that owns the starship.
- * @param target A pointer to the Planet that is the target of the starship.
+ * @param fleetIndex The index of the Fleet the starship belongs to, in its level's fleets array.
  * @return The created Starship object.
  */
-Starship CreateStarship(Vec2 position, Vec2 velocity, const Faction *owner, Planet *target) {
+Starship CreateStarship(Vec2 position, Vec2 velocity, uint32_t fleetIndex) {
     // We first make a Starship struct
     Starship ship;
 
@@ -179,9 +235,10 @@ Starship CreateStarship(Vec2 position, Vec2 velocity, const Faction *owner, Plan
     // Much like Planet, a starship is such a simple object
     // that it does not require any dynamic memory allocation.
     ship.position = position;
+    ship.previousPosition = position;
     ship.velocity = velocity;
-    ship.owner = owner;
-    ship.target = target;
+    ship.fleetIndex = fleetIndex;
+    ship.weight = 1;
     ship.trailCount = 0;
     ship.trailTimeSinceLastEmit = 0.0f;
     for (size_t i = 0; i < STARSHIP_TRAIL_MAX_SAMPLES; ++i) {
@@ -193,20 +250,25 @@ Starship CreateStarship(Vec2 position, Vec2 velocity, const Faction *owner, Plan
 
 /**
  * Updates the state of the starship over time.
- * This function accelerates the starship towards its target planet
+ * This function accelerates the starship towards its fleet's target planet
  * and updates its position based on its velocity.
  * If the starship has a trail, it also updates the trail samples.
  * @param ship A pointer to the Starship object to update.
+ * @param fleet A pointer to the Fleet the starship belongs to.
  * @param deltaTime The time elapsed since the last update, in seconds.
  */
-void StarshipUpdate(Starship *ship, float deltaTime) {
+void StarshipUpdate(Starship *ship, const Fleet *fleet, float deltaTime) {
     if (ship == NULL) {
         return;
     }
 
+    // Remember where the starship was before this update,
+    // so it can be drawn partway between this update and the next.
+    ship->previousPosition = ship->position;
+
     // Target should never be NULL for a valid starship,
     // but we check anyway to be safe.
-    if (ship->target != NULL) {
+    if (fleet != NULL && fleet->target != NULL) {
         // The relevant math is as follows:
         // We want to accelerate the starship towards its target planet.
         // To do this, we first compute the vector from the starship to the planet.
@@ -222,7 +284,7 @@ void StarshipUpdate(Starship *ship, float deltaTime) {
         // ship.velocity += acceleration
         // Once the update step finishes, a separate speed limit check
         // will gently bring the ship down toward STARSHIP_MAX_SPEED if needed.
-        Vec2 toTarget = Vec2Subtract(ship->target->position, ship->position);
+        Vec2 toTarget = Vec2Subtract(fleet->target->position, ship->position);
         Vec2 direction = Vec2Normalize(toTarget);
         Vec2 acceleration = Vec2Scale(direction, STARSHIP_ACCELERATION * deltaTime);
         ship->velocity = Vec2Add(ship->velocity, acceleration);
@@ -304,21 +366,22 @@ void StarshipUpdate(Starship *ship, float deltaTime) {
 }
 
 /**
- * Checks if the starship has collided with its target planet.
+ * Checks if the starship has collided with its fleet's target planet.
  * A collision is detected if the distance between the starship and the planet
  * is less than or equal to the sum of their collision radii.
  * @param ship A pointer to the Starship object to check for collision.
+ * @param fleet A pointer to the Fleet the starship belongs to.
  * @return true if the starship has collided with its target planet, false otherwise.
  */
-bool StarshipCheckCollision(const Starship *ship) {
-    if (ship == NULL || ship->target == NULL) {
+bool StarshipCheckCollision(const Starship *ship, const Fleet *fleet) {
+    if (ship == NULL || fleet == NULL || fleet->target == NULL) {
         return false;
     }
 
     // We get the combined collision radius of the planet and starship.
     // Then we compute the distance between the starship and planet.
-    float collisionRadius = PlanetGetCollisionRadius(ship->target) + STARSHIP_RADIUS;
-    Vec2 toTarget = Vec2Subtract(ship->position, ship->target->position);
+    float collisionRadius = PlanetGetCollisionRadius(fleet->target) + STARSHIP_RADIUS;
+    Vec2 toTarget = Vec2Subtract(ship->position, fleet->target->position);
     float distance = Vec2Length(toTarget);
 
     // If the distance is less than or equal to the collision radius, we have a collision.
@@ -328,13 +391,14 @@ bool StarshipCheckCollision(const Starship *ship) {
 /**
  * Draws the starship using OpenGL.
  * The starship is drawn as a filled circle at its position,
- * using the color of its owner faction if available.
- * If the starship has no owner, a default gray color is used.
+ * using the color of its fleet's owner faction if available.
+ * If the fleet has no owner, a default gray color is used.
  * Furthermore, the starship's glow and trail effects are also drawn
  * with their respective helper functions, called here.
  * @param ship A pointer to the Starship object to draw.
+ * @param fleet A pointer to the Fleet the starship belongs to, or NULL.
  */
-void StarshipDraw(const Starship *ship) {
+void StarshipDraw(const Starship *ship, const Fleet *fleet) {
     if (ship == NULL) {
         return;
     }
@@ -342,18 +406,25 @@ void StarshipDraw(const Starship *ship) {
     // Default/fallback color for the starship.
     float color[4] = {0.0f, 0.0f, 0.0f, 1.0f};
 
-    // Resolve the starship's color based on its owner.
-    StarshipResolveColor(ship, color);
+    // Resolve the starship's color based on its fleet's owner.
+    StarshipResolveColor(fleet, color);
 
     // Draw the starship's glow and trail effects.
     StarshipDrawGlow(ship, color);
-    StarshipDrawTrail(ship, color);
+    StarshipDrawTrail(ship, color, 1);
 
-    // Set the OpenGL color to the starship's color.
-    glColor4fv(color);
+    // Set the batch color to the starship's color.
+    // Ship colors are opaque, so alpha blending draws the disc exactly as
+    // unblended drawing would while letting it join the surrounding batch.
+    // The disc goes on the ship layer, above every glow, when inside a sorted pass.
+    RenderBatchLayer previousLayer = RenderBatchGetLayer();
+    RenderBatchSetLayer(RENDER_BATCH_LAYER_SHIPS);
+    RenderBatchSetColor(color);
+    RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ALPHA);
 
     // Draw the starship as a filled circle at its position.
-    DrawFilledCircle(ship->position.x, ship->position.y, STARSHIP_RADIUS, 20);
+    DrawFilledCircle(ship->position.x, ship->position.y, STARSHIP_RADIUS, ComputeDetailSegments(STARSHIP_DISC_SEGMENTS));
+    RenderBatchSetLayer(previousLayer);
 }
 
 /**
@@ -361,8 +432,8 @@ void StarshipDraw(const Starship *ship) {
  * @param ship A pointer to the Starship whose trail to draw.
  * @param baseColor An array of 4 floats representing the RGBA color for the trail.
  */
-static void StarshipDrawTrail(const Starship *ship, const float baseColor[4]) {
-    StarshipTrailDrawStrip(ship->trail, ship->trailCount, baseColor);
+static void StarshipDrawTrail(const Starship *ship, const float baseColor[4], size_t stride) {
+    StarshipTrailDrawStrip(ship->trail, ship->trailCount, baseColor, stride);
 }
 
 /**
@@ -399,68 +470,166 @@ static void StarshipTrailAdvanceAges(StarshipTrailSample *samples, size_t *count
 }
 
 /**
- * Helper function to draw a starship trail as a line strip.
+ * Helper function to write a starship trail into the render batch as lines.
  * The trail fades out over its length based on the age of each sample.
+ * When zoomed out, samples can be skipped with stride, since neighbouring
+ * samples then land within a pixel or two of each other anyway.
+ * This does not touch the blend mode or line width; the caller sets those up,
+ * which lets any number of trails share the same state and the same draw call.
  * @param samples An array of StarshipTrailSample objects.
  * @param count The number of samples in the array.
  * @param baseColor An array of 4 floats representing the RGBA color for the trail.
+ * @param stride How many samples to step over at a time. 1 draws every sample.
  */
-static void StarshipTrailDrawStrip(const StarshipTrailSample *samples, size_t count, const float baseColor[4]) {
+static void StarshipTrailWriteStrip(const StarshipTrailSample *samples, size_t count, const float baseColor[4], size_t stride) {
     // Basic validation of parameters.
     // We need at least 2 samples to draw a trail between them.
     if (samples == NULL || baseColor == NULL || count < 2) {
         return;
     }
 
+    if (stride < 1) {
+        stride = 1;
+    }
+
+    // Work out how many samples we keep: every stride-th one starting from the newest,
+    // plus the oldest one so the trail does not get shorter.
+    size_t keptCount = (count - 1 + stride - 1) / stride + 1;
+
     // Extract out the base color components for easier access.
     float r = baseColor[0];
     float g = baseColor[1];
     float b = baseColor[2];
     float a = baseColor[3];
 
-    // Tell OpenGL that we want to draw lines with a specific width.
-    glLineWidth(STARSHIP_TRAIL_LINE_WIDTH);
-
-    // What glEnable(GL_BLEND) does is enable blending in OpenGL.
-    // Blending is a technique used to combine the color of a source pixel (the pixel being drawn)
-    // with the color of a destination pixel (the pixel already present in the framebuffer)
-    glEnable(GL_BLEND);
-
-    // glBlendFunc specifies how the blending is done.
-    // The parameters GL_SRC_ALPHA and GL_ONE_MINUS_SRC_ALPHA mean that
-    // the source color is multiplied by its alpha value,
-    // and the destination color is multiplied by (1 - source alpha).
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    // Now we draw the trail as a line strip.
     // Each sample's color alpha is modulated based on its age,
     // so older samples are more transparent.
     // This gives rise to a sort of fade effect along the trail,
     // with older portions of the trail fading out into the background.
-    glBegin(GL_LINE_STRIP);
-    for (size_t index = count; index-- > 0;) {
-        // Fetch the sample.
+    // The batch only holds independent lines, so each piece of the strip
+    // between two neighbouring samples becomes its own pair of vertices.
+    // That also means consecutive trails need no "restart" between them,
+    // since no line ever connects the end of one trail to the start of the next.
+    RenderBatchVertex *vertices = RenderBatchReserve(RENDER_BATCH_PRIMITIVE_LINES, (keptCount - 1) * 2);
+    if (vertices == NULL) {
+        return;
+    }
+
+    // We walk from the oldest kept sample to the newest one,
+    // writing each sample as the end of one line and the start of the next.
+    for (size_t kept = keptCount; kept-- > 0;) {
+        // Fetch the sample. The last kept sample is always the oldest one.
+        size_t index = kept == keptCount - 1 ? count - 1 : kept * stride;
         const StarshipTrailSample *sample = &samples[index];
 
         // Compute the life factor (0.0 to 1.0) based on age.
         // Newer samples have life closer to 1.0, older samples closer to 0.0.
         float life = Clamp01(1.0f - (sample->age / STARSHIP_TRAIL_LENGTH_SECONDS));
 
-        // Set the color with modulated alpha.
-        glColor4f(r, g, b, a * life);
-
-        // Specify the vertex position.
-        glVertex2f(sample->position.x, sample->position.y);
+        // The oldest sample only starts a line, the newest only ends one,
+        // and every sample in between does both.
+        int writes = (kept == keptCount - 1 || kept == 0) ? 1 : 2;
+        for (int w = 0; w < writes; ++w) {
+            vertices->x = sample->position.x;
+            vertices->y = sample->position.y;
+            vertices->color[0] = r;
+            vertices->color[1] = g;
+            vertices->color[2] = b;
+            vertices->color[3] = a * life;
+            vertices++;
+        }
     }
+}
 
-    // End the line strip.
-    glEnd();
+/**
+ * Helper function to set up the render batch for drawing trails.
+ * Trails are alpha blended lines of width STARSHIP_TRAIL_LINE_WIDTH,
+ * drawn on the trail layer when inside a sorted pass.
+ * @return The layer that was current before, to be handed to StarshipTrailEndPass.
+ */
+static RenderBatchLayer StarshipTrailBeginPass(void) {
+    RenderBatchLayer previousLayer = RenderBatchGetLayer();
+    RenderBatchSetLayer(RENDER_BATCH_LAYER_TRAILS);
 
-    // Reset the blending function back to standard alpha blending.
-    glDisable(GL_BLEND);
+    // Tell the render batch that we want to draw lines with a specific width.
+    RenderBatchSetLineWidth(STARSHIP_TRAIL_LINE_WIDTH);
 
+    // Blending combines the color of a source pixel (the pixel being drawn)
+    // with the color of a destination pixel (the pixel already present in the framebuffer).
+    // Alpha blending means that the source color is multiplied by its alpha value,
+    // and the destination color is multiplied by (1 - source alpha).
+    RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ALPHA);
+    return previousLayer;
+}
+
+/**
+ * Helper function to restore the default line width and the previous layer after drawing trails.
+ * @param previousLayer The layer returned by StarshipTrailBeginPass.
+ */
+static void StarshipTrailEndPass(RenderBatchLayer previousLayer) {
     // Reset the line width to default (1.0f).
-    glLineWidth(1.0f);
+    RenderBatchSetLineWidth(1.0f);
+    RenderBatchSetLayer(previousLayer);
+}
+
+/**
+ * Helper function to draw a single starship trail as a line strip,
+ * setting up and restoring the render state around it.
+ * @param samples An array of StarshipTrailSample objects.
+ * @param count The number of samples in the array.
+ * @param baseColor An array of 4 floats representing the RGBA color for the trail.
+ * @param stride How many samples to step over at a time. 1 draws every sample.
+ */
+static void StarshipTrailDrawStrip(const StarshipTrailSample *samples, size_t count, const float baseColor[4], size_t stride) {
+    if (samples == NULL || baseColor == NULL || count < 2) {
+        return;
+    }
+
+    RenderBatchLayer previousLayer = StarshipTrailBeginPass();
+    StarshipTrailWriteStrip(samples, count, baseColor, stride);
+    StarshipTrailEndPass(previousLayer);
+}
+
+/**
+ * Draws the trails of many starships and trail effects in a single pass.
+ * The blend mode and line width are set once for the whole pass,
+ * so every trail lands in the same draw call (unless the batch fills up).
+ * @param starships The array of starships whose trails to draw, or NULL for none.
+ * @param fleets The fleets array the starships' fleet indices refer to.
+ * @param starshipIndices The indices of the starships to draw, or NULL for the first starshipCount.
+ * @param starshipCount The number of starship trails to draw.
+ * @param effects The array of trail effects to draw, or NULL for none.
+ * @param effectIndices The indices of the trail effects to draw, or NULL for the first effectCount.
+ * @param effectCount The number of trail effects to draw.
+ * @param stride How many samples to step over at a time. 1 draws every sample.
+ */
+void StarshipDrawTrails(const Starship *starships, const Fleet *fleets, const size_t *starshipIndices, size_t starshipCount,
+    const StarshipTrailEffect *effects, const size_t *effectIndices, size_t effectCount, size_t stride) {
+    if ((starships == NULL || starshipCount == 0) && (effects == NULL || effectCount == 0)) {
+        return;
+    }
+
+    RenderBatchLayer previousLayer = StarshipTrailBeginPass();
+
+    // Trails left behind by destroyed ships go first, as they always have.
+    if (effects != NULL) {
+        for (size_t n = 0; n < effectCount; ++n) {
+            const StarshipTrailEffect *effect = &effects[effectIndices != NULL ? effectIndices[n] : n];
+            StarshipTrailWriteStrip(effect->samples, effect->sampleCount, effect->color, stride);
+        }
+    }
+
+    // Then the trails of the ships still flying.
+    if (starships != NULL) {
+        for (size_t n = 0; n < starshipCount; ++n) {
+            const Starship *ship = &starships[starshipIndices != NULL ? starshipIndices[n] : n];
+            float color[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+            StarshipResolveColor(StarshipFleetOf(fleets, ship), color);
+            StarshipTrailWriteStrip(ship->trail, ship->trailCount, color, stride);
+        }
+    }
+
+    StarshipTrailEndPass(previousLayer);
 }
 
 /**
@@ -480,14 +649,345 @@ static void StarshipDrawGlow(const Starship *ship, const float baseColor[4]) {
     float glowOuterRadius = STARSHIP_RADIUS + STARSHIP_GLOW_RADIUS;
 
     // Draw the radial gradient ring for the glow effect.
-    // We enable blending and set the blend function to additive blending
-    // to create a glowing effect where colors add light to the background.
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    // We use additive blending to create a glowing effect
+    // where colors add light to the background.
+    // The batch switches back to standard alpha blending when it flushes.
+    // Glows get a layer of their own beneath the ships, so that in a sorted pass
+    // every glow is drawn in one go rather than alternating with the ship discs.
+    RenderBatchLayer previousLayer = RenderBatchGetLayer();
+    RenderBatchSetLayer(RENDER_BATCH_LAYER_SHIP_GLOWS);
+    RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ADDITIVE);
     DrawRadialGradientRing(ship->position.x, ship->position.y,
-        0.0f, glowOuterRadius, 32, innerColor, outerColor);
+        0.0f, glowOuterRadius, ComputeDetailSegments(STARSHIP_GLOW_SEGMENTS), innerColor, outerColor);
+    RenderBatchSetLayer(previousLayer);
+}
+
+/**
+ * Chooses the level of detail to draw starships with at the given camera zoom.
+ * @param zoom The camera zoom, in screen pixels per world unit.
+ * @return The level of detail to use.
+ */
+StarshipDetailLevel StarshipDetailLevelForZoom(float zoom) {
+    if (zoom < STARSHIP_BLOB_DETAIL_ZOOM) {
+        return STARSHIP_DETAIL_BLOB;
+    }
+    if (zoom < STARSHIP_POINT_DETAIL_ZOOM) {
+        return STARSHIP_DETAIL_POINT;
+    }
+    return STARSHIP_DETAIL_FULL;
+}
+
+/**
+ * Chooses how many trail samples to step over at a time at the given camera zoom.
+ * A stride of 1 draws every sample.
+ * @param zoom The camera zoom, in screen pixels per world unit.
+ * @return The trail stride to use, between 1 and STARSHIP_TRAIL_MAX_STRIDE.
+ */
+size_t StarshipTrailStrideForZoom(float zoom) {
+    if (zoom <= 0.0f) {
+        return STARSHIP_TRAIL_MAX_STRIDE;
+    }
+
+    // Samples are emitted at least STARSHIP_TRAIL_MIN_DISTANCE apart in the world,
+    // which is that distance times the zoom apart on screen.
+    // We step over enough samples to keep them about STARSHIP_TRAIL_PIXELS_PER_SAMPLE apart.
+    float sampleSpacingPixels = STARSHIP_TRAIL_MIN_DISTANCE * zoom;
+    size_t stride = (size_t)(STARSHIP_TRAIL_PIXELS_PER_SAMPLE / sampleSpacingPixels);
+    if (stride < 1) {
+        stride = 1;
+    }
+    if (stride > STARSHIP_TRAIL_MAX_STRIDE) {
+        stride = STARSHIP_TRAIL_MAX_STRIDE;
+    }
+    return stride;
+}
+
+/**
+ * Helper function to draw a square of the given half size as two triangles.
+ * Used for starships drawn as points.
+ * @param center The center of the square.
+ * @param halfSize Half of the square's side length.
+ * @param color The RGBA color of the square.
+ */
+static void StarshipDrawPoint(Vec2 center, float halfSize, const float color[4]) {
+    RenderBatchVertex *vertices = RenderBatchReserve(RENDER_BATCH_PRIMITIVE_TRIANGLES, 6);
+    if (vertices == NULL) {
+        return;
+    }
+
+    float corners[6][2] = {
+        {center.x - halfSize, center.y - halfSize},
+        {center.x + halfSize, center.y - halfSize},
+        {center.x + halfSize, center.y + halfSize},
+        {center.x - halfSize, center.y - halfSize},
+        {center.x + halfSize, center.y + halfSize},
+        {center.x - halfSize, center.y + halfSize}
+    };
+
+    for (int i = 0; i < 6; ++i) {
+        vertices[i].x = corners[i][0];
+        vertices[i].y = corners[i][1];
+        vertices[i].color[0] = color[0];
+        vertices[i].color[1] = color[1];
+        vertices[i].color[2] = color[2];
+        vertices[i].color[3] = color[3];
+    }
+}
+
+/**
+ * Draws the starship at the given level of detail.
+ * STARSHIP_DETAIL_BLOB is drawn like STARSHIP_DETAIL_POINT here,
+ * since blobs are only meaningful for many ships at once (see StarshipDrawFleetBlobs).
+ * @param ship A pointer to the Starship object to draw.
+ * @param fleet A pointer to the Fleet the starship belongs to, or NULL.
+ * @param detail The level of detail to draw with.
+ * @param zoom The camera zoom, in screen pixels per world unit.
+ */
+void StarshipDrawWithDetail(const Starship *ship, const Fleet *fleet, StarshipDetailLevel detail, float zoom) {
+    if (ship == NULL) {
+        return;
+    }
+
+    if (detail == STARSHIP_DETAIL_FULL || zoom <= 0.0f) {
+        StarshipDraw(ship, fleet);
+        return;
+    }
+
+    float color[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    StarshipResolveColor(fleet, color);
+
+    // The trail only needs a fraction of its samples at this distance.
+    StarshipDrawTrail(ship, color, StarshipTrailStrideForZoom(zoom));
+    StarshipDrawHull(ship, fleet, detail, zoom);
+}
+
+/**
+ * Draws the starship at the given level of detail, without its trail.
+ * Used together with StarshipDrawTrails, which draws all trails in one pass beforehand.
+ * STARSHIP_DETAIL_BLOB is drawn like STARSHIP_DETAIL_POINT here.
+ * @param ship A pointer to the Starship object to draw.
+ * @param fleet A pointer to the Fleet the starship belongs to, or NULL.
+ * @param detail The level of detail to draw with.
+ * @param zoom The camera zoom, in screen pixels per world unit.
+ */
+void StarshipDrawHull(const Starship *ship, const Fleet *fleet, StarshipDetailLevel detail, float zoom) {
+    if (ship == NULL) {
+        return;
+    }
+
+    float color[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    StarshipResolveColor(fleet, color);
+
+    RenderBatchLayer previousLayer = RenderBatchGetLayer();
+
+    if (detail == STARSHIP_DETAIL_FULL || zoom <= 0.0f) {
+        // The glow first, then the disc on top of it, exactly like StarshipDraw.
+        StarshipDrawGlow(ship, color);
+        RenderBatchSetLayer(RENDER_BATCH_LAYER_SHIPS);
+        RenderBatchSetColor(color);
+        RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ALPHA);
+        DrawFilledCircle(ship->position.x, ship->position.y, STARSHIP_RADIUS, ComputeDetailSegments(STARSHIP_DISC_SEGMENTS));
+        RenderBatchSetLayer(previousLayer);
+        return;
+    }
+
+    // The glow is less than a couple of pixels across at this distance, so we leave it out,
+    // and the ship itself becomes a small square a pixel or two across.
+    float halfSize = fmaxf(STARSHIP_RADIUS, STARSHIP_POINT_PIXEL_SIZE * 0.5f / zoom);
+    RenderBatchSetLayer(RENDER_BATCH_LAYER_SHIPS);
+    RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ALPHA);
+    StarshipDrawPoint(ship->position, halfSize, color);
+    RenderBatchSetLayer(previousLayer);
+}
+
+/**
+ * Helper function to make sure the blob table can hold at least the given number of blobs
+ * while staying at most half full, and to clear it for a new frame.
+ * @param blobCount The most blobs that will be added.
+ * @return true if the table is ready, false on allocation failure.
+ */
+static bool StarshipPrepareBlobTable(size_t blobCount) {
+    size_t required = 16;
+    while (required < blobCount * 2) {
+        required *= 2;
+    }
+
+    if (required > blobTableCapacity) {
+        StarshipBlob *resized = (StarshipBlob *)realloc(blobTable, required * sizeof(StarshipBlob));
+        if (resized == NULL) {
+            return false;
+        }
+        blobTable = resized;
+        blobTableCapacity = required;
+    }
+
+    memset(blobTable, 0, blobTableCapacity * sizeof(StarshipBlob));
+    return true;
+}
+
+/**
+ * Helper function to find the blob for a fleet and cell, claiming an empty slot if there is none yet.
+ * @param fleetIndex The index of the fleet.
+ * @param cellX The x-coordinate of the cell.
+ * @param cellY The y-coordinate of the cell.
+ * @return A pointer to the blob.
+ */
+static StarshipBlob *StarshipFindBlob(uint32_t fleetIndex, long cellX, long cellY) {
+    // Mix everything identifying the blob into one hash.
+    size_t hash = (size_t)fleetIndex * 2654435761u;
+    hash = (hash ^ (size_t)cellX) * 2654435761u;
+    hash = (hash ^ (size_t)cellY) * 2654435761u;
+    hash ^= hash >> 15;
+
+    // Linear probing; the table is never more than half full so this always finds a slot.
+    size_t mask = blobTableCapacity - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        StarshipBlob *blob = &blobTable[slot];
+        if (!blob->used) {
+            blob->used = true;
+            blob->fleetIndex = fleetIndex;
+            blob->cellX = cellX;
+            blob->cellY = cellY;
+            return blob;
+        }
+        if (blob->fleetIndex == fleetIndex && blob->cellX == cellX && blob->cellY == cellY) {
+            return blob;
+        }
+    }
+}
+
+/**
+ * Draws a set of starships as blobs, one per fleet per on-screen cell.
+ * Each blob is placed at the average position of its ships,
+ * and sized so its area is proportional to the number of ships it holds,
+ * with each starship counting for as many ships as its weight.
+ * @param starships The array of starships.
+ * @param fleets The fleets array the starships' fleet indices refer to.
+ * @param indices The indices of the starships to draw, or NULL to draw the first count starships.
+ * @param count The number of starships to draw.
+ * @param zoom The camera zoom, in screen pixels per world unit.
+ */
+void StarshipDrawFleetBlobs(const Starship *starships, const Fleet *fleets, const size_t *indices, size_t count, float zoom) {
+    if (starships == NULL || count == 0 || zoom <= 0.0f) {
+        return;
+    }
+
+    // If we cannot get memory for the table, drawing every ship as a point is the next best thing.
+    if (!StarshipPrepareBlobTable(count)) {
+        for (size_t n = 0; n < count; ++n) {
+            const Starship *ship = &starships[indices != NULL ? indices[n] : n];
+            StarshipDrawWithDetail(ship, StarshipFleetOf(fleets, ship), STARSHIP_DETAIL_POINT, zoom);
+        }
+        return;
+    }
+
+    // Cells are a fixed size on screen, which in the world means larger cells the further out we zoom.
+    // This is what keeps the number of blobs bounded by the screen size rather than the ship count.
+    float cellSize = STARSHIP_BLOB_CELL_PIXELS / zoom;
+
+    // Accumulate every ship into its blob.
+    for (size_t n = 0; n < count; ++n) {
+        const Starship *ship = &starships[indices != NULL ? indices[n] : n];
+        long cellX = (long)floorf(ship->position.x / cellSize);
+        long cellY = (long)floorf(ship->position.y / cellSize);
+        StarshipBlob *blob = StarshipFindBlob(ship->fleetIndex, cellX, cellY);
+        blob->sumX += ship->position.x * (float)ship->weight;
+        blob->sumY += ship->position.y * (float)ship->weight;
+        blob->count += ship->weight;
+        if (blob->fleet == NULL) {
+            blob->fleet = StarshipFleetOf(fleets, ship);
+        }
+    }
+
+    // Then draw one disc per blob.
+    RenderBatchLayer previousLayer = RenderBatchGetLayer();
+    RenderBatchSetLayer(RENDER_BATCH_LAYER_SHIPS);
+    RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ALPHA);
+    float maxRadiusPixels = STARSHIP_BLOB_CELL_PIXELS * 0.5f;
+    for (size_t slot = 0; slot < blobTableCapacity; ++slot) {
+        const StarshipBlob *blob = &blobTable[slot];
+        if (!blob->used) {
+            continue;
+        }
+
+        float color[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        StarshipResolveColor(blob->fleet, color);
+        RenderBatchSetColor(color);
+
+        float radiusPixels = fminf(STARSHIP_BLOB_BASE_PIXELS * sqrtf((float)blob->count), maxRadiusPixels);
+        float centerX = blob->sumX / (float)blob->count;
+        float centerY = blob->sumY / (float)blob->count;
+        DrawFilledCircle(centerX, centerY, radiusPixels / zoom, STARSHIP_BLOB_SEGMENTS);
+    }
+
+    RenderBatchSetLayer(previousLayer);
+}
+
+/**
+ * Helper function to grow a bounding box to contain the given trail samples.
+ * @param samples An array of StarshipTrailSample objects.
+ * @param count The number of samples in the array.
+ * @param min The minimum corner of the bounding box, updated in place.
+ * @param max The maximum corner of the bounding box, updated in place.
+ */
+static void StarshipTrailExpandBounds(const StarshipTrailSample *samples, size_t count, Vec2 *min, Vec2 *max) {
+    for (size_t i = 0; i < count; ++i) {
+        Vec2 position = samples[i].position;
+        min->x = fminf(min->x, position.x);
+        min->y = fminf(min->y, position.y);
+        max->x = fmaxf(max->x, position.x);
+        max->y = fmaxf(max->y, position.y);
+    }
+}
+
+/**
+ * Computes the axis-aligned bounding box of everything drawn for a starship trail effect.
+ * @param effect A pointer to the StarshipTrailEffect to measure.
+ * @param outMin Receives the minimum corner of the bounding box.
+ * @param outMax Receives the maximum corner of the bounding box.
+ * @return true if the effect has anything to draw, false otherwise.
+ */
+bool StarshipTrailEffectComputeBounds(const StarshipTrailEffect *effect, Vec2 *outMin, Vec2 *outMax) {
+    // A trail needs at least two samples for anything to be drawn.
+    if (effect == NULL || outMin == NULL || outMax == NULL || effect->sampleCount < 2) {
+        return false;
+    }
+
+    Vec2 min = effect->samples[0].position;
+    Vec2 max = min;
+    StarshipTrailExpandBounds(effect->samples, effect->sampleCount, &min, &max);
+
+    // Pad by the line width so the edge of the line is not cut off.
+    float padding = STARSHIP_TRAIL_LINE_WIDTH;
+    outMin->x = min.x - padding;
+    outMin->y = min.y - padding;
+    outMax->x = max.x + padding;
+    outMax->y = max.y + padding;
+    return true;
+}
+
+/**
+ * Computes the axis-aligned bounding box of everything StarshipDraw draws for a starship,
+ * which includes its glow and its trail.
+ * @param ship A pointer to the Starship object to measure.
+ * @param outMin Receives the minimum corner of the bounding box.
+ * @param outMax Receives the maximum corner of the bounding box.
+ * @return true if the bounds were computed, false if any pointer was NULL.
+ */
+bool StarshipComputeBounds(const Starship *ship, Vec2 *outMin, Vec2 *outMax) {
+    if (ship == NULL || outMin == NULL || outMax == NULL) {
+        return false;
+    }
 
-    // And then we reset the blending function back to standard alpha blending. 
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDisable(GL_BLEND);
+    // The glow is the widest part of the ship itself.
+    Vec2 min = ship->position;
+    Vec2 max = ship->position;
+    StarshipTrailExpandBounds(ship->trail, ship->trailCount, &min, &max);
+
+    float padding = fmaxf(STARSHIP_RADIUS + STARSHIP_GLOW_RADIUS, STARSHIP_TRAIL_LINE_WIDTH);
+    outMin->x = min.x - padding;
+    outMin->y = min.y - padding;
+    outMax->x = max.x + padding;
+    outMax->y = max.y + padding;
+    return true;
 }
@@ -9,11 +9,14 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <GL/gl.h>
 #include <string.h>
 
 #include "Objects/vec2.h"
 #include "Objects/faction.h"
+#include "Objects/fleet.h"
 #include "Utilities/renderUtilities.h"
 
 // Forward declaration in order to avoid circular dependency.
@@ -53,6 +56,40 @@ struct Planet;
 // Time interval in seconds between emitting new trail samples.
 #define STARSHIP_TRAIL_EMIT_INTERVAL 0.05f
 
+// Starship level of detail constants
+
+// Below this zoom level, starships are drawn as single points without a glow.
+#define STARSHIP_POINT_DETAIL_ZOOM 0.5f
+
+// Below this zoom level, nearby starships of the same fleet are merged into a single blob.
+#define STARSHIP_BLOB_DETAIL_ZOOM 0.2f
+
+// The on-screen size of a starship drawn as a point, in pixels.
+#define STARSHIP_POINT_PIXEL_SIZE 1.5f
+
+// The size of the on-screen cells used to merge starships into blobs, in pixels.
+// Only ships of the same fleet within the same cell are merged.
+#define STARSHIP_BLOB_CELL_PIXELS 24.0f
+
+// The on-screen radius of a blob holding a single starship, in pixels.
+// Blobs grow with the square root of the number of ships they hold,
+// so their area is proportional to the ship count.
+#define STARSHIP_BLOB_BASE_PIXELS 1.5f
+
+// Trails skip samples when zoomed out, keeping roughly one sample per this many pixels.
+// At most STARSHIP_TRAIL_MAX_STRIDE samples are ever skipped over at once.
+#define STARSHIP_TRAIL_PIXELS_PER_SAMPLE 2.5f
+#define STARSHIP_TRAIL_MAX_STRIDE 8
+
+// How much detail starships are drawn with.
+// FULL draws the glow, trail and disc, POINT draws the trail and a single point,
+// and BLOB replaces individual ships with one blob per fleet and screen cell.
+typedef enum StarshipDetailLevel {
+    STARSHIP_DETAIL_FULL = 0,
+    STARSHIP_DETAIL_POINT = 1,
+    STARSHIP_DETAIL_BLOB = 2
+} StarshipDetailLevel;
+
 // A starship trail sample represents a single point in the starship's trail.
 // It contains the position of the sample and its age in seconds.
 typedef struct StarshipTrailSample {
@@ -70,31 +107,41 @@ typedef struct StarshipTrailEffect {
 } StarshipTrailEffect;
 
 // A starship represents a unit that can be sent from one planet to another.
-// A starship has a position, velocity, owner faction, and target planet.
+// A starship has a position and velocity, and belongs to the fleet it was launched in.
+// The fleet is where the starship's owner faction and target planet are found,
+// since every starship of a launch shares them; fleetIndex is the fleet's index
+// in the fleets array of the level the starship is in (see fleet.h).
+// weight is the number of ships this one simulated starship stands for.
+// Very large launches are simulated with fewer, heavier starships rather than one per ship
+// (see LevelSpawnFleet), and a starship arriving at a planet counts as weight ships arriving at once.
 // A starship also has a trail of samples for rendering its trail effect, and a timer
 // which helps determine when to emit new trail samples.
+// previousPosition is where the starship was before its most recent update,
+// which lets whoever draws the starship place it anywhere between its last two positions
+// when drawing happens at a different rate than updating.
 // A starship will always accelerate towards its target planet until it reaches its maximum speed.
 // This acceleration is constant, and defined by STARSHIP_ACCELERATION.
 // Upon reaching its target planet, the starship will be considered to have collided with it.
 // See planet.c's PlanetHandleIncomingShip function for handling the effects of a starship arriving at a planet.
 typedef struct Starship {
     Vec2 position;
+    Vec2 previousPosition;
     Vec2 velocity;
-    const Faction *owner;
-    struct Planet *target;
+    uint32_t fleetIndex;
+    uint32_t weight;
     size_t trailCount;
     float trailTimeSinceLastEmit;
     StarshipTrailSample trail[STARSHIP_TRAIL_MAX_SAMPLES];
 } Starship;
 
 /**
- * Resolves (that is, determines) the color of the starship based on its owner faction.
- * If the starship has an owner, returns the owner's color.
+ * Resolves (that is, determines) the color of a fleet's starships based on the fleet's owner faction.
+ * If the fleet has an owner, returns the owner's color.
  * Otherwise, returns a default gray color.
- * @param ship A pointer to the Starship object.
+ * @param fleet A pointer to the Fleet the starships belong to, or NULL.
  * @param outColor An array of 4 floats to receive the RGBA color.
  */
-void StarshipResolveColor(const Starship *ship, float outColor[4]);
+void StarshipResolveColor(const Fleet *fleet, float outColor[4]);
 
 /**
  * Initializes a starship trail effect based on the given starship's trail data.
@@ -130,41 +177,137 @@ bool StarshipTrailEffectIsAlive(const StarshipTrailEffect *effect);
 void StarshipTrailEffectDraw(const StarshipTrailEffect *effect);
 
 /**
- * Creates a new starship with the specified position, velocity, owner, and target.
+ * Computes the axis-aligned bounding box of everything drawn for a starship trail effect.
+ * @param effect A pointer to the StarshipTrailEffect to measure.
+ * @param outMin Receives the minimum corner of the bounding box.
+ * @param outMax Receives the maximum corner of the bounding box.
+ * @return true if the effect has anything to draw, false otherwise.
+ */
+bool StarshipTrailEffectComputeBounds(const StarshipTrailEffect *effect, Vec2 *outMin, Vec2 *outMax);
+
+/**
+ * Creates a new starship with the specified position, velocity, and fleet.
  * The starship's initial velocity is preserved, even if it exceeds STARSHIP_MAX_SPEED.
+ * The starship stands for a single ship, that is, has a weight of 1.
  * @param position The initial position of the starship.
  * @param velocity The initial velocity of the starship.
- * @param owner A pointer to the Faction that owns the starship.
- * @param target A pointer to the Planet that is the target of the starship.
+ * @param fleetIndex The index of the Fleet the starship belongs to, in its level's fleets array.
  * @return The created Starship object.
  */
-Starship CreateStarship(Vec2 position, Vec2 velocity, const Faction *owner, struct Planet *target);
+Starship CreateStarship(Vec2 position, Vec2 velocity, uint32_t fleetIndex);
 
 /**
  * Updates the state of the starship over time.
- * This function accelerates the starship towards its target planet
+ * This function accelerates the starship towards its fleet's target planet
  * and updates its position based on its velocity.
  * @param ship A pointer to the Starship object to update.
+ * @param fleet A pointer to the Fleet the starship belongs to.
  * @param deltaTime The time elapsed since the last update, in seconds.
  */
-void StarshipUpdate(Starship *ship, float deltaTime);
+void StarshipUpdate(Starship *ship, const Fleet *fleet, float deltaTime);
 
 /**
- * Checks if the starship has collided with its target planet.
+ * Checks if the starship has collided with its fleet's target planet.
  * A collision is detected if the distance between the starship and the planet
  * is less than or equal to the sum of their collision radii.
  * @param ship A pointer to the Starship object to check for collision.
+ * @param fleet A pointer to the Fleet the starship belongs to.
  * @return true if the starship has collided with its target planet, false otherwise.
  */
-bool StarshipCheckCollision(const Starship *ship);
+bool StarshipCheckCollision(const Starship *ship, const Fleet *fleet);
 
 /**
  * Draws the starship using OpenGL.
  * The starship is drawn as a filled circle at its position,
- * using the color of its owner faction if available.
- * If the starship has no owner, a default gray color is used.
+ * using the color of its fleet's owner faction if available.
+ * If the fleet has no owner, a default gray color is used.
+ * @param ship A pointer to the Starship object to draw.
+ * @param fleet A pointer to the Fleet the starship belongs to, or NULL.
+ */
+void StarshipDraw(const Starship *ship, const Fleet *fleet);
+
+/**
+ * Chooses the level of detail to draw starships with at the given camera zoom.
+ * @param zoom The camera zoom, in screen pixels per world unit.
+ * @return The level of detail to use.
+ */
+StarshipDetailLevel StarshipDetailLevelForZoom(float zoom);
+
+/**
+ * Chooses how many trail samples to step over at a time at the given camera zoom.
+ * A stride of 1 draws every sample.
+ * @param zoom The camera zoom, in screen pixels per world unit.
+ * @return The trail stride to use, between 1 and STARSHIP_TRAIL_MAX_STRIDE.
+ */
+size_t StarshipTrailStrideForZoom(float zoom);
+
+/**
+ * Draws the starship trail effect, only using every stride-th sample.
+ * The newest and oldest samples are always kept so the trail keeps its length.
+ * @param effect A pointer to the StarshipTrailEffect to draw.
+ * @param stride How many samples to step over at a time. 1 draws every sample.
+ */
+void StarshipTrailEffectDrawWithStride(const StarshipTrailEffect *effect, size_t stride);
+
+/**
+ * Draws the starship at the given level of detail.
+ * STARSHIP_DETAIL_BLOB is drawn like STARSHIP_DETAIL_POINT here,
+ * since blobs are only meaningful for many ships at once (see StarshipDrawFleetBlobs).
+ * @param ship A pointer to the Starship object to draw.
+ * @param fleet A pointer to the Fleet the starship belongs to, or NULL.
+ * @param detail The level of detail to draw with.
+ * @param zoom The camera zoom, in screen pixels per world unit.
+ */
+void StarshipDrawWithDetail(const Starship *ship, const Fleet *fleet, StarshipDetailLevel detail, float zoom);
+
+/**
+ * Draws the starship at the given level of detail, without its trail.
+ * Used together with StarshipDrawTrails, which draws all trails in one pass beforehand.
+ * STARSHIP_DETAIL_BLOB is drawn like STARSHIP_DETAIL_POINT here.
  * @param ship A pointer to the Starship object to draw.
+ * @param fleet A pointer to the Fleet the starship belongs to, or NULL.
+ * @param detail The level of detail to draw with.
+ * @param zoom The camera zoom, in screen pixels per world unit.
+ */
+void StarshipDrawHull(const Starship *ship, const Fleet *fleet, StarshipDetailLevel detail, float zoom);
+
+/**
+ * Draws the trails of many starships and trail effects in a single pass.
+ * The blend mode and line width are set once for the whole pass,
+ * so every trail lands in the same draw call (unless the batch fills up).
+ * @param starships The array of starships whose trails to draw, or NULL for none.
+ * @param fleets The fleets array the starships' fleet indices refer to.
+ * @param starshipIndices The indices of the starships to draw, or NULL for the first starshipCount.
+ * @param starshipCount The number of starship trails to draw.
+ * @param effects The array of trail effects to draw, or NULL for none.
+ * @param effectIndices The indices of the trail effects to draw, or NULL for the first effectCount.
+ * @param effectCount The number of trail effects to draw.
+ * @param stride How many samples to step over at a time. 1 draws every sample.
+ */
+void StarshipDrawTrails(const Starship *starships, const Fleet *fleets, const size_t *starshipIndices, size_t starshipCount,
+    const StarshipTrailEffect *effects, const size_t *effectIndices, size_t effectCount, size_t stride);
+
+/**
+ * Draws a set of starships as blobs, one per fleet per on-screen cell.
+ * Each blob is placed at the average position of its ships,
+ * and sized so its area is proportional to the number of ships it holds,
+ * with each starship counting for as many ships as its weight.
+ * @param starships The array of starships.
+ * @param fleets The fleets array the starships' fleet indices refer to.
+ * @param indices The indices of the starships to draw, or NULL to draw the first count starships.
+ * @param count The number of starships to draw.
+ * @param zoom The camera zoom, in screen pixels per world unit.
+ */
+void StarshipDrawFleetBlobs(const Starship *starships, const Fleet *fleets, const size_t *indices, size_t count, float zoom);
+
+/**
+ * Computes the axis-aligned bounding box of everything StarshipDraw draws for a starship,
+ * which includes its glow and its trail.
+ * @param ship A pointer to the Starship object to measure.
+ * @param outMin Receives the minimum corner of the bounding box.
+ * @param outMax Receives the maximum corner of the bounding box.
+ * @return true if the bounds were computed, false if any pointer was NULL.
  */
-void StarshipDraw(const Starship *ship);
+bool StarshipComputeBounds(const Starship *ship, Vec2 *outMin, Vec2 *outMax);
 
 #endif // _STARSHIP_H_
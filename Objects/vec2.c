@@ -9,6 +9,7 @@
  */
 
 #include "Objects/vec2.h"
+#include "Utilities/simMathUtilities.h"
 
 /**
  * Returns a Vec2 initialized to (0.0f, 0.0f).
@@ -66,11 +67,13 @@ float Vec2Dot(Vec2 a, Vec2 b) {
 /**
  * Calculates the 2 norm, or Euclidean length, of a Vec2.
  * This is given by the formula: sqrt(v.x^2 + v.y^2).
+ * Starships steer by normalizing their velocity, so the square root is taken with SimSqrt,
+ * which gives the same bits on every build, rather than with sqrtf, which may not.
  * @param v The Vec2 whose length is to be calculated.
  * @return The length of the Vec2 as a float.
  */
 float Vec2Length(Vec2 v) {
-    return sqrtf(Vec2Dot(v, v));
+    return SimSqrt(Vec2Dot(v, v));
 }
 
 /**
@@ -31,12 +31,31 @@ static float planetStateAccumulator = 0.0f;
 // Used to run AI turns at a fixed rate regardless of frame rate.
 static float aiActionAccumulator = 0.0f;
 
+// Accumulator for simulation tick timing.
+// Used to update the level in fixed SERVER_SIMULATION_TICK_RATE steps regardless of frame rate.
+static float simulationAccumulator = 0.0f;
+
 // UDP socket used for communication with clients.
 static SOCKET server_socket = INVALID_SOCKET;
 
 // Camera state used for navigating the server's spectator view.
 static CameraState cameraState = {0};
 
+// Indices of the planets, trail effects and starships found visible this frame.
+// Kept around between frames so their memory is reused rather than reallocated.
+static CullingIndexList visiblePlanets = {0};
+static CullingIndexList visibleTrails = {0};
+static CullingIndexList visibleStarships = {0};
+
+// Visible versus total object counts from the most recent frame, shown in the debug overlay.
+static CullingStats cullingStats = {0};
+
+// The background and settled planets, kept in a texture and only drawn again where they change.
+static StaticLayer staticLayer = {0};
+
+// Whether the profiler's frame timing overlay is shown. Toggled with F3.
+static bool profilerOverlayVisible = false;
+
 // Current stage of the server application.
 static ServerStage currentStage = SERVER_STAGE_LOBBY;
 
@@ -64,9 +83,33 @@ static LobbyMenuGenerationSettings lobbySettings = {
 // Flag indicating whether the lobby state needs to be re-broadcasted to all players.
 static bool lobbyStateDirty = true;
 
+// Time since the lobby state was last broadcast, so that edits coming in quick succession
+// are held back and sent together. Starts out full so the very first edit goes out right away.
+static float lobbyBroadcastTimer = SERVER_LOBBY_BROADCAST_INTERVAL;
+
+// Revision of the lobby state, bumped with every broadcast, so clients can tell whether they missed one.
+static uint32_t lobbyRevision = 0;
+
+// The lobby state as it was last broadcast, which the next broadcast is compared against
+// so that only the slots that changed since need to be sent.
+// Invalid when the next broadcast must be the full state, such as when the lobby is set up anew.
+static LevelLobbyStatePacket broadcastLobbyPacket;
+static LevelLobbySlotInfo broadcastLobbySlots[LOBBY_MENU_MAX_SLOTS];
+static bool broadcastLobbyValid = false;
+
 // RNG State used to calculate ship spawn positions.
 static unsigned int shipSpawnRNGState = SHIP_SPAWN_SEED;
 
+// Map file every match is played on, given with SERVER_MAP_OPTION.
+// Left closed (data is NULL) if levels are generated instead.
+static MapFile lobbyMap = {0};
+
+// Path of lobbyMap, or empty if there is none.
+static char lobbyMapPath[MAX_PATH] = {0};
+
+// Path generated levels are written to as a map file, given with SERVER_EXPORT_MAP_OPTION, or empty if there is none.
+static char exportMapPath[MAX_PATH] = {0};
+
 // Time in seconds the server shall wait for a message before considering
 // a client to have timed out.
 static const float CLIENT_TIMEOUT_SECONDS = (float)CLIENT_TIMEOUT_MS / 1000.0f;
@@ -79,6 +122,12 @@ static void HandleMoveOrderPacket(const SOCKADDR_IN *sender, const uint8_t *data
 static void HandleLobbyColorPacket(const SOCKADDR_IN *sender, const uint8_t *data, size_t size);
 static void HandleLobbyTeamPacket(const SOCKADDR_IN *sender, const uint8_t *data, size_t size);
 static void HandleLobbySharedControlPacket(const SOCKADDR_IN *sender, const uint8_t *data, size_t size);
+static void HandleMapRequestPacket(const SOCKADDR_IN *sender, const uint8_t *data, size_t size);
+static void HandleMapReadyPacket(const SOCKADDR_IN *sender, const uint8_t *data, size_t size);
+static void HandleLobbyResyncPacket(const SOCKADDR_IN *sender, const uint8_t *data, size_t size);
+static void HandleFullRequestPacket(const SOCKADDR_IN *sender, const uint8_t *data, size_t size);
+static bool ReadCommandLinePath(const char *commandLine, const char *option, char *outPath, size_t outPathSize);
+static bool LoadLobbyMap(const char *path);
 static bool LaunchFleetAndBroadcast(Planet *origin, Planet *destination);
 static void RemovePlayer(Player *player);
 static void UpdatePlayerTimeouts(float deltaTime);
@@ -289,8 +338,10 @@ static void InitializeLobbyState(void) {
     // Refresh the lobby slots to match current player assignments.
     RefreshLobbySlots();
 
-    // Mark the lobby state as dirty to ensure it is (re)broadcasted.
+    // Mark the lobby state as dirty to ensure it is (re)broadcasted,
+    // in full, since clients coming back from a match have no lobby state to apply a delta to.
     lobbyStateDirty = true;
+    broadcastLobbyValid = false;
 
     // Reset preview state so the next preview reflects fresh lobby settings.
     LobbyPreviewReset(&lobbyPreview);
@@ -611,6 +662,7 @@ static void BuildLobbyPacket(LevelLobbyStatePacket *packet, LevelLobbySlotInfo *
     // Clear the packet and populate it with current lobby settings.
     memset(packet, 0, sizeof(*packet));
     packet->type = LEVEL_PACKET_TYPE_LOBBY_STATE;
+    packet->revision = lobbyRevision;
     packet->factionCount = (uint32_t)lobbySettings.factionCount;
     packet->planetCount = (uint32_t)lobbySettings.planetCount;
     packet->minFleetCapacity = lobbySettings.minFleetCapacity;
@@ -620,6 +672,16 @@ static void BuildLobbyPacket(LevelLobbyStatePacket *packet, LevelLobbySlotInfo *
     packet->randomSeed = lobbySettings.randomSeed;
     packet->occupiedCount = (uint32_t)(playerCount + CountAIFactions());
 
+    // With a map file, its planets and bounds are what the match will actually be played with,
+    // and clients need its hash and size to find it in their cache or download it.
+    if (lobbyMap.data != NULL) {
+        packet->planetCount = lobbyMap.header->planetCount;
+        packet->levelWidth = lobbyMap.header->width;
+        packet->levelHeight = lobbyMap.header->height;
+        packet->mapHash = lobbyMap.hash;
+        packet->mapSize = (uint32_t)lobbyMap.size;
+    }
+
     // Determine the total number of slots to populate.
     // Will either be the faction count or the max slots allowed.
     size_t slotCount = (size_t)lobbySettings.factionCount;
@@ -667,10 +729,14 @@ static void BuildLobbyPacket(LevelLobbyStatePacket *packet, LevelLobbySlotInfo *
  * Used to inform all players of the current lobby state, including faction slots and level settings.
  * Typically called whenever there is a change in the lobby, such as a player joining, leaving, 
  * or changing their faction, or when the server updates level settings.
+ * Only the slots that changed since the last broadcast are sent, as a delta,
+ * unless the settings changed too, in which case the full state is sent.
  */
 static void BroadcastLobbyStateToAll(void) {
     // If there are no players or the server socket is invalid, there's nothing to do.
+    // Whoever joins next gets the full state anyway, and so should everyone after them.
     if (server_socket == INVALID_SOCKET || playerCount == 0) {
+        broadcastLobbyValid = false;
         return;
     }
 
@@ -679,14 +745,65 @@ static void BroadcastLobbyStateToAll(void) {
     LevelLobbySlotInfo slots[LOBBY_MENU_MAX_SLOTS] = {0};
     BuildLobbyPacket(&packet, slots);
 
-    // Broadcast the lobby state to all connected players.
-    BroadcastLobbyState(server_socket, players, playerCount, &packet, slots);
+    size_t slotCount = (size_t)lobbySettings.factionCount;
+    if (slotCount > LOBBY_MENU_MAX_SLOTS) {
+        slotCount = LOBBY_MENU_MAX_SLOTS;
+    }
+
+    // The occupied count and revision are carried by deltas as well,
+    // so any other difference in the header means the settings changed, which needs the full state.
+    LevelLobbyStatePacket header = packet;
+    header.revision = broadcastLobbyPacket.revision;
+    header.occupiedCount = broadcastLobbyPacket.occupiedCount;
+    bool sendFull = !broadcastLobbyValid || memcmp(&header, &broadcastLobbyPacket, sizeof(header)) != 0;
+
+    // Gather up the slots that changed. Every field of every slot is zeroed before being filled in,
+    // padding and unused name characters included, so comparing the bytes is enough.
+    LevelLobbySlotInfo changed[LOBBY_MENU_MAX_SLOTS];
+    size_t changedCount = 0;
+    if (!sendFull) {
+        for (size_t i = 0; i < slotCount; ++i) {
+            if (memcmp(&slots[i], &broadcastLobbySlots[i], sizeof(LevelLobbySlotInfo)) != 0) {
+                changed[changedCount++] = slots[i];
+            }
+        }
+
+        // Edits can cancel each other out within the broadcast window, leaving nothing to send.
+        if (changedCount == 0 && packet.occupiedCount == broadcastLobbyPacket.occupiedCount) {
+            return;
+        }
+    }
+
+    // Either way, this is a new revision of the lobby.
+    uint32_t baseRevision = lobbyRevision;
+    lobbyRevision++;
+    packet.revision = lobbyRevision;
+
+    if (sendFull) {
+        BroadcastLobbyState(server_socket, players, playerCount, &packet, slots);
+    } else {
+        LevelLobbyDeltaPacket delta = {0};
+        delta.type = LEVEL_PACKET_TYPE_LOBBY_DELTA;
+        delta.baseRevision = baseRevision;
+        delta.revision = lobbyRevision;
+        delta.occupiedCount = packet.occupiedCount;
+        delta.slotCount = (uint32_t)changedCount;
+        BroadcastLobbyDelta(server_socket, players, playerCount, &delta, changed);
+    }
+
+    // Remember what was sent, for the next broadcast to compare against.
+    broadcastLobbyPacket = packet;
+    memcpy(broadcastLobbySlots, slots, sizeof(broadcastLobbySlots));
+    broadcastLobbyValid = true;
 }
 
 /**
  * Sends the current lobby state to a specific player.
  * Used when a player joins the lobby to inform them of the current state
  * of said lobby, including faction slots and level settings.
+ * Also used when a player missed a delta and asked for the full state again.
+ * The state sent may already include edits that are yet to be broadcast, but since deltas
+ * carry whole slots rather than changes to them, applying the next delta on top of it is still correct.
  * @param player The player to send the lobby state to.
  */
 static void SendLobbyStateToPlayerInstance(Player *player) {
@@ -830,6 +947,35 @@ static bool AttemptStartGame(void) {
         return false;
     }
 
+    // A match on a map file can only start if the map has a start slot for every faction,
+    // and once every player has the map, since the level sent to them leaves the planets out.
+    if (lobbyMap.data != NULL) {
+        if ((uint32_t)parsed.factionCount > lobbyMap.header->startSlotCount) {
+            char status[128];
+            snprintf(status, sizeof(status), "This map only has room for %u factions.", lobbyMap.header->startSlotCount);
+            LobbyMenuUISetStatusMessage(&lobbyMenuUI, status);
+            return false;
+        }
+
+        size_t missingMap = 0;
+        for (size_t i = 0; i < playerCount; ++i) {
+            if (players[i].mapHash != lobbyMap.hash) {
+                ++missingMap;
+            }
+        }
+        if (missingMap > 0) {
+            char status[128];
+            snprintf(status, sizeof(status), "Waiting for %zu player(s) to download the map.", missingMap);
+            LobbyMenuUISetStatusMessage(&lobbyMenuUI, status);
+            return false;
+        }
+
+        // Whatever the lobby settings say, the map decides the planets and bounds.
+        parsed.planetCount = (int)lobbyMap.header->planetCount;
+        parsed.levelWidth = lobbyMap.header->width;
+        parsed.levelHeight = lobbyMap.header->height;
+    }
+
     // We save into a temporary object the level's current factions
     // so that way we can properly configure the level for generation
     // without losing the existing faction instances.
@@ -903,17 +1049,34 @@ static bool AttemptStartGame(void) {
     }
 
 
-    // Try to generate the level with the provided settings.
-    if (!GenerateRandomLevel(&level,
-            (size_t)parsed.planetCount,
-            (size_t)parsed.factionCount,
-            parsed.minFleetCapacity,
-            parsed.maxFleetCapacity,
-            parsed.levelWidth,
-            parsed.levelHeight,
-            parsed.randomSeed)) {
-        LobbyMenuUISetStatusMessage(&lobbyMenuUI, "Failed to generate level with the provided settings.");
-        return false;
+    // With a map file, lay the level out straight from the mapped planet records.
+    if (lobbyMap.data != NULL) {
+        if (!MapFileApplyToLevel(&lobbyMap, &level, (size_t)parsed.factionCount)) {
+            LobbyMenuUISetStatusMessage(&lobbyMenuUI, "Failed to lay out the level from the map file.");
+            return false;
+        }
+    } else {
+        // Otherwise, try to generate the level with the provided settings.
+        if (!GenerateRandomLevel(&level,
+                (size_t)parsed.planetCount,
+                (size_t)parsed.factionCount,
+                parsed.minFleetCapacity,
+                parsed.maxFleetCapacity,
+                parsed.levelWidth,
+                parsed.levelHeight,
+                parsed.randomSeed)) {
+            LobbyMenuUISetStatusMessage(&lobbyMenuUI, "Failed to generate level with the provided settings.");
+            return false;
+        }
+
+        // Every faction still sits on its starting planet, so now is when a generated level makes a complete map.
+        if (exportMapPath[0] != '\0') {
+            if (MapFileWriteLevel(&level, exportMapPath)) {
+                printf("Wrote the generated level to %s.\n", exportMapPath);
+            } else {
+                printf("Failed to write the generated level to %s.\n", exportMapPath);
+            }
+        }
     }
 
     // We successfully generated the level, so apply the new settings.
@@ -924,6 +1087,7 @@ static bool AttemptStartGame(void) {
     RefreshCameraBounds();
     shipSpawnRNGState = SHIP_SPAWN_SEED;
     planetStateAccumulator = 0.0f;
+    simulationAccumulator = 0.0f;
     selected_planet = NULL;
     CameraInitialize(&cameraState);
     cameraState.minZoom = SERVER_CAMERA_MIN_ZOOM / (fmaxf(level.width, level.height) / 2000.0f);
@@ -933,12 +1097,23 @@ static bool AttemptStartGame(void) {
     // Clear any previous game-over overlay so the new match can trigger it again.
     GameOverUIReset(&gameOverUI);
 
-    // Notify all players that the game is starting and send them the full level packet.
+    // Notify all players that the game is starting. Rather than the whole level, they are sent
+    // what it was laid out from, and lay it out themselves. Only should their level's hash not match ours
+    // do they ask for the full level packet, which then goes out to them alone.
     if (playerCount > 0) {
-        BroadcastStartGame(server_socket, players, playerCount);
+        LevelStartGamePacket startPacket = {0};
+        startPacket.planetCount = (uint32_t)level.planetCount;
+        startPacket.minFleetCapacity = parsed.minFleetCapacity;
+        startPacket.maxFleetCapacity = parsed.maxFleetCapacity;
+        startPacket.width = level.width;
+        startPacket.height = level.height;
+        startPacket.seed = parsed.randomSeed;
+        startPacket.mapHash = level.mapHash;
+        startPacket.layoutHash = LevelComputeLayoutHash(&level);
+        BroadcastStartGame(server_socket, players, playerCount, &startPacket, &level);
         for (size_t i = 0; i < playerCount; ++i) {
-            players[i].awaitingFullPacket = true;
-            SendFullPacketToPlayer(&players[i], server_socket, &level);
+            players[i].awaitingFullPacket = false;
+            SendAssignmentPacket(&players[i], server_socket);
         }
     }
 
@@ -996,6 +1171,7 @@ static void ReturnServerToLobby(void) {
     // Reset accumulators and selections so the next match starts cleanly.
     planetStateAccumulator = 0.0f;
     aiActionAccumulator = 0.0f;
+    simulationAccumulator = 0.0f;
     shipSpawnRNGState = SHIP_SPAWN_SEED;
     selected_planet = NULL;
 
@@ -1253,6 +1429,21 @@ LRESULT CALLBACK WindowProcessMessage(HWND window_handle, UINT msg, WPARAM wPara
         // It is suitable for handling non-text input, such as arrow keys
         // or keys like shift.
         case WM_KEYDOWN: {
+            // The profiler keys work in every stage.
+            // F3 shows or hides the frame timing overlay, and F4 writes out a trace of recent frames.
+            if (wParam == VK_F3) {
+                profilerOverlayVisible = !profilerOverlayVisible;
+                return 0;
+            }
+            if (wParam == VK_F4) {
+                if (ProfilerWriteChromeTrace(SERVER_PROFILER_TRACE_PATH)) {
+                    printf("Wrote profiler trace to %s.\n", SERVER_PROFILER_TRACE_PATH);
+                } else {
+                    printf("Failed to write profiler trace to %s.\n", SERVER_PROFILER_TRACE_PATH);
+                }
+                return 0;
+            }
+
             if (currentStage == SERVER_STAGE_LOBBY) {
                 bool shiftDown = (GetKeyState(VK_SHIFT) & 0x8000) != 0;
                 LobbyMenuUIHandleKeyDown(&lobbyMenuUI, wParam, shiftDown);
@@ -1618,6 +1809,130 @@ static void HandleLobbyTeamPacket(const SOCKADDR_IN *sender, const uint8_t *data
     lobbyStateDirty = true;
 }
 
+/**
+ * Processes a lobby resync request packet received from a client,
+ * which missed a lobby delta and needs the full lobby state again.
+ * @param sender Address of the client that sent the packet.
+ * @param data Pointer to the packet data.
+ * @param size Size of the packet data.
+ */
+static void HandleLobbyResyncPacket(const SOCKADDR_IN *sender, const uint8_t *data, size_t size) {
+    if (sender == NULL || data == NULL || size < sizeof(LevelLobbyResyncPacket)) {
+        return;
+    }
+
+    if (currentStage != SERVER_STAGE_LOBBY) {
+        return;
+    }
+
+    const LevelLobbyResyncPacket *packet = (const LevelLobbyResyncPacket *)data;
+    if (packet->type != LEVEL_PACKET_TYPE_LOBBY_RESYNC) {
+        return;
+    }
+
+    Player *player = FindPlayerByAddress(sender);
+    if (player == NULL) {
+        return;
+    }
+
+    SendLobbyStateToPlayerInstance(player);
+}
+
+/**
+ * Processes a full level request packet received from a client,
+ * whose own layout of the starting level did not match ours, or who never received the start game packet,
+ * and so needs the whole level sent.
+ * @param sender Address of the client that sent the packet.
+ * @param data Pointer to the packet data.
+ * @param size Size of the packet data.
+ */
+static void HandleFullRequestPacket(const SOCKADDR_IN *sender, const uint8_t *data, size_t size) {
+    if (sender == NULL || data == NULL || size < sizeof(LevelFullRequestPacket)) {
+        return;
+    }
+
+    if (currentStage != SERVER_STAGE_GAME) {
+        return;
+    }
+
+    const LevelFullRequestPacket *packet = (const LevelFullRequestPacket *)data;
+    if (packet->type != LEVEL_PACKET_TYPE_FULL_REQUEST) {
+        return;
+    }
+
+    Player *player = FindPlayerByAddress(sender);
+    if (player == NULL) {
+        return;
+    }
+
+    if (packet->layoutHash == 0u) {
+        printf("Player %s missed the start of the match, sending them the full level.\n", player->name);
+    } else {
+        printf("Player %s laid out a different level (hash %016llx), sending them the full level.\n",
+            player->name, (unsigned long long)packet->layoutHash);
+    }
+    player->awaitingFullPacket = true;
+    SendFullPacketToPlayer(player, server_socket, &level);
+}
+
+/**
+ * Processes a map request packet received from a client, sending back the chunks it asked for.
+ * Only the lobby's own map is ever sent, and only to connected players.
+ * @param sender Address of the client that sent the packet.
+ * @param data Pointer to the packet data.
+ * @param size Size of the packet data.
+ */
+static void HandleMapRequestPacket(const SOCKADDR_IN *sender, const uint8_t *data, size_t size) {
+    if (sender == NULL || data == NULL || size < sizeof(LevelMapRequestPacket)) {
+        return;
+    }
+
+    const LevelMapRequestPacket *packet = (const LevelMapRequestPacket *)data;
+    if (packet->type != LEVEL_PACKET_TYPE_MAP_REQUEST) {
+        return;
+    }
+
+    // A request for any other map is stale, most likely from before the server was restarted.
+    if (lobbyMap.data == NULL || packet->mapHash != lobbyMap.hash) {
+        return;
+    }
+
+    Player *player = FindPlayerByAddress(sender);
+    if (player == NULL) {
+        return;
+    }
+
+    SendMapChunksToPlayer(player, server_socket, &lobbyMap, packet->firstChunk, packet->chunkCount);
+}
+
+/**
+ * Processes a map ready packet received from a client, recording which map it has.
+ * @param sender Address of the client that sent the packet.
+ * @param data Pointer to the packet data.
+ * @param size Size of the packet data.
+ */
+static void HandleMapReadyPacket(const SOCKADDR_IN *sender, const uint8_t *data, size_t size) {
+    if (sender == NULL || data == NULL || size < sizeof(LevelMapReadyPacket)) {
+        return;
+    }
+
+    const LevelMapReadyPacket *packet = (const LevelMapReadyPacket *)data;
+    if (packet->type != LEVEL_PACKET_TYPE_MAP_READY) {
+        return;
+    }
+
+    Player *player = FindPlayerByAddress(sender);
+    if (player == NULL) {
+        return;
+    }
+
+    // Clients keep repeating this while in the lobby, so only announce the first time.
+    if (player->mapHash != packet->mapHash && lobbyMap.data != NULL && packet->mapHash == lobbyMap.hash) {
+        printf("Player %s has the map.\n", player->name);
+    }
+    player->mapHash = packet->mapHash;
+}
+
 /**
  * Processes a lobby shared control update packet received from a client.
  * Valid only during the lobby stage and for the sender's own faction.
@@ -1861,6 +2176,75 @@ static void HandleMoveOrderPacket(const SOCKADDR_IN *sender, const uint8_t *data
     free(validOrigins);
 }
 
+/**
+ * Finds the given option on the command line and reads the path following it.
+ * The path is whatever follows the option, up to the next space.
+ * @param commandLine The command line, excluding the program name. May be NULL.
+ * @param option The option to look for.
+ * @param outPath Receives the path, or an empty string if the option or its path is missing.
+ * @param outPathSize The size of outPath in bytes.
+ * @return true if the option was found with a usable path, false otherwise.
+ */
+static bool ReadCommandLinePath(const char *commandLine, const char *option, char *outPath, size_t outPathSize) {
+    if (outPath == NULL || outPathSize == 0) {
+        return false;
+    }
+    outPath[0] = '\0';
+
+    const char *found = commandLine != NULL ? strstr(commandLine, option) : NULL;
+    if (found == NULL) {
+        return false;
+    }
+
+    const char *path = found + strlen(option);
+    while (*path == ' ') {
+        ++path;
+    }
+    size_t length = strcspn(path, " ");
+    if (length == 0 || length >= outPathSize) {
+        printf("Ignoring %s without a usable path.\n", option);
+        return false;
+    }
+
+    memcpy(outPath, path, length);
+    outPath[length] = '\0';
+    return true;
+}
+
+/**
+ * Opens the map file every match will be played on, and makes the lobby settings match it.
+ * @param path The path of the map file.
+ * @return true if the map was opened, false if levels will be generated as usual.
+ */
+static bool LoadLobbyMap(const char *path) {
+    if (!MapFileOpen(path, &lobbyMap)) {
+        printf("Failed to open map %s; generating levels instead.\n", path);
+        return false;
+    }
+
+    // The lobby settings only hold planet counts that fit in an int.
+    if (lobbyMap.header->planetCount > (uint32_t)INT_MAX || lobbyMap.size > UINT32_MAX) {
+        printf("Map %s is too large to play; generating levels instead.\n", path);
+        MapFileClose(&lobbyMap);
+        return false;
+    }
+
+    strncpy(lobbyMapPath, path, sizeof(lobbyMapPath) - 1);
+    lobbyMapPath[sizeof(lobbyMapPath) - 1] = '\0';
+
+    // Show the map's own planets and bounds in the lobby, and no more factions than it has room for.
+    lobbySettings.planetCount = (int)lobbyMap.header->planetCount;
+    lobbySettings.levelWidth = lobbyMap.header->width;
+    lobbySettings.levelHeight = lobbyMap.header->height;
+    if ((uint32_t)lobbySettings.factionCount > lobbyMap.header->startSlotCount) {
+        lobbySettings.factionCount = (int)lobbyMap.header->startSlotCount;
+    }
+
+    printf("Playing on map %s: %u planets, %u start slots, hash %016llx.\n", path,
+        lobbyMap.header->planetCount, lobbyMap.header->startSlotCount, (unsigned long long)lobbyMap.hash);
+    return true;
+}
+
 /**
  * Starting point for the program.
  * @param hInstance Handle to the current instance of the program.
@@ -1875,9 +2259,19 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
     // Force printf to flush immediately
     setvbuf(stdout, NULL, _IONBF, 0);
 
-    // Suppresses -Wunused-parameter warning for hPrevInstance and pCmdLine
+    // Start the profiler before anything it times gets going.
+    ProfilerInitialize();
+
+    // Suppresses -Wunused-parameter warning for hPrevInstance
     (void)hPrevInstance;
-    (void)pCmdLine;
+
+    // The determinism replay needs no window, clients, or anything else, so it runs and exits right away.
+    if (pCmdLine != NULL && strstr(pCmdLine, SERVER_DETERMINISM_REPLAY_OPTION) != NULL) {
+        return RunDeterminismReplay(false, NULL) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (pCmdLine != NULL && strstr(pCmdLine, SERVER_DETERMINISM_RECORD_OPTION) != NULL) {
+        return RunDeterminismReplay(true, NULL) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
     // Create the window class to hold information about the window.
     static WNDCLASS window_class = {0};
@@ -1991,15 +2385,21 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
     cameraState.minZoom = SERVER_CAMERA_MIN_ZOOM;
     cameraState.maxZoom = SERVER_CAMERA_MAX_ZOOM;
     LobbyPreviewInitialize(&lobbyPreview, SERVER_CAMERA_MIN_ZOOM, SERVER_CAMERA_MAX_ZOOM);
+
+    // Pick up the map file to play on, if any, before the lobby settings are shown.
+    char mapPath[MAX_PATH];
+    if (ReadCommandLinePath(pCmdLine, SERVER_MAP_OPTION, mapPath, sizeof(mapPath)) && LoadLobbyMap(mapPath)) {
+        LobbyPreviewSetMapPath(&lobbyPreview, lobbyMapPath);
+    }
+    ReadCommandLinePath(pCmdLine, SERVER_EXPORT_MAP_OPTION, exportMapPath, sizeof(exportMapPath));
+
     // Initialize the game over overlay with server-specific behavior.
     GameOverUIInitialize(&gameOverUI, true);
     InitializeLobbyState();
 
-    // Initialize the sound manager so ownership cues can be played.
-    SoundManagerInitialize();
-
-    // Server does not play sounds itself, so we set volume to zero.
-    SoundManagerSetVolume(0.0f);
+    // The server does not play sounds itself, so the sound manager gets the null backend,
+    // which leaves sound switched off without so much as a thread or device behind it.
+    SoundManagerInitialize(&SOUND_NULL_BACKEND, NULL);
 
     printf("Entering main program loop...\n");
 
@@ -2017,6 +2417,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
         }
 
         // Here we wait for a UDP message
+        // Everything up to the delta time calculation counts as network time.
+        // Should a packet be rejected early with a continue, the marker is simply never ended.
+        ProfilerMarker networkMarker = ProfilerBegin(PROFILER_ZONE_NETWORK);
         
         // Flags tell recvfrom how to behave, 0 means no special behavior
         int flags = 0;
@@ -2128,6 +2531,18 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
                 } else if (packetType == LEVEL_PACKET_TYPE_LOBBY_SHARED_CONTROL) {
                     HandleLobbySharedControlPacket(&sender_address, (const uint8_t *)recv_buffer, (size_t)bytes_received);
                     handled = true;
+                } else if (packetType == LEVEL_PACKET_TYPE_MAP_REQUEST) {
+                    HandleMapRequestPacket(&sender_address, (const uint8_t *)recv_buffer, (size_t)bytes_received);
+                    handled = true;
+                } else if (packetType == LEVEL_PACKET_TYPE_MAP_READY) {
+                    HandleMapReadyPacket(&sender_address, (const uint8_t *)recv_buffer, (size_t)bytes_received);
+                    handled = true;
+                } else if (packetType == LEVEL_PACKET_TYPE_LOBBY_RESYNC) {
+                    HandleLobbyResyncPacket(&sender_address, (const uint8_t *)recv_buffer, (size_t)bytes_received);
+                    handled = true;
+                } else if (packetType == LEVEL_PACKET_TYPE_FULL_REQUEST) {
+                    HandleFullRequestPacket(&sender_address, (const uint8_t *)recv_buffer, (size_t)bytes_received);
+                    handled = true;
                 } else if (packetType == LEVEL_PACKET_TYPE_CLIENT_DISCONNECT) {
                     // It's a disconnect notice from a client.
                     // We need to figure out which player is disconnecting
@@ -2156,6 +2571,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
                 printf("recvfrom failed: %d\n", error);
             }
         }
+        ProfilerEnd(&networkMarker);
 
         // Calculate delta time
         int64_t current_ticks = GetTicks();
@@ -2172,18 +2588,38 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
                 // Update the camera based on input
                 UpdateCamera(window_handle, delta_time);
 
-                // Update the level state
-                LevelUpdate(&level, delta_time);
+                // Update the level state, one fixed tick at a time, exactly as the clients do.
+                // A variable step would integrate the starships along a different path than
+                // the clients' fixed one, and the two would drift apart however exact the math.
+                ProfilerMarker updateMarker = ProfilerBegin(PROFILER_ZONE_LEVEL_UPDATE);
+                float tickSeconds = 1.0f / (float)SERVER_SIMULATION_TICK_RATE;
+                simulationAccumulator += delta_time;
+
+                // If we have fallen far behind, we skip the ticks we missed rather than
+                // running all of them back to back, which would only put us further behind.
+                if (simulationAccumulator > tickSeconds * (float)SERVER_SIMULATION_MAX_CATCHUP_TICKS) {
+                    simulationAccumulator = tickSeconds * (float)SERVER_SIMULATION_MAX_CATCHUP_TICKS;
+                }
+                while (simulationAccumulator >= tickSeconds) {
+                    LevelUpdate(&level, tickSeconds);
+                    simulationAccumulator -= tickSeconds;
+                }
+                ProfilerEnd(&updateMarker);
+
+                // One cue per planet for whatever arrived there this frame.
+                LevelPlayAudioEvents(&level);
 
                 // We run AI actions at a fixed rate (default 2Hz) since there isn't much need
                 // to process them every frame. The game isn't that fast-paced (yet).
                 if (AI_ACTION_RATE > 0) {
+                    ProfilerMarker aiMarker = ProfilerBegin(PROFILER_ZONE_AI);
                     float interval = 1.0f / (float)AI_ACTION_RATE;
                     aiActionAccumulator += delta_time;
                     while (aiActionAccumulator >= interval) {
                         RunAIActions();
                         aiActionAccumulator -= interval;
                     }
+                    ProfilerEnd(&aiMarker);
                 }
             }
 
@@ -2217,14 +2653,22 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
         if (currentStage == SERVER_STAGE_GAME) {
             // Keep track of time for planet state broadcasting
             // Broadcasts now run at 20 Hz to keep ownership in sync.
+            ProfilerMarker snapshotMarker = ProfilerBegin(PROFILER_ZONE_SNAPSHOT);
             planetStateAccumulator += delta_time;
             while (planetStateAccumulator >= PLANET_STATE_BROADCAST_INTERVAL) {
                 BroadcastSnapshots(sock, &level, players, playerCount);
                 planetStateAccumulator -= PLANET_STATE_BROADCAST_INTERVAL;
             }
-        } else if (lobbyStateDirty) {
-            BroadcastLobbyStateToAll();
-            lobbyStateDirty = false;
+            ProfilerEnd(&snapshotMarker);
+        } else {
+            // Lobby edits are held back until a broadcast window has passed since the last broadcast,
+            // so however many edits are made in the meantime, they all go out as one.
+            lobbyBroadcastTimer += delta_time;
+            if (lobbyStateDirty && lobbyBroadcastTimer >= SERVER_LOBBY_BROADCAST_INTERVAL) {
+                BroadcastLobbyStateToAll();
+                lobbyStateDirty = false;
+                lobbyBroadcastTimer = 0.0f;
+            }
         }
 
         // Calculate frames per second (FPS)
@@ -2237,6 +2681,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
         }
 
         if (openglContext.deviceContext && openglContext.renderContext) {
+            // Start counting draw calls and vertices for this frame.
+            RenderBatchBeginFrame();
+
             // Sets the clear color for the window (background color)
             glClearColor(BACKGROUND_COLOR_R, BACKGROUND_COLOR_G, BACKGROUND_COLOR_B, BACKGROUND_COLOR_A);
 
@@ -2250,11 +2697,45 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
             glLoadIdentity();
 
             if (openglContext.width > 0 && openglContext.height > 0) {
-                // Draw the background gradient
-                DrawBackgroundGradient(openglContext.width, openglContext.height);
+                bool drawingLevel = currentStage == SERVER_STAGE_GAME;
+                bool culled = false;
+                bool layered = false;
+
+                if (drawingLevel) {
+                    // Culling and the static layer are both in service of drawing the planets,
+                    // so their time counts toward the planets.
+                    ProfilerMarker planetMarker = ProfilerBegin(PROFILER_ZONE_DRAW_PLANETS);
+
+                    // Tessellate world shapes for the size they appear on screen,
+                    // and pick how much detail starships and trails are drawn with.
+                    RenderSetDetailScale(cameraState.zoom);
+
+                    // Work out what is actually inside the camera's view,
+                    // so that we only draw the planets, trails and ships that can be seen.
+                    // Should culling fail for whatever reason, we fall back to drawing everything.
+                    CullingRect viewRect = CullingRectFromCamera(&cameraState,
+                        (float)openglContext.width, (float)openglContext.height);
+                    culled = CullLevel(&level, &viewRect, &visiblePlanets, &visibleTrails, &visibleStarships, &cullingStats);
+                    if (!culled) {
+                        cullingStats.visiblePlanets = cullingStats.totalPlanets = level.planetCount;
+                        cullingStats.visibleTrails = cullingStats.totalTrails = level.trailEffectCount;
+                        cullingStats.visibleStarships = cullingStats.totalStarships = level.starshipCount;
+                    }
+
+                    // The background and every planet that has not changed in a while come from the static layer,
+                    // which only draws again what changed since the last frame.
+                    layered = StaticLayerCompose(&staticLayer, &level, &cameraState, openglContext.width, openglContext.height,
+                        culled ? visiblePlanets.indices : NULL, cullingStats.visiblePlanets);
+                    ProfilerEnd(&planetMarker);
+                }
+
+                // Draw the background gradient, unless the static layer already holds it.
+                if (!layered) {
+                    DrawBackgroundGradient(openglContext.width, openglContext.height);
+                }
 
                 // We only draw the game elements if we are in the game stage.
-                if (currentStage == SERVER_STAGE_GAME) {
+                if (drawingLevel) {
                     // Save the current matrix state before applying camera transformations.
                     glPushMatrix();
 
@@ -2262,34 +2743,76 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
                     // to allow for panning and zooming.
                     ApplyCameraTransform();
 
-                    // Draw each planet in the level
-                    for (size_t i = 0; i < level.planetCount; ++i) {
-                        PlanetDraw(&level.planets[i]);
-                    }
-
-                    // Draw each starship trail effect
-                    for (size_t i = 0; i < level.trailEffectCount; ++i) {
-                        StarshipTrailEffectDraw(&level.trailEffects[i]);
+                    // Everything in the world is drawn in a sorted pass, so that objects switching back
+                    // and forth between blend modes (such as ship glows and ship discs) only cost
+                    // one state change per layer and mode rather than one per object.
+                    RenderBatchBeginSortedPass();
+                    StarshipDetailLevel shipDetail = StarshipDetailLevelForZoom(cameraState.zoom);
+                    size_t trailStride = StarshipTrailStrideForZoom(cameraState.zoom);
+
+                    // Draw each visible planet in the level that is not already part of the static layer.
+                    ProfilerMarker planetMarker = ProfilerBegin(PROFILER_ZONE_DRAW_PLANETS);
+                    for (size_t n = 0; n < cullingStats.visiblePlanets; ++n) {
+                        size_t i = culled ? visiblePlanets.indices[n] : n;
+                        if (layered && StaticLayerIsPlanetBaked(&staticLayer, i)) {
+                            continue;
+                        }
+                        PlanetDrawCached(&level.planets[i], level.planetRenderCaches != NULL ? &level.planetRenderCaches[i] : NULL);
                     }
+                    ProfilerEnd(&planetMarker);
+
+                    // Draw every visible trail, both those left behind by destroyed ships
+                    // and those of ships still flying, in a single pass with one set of render state.
+                    // Blobs have no trails, so ship trails are skipped when zoomed that far out.
+                    ProfilerMarker trailMarker = ProfilerBegin(PROFILER_ZONE_DRAW_TRAILS);
+                    StarshipDrawTrails(level.starships, level.fleets, culled ? visibleStarships.indices : NULL,
+                        shipDetail == STARSHIP_DETAIL_BLOB ? 0 : cullingStats.visibleStarships,
+                        level.trailEffects, culled ? visibleTrails.indices : NULL,
+                        cullingStats.visibleTrails, trailStride);
+                    ProfilerEnd(&trailMarker);
 
                     // If a planet is selected, draw a ring around it
                     if (selected_planet != NULL) {
                         float radius = PlanetGetOuterRadius(selected_planet);
                         float highlightColor[4] = {1.0f, 1.0f, 1.0f, 0.85f};
+                        // The ring sits above the trails but beneath the ships.
+                        RenderBatchSetLayer(RENDER_BATCH_LAYER_SELECTION);
                         DrawFeatheredRing(selected_planet->position.x, selected_planet->position.y,
                             radius + 2.0f, radius + 5.0f, 1.2f, highlightColor);
+                        RenderBatchSetLayer(RENDER_BATCH_LAYER_WORLD);
                     }
 
-                    // Draw each starship in the level
-                    for (size_t i = 0; i < level.starshipCount; ++i) {
-                        StarshipDraw(&level.starships[i]);
+                    // Draw each visible starship in the level
+                    // When zoomed far out, ships of the same fleet are merged into blobs instead.
+                    ProfilerMarker shipMarker = ProfilerBegin(PROFILER_ZONE_DRAW_SHIPS);
+                    if (shipDetail == STARSHIP_DETAIL_BLOB) {
+                        StarshipDrawFleetBlobs(level.starships, level.fleets, culled ? visibleStarships.indices : NULL,
+                            cullingStats.visibleStarships, cameraState.zoom);
+                    } else {
+                        for (size_t n = 0; n < cullingStats.visibleStarships; ++n) {
+                            size_t i = culled ? visibleStarships.indices[n] : n;
+                            const Starship *ship = &level.starships[i];
+                            StarshipDrawHull(ship, &level.fleets[ship->fleetIndex], shipDetail, cameraState.zoom);
+                        }
                     }
+                    ProfilerEnd(&shipMarker);
+
+                    // Submit everything batched so far while the camera transform is still applied.
+                    ProfilerMarker submitMarker = ProfilerBegin(PROFILER_ZONE_DRAW_SUBMIT);
+                    RenderBatchEndSortedPass();
+                    RenderBatchFlush();
+                    ProfilerEnd(&submitMarker);
+
+                    // Anything drawn from here on is in screen space, so back to full detail.
+                    RenderSetDetailScale(1.0f);
 
                     // Restore the previous matrix state
                     glPopMatrix();
                 }
             }
 
+            ProfilerMarker uiMarker = ProfilerBegin(PROFILER_ZONE_DRAW_UI);
+
             // We only need to draw the lobby UI elements if we are in the lobby stage.
             if (currentStage == SERVER_STAGE_LOBBY) {
                 LobbyMenuUIDraw(&lobbyMenuUI, &openglContext, openglContext.width, openglContext.height);
@@ -2308,20 +2831,45 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
             int textPositionFromLeft = 10;
 
             if (openglContext.width >= textPositionFromLeft && openglContext.height >= textPositionFromTop) {
-                char fpsString[32];
-                snprintf(fpsString, sizeof(fpsString), "FPS: %.0f", fps);
+                char fpsString[256];
+                RenderBatchStats batchStats = RenderBatchGetStats();
+                int written = snprintf(fpsString, sizeof(fpsString), "FPS: %.0f\nDraw Calls: %zu\nVertices: %zu",
+                    fps, batchStats.drawCalls, batchStats.vertexCount);
+
+                // Visibility counts only mean something while the game world is being drawn.
+                if (currentStage == SERVER_STAGE_GAME && written > 0 && (size_t)written < sizeof(fpsString)) {
+                    snprintf(fpsString + written, sizeof(fpsString) - (size_t)written,
+                        "\nVisible Planets: %zu/%zu\nVisible Ships: %zu/%zu\nVisible Trails: %zu/%zu",
+                        cullingStats.visiblePlanets, cullingStats.totalPlanets,
+                        cullingStats.visibleStarships, cullingStats.totalStarships,
+                        cullingStats.visibleTrails, cullingStats.totalTrails);
+                }
 
                 float textColor[4] = {1.0f, 1.0f, 1.0f, 1.0f};
                 float textSize = 16.0f;
                 DrawScreenText(&openglContext, fpsString, (float)textPositionFromLeft, (float)textPositionFromTop, textSize, textSize / 2, textColor);
             }
 
+            // The profiler overlay goes over absolutely everything else.
+            if (profilerOverlayVisible) {
+                ProfilerDrawOverlay(&openglContext, (float)openglContext.width - PROFILER_OVERLAY_WIDTH - 10.0f, 10.0f);
+            }
+
+            // Make sure nothing is left waiting in the render batch.
+            RenderBatchFlush();
+            ProfilerEnd(&uiMarker);
+
             // Swap the front and back buffers to display the rendered frame.
             // There's two buffers, one being displayed while the other is drawn to.
             // Swapping them makes the newly drawn frame visible, while taking the
             // previously displayed buffer off-screen for the next frame's drawing.
+            ProfilerMarker swapMarker = ProfilerBegin(PROFILER_ZONE_SWAP_BUFFERS);
             SwapBuffers(openglContext.deviceContext);
+            ProfilerEnd(&swapMarker);
         }
+
+        // Everything for this frame is done, so its timings go into the history.
+        ProfilerEndFrame();
     }
 
     // At this point in the code, we are exiting the main loop and need to clean up resources.
@@ -2329,10 +2877,18 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
     server_socket = INVALID_SOCKET;
     WSACleanup();
     LevelRelease(&level);
+    MapFileClose(&lobbyMap);
     LobbyPreviewRelease(&lobbyPreview);
+    CullingIndexListRelease(&visiblePlanets);
+    CullingIndexListRelease(&visibleTrails);
+    CullingIndexListRelease(&visibleStarships);
+    RenderBatchRelease();
+    RenderReleaseTextCache();
+    StaticLayerRelease(&staticLayer);
 
     // Disable sound playback before releasing OS resources.
     SoundManagerShutdown();
     OpenGLShutdownForWindow(&openglContext, window_handle);
+    ProfilerShutdown();
     return EXIT_SUCCESS;
 }
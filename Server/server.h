@@ -23,9 +23,12 @@
 #include <limits.h>
 #include "Utilities/gameUtilities.h"
 #include "Utilities/networkUtilities.h"
+#include "Utilities/mapFileUtilities.h"
 #include "Utilities/renderUtilities.h"
 #include "Utilities/openglUtilities.h"
 #include "Utilities/cameraUtilities.h"
+#include "Utilities/cullingUtilities.h"
+#include "Utilities/staticLayerUtilities.h"
 #include "Utilities/MenuUtilities/lobbyMenuUtilities.h"
 #include "Utilities/MenuUtilities/lobbyPreviewUtilities.h"
 #include "Utilities/MenuUtilities/gameOverUIUtilities.h"
@@ -35,6 +38,8 @@
 #include "Objects/starship.h"
 #include "Objects/player.h"
 #include "AI/aiPersonality.h"
+#include "Utilities/profilerUtilities.h"
+#include "Utilities/profilerOverlayUtilities.h"
 
 // Port number for the server to listen on
 #define SERVER_PORT 22311
@@ -46,6 +51,16 @@
 // Interval at which to broadcast planet state snapshots to all clients (in seconds).
 #define PLANET_STATE_BROADCAST_INTERVAL (1.0f / 20.0f) // 20 Hz
 
+// Number of times per second the level is updated, each time by exactly one tick's length,
+// however quickly or slowly frames are drawn.
+// Must match CLIENT_SIMULATION_TICK_RATE, so that the server and its clients integrate
+// the simulation with the same sequence of steps and so compute the same bits.
+#define SERVER_SIMULATION_TICK_RATE 60
+
+// Most ticks the server will run back to back to catch up after falling behind,
+// for instance while the window is being dragged. Any ticks beyond this are skipped.
+#define SERVER_SIMULATION_MAX_CATCHUP_TICKS 5
+
 // Howfar the mouse must be from the edge of the window
 // before edge panning begins (in pixels).
 #define SERVER_CAMERA_EDGE_MARGIN 24.0f
@@ -72,6 +87,28 @@
 // a client to have timed out.
 #define CLIENT_TIMEOUT_MS 1800000
 
+// Shortest time in seconds between two lobby broadcasts.
+// Lobby edits made within this window, such as a color being dragged around, go out together as one delta.
+#define SERVER_LOBBY_BROADCAST_INTERVAL 0.1f
+
+// File the profiler writes its trace of recent frames to when F4 is pressed.
+#define SERVER_PROFILER_TRACE_PATH "server_trace.json"
+
+// Command line options for map files.
+// "--map <path>" plays every match on the given map file rather than generating a level,
+// sending the map to any client that does not have it yet.
+// "--export-map <path>" writes each generated level out as a map file as its match starts,
+// which is the simplest way to make a map file to begin with.
+#define SERVER_MAP_OPTION "--map"
+#define SERVER_EXPORT_MAP_OPTION "--export-map"
+
+// Command line options which, rather than starting the server, run the determinism replay and exit.
+// See RunDeterminismReplay. "--determinism-replay" checks the state hashes the replay produces
+// against the expected ones and exits with a failure code should any differ,
+// while "--determinism-record" prints them, for updating the expected hashes after an intended change.
+#define SERVER_DETERMINISM_REPLAY_OPTION "--determinism-replay"
+#define SERVER_DETERMINISM_RECORD_OPTION "--determinism-record"
+
 /**
  * Defines the various stages the server application can be in.
  * Used to determine which logic and rendering to perform.
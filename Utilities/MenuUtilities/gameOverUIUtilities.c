@@ -375,14 +375,21 @@ bool GameOverUIComputeWinningTeam(const Level *level, int *outTeamNumber, int *o
     }
 
     // Starships must also belong to the same team to prevent stalemates from ending early.
-    for (size_t i = 0; i < level->starshipCount; ++i) {
-        const Faction *owner = level->starships[i].owner;
+    // Every starship of a fleet has the fleet's owner, so it is enough to check each fleet
+    // that still stands for any ships, adding up the weights of its starships, rather than each starship.
+    for (size_t i = 0; i < level->fleetCount; ++i) {
+        const Fleet *fleet = &level->fleets[i];
+        if (fleet->liveWeight == 0) {
+            continue;
+        }
+
+        const Faction *owner = fleet->owner;
         if (owner == NULL || owner->teamNumber != winningTeam) {
             return false;
         }
 
         // If the winning team is FACTION_TEAM_NONE, we need to check and see if 
-        // this starship is owned by a different faction.
+        // this fleet is owned by a different faction.
         if (winningTeam == FACTION_TEAM_NONE && owner->id != winningFactionId) {
             return false;
         }
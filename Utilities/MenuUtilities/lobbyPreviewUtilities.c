@@ -109,35 +109,45 @@ static void LobbyPreviewResetCamera(LobbyPreviewContext *preview, const MenuUIRe
 }
 
 /**
- * Generates the preview level using the provided settings and slot colors.
- * @param preview Pointer to the LobbyPreviewContext to update.
- * @param settings Pointer to lobby generation settings.
- * @param slotColors Slot color array for faction previews.
- * @param slotColorValid Flags indicating which slot colors are valid.
- * @param slotCount Number of slots to use for preview coloring.
- * @return True if generation succeeded, false otherwise.
+ * Generates a preview level using the provided settings and slot colors.
+ * Called on the worker thread, so it must only touch the level and request it is given.
+ * @param level Pointer to the Level to generate into.
+ * @param request Pointer to the request holding the settings and slot colors to use.
+ * @param cancelRequested Checked during generation, which stops once it becomes nonzero. May be NULL.
+ * @return True if generation succeeded, false if it failed or was cancelled.
  */
-static bool LobbyPreviewBuildLevel(LobbyPreviewContext *preview,
-    const LobbyMenuGenerationSettings *settings,
-    const float slotColors[LOBBY_MENU_MAX_SLOTS][4],
-    const bool slotColorValid[LOBBY_MENU_MAX_SLOTS],
-    size_t slotCount) {
-    if (preview == NULL || settings == NULL) {
+static bool LobbyPreviewBuildLevel(Level *level, const LobbyPreviewRequest *request, volatile LONG *cancelRequested) {
+    if (level == NULL || request == NULL) {
         return false;
     }
 
+    const LobbyMenuGenerationSettings *settings = &request->settings;
     size_t factionCount = (size_t)settings->factionCount;
     size_t planetCount = (size_t)settings->planetCount;
 
+    // A map file decides the planets itself, and how many factions it has room for.
+    // The worker opens its own view of the map, so nothing is shared with whoever else has it open.
+    MapFile map = {0};
+    bool fromMap = request->mapPath[0] != '\0';
+    if (fromMap) {
+        if (!MapFileOpen(request->mapPath, &map)) {
+            return false;
+        }
+        planetCount = (size_t)map.header->planetCount;
+        if (factionCount > (size_t)map.header->startSlotCount) {
+            factionCount = (size_t)map.header->startSlotCount;
+        }
+    }
+
     // Allocate level storage sized to lobby settings.
     size_t initialShipCapacity = factionCount * (size_t)((settings->minFleetCapacity + settings->maxFleetCapacity) * 0.5f);
-    if (!LevelConfigure(&preview->level, factionCount, planetCount, initialShipCapacity)) {
-        preview->levelInitialized = false;
+    if (!LevelConfigure(level, factionCount, planetCount, initialShipCapacity)) {
+        MapFileClose(&map);
         return false;
     }
 
     // Apply faction colors from lobby slots to keep the preview consistent.
-    size_t colorCount = slotCount;
+    size_t colorCount = request->slotCount;
     if (colorCount > LOBBY_MENU_MAX_SLOTS) {
         colorCount = LOBBY_MENU_MAX_SLOTS;
     }
@@ -147,31 +157,172 @@ static bool LobbyPreviewBuildLevel(LobbyPreviewContext *preview,
         // Fallback to a neutral gray if no slot color is assigned.
         float fallback[4] = {0.8f, 0.8f, 0.8f, 1.0f};
         const float *color = fallback;
-        if (i < colorCount && slotColorValid != NULL && slotColorValid[i]) {
-            color = slotColors[i];
+        if (i < colorCount && request->slotColorValid[i]) {
+            color = request->slotColors[i];
         }
-        preview->level.factions[i] = CreateFaction((int)i, color[0], color[1], color[2]);
+        level->factions[i] = CreateFaction((int)i, color[0], color[1], color[2]);
+    }
+
+    // Laying out a map is a single pass over its planets, so there is no point checking for cancellation.
+    if (fromMap) {
+        bool applied = MapFileApplyToLevel(&map, level, factionCount);
+        MapFileClose(&map);
+        return applied;
     }
 
     // Generate the randomized planet layout using the current settings.
-    if (!GenerateRandomLevel(&preview->level,
+    return GenerateRandomLevelCancellable(level,
         planetCount,
         factionCount,
         settings->minFleetCapacity,
         settings->maxFleetCapacity,
         settings->levelWidth,
         settings->levelHeight,
-        settings->randomSeed)) {
-        preview->levelInitialized = false;
+        settings->randomSeed,
+        cancelRequested);
+}
+
+/**
+ * Generates pendingLevel for the most recent request, unless the worker has already started on it.
+ * Afterwards, the level is marked ready to swap in, unless a newer request arrived in the meantime.
+ * @param preview Pointer to the LobbyPreviewContext to generate for.
+ * @return True if there was a request to generate for, false if the worker is up to date.
+ */
+static bool LobbyPreviewBuildPending(LobbyPreviewContext *preview) {
+    EnterCriticalSection(&preview->workerLock);
+    if (preview->startedGeneration == preview->requestedGeneration) {
+        LeaveCriticalSection(&preview->workerLock);
         return false;
     }
 
-    preview->levelInitialized = true;
+    // Take our own copy of the request so the UI thread is free to replace it while we work.
+    LobbyPreviewRequest request = preview->request;
+    LONG generation = preview->requestedGeneration;
+    preview->startedGeneration = generation;
+    preview->pendingReady = false;
+    // Any cancellation so far was meant for an earlier request, not this one.
+    InterlockedExchange(&preview->cancelRequested, 0);
+    LeaveCriticalSection(&preview->workerLock);
+
+    bool succeeded = LobbyPreviewBuildLevel(&preview->pendingLevel, &request, &preview->cancelRequested);
+
+    // Only hand the level over if it is still what the UI thread wants, otherwise it is simply dropped.
+    EnterCriticalSection(&preview->workerLock);
+    if (generation == preview->requestedGeneration) {
+        preview->pendingReady = true;
+        preview->pendingSucceeded = succeeded;
+        preview->pendingGeneration = generation;
+    }
+    LeaveCriticalSection(&preview->workerLock);
     return true;
 }
 
 /**
- * Initializes the lobby preview context and its camera constraints.
+ * Entry point of the preview worker thread.
+ * Sleeps until woken, then generates the most recent request, over and over until told to stop.
+ * @param parameter Pointer to the LobbyPreviewContext the worker belongs to.
+ * @return Always 0.
+ */
+static DWORD WINAPI LobbyPreviewWorkerThread(LPVOID parameter) {
+    LobbyPreviewContext *preview = (LobbyPreviewContext *)parameter;
+
+    while (preview->workerStopRequested == 0) {
+        WaitForSingleObject(preview->workerWakeEvent, INFINITE);
+
+        // More requests may have arrived while generating, so keep going until caught up.
+        while (preview->workerStopRequested == 0 && LobbyPreviewBuildPending(preview)) {
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Asks for a new preview level to be generated for the given settings.
+ * Any level still being generated for older settings is cancelled.
+ * Without a worker thread, the level is generated right away instead.
+ * @param preview Pointer to the LobbyPreviewContext to update.
+ * @param settings Pointer to lobby generation settings.
+ * @param slotColors Slot color array for faction previews.
+ * @param slotColorValid Flags indicating which slot colors are valid.
+ * @param slotCount Number of slots to use for preview coloring.
+ */
+static void LobbyPreviewRequestBuild(LobbyPreviewContext *preview,
+    const LobbyMenuGenerationSettings *settings,
+    const float slotColors[LOBBY_MENU_MAX_SLOTS][4],
+    const bool slotColorValid[LOBBY_MENU_MAX_SLOTS],
+    size_t slotCount) {
+    EnterCriticalSection(&preview->workerLock);
+    preview->request.settings = *settings;
+    for (size_t i = 0; i < LOBBY_MENU_MAX_SLOTS; ++i) {
+        preview->request.slotColorValid[i] = slotColorValid != NULL && slotColors != NULL && slotColorValid[i];
+        if (preview->request.slotColorValid[i]) {
+            memcpy(preview->request.slotColors[i], slotColors[i], sizeof(preview->request.slotColors[i]));
+        }
+    }
+    preview->request.slotCount = slotCount;
+    memcpy(preview->request.mapPath, preview->mapPath, sizeof(preview->request.mapPath));
+    preview->requestedGeneration++;
+    InterlockedExchange(&preview->cancelRequested, 1);
+    LeaveCriticalSection(&preview->workerLock);
+
+    preview->generating = true;
+    if (preview->workerThread != NULL) {
+        SetEvent(preview->workerWakeEvent);
+    } else {
+        LobbyPreviewBuildPending(preview);
+    }
+}
+
+/**
+ * Cancels any preview level still being generated, and drops any that is waiting to be swapped in.
+ * @param preview Pointer to the LobbyPreviewContext to update.
+ */
+static void LobbyPreviewCancelBuild(LobbyPreviewContext *preview) {
+    EnterCriticalSection(&preview->workerLock);
+    // Bumping the generation is enough to make whatever the worker finishes stale.
+    // There is nothing new to generate, so the worker is marked as already having started on it.
+    preview->requestedGeneration++;
+    preview->startedGeneration = preview->requestedGeneration;
+    preview->pendingReady = false;
+    InterlockedExchange(&preview->cancelRequested, 1);
+    LeaveCriticalSection(&preview->workerLock);
+
+    preview->generating = false;
+}
+
+/**
+ * Swaps in the level the worker generated, if it has finished one for the most recent request.
+ * The level swapped out is released, so the worker starts from an empty level next time.
+ * @param preview Pointer to the LobbyPreviewContext to update.
+ * @return True if a newly generated level was swapped in, false otherwise.
+ */
+static bool LobbyPreviewCollectBuild(LobbyPreviewContext *preview) {
+    bool swapped = false;
+
+    EnterCriticalSection(&preview->workerLock);
+    if (preview->pendingReady && preview->pendingGeneration == preview->requestedGeneration) {
+        // While pendingReady is set, the worker keeps its hands off pendingLevel, so the swap is safe.
+        // Levels only hold pointers to their arrays, so swapping them is just a few words of copying.
+        Level finished = preview->pendingLevel;
+        preview->pendingLevel = preview->level;
+        preview->level = finished;
+        LevelRelease(&preview->pendingLevel);
+
+        preview->levelInitialized = preview->pendingSucceeded;
+        preview->pendingReady = false;
+        preview->generating = false;
+        swapped = preview->levelInitialized;
+    }
+    LeaveCriticalSection(&preview->workerLock);
+
+    return swapped;
+}
+
+/**
+ * Initializes the lobby preview context and its camera constraints,
+ * and starts the worker thread which generates preview levels.
+ * Should the worker fail to start, preview levels are generated on the UI thread instead.
  * @param preview Pointer to the LobbyPreviewContext to initialize.
  * @param minZoom Minimum zoom level for the preview camera.
  * @param maxZoom Maximum zoom level for the preview camera.
@@ -184,6 +335,7 @@ void LobbyPreviewInitialize(LobbyPreviewContext *preview, float minZoom, float m
     // Clear the preview state so we start from a known baseline.
     memset(preview, 0, sizeof(*preview));
     LevelInit(&preview->level);
+    LevelInit(&preview->pendingLevel);
     CameraInitialize(&preview->camera);
     // Store base limits so later fit-to-level logic can temporarily lower min zoom.
     preview->baseMinZoom = minZoom;
@@ -191,10 +343,21 @@ void LobbyPreviewInitialize(LobbyPreviewContext *preview, float minZoom, float m
     preview->camera.minZoom = minZoom;
     preview->camera.maxZoom = maxZoom;
     preview->dirty = true;
+
+    InitializeCriticalSection(&preview->workerLock);
+
+    // An auto-reset event, so each wake-up is consumed by the wait it ends.
+    preview->workerWakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (preview->workerWakeEvent != NULL) {
+        preview->workerThread = CreateThread(NULL, 0, LobbyPreviewWorkerThread, preview, 0, NULL);
+    }
+    if (preview->workerThread == NULL) {
+        printf("Failed to start the lobby preview worker; previews will be generated in the foreground.\n");
+    }
 }
 
 /**
- * Releases memory owned by the preview level.
+ * Stops the preview worker thread and releases memory owned by the preview levels.
  * @param preview Pointer to the LobbyPreviewContext to release.
  */
 void LobbyPreviewRelease(LobbyPreviewContext *preview) {
@@ -202,8 +365,26 @@ void LobbyPreviewRelease(LobbyPreviewContext *preview) {
         return;
     }
 
+    // Make the worker abandon whatever it is doing and exit, then wait for it,
+    // so nothing is left touching pendingLevel when it is released.
+    if (preview->workerThread != NULL) {
+        InterlockedExchange(&preview->workerStopRequested, 1);
+        InterlockedExchange(&preview->cancelRequested, 1);
+        SetEvent(preview->workerWakeEvent);
+        WaitForSingleObject(preview->workerThread, INFINITE);
+        CloseHandle(preview->workerThread);
+        preview->workerThread = NULL;
+    }
+    if (preview->workerWakeEvent != NULL) {
+        CloseHandle(preview->workerWakeEvent);
+        preview->workerWakeEvent = NULL;
+    }
+    DeleteCriticalSection(&preview->workerLock);
+
     LevelRelease(&preview->level);
+    LevelRelease(&preview->pendingLevel);
     preview->levelInitialized = false;
+    preview->generating = false;
 }
 
 /**
@@ -223,6 +404,8 @@ void LobbyPreviewReset(LobbyPreviewContext *preview) {
     // Keep base zoom limits intact while clearing transient preview state.
     preview->dirty = true;
     preview->levelInitialized = false;
+    // The previous session's preview is of no use any more, even if it is still being generated.
+    LobbyPreviewCancelBuild(preview);
     LevelRelease(&preview->level);
 }
 
@@ -238,6 +421,31 @@ void LobbyPreviewMarkDirty(LobbyPreviewContext *preview) {
     preview->dirty = true;
 }
 
+/**
+ * Sets the map file previews are laid out from, in place of generating them from the lobby settings.
+ * The map file is opened by the worker thread each time a preview is built, so it must stay where it is.
+ * @param preview Pointer to the LobbyPreviewContext to modify.
+ * @param mapPath Path of the map file, or NULL or an empty string to go back to generating previews.
+ */
+void LobbyPreviewSetMapPath(LobbyPreviewContext *preview, const char *mapPath) {
+    if (preview == NULL) {
+        return;
+    }
+
+    if (mapPath == NULL) {
+        mapPath = "";
+    }
+
+    // Only regenerate when the map actually changes, since this is called on every lobby update.
+    if (strncmp(preview->mapPath, mapPath, sizeof(preview->mapPath)) == 0) {
+        return;
+    }
+
+    strncpy(preview->mapPath, mapPath, sizeof(preview->mapPath) - 1);
+    preview->mapPath[sizeof(preview->mapPath) - 1] = '\0';
+    preview->dirty = true;
+}
+
 /**
  * Updates preview generation and camera edge panning while the preview is open.
  * @param preview Pointer to the LobbyPreviewContext to update.
@@ -288,15 +496,20 @@ bool LobbyPreviewUpdate(LobbyPreviewContext *preview,
     if (preview->dirty || openedNow) {
         if (!settingsValid) {
             // Keep dirty true so we retry when settings become valid again.
+            // Anything still generating was for settings that no longer apply.
+            LobbyPreviewCancelBuild(preview);
             preview->levelInitialized = false;
             preview->dirty = true;
             return true;
         }
 
+        // The old preview stays on screen until the new one is ready.
         preview->dirty = false;
-        if (LobbyPreviewBuildLevel(preview, settings, slotColors, slotColorValid, slotCount)) {
-            LobbyPreviewResetCamera(preview, &viewRect);
-        }
+        LobbyPreviewRequestBuild(preview, settings, slotColors, slotColorValid, slotCount);
+    }
+
+    if (LobbyPreviewCollectBuild(preview)) {
+        LobbyPreviewResetCamera(preview, &viewRect);
     }
 
     if (!preview->levelInitialized) {
@@ -568,10 +781,14 @@ void LobbyPreviewRender(LobbyPreviewContext *preview,
     if (!preview->levelInitialized) {
         float textX = panelRect.x + LOBBY_MENU_PREVIEW_PANEL_PADDING;
         float textY = panelRect.y + LOBBY_MENU_PREVIEW_PANEL_HEADER_HEIGHT + MENU_GENERIC_TEXT_HEIGHT;
-        DrawScreenText(context, "Preview unavailable", textX, textY, MENU_GENERIC_TEXT_HEIGHT, MENU_GENERIC_TEXT_WIDTH, labelColor);
+        DrawScreenText(context, preview->generating ? "Generating preview..." : "Preview unavailable", textX, textY, MENU_GENERIC_TEXT_HEIGHT, MENU_GENERIC_TEXT_WIDTH, labelColor);
         return;
     }
 
+    // Anything batched so far (the panel and its label) belongs to the whole window,
+    // so it has to be drawn before the viewport and scissor box change.
+    RenderBatchFlush();
+
     // Clip rendering to the preview viewport.
     GLint previousViewport[4] = {0, 0, 0, 0};
 
@@ -610,11 +827,18 @@ void LobbyPreviewRender(LobbyPreviewContext *preview,
     glPushMatrix();
     LobbyPreviewApplyCameraTransform(preview);
 
+    // The preview is usually zoomed far out, so planets only need a fraction of their usual detail.
+    RenderSetDetailScale(preview->camera.zoom);
+
     // Draw each planet in the preview level.
     for (size_t i = 0; i < preview->level.planetCount; ++i) {
-        PlanetDraw(&preview->level.planets[i]);
+        PlanetDrawCached(&preview->level.planets[i], preview->level.planetRenderCaches != NULL ? &preview->level.planetRenderCaches[i] : NULL);
     }
 
+    // Submit the batched preview geometry before the preview's matrices and viewport go away.
+    RenderBatchFlush();
+    RenderSetDetailScale(1.0f);
+
     glPopMatrix();
 
     // Restore matrices and viewport state.
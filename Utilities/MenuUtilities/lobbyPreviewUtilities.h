@@ -20,17 +20,51 @@
 #include "Utilities/MenuUtilities/lobbyMenuUtilities.h"
 #include "Utilities/renderUtilities.h"
 #include "Utilities/gameUtilities.h"
+#include "Utilities/mapFileUtilities.h"
 #include "Objects/faction.h"
 #include "Objects/planet.h"
 
+/**
+ * Everything needed to generate a preview level, copied whenever a new preview is asked for
+ * so the worker thread never reads settings the UI thread might be changing.
+ */
+typedef struct LobbyPreviewRequest {
+    LobbyMenuGenerationSettings settings; /* Lobby generation settings to generate with. */
+    float slotColors[LOBBY_MENU_MAX_SLOTS][4]; /* Slot colors for faction previews. */
+    bool slotColorValid[LOBBY_MENU_MAX_SLOTS]; /* Flags indicating which slot colors are valid. */
+    size_t slotCount; /* Number of slots to use for preview coloring. */
+    char mapPath[MAX_PATH]; /* Map file to lay the level out from, or empty to generate it from the settings. */
+} LobbyPreviewRequest;
+
 /**
  * Stores all runtime state needed to render and interact with the lobby preview panel.
  * This keeps the preview implementation shared between client and server.
+ *
+ * Preview levels are generated on a worker thread, so that large settings never freeze the lobby.
+ * The level shown is double buffered: the worker generates into pendingLevel while level stays on screen,
+ * and the two are swapped by the UI thread once the worker is done.
+ * Every request bumps a generation counter, so that a level generated for settings which have
+ * since changed is recognized as stale and dropped, and the worker is told to give up on it early.
  */
 typedef struct LobbyPreviewContext {
-    Level level; /* Generated preview level. */
+    Level level; /* Generated preview level, only ever touched by the UI thread. */
     bool levelInitialized; /* True when the preview level contains valid data. */
     bool dirty; /* True when the preview needs regeneration. */
+    bool generating; /* True from when a preview is requested until it is swapped in. */
+    char mapPath[MAX_PATH]; /* Map file previews are laid out from, or empty to generate them from the settings. */
+
+    Level pendingLevel; /* Back buffer the worker generates into, owned by the worker unless pendingReady. */
+    HANDLE workerThread; /* Thread generating preview levels, or NULL to generate them on the UI thread. */
+    HANDLE workerWakeEvent; /* Signaled whenever there is a new request or the worker should stop. */
+    CRITICAL_SECTION workerLock; /* Guards the request, the generation counters, and the pending flags. */
+    volatile LONG workerStopRequested; /* Set to nonzero to make the worker exit. */
+    volatile LONG cancelRequested; /* Set to nonzero to make the worker give up on the level it is generating. */
+    LobbyPreviewRequest request; /* The most recent request. */
+    LONG requestedGeneration; /* Generation of the most recent request. */
+    LONG startedGeneration; /* Generation of the request the worker most recently started on. */
+    bool pendingReady; /* True when pendingLevel holds a finished level waiting to be swapped in. */
+    bool pendingSucceeded; /* True if generating pendingLevel succeeded. */
+    LONG pendingGeneration; /* Generation of the request pendingLevel was generated for. */
 
     CameraState camera; /* Camera used for navigating the preview panel. */
     float baseMinZoom; /* Original min zoom so fit-to-level can lower bounds safely. */
@@ -45,7 +79,8 @@ typedef struct LobbyPreviewContext {
 } LobbyPreviewContext;
 
 /**
- * Initializes the lobby preview context and its camera constraints.
+ * Initializes the lobby preview context and its camera constraints,
+ * and starts the worker thread which generates preview levels.
  * @param preview Pointer to the LobbyPreviewContext to initialize.
  * @param minZoom Minimum zoom level for the preview camera.
  * @param maxZoom Maximum zoom level for the preview camera.
@@ -53,7 +88,7 @@ typedef struct LobbyPreviewContext {
 void LobbyPreviewInitialize(LobbyPreviewContext *preview, float minZoom, float maxZoom);
 
 /**
- * Releases memory owned by the preview level.
+ * Stops the preview worker thread and releases memory owned by the preview levels.
  * @param preview Pointer to the LobbyPreviewContext to release.
  */
 void LobbyPreviewRelease(LobbyPreviewContext *preview);
@@ -70,8 +105,18 @@ void LobbyPreviewReset(LobbyPreviewContext *preview);
  */
 void LobbyPreviewMarkDirty(LobbyPreviewContext *preview);
 
+/**
+ * Sets the map file previews are laid out from, in place of generating them from the lobby settings.
+ * The map file is opened by the worker thread each time a preview is built, so it must stay where it is.
+ * @param preview Pointer to the LobbyPreviewContext to modify.
+ * @param mapPath Path of the map file, or NULL or an empty string to go back to generating previews.
+ */
+void LobbyPreviewSetMapPath(LobbyPreviewContext *preview, const char *mapPath);
+
 /**
  * Updates preview generation and camera edge panning while the preview is open.
+ * Regenerating the preview only hands the settings to the worker thread;
+ * the new level is swapped in by a later update, once the worker has finished it.
  * @param preview Pointer to the LobbyPreviewContext to update.
  * @param lobbyUI Pointer to the lobby UI state for layout queries.
  * @param settings Pointer to lobby generation settings.
@@ -0,0 +1,275 @@
+/**
+ * Implementation of the bitset utilities.
+ * @file Utilities/bitsetUtilities.c
+ * @author abmize
+ */
+#include "Utilities/bitsetUtilities.h"
+
+/**
+ * Counts the number of set bits in a single word.
+ * @param word The word to count the set bits of.
+ * @return The number of set bits.
+ */
+static size_t BitsetWordPopCount(uint64_t word) {
+#if defined(__GNUC__)
+    // GCC turns this into a single popcnt instruction where the target has one,
+    // and into the same bit trick as below where it does not.
+    return (size_t)__builtin_popcountll(word);
+#else
+    // Count the bits in parallel, two bits at a time, then four, then eight,
+    // and finally add up the eight byte counts with one multiplication.
+    word = word - ((word >> 1) & 0x5555555555555555ull);
+    word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (size_t)((word * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+/**
+ * Finds the index of the lowest set bit in a word.
+ * @param word The word to search, which must not be 0.
+ * @return The index of the lowest set bit, from 0 to 63.
+ */
+static size_t BitsetWordLowestBit(uint64_t word) {
+#if defined(__GNUC__)
+    // A single count-trailing-zeros (or bit-scan-forward) instruction.
+    return (size_t)__builtin_ctzll(word);
+#else
+    size_t index = 0;
+    while ((word & 1ull) == 0ull) {
+        word >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+/**
+ * Computes the mask of the bits in use in the last word of a bitset,
+ * which is every bit if the bit count is a multiple of the word size.
+ * @param bitCount The number of bits in the bitset.
+ * @return The mask of the bits in use in the last word.
+ */
+static uint64_t BitsetLastWordMask(size_t bitCount) {
+    size_t usedBits = bitCount % BITSET_WORD_BITS;
+    if (usedBits == 0) {
+        return ~0ull;
+    }
+    return (1ull << usedBits) - 1ull;
+}
+
+/**
+ * Resizes a bitset to hold the integers 0 to bitCount - 1, and clears it.
+ * A zero-initialized bitset may be passed in, and a bitCount of 0 frees the bitset.
+ * @param bitset The bitset to resize.
+ * @param bitCount The number of integers the bitset must be able to hold.
+ * @return true if the bitset was resized, false if allocation failed, in which case the bitset is left empty.
+ */
+bool BitsetResize(Bitset *bitset, size_t bitCount) {
+    // Basic validation of input pointer.
+    if (bitset == NULL) {
+        return false;
+    }
+
+    size_t wordCount = (bitCount + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS;
+
+    // If the number of words is unchanged, the existing buffer can be reused as is.
+    if (wordCount == bitset->wordCount && bitset->words != NULL) {
+        bitset->bitCount = bitCount;
+        BitsetClearAll(bitset);
+        return true;
+    }
+
+    BitsetFree(bitset);
+    if (wordCount == 0) {
+        return true;
+    }
+
+    bitset->words = (uint64_t *)calloc(wordCount, sizeof(uint64_t));
+    if (bitset->words == NULL) {
+        printf("Failed to allocate bitset of %zu bits.\n", bitCount);
+        return false;
+    }
+
+    bitset->wordCount = wordCount;
+    bitset->bitCount = bitCount;
+    return true;
+}
+
+/**
+ * Frees the memory held by a bitset, leaving it empty.
+ * @param bitset The bitset to free.
+ */
+void BitsetFree(Bitset *bitset) {
+    // Basic validation of input pointer.
+    if (bitset == NULL) {
+        return;
+    }
+
+    free(bitset->words);
+    bitset->words = NULL;
+    bitset->wordCount = 0;
+    bitset->bitCount = 0;
+}
+
+/**
+ * Clears every bit of a bitset.
+ * @param bitset The bitset to clear.
+ */
+void BitsetClearAll(Bitset *bitset) {
+    if (bitset == NULL || bitset->words == NULL) {
+        return;
+    }
+
+    memset(bitset->words, 0, bitset->wordCount * sizeof(uint64_t));
+}
+
+/**
+ * Checks whether the given bit of a bitset is set.
+ * @param bitset The bitset to check.
+ * @param index The index of the bit. Indices past the end of the bitset are never set.
+ * @return true if the bit is set, false otherwise.
+ */
+bool BitsetTest(const Bitset *bitset, size_t index) {
+    if (bitset == NULL || bitset->words == NULL || index >= bitset->bitCount) {
+        return false;
+    }
+
+    return (bitset->words[index / BITSET_WORD_BITS] >> (index % BITSET_WORD_BITS)) & 1ull;
+}
+
+/**
+ * Sets or clears the given bit of a bitset.
+ * @param bitset The bitset to modify.
+ * @param index The index of the bit.
+ * @param value true to set the bit, false to clear it.
+ * @return true if the bit was in range and updated, false otherwise.
+ */
+bool BitsetAssign(Bitset *bitset, size_t index, bool value) {
+    if (bitset == NULL || bitset->words == NULL || index >= bitset->bitCount) {
+        return false;
+    }
+
+    uint64_t bit = 1ull << (index % BITSET_WORD_BITS);
+    if (value) {
+        bitset->words[index / BITSET_WORD_BITS] |= bit;
+    } else {
+        bitset->words[index / BITSET_WORD_BITS] &= ~bit;
+    }
+    return true;
+}
+
+/**
+ * Counts the set bits of a bitset.
+ * @param bitset The bitset to count.
+ * @return The number of set bits.
+ */
+size_t BitsetPopCount(const Bitset *bitset) {
+    if (bitset == NULL || bitset->words == NULL) {
+        return 0;
+    }
+
+    // The unused bits of the last word are always clear, so every word can be counted whole.
+    size_t count = 0;
+    for (size_t i = 0; i < bitset->wordCount; ++i) {
+        count += BitsetWordPopCount(bitset->words[i]);
+    }
+    return count;
+}
+
+/**
+ * Replaces the contents of a bitset with those of another.
+ * Only the bits both bitsets can hold are copied, the rest of the destination is cleared.
+ * @param destination The bitset to copy into.
+ * @param source The bitset to copy from.
+ */
+void BitsetCopy(Bitset *destination, const Bitset *source) {
+    if (destination == NULL || destination->words == NULL) {
+        return;
+    }
+
+    BitsetClearAll(destination);
+    BitsetUnion(destination, source);
+}
+
+/**
+ * Sets every bit of a bitset which is set in another, that is, makes the first the union of both.
+ * Bits past the end of the destination are ignored.
+ * @param destination The bitset to add bits to.
+ * @param source The bitset whose bits are added.
+ */
+void BitsetUnion(Bitset *destination, const Bitset *source) {
+    if (destination == NULL || destination->words == NULL || source == NULL || source->words == NULL) {
+        return;
+    }
+
+    size_t wordCount = destination->wordCount < source->wordCount ? destination->wordCount : source->wordCount;
+    for (size_t i = 0; i < wordCount; ++i) {
+        destination->words[i] |= source->words[i];
+    }
+
+    // A longer source may have set bits past the end of the destination in its last word, which must stay clear.
+    if (wordCount == destination->wordCount) {
+        destination->words[wordCount - 1] &= BitsetLastWordMask(destination->bitCount);
+    }
+}
+
+/**
+ * Clears every bit of a bitset which is not set in another, that is, makes the first the intersection of both.
+ * Bits past the end of the source count as clear.
+ * @param destination The bitset to remove bits from.
+ * @param source The bitset whose bits are kept.
+ */
+void BitsetIntersect(Bitset *destination, const Bitset *source) {
+    if (destination == NULL || destination->words == NULL) {
+        return;
+    }
+
+    // Against an empty source, nothing is kept.
+    if (source == NULL || source->words == NULL) {
+        BitsetClearAll(destination);
+        return;
+    }
+
+    size_t wordCount = destination->wordCount < source->wordCount ? destination->wordCount : source->wordCount;
+    for (size_t i = 0; i < wordCount; ++i) {
+        destination->words[i] &= source->words[i];
+    }
+
+    // Whatever the source does not reach is cleared.
+    for (size_t i = wordCount; i < destination->wordCount; ++i) {
+        destination->words[i] = 0ull;
+    }
+}
+
+/**
+ * Finds the first set bit of a bitset at or after the given index, for iterating over the set bits:
+ * for (size_t i = BitsetNextSet(&set, 0); i < set.bitCount; i = BitsetNextSet(&set, i + 1)) { ... }
+ * @param bitset The bitset to search.
+ * @param start The index to start searching at.
+ * @return The index of the set bit, or bitset->bitCount if there is none.
+ */
+size_t BitsetNextSet(const Bitset *bitset, size_t start) {
+    if (bitset == NULL) {
+        return 0;
+    }
+
+    if (bitset->words == NULL || start >= bitset->bitCount) {
+        return bitset->bitCount;
+    }
+
+    // Look at the word holding the start bit first, ignoring the bits below it.
+    size_t wordIndex = start / BITSET_WORD_BITS;
+    uint64_t word = bitset->words[wordIndex] & (~0ull << (start % BITSET_WORD_BITS));
+
+    // Then skip over whole empty words until one with a set bit turns up.
+    while (word == 0ull) {
+        wordIndex++;
+        if (wordIndex >= bitset->wordCount) {
+            return bitset->bitCount;
+        }
+        word = bitset->words[wordIndex];
+    }
+
+    return wordIndex * BITSET_WORD_BITS + BitsetWordLowestBit(word);
+}
@@ -0,0 +1,114 @@
+/**
+ * Header file for the bitset utilities.
+ * A bitset is a set of small non-negative integers (here, almost always planet indices)
+ * stored as one bit per integer, packed 64 to a word.
+ * Compared to an array of bools, which spends a whole byte on every integer,
+ * this takes an eighth of the memory, and more importantly lets set operations
+ * such as union, intersection and counting work on 64 integers at a time.
+ * Iterating over the integers in a set skips over empty words entirely, and finds each set bit
+ * in a word with a single count-trailing-zeros instruction, so it costs time proportional
+ * to the number of integers in the set rather than to the number that could be.
+ * @file Utilities/bitsetUtilities.h
+ * @author abmize
+ */
+#ifndef _BITSET_UTILITIES_H_
+#define _BITSET_UTILITIES_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Number of bits held by each word of a bitset.
+#define BITSET_WORD_BITS 64u
+
+// A bitset able to hold the integers 0 to bitCount - 1.
+// Bits past bitCount in the last word are always kept clear,
+// so that whole-word operations such as counting never see them.
+typedef struct Bitset {
+    uint64_t *words;
+    size_t wordCount;
+    size_t bitCount;
+} Bitset;
+
+/**
+ * Resizes a bitset to hold the integers 0 to bitCount - 1, and clears it.
+ * A zero-initialized bitset may be passed in, and a bitCount of 0 frees the bitset.
+ * @param bitset The bitset to resize.
+ * @param bitCount The number of integers the bitset must be able to hold.
+ * @return true if the bitset was resized, false if allocation failed, in which case the bitset is left empty.
+ */
+bool BitsetResize(Bitset *bitset, size_t bitCount);
+
+/**
+ * Frees the memory held by a bitset, leaving it empty.
+ * @param bitset The bitset to free.
+ */
+void BitsetFree(Bitset *bitset);
+
+/**
+ * Clears every bit of a bitset.
+ * @param bitset The bitset to clear.
+ */
+void BitsetClearAll(Bitset *bitset);
+
+/**
+ * Checks whether the given bit of a bitset is set.
+ * @param bitset The bitset to check.
+ * @param index The index of the bit. Indices past the end of the bitset are never set.
+ * @return true if the bit is set, false otherwise.
+ */
+bool BitsetTest(const Bitset *bitset, size_t index);
+
+/**
+ * Sets or clears the given bit of a bitset.
+ * @param bitset The bitset to modify.
+ * @param index The index of the bit.
+ * @param value true to set the bit, false to clear it.
+ * @return true if the bit was in range and updated, false otherwise.
+ */
+bool BitsetAssign(Bitset *bitset, size_t index, bool value);
+
+/**
+ * Counts the set bits of a bitset.
+ * @param bitset The bitset to count.
+ * @return The number of set bits.
+ */
+size_t BitsetPopCount(const Bitset *bitset);
+
+/**
+ * Replaces the contents of a bitset with those of another.
+ * Only the bits both bitsets can hold are copied, the rest of the destination is cleared.
+ * @param destination The bitset to copy into.
+ * @param source The bitset to copy from.
+ */
+void BitsetCopy(Bitset *destination, const Bitset *source);
+
+/**
+ * Sets every bit of a bitset which is set in another, that is, makes the first the union of both.
+ * Bits past the end of the destination are ignored.
+ * @param destination The bitset to add bits to.
+ * @param source The bitset whose bits are added.
+ */
+void BitsetUnion(Bitset *destination, const Bitset *source);
+
+/**
+ * Clears every bit of a bitset which is not set in another, that is, makes the first the intersection of both.
+ * Bits past the end of the source count as clear.
+ * @param destination The bitset to remove bits from.
+ * @param source The bitset whose bits are kept.
+ */
+void BitsetIntersect(Bitset *destination, const Bitset *source);
+
+/**
+ * Finds the first set bit of a bitset at or after the given index, for iterating over the set bits:
+ * for (size_t i = BitsetNextSet(&set, 0); i < set.bitCount; i = BitsetNextSet(&set, i + 1)) { ... }
+ * @param bitset The bitset to search.
+ * @param start The index to start searching at.
+ * @return The index of the set bit, or bitset->bitCount if there is none.
+ */
+size_t BitsetNextSet(const Bitset *bitset, size_t start);
+
+#endif // _BITSET_UTILITIES_H_
@@ -0,0 +1,414 @@
+/**
+ * Implementation of the visibility culling utilities.
+ * The renderers ask these functions which planets, starships and trails
+ * overlap the camera's view, and then only draw those.
+ * Planets are looked up through a uniform grid, while starships and trails,
+ * which move every frame, are tested in a single tight pass over their arrays.
+ * @file Utilities/cullingUtilities.c
+ * @author abmize
+ */
+#include "Utilities/cullingUtilities.h"
+
+#include "Objects/level.h"
+
+/**
+ * Helper function to make sure an index list can hold at least the given number of indices.
+ * Grows by doubling, starting from 16.
+ * @param list Pointer to the list to grow.
+ * @param minCapacity The number of indices the list must be able to hold.
+ * @return true if the list is large enough, false on allocation failure.
+ */
+static bool EnsureIndexCapacity(CullingIndexList *list, size_t minCapacity) {
+    if (list->capacity >= minCapacity) {
+        return true;
+    }
+
+    size_t newCapacity = list->capacity == 0 ? 16 : list->capacity;
+    while (newCapacity < minCapacity) {
+        newCapacity *= 2;
+    }
+
+    size_t *resized = (size_t *)realloc(list->indices, newCapacity * sizeof(size_t));
+    if (resized == NULL) {
+        return false;
+    }
+
+    list->indices = resized;
+    list->capacity = newCapacity;
+    return true;
+}
+
+/**
+ * Helper function to clamp a world coordinate to a grid cell index along one axis.
+ * @param value The world coordinate.
+ * @param cellSize The side length of a cell.
+ * @param cellCount The number of cells along the axis.
+ * @return The index of the cell containing the coordinate, clamped to the grid.
+ */
+static size_t CellIndexForCoordinate(float value, float cellSize, size_t cellCount) {
+    if (value <= 0.0f) {
+        return 0;
+    }
+
+    float cell = value / cellSize;
+    if (cell >= (float)cellCount) {
+        return cellCount - 1;
+    }
+
+    return (size_t)cell;
+}
+
+/**
+ * qsort comparison function for size_t values in ascending order.
+ * @param a Pointer to the first value.
+ * @param b Pointer to the second value.
+ * @return Negative, zero or positive as a is less than, equal to or greater than b.
+ */
+static int CompareIndices(const void *a, const void *b) {
+    size_t left = *(const size_t *)a;
+    size_t right = *(const size_t *)b;
+    return (left > right) - (left < right);
+}
+
+/**
+ * Computes the rectangle of the world visible through the camera.
+ * @param camera Pointer to the CameraState describing the view.
+ * @param viewWidth The width of the viewport in pixels.
+ * @param viewHeight The height of the viewport in pixels.
+ * @return The visible rectangle in world coordinates.
+ */
+CullingRect CullingRectFromCamera(const CameraState *camera, float viewWidth, float viewHeight) {
+    CullingRect rect = {0.0f, 0.0f, 0.0f, 0.0f};
+    if (camera == NULL || camera->zoom <= 0.0f) {
+        return rect;
+    }
+
+    // The camera position is the top-left corner of the view,
+    // and the view covers the viewport's size divided by the zoom level.
+    rect.minX = camera->position.x;
+    rect.minY = camera->position.y;
+    rect.maxX = camera->position.x + viewWidth / camera->zoom;
+    rect.maxY = camera->position.y + viewHeight / camera->zoom;
+    return rect;
+}
+
+/**
+ * Checks whether an axis-aligned box overlaps the given rectangle.
+ * @param rect Pointer to the rectangle to test against.
+ * @param min The minimum corner of the box.
+ * @param max The maximum corner of the box.
+ * @return true if they overlap, false otherwise.
+ */
+bool CullingRectOverlapsBox(const CullingRect *rect, Vec2 min, Vec2 max) {
+    if (rect == NULL) {
+        return false;
+    }
+
+    return max.x >= rect->minX && min.x <= rect->maxX
+        && max.y >= rect->minY && min.y <= rect->maxY;
+}
+
+/**
+ * Checks whether a circle overlaps the given rectangle.
+ * @param rect Pointer to the rectangle to test against.
+ * @param center The center of the circle.
+ * @param radius The radius of the circle.
+ * @return true if they overlap, false otherwise.
+ */
+bool CullingRectOverlapsCircle(const CullingRect *rect, Vec2 center, float radius) {
+    if (rect == NULL) {
+        return false;
+    }
+
+    // Find the point of the rectangle closest to the circle's center,
+    // and check whether it lies within the circle.
+    float closestX = fminf(fmaxf(center.x, rect->minX), rect->maxX);
+    float closestY = fminf(fmaxf(center.y, rect->minY), rect->maxY);
+    float dx = center.x - closestX;
+    float dy = center.y - closestY;
+    return dx * dx + dy * dy <= radius * radius;
+}
+
+/**
+ * Builds the planet culling grid from the given planets.
+ * Any previous contents of the grid are released first.
+ * @param grid Pointer to the grid to build.
+ * @param planets The planets to bucket.
+ * @param planetCount The number of planets.
+ * @param levelWidth The width of the level in world units.
+ * @param levelHeight The height of the level in world units.
+ * @return true if the grid was built, false on allocation failure.
+ */
+bool PlanetCullingGridBuild(PlanetCullingGrid *grid, const Planet *planets, size_t planetCount,
+    float levelWidth, float levelHeight) {
+    if (grid == NULL || (planets == NULL && planetCount > 0)) {
+        return false;
+    }
+
+    PlanetCullingGridRelease(grid);
+
+    // Work out how many cells we need to cover the level,
+    // growing the cells instead if there would be too many.
+    float cellSize = CULLING_GRID_CELL_SIZE;
+    float largestSide = fmaxf(levelWidth, levelHeight);
+    if (largestSide / cellSize > (float)CULLING_GRID_MAX_CELLS_PER_AXIS) {
+        cellSize = largestSide / (float)CULLING_GRID_MAX_CELLS_PER_AXIS;
+    }
+
+    size_t columns = (size_t)ceilf(fmaxf(levelWidth, 0.0f) / cellSize);
+    size_t rows = (size_t)ceilf(fmaxf(levelHeight, 0.0f) / cellSize);
+    if (columns == 0) {
+        columns = 1;
+    }
+    if (rows == 0) {
+        rows = 1;
+    }
+
+    size_t cellCount = columns * rows;
+    grid->cellStarts = (size_t *)calloc(cellCount + 1, sizeof(size_t));
+    if (grid->cellStarts == NULL) {
+        return false;
+    }
+
+    if (planetCount > 0) {
+        grid->planetIndices = (size_t *)malloc(planetCount * sizeof(size_t));
+        if (grid->planetIndices == NULL) {
+            PlanetCullingGridRelease(grid);
+            return false;
+        }
+    }
+
+    // We fill the buckets with a counting sort in two passes.
+    // The first pass counts how many planets land in each cell,
+    // which turned into running totals tells us where each cell's bucket starts.
+    float largestRadius = 0.0f;
+    for (size_t i = 0; i < planetCount; ++i) {
+        size_t column = CellIndexForCoordinate(planets[i].position.x, cellSize, columns);
+        size_t row = CellIndexForCoordinate(planets[i].position.y, cellSize, rows);
+        grid->cellStarts[row * columns + column + 1]++;
+        largestRadius = fmaxf(largestRadius, PlanetGetVisualRadius(&planets[i]));
+    }
+
+    for (size_t cell = 0; cell < cellCount; ++cell) {
+        grid->cellStarts[cell + 1] += grid->cellStarts[cell];
+    }
+
+    // The second pass drops each planet into the next free slot of its cell's bucket.
+    // Walking the planets in order keeps each bucket sorted by index.
+    size_t *nextSlot = (size_t *)malloc(cellCount * sizeof(size_t));
+    if (nextSlot == NULL) {
+        PlanetCullingGridRelease(grid);
+        return false;
+    }
+    memcpy(nextSlot, grid->cellStarts, cellCount * sizeof(size_t));
+
+    for (size_t i = 0; i < planetCount; ++i) {
+        size_t column = CellIndexForCoordinate(planets[i].position.x, cellSize, columns);
+        size_t row = CellIndexForCoordinate(planets[i].position.y, cellSize, rows);
+        grid->planetIndices[nextSlot[row * columns + column]++] = i;
+    }
+
+    free(nextSlot);
+
+    grid->cellSize = cellSize;
+    grid->columns = columns;
+    grid->rows = rows;
+    grid->planetCount = planetCount;
+    grid->queryMargin = largestRadius * CULLING_GRID_RADIUS_SLACK;
+    grid->built = true;
+    return true;
+}
+
+/**
+ * Releases the memory held by a planet culling grid and marks it as unbuilt.
+ * @param grid Pointer to the grid to release.
+ */
+void PlanetCullingGridRelease(PlanetCullingGrid *grid) {
+    if (grid == NULL) {
+        return;
+    }
+
+    free(grid->cellStarts);
+    free(grid->planetIndices);
+    grid->cellStarts = NULL;
+    grid->planetIndices = NULL;
+    grid->columns = 0;
+    grid->rows = 0;
+    grid->planetCount = 0;
+    grid->queryMargin = 0.0f;
+    grid->built = false;
+}
+
+/**
+ * Collects the indices of all planets visible within the given rectangle.
+ * Indices are written in ascending order so planets keep their usual draw order.
+ * @param grid Pointer to a built planet culling grid.
+ * @param planets The planets the grid was built from.
+ * @param rect Pointer to the visible rectangle.
+ * @param outList Pointer to the index list to fill.
+ * @return true on success, false if the grid is not built or allocation failed.
+ */
+bool PlanetCullingGridQuery(const PlanetCullingGrid *grid, const Planet *planets,
+    const CullingRect *rect, CullingIndexList *outList) {
+    if (grid == NULL || !grid->built || rect == NULL || outList == NULL) {
+        return false;
+    }
+
+    outList->count = 0;
+    if (grid->planetCount == 0 || planets == NULL) {
+        return true;
+    }
+
+    // Every visible planet fits in the list, so grow it once up front.
+    if (!EnsureIndexCapacity(outList, grid->planetCount)) {
+        return false;
+    }
+
+    // Only cells whose planets could reach into the view need to be visited.
+    size_t minColumn = CellIndexForCoordinate(rect->minX - grid->queryMargin, grid->cellSize, grid->columns);
+    size_t maxColumn = CellIndexForCoordinate(rect->maxX + grid->queryMargin, grid->cellSize, grid->columns);
+    size_t minRow = CellIndexForCoordinate(rect->minY - grid->queryMargin, grid->cellSize, grid->rows);
+    size_t maxRow = CellIndexForCoordinate(rect->maxY + grid->queryMargin, grid->cellSize, grid->rows);
+
+    for (size_t row = minRow; row <= maxRow; ++row) {
+        for (size_t column = minColumn; column <= maxColumn; ++column) {
+            size_t cell = row * grid->columns + column;
+            for (size_t slot = grid->cellStarts[cell]; slot < grid->cellStarts[cell + 1]; ++slot) {
+                // The cell being close enough only means the planet might be visible,
+                // so we check its actual current size too.
+                size_t index = grid->planetIndices[slot];
+                const Planet *planet = &planets[index];
+                if (CullingRectOverlapsCircle(rect, planet->position, PlanetGetVisualRadius(planet))) {
+                    outList->indices[outList->count++] = index;
+                }
+            }
+        }
+    }
+
+    // Cells are visited in grid order rather than planet order,
+    // so we sort to keep overlapping planets layered the way they always were.
+    qsort(outList->indices, outList->count, sizeof(size_t), CompareIndices);
+    return true;
+}
+
+/**
+ * Collects the indices of all starships visible within the given rectangle.
+ * @param starships The starships to test.
+ * @param starshipCount The number of starships.
+ * @param rect Pointer to the visible rectangle.
+ * @param outList Pointer to the index list to fill.
+ * @return true on success, false if allocation failed.
+ */
+bool CullStarships(const Starship *starships, size_t starshipCount,
+    const CullingRect *rect, CullingIndexList *outList) {
+    if (rect == NULL || outList == NULL || (starships == NULL && starshipCount > 0)) {
+        return false;
+    }
+
+    outList->count = 0;
+    if (!EnsureIndexCapacity(outList, starshipCount)) {
+        return false;
+    }
+
+    // One pass over the whole array, writing out the survivors,
+    // so the draw loop afterwards only touches ships that are on screen.
+    for (size_t i = 0; i < starshipCount; ++i) {
+        Vec2 min;
+        Vec2 max;
+        if (StarshipComputeBounds(&starships[i], &min, &max) && CullingRectOverlapsBox(rect, min, max)) {
+            outList->indices[outList->count++] = i;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Collects the indices of all trail effects visible within the given rectangle.
+ * @param effects The trail effects to test.
+ * @param effectCount The number of trail effects.
+ * @param rect Pointer to the visible rectangle.
+ * @param outList Pointer to the index list to fill.
+ * @return true on success, false if allocation failed.
+ */
+bool CullTrailEffects(const StarshipTrailEffect *effects, size_t effectCount,
+    const CullingRect *rect, CullingIndexList *outList) {
+    if (rect == NULL || outList == NULL || (effects == NULL && effectCount > 0)) {
+        return false;
+    }
+
+    outList->count = 0;
+    if (!EnsureIndexCapacity(outList, effectCount)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < effectCount; ++i) {
+        Vec2 min;
+        Vec2 max;
+        if (StarshipTrailEffectComputeBounds(&effects[i], &min, &max) && CullingRectOverlapsBox(rect, min, max)) {
+            outList->indices[outList->count++] = i;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Culls the whole level against the given rectangle in one go.
+ * Builds the level's planet culling grid first if it has not been built yet,
+ * then fills in the visible planets, trail effects and starships.
+ * @param level Pointer to the level to cull.
+ * @param rect Pointer to the visible rectangle.
+ * @param outPlanets Pointer to the index list receiving visible planets.
+ * @param outTrails Pointer to the index list receiving visible trail effects.
+ * @param outStarships Pointer to the index list receiving visible starships.
+ * @param outStats Pointer to the stats to fill in, or NULL if not needed.
+ * @return true on success, false on failure, in which case everything should be drawn.
+ */
+bool CullLevel(struct Level *level, const CullingRect *rect, CullingIndexList *outPlanets,
+    CullingIndexList *outTrails, CullingIndexList *outStarships, CullingStats *outStats) {
+    if (level == NULL || rect == NULL || outPlanets == NULL || outTrails == NULL || outStarships == NULL) {
+        return false;
+    }
+
+    // The grid is thrown away whenever the level is released or reconfigured,
+    // and planets are placed after configuration, so the first cull builds it.
+    if (!level->planetCullingGrid.built) {
+        if (!PlanetCullingGridBuild(&level->planetCullingGrid, level->planets, level->planetCount,
+            level->width, level->height)) {
+            return false;
+        }
+    }
+
+    if (!PlanetCullingGridQuery(&level->planetCullingGrid, level->planets, rect, outPlanets)
+        || !CullTrailEffects(level->trailEffects, level->trailEffectCount, rect, outTrails)
+        || !CullStarships(level->starships, level->starshipCount, rect, outStarships)) {
+        return false;
+    }
+
+    if (outStats != NULL) {
+        outStats->visiblePlanets = outPlanets->count;
+        outStats->totalPlanets = level->planetCount;
+        outStats->visibleTrails = outTrails->count;
+        outStats->totalTrails = level->trailEffectCount;
+        outStats->visibleStarships = outStarships->count;
+        outStats->totalStarships = level->starshipCount;
+    }
+
+    return true;
+}
+
+/**
+ * Releases the memory held by a culling index list.
+ * @param list Pointer to the list to release.
+ */
+void CullingIndexListRelease(CullingIndexList *list) {
+    if (list == NULL) {
+        return;
+    }
+
+    free(list->indices);
+    list->indices = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * Header file for the visibility culling utilities.
+ * Culling means skipping anything that cannot possibly end up on screen
+ * before we spend any time tessellating or submitting it.
+ * @file Utilities/cullingUtilities.h
+ * @author abmize
+ */
+#ifndef _CULLING_UTILITIES_H_
+#define _CULLING_UTILITIES_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Objects/vec2.h"
+#include "Objects/planet.h"
+#include "Objects/starship.h"
+#include "Utilities/cameraUtilities.h"
+
+// Forward declaration in order to avoid circular dependency.
+struct Level;
+
+// Side length of a single planet culling grid cell in world units.
+// Roughly the width of a zoomed-in view, so a query touches only a handful of cells.
+#define CULLING_GRID_CELL_SIZE 256.0f
+
+// Upper bound on the number of cells along either axis of the planet culling grid,
+// so enormous levels do not end up with enormous grids.
+#define CULLING_GRID_MAX_CELLS_PER_AXIS 64
+
+// Planets are stored in the grid by their center only, so a query has to look
+// a little past the edges of the view to catch planets whose glow reaches in.
+// The margin is the largest visual radius seen when the grid was built
+// multiplied by this slack, which leaves room for planets growing over capacity.
+#define CULLING_GRID_RADIUS_SLACK 2.0f
+
+// An axis-aligned rectangle in world coordinates.
+typedef struct CullingRect {
+    float minX;
+    float minY;
+    float maxX;
+    float maxY;
+} CullingRect;
+
+// A uniform grid over the level, bucketing planets by the cell containing their center.
+// Planets never move, so the grid is built once per level and only queried afterwards.
+// The buckets are stored back to back in planetIndices, with the planets in cell c
+// found at planetIndices[cellStarts[c]] up to (but not including) planetIndices[cellStarts[c + 1]].
+typedef struct PlanetCullingGrid {
+    bool built;
+    float cellSize;
+    size_t columns;
+    size_t rows;
+    size_t *cellStarts;
+    size_t *planetIndices;
+    size_t planetCount;
+    float queryMargin;
+} PlanetCullingGrid;
+
+// A growable list of indices into one of the level's arrays,
+// filled in by the culling functions with whatever is visible.
+typedef struct CullingIndexList {
+    size_t *indices;
+    size_t count;
+    size_t capacity;
+} CullingIndexList;
+
+// Counts of how many objects were visible out of how many exist,
+// shown in the debug overlay.
+typedef struct CullingStats {
+    size_t visiblePlanets;
+    size_t totalPlanets;
+    size_t visibleStarships;
+    size_t totalStarships;
+    size_t visibleTrails;
+    size_t totalTrails;
+} CullingStats;
+
+/**
+ * Computes the rectangle of the world visible through the camera.
+ * @param camera Pointer to the CameraState describing the view.
+ * @param viewWidth The width of the viewport in pixels.
+ * @param viewHeight The height of the viewport in pixels.
+ * @return The visible rectangle in world coordinates.
+ */
+CullingRect CullingRectFromCamera(const CameraState *camera, float viewWidth, float viewHeight);
+
+/**
+ * Checks whether an axis-aligned box overlaps the given rectangle.
+ * @param rect Pointer to the rectangle to test against.
+ * @param min The minimum corner of the box.
+ * @param max The maximum corner of the box.
+ * @return true if they overlap, false otherwise.
+ */
+bool CullingRectOverlapsBox(const CullingRect *rect, Vec2 min, Vec2 max);
+
+/**
+ * Checks whether a circle overlaps the given rectangle.
+ * @param rect Pointer to the rectangle to test against.
+ * @param center The center of the circle.
+ * @param radius The radius of the circle.
+ * @return true if they overlap, false otherwise.
+ */
+bool CullingRectOverlapsCircle(const CullingRect *rect, Vec2 center, float radius);
+
+/**
+ * Builds the planet culling grid from the given planets.
+ * Any previous contents of the grid are released first.
+ * @param grid Pointer to the grid to build.
+ * @param planets The planets to bucket.
+ * @param planetCount The number of planets.
+ * @param levelWidth The width of the level in world units.
+ * @param levelHeight The height of the level in world units.
+ * @return true if the grid was built, false on allocation failure.
+ */
+bool PlanetCullingGridBuild(PlanetCullingGrid *grid, const Planet *planets, size_t planetCount,
+    float levelWidth, float levelHeight);
+
+/**
+ * Releases the memory held by a planet culling grid and marks it as unbuilt.
+ * @param grid Pointer to the grid to release.
+ */
+void PlanetCullingGridRelease(PlanetCullingGrid *grid);
+
+/**
+ * Collects the indices of all planets visible within the given rectangle.
+ * Indices are written in ascending order so planets keep their usual draw order.
+ * @param grid Pointer to a built planet culling grid.
+ * @param planets The planets the grid was built from.
+ * @param rect Pointer to the visible rectangle.
+ * @param outList Pointer to the index list to fill.
+ * @return true on success, false if the grid is not built or allocation failed.
+ */
+bool PlanetCullingGridQuery(const PlanetCullingGrid *grid, const Planet *planets,
+    const CullingRect *rect, CullingIndexList *outList);
+
+/**
+ * Collects the indices of all starships visible within the given rectangle.
+ * @param starships The starships to test.
+ * @param starshipCount The number of starships.
+ * @param rect Pointer to the visible rectangle.
+ * @param outList Pointer to the index list to fill.
+ * @return true on success, false if allocation failed.
+ */
+bool CullStarships(const Starship *starships, size_t starshipCount,
+    const CullingRect *rect, CullingIndexList *outList);
+
+/**
+ * Collects the indices of all trail effects visible within the given rectangle.
+ * @param effects The trail effects to test.
+ * @param effectCount The number of trail effects.
+ * @param rect Pointer to the visible rectangle.
+ * @param outList Pointer to the index list to fill.
+ * @return true on success, false if allocation failed.
+ */
+bool CullTrailEffects(const StarshipTrailEffect *effects, size_t effectCount,
+    const CullingRect *rect, CullingIndexList *outList);
+
+/**
+ * Culls the whole level against the given rectangle in one go.
+ * Builds the level's planet culling grid first if it has not been built yet,
+ * then fills in the visible planets, trail effects and starships.
+ * @param level Pointer to the level to cull.
+ * @param rect Pointer to the visible rectangle.
+ * @param outPlanets Pointer to the index list receiving visible planets.
+ * @param outTrails Pointer to the index list receiving visible trail effects.
+ * @param outStarships Pointer to the index list receiving visible starships.
+ * @param outStats Pointer to the stats to fill in, or NULL if not needed.
+ * @return true on success, false on failure, in which case everything should be drawn.
+ */
+bool CullLevel(struct Level *level, const CullingRect *rect, CullingIndexList *outPlanets,
+    CullingIndexList *outTrails, CullingIndexList *outStarships, CullingStats *outStats);
+
+/**
+ * Releases the memory held by a culling index list.
+ * @param list Pointer to the list to release.
+ */
+void CullingIndexListRelease(CullingIndexList *list);
+
+#endif // _CULLING_UTILITIES_H_
@@ -5,10 +5,77 @@
  */
 
 #include "Utilities/gameUtilities.h"
+#include "Utilities/simMathUtilities.h"
 
 // Included here to avoid circular dependency issues.
 #include "Objects/planet.h"
 
+// How far planets are kept from the edges of the level, on top of their own radius.
+#define PLANET_EDGE_MARGIN 20.0f
+
+// How many random positions anywhere on the level a planet tries before the level counts as crowded.
+#define PLANET_PLACEMENT_RANDOM_ATTEMPTS 64
+
+// How many positions around an already placed planet are tried before it counts as boxed in.
+// 30 is the usual choice for Bridson's algorithm.
+#define PLANET_PLACEMENT_RING_ATTEMPTS 30
+
+// The most grid cells the planet placement grid may have per planet, see PlanetPlacementGridInit.
+#define PLANET_PLACEMENT_MAX_CELLS_PER_PLANET 4.0
+
+// Marks the end of a planet placement grid cell's list.
+#define PLANET_PLACEMENT_GRID_EMPTY SIZE_MAX
+
+// Settings for the determinism replay, see RunDeterminismReplay.
+// The replay generates a level from a fixed seed, then steps it with a fixed time step,
+// sending a fleet from a randomly chosen owned planet every DETERMINISM_REPLAY_LAUNCH_INTERVAL ticks,
+// and checks LevelComputeStateHash every DETERMINISM_REPLAY_HASH_INTERVAL ticks.
+// The level matches the lobby's default settings.
+// Changing any of these changes every hash the replay produces, so the expected hashes below must be recorded again.
+#define DETERMINISM_REPLAY_SEED 0x4C595753u
+#define DETERMINISM_REPLAY_PLANET_COUNT 48
+#define DETERMINISM_REPLAY_FACTION_COUNT 4
+#define DETERMINISM_REPLAY_MIN_FLEET_CAPACITY 20.0f
+#define DETERMINISM_REPLAY_MAX_FLEET_CAPACITY 70.0f
+#define DETERMINISM_REPLAY_WIDTH 4800.0f
+#define DETERMINISM_REPLAY_HEIGHT 4800.0f
+#define DETERMINISM_REPLAY_TIME_STEP (1.0f / 60.0f)
+#define DETERMINISM_REPLAY_TICKS 7200u
+#define DETERMINISM_REPLAY_LAUNCH_INTERVAL 20u
+#define DETERMINISM_REPLAY_HASH_INTERVAL 600u
+
+// The hashes every build must produce with the settings above: the layout hash of the generated level,
+// the state hash after every DETERMINISM_REPLAY_HASH_INTERVAL ticks, and the state hash once the replay ends.
+// Any change to the simulation which moves a single bit changes them. When that is intended,
+// run the server or client with --determinism-record, and paste what it prints over these.
+#define DETERMINISM_REPLAY_EXPECTED_LAYOUT_HASH 0x0D062938AFA67E86ull
+#define DETERMINISM_REPLAY_EXPECTED_FINAL_HASH 0xEA909E198AA18E3Eull
+static const uint64_t DETERMINISM_REPLAY_EXPECTED_HASHES[DETERMINISM_REPLAY_TICKS / DETERMINISM_REPLAY_HASH_INTERVAL] = {
+    0xDAEA86C6426B94A8ull,
+    0xE12320D35F85077Full,
+    0x4785195B5558A51Bull,
+    0xED7E070B45D47D22ull,
+    0x2C1AA1937F39AC9Eull,
+    0xFBAAAA81BFCAF266ull,
+    0xF8EA2E2C28D25874ull,
+    0x4EC62D22639A2FA2ull,
+    0xE970A02DDA4C234Full,
+    0x5D8988C458B14048ull,
+    0x7BCD29D29772039Cull,
+    0xEA909E198AA18E3Eull
+};
+
+// A uniform grid over the level used while placing planets, so that checking whether a position is clear
+// only needs to look at the planets near it. Each cell holds a linked list of the planets whose centers fall in it:
+// cellHeads holds the first planet in each cell, and nextInCell the planet after each planet in its cell.
+typedef struct PlanetPlacementGrid {
+    float cellSize;
+    size_t columns;
+    size_t rows;
+    size_t *cellHeads;
+    size_t *nextInCell;
+} PlanetPlacementGrid;
+
 /**
  * Gets the current tick count using QueryPerformanceCounter.
  * @return The current tick count.
@@ -142,7 +209,7 @@ static float Distance(Vec2 a, Vec2 b) {
  * @return A Vec2 representing the random position.
  */
 static Vec2 RandomPlanetPosition(unsigned int *state, float width, float height, float radius) {
-    float margin = radius + 20.0f;
+    float margin = radius + PLANET_EDGE_MARGIN;
     float x = RandomRange(state, margin, fmaxf(width - margin, margin));
     float y = RandomRange(state, margin, fmaxf(height - margin, margin));
     Vec2 position = {x, y};
@@ -150,9 +217,177 @@ static Vec2 RandomPlanetPosition(unsigned int *state, float width, float height,
 }
 
 /**
- * Generates a random level with the specified parameters.
+ * Helper function to check whether a planet at the given position would stay
+ * within the level boundaries, by the same margin RandomPlanetPosition keeps.
+ * @param position The position of the planet.
+ * @param width The width of the level.
+ * @param height The height of the level.
+ * @param radius The radius of the planet.
+ * @return true if the position is within the boundaries, false otherwise.
+ */
+static bool PlanetPositionInBounds(Vec2 position, float width, float height, float radius) {
+    float margin = radius + PLANET_EDGE_MARGIN;
+    return position.x >= margin && position.x <= fmaxf(width - margin, margin)
+        && position.y >= margin && position.y <= fmaxf(height - margin, margin);
+}
+
+/**
+ * Sets up an empty planet placement grid covering a level.
+ * Each cell is at least as wide as the furthest apart two planets can be while still being too close,
+ * so that any planet too close to a position is always in the position's cell or one of its eight neighbors.
+ * On a level that is huge compared to its planet count, the cells are made larger still,
+ * so the grid never has more than a few cells per planet, but never smaller.
+ * @param grid The grid to set up.
+ * @param width The width of the level.
+ * @param height The height of the level.
+ * @param reach The furthest apart two planets can be while still being too close.
+ * @param planetCount The number of planets that will be placed.
+ * @return true if the grid was set up, false if allocation failed or no cell size would do.
+ */
+static bool PlanetPlacementGridInit(PlanetPlacementGrid *grid, float width, float height, float reach, size_t planetCount) {
+    float cellSize = fmaxf(reach, 1.0f);
+    double maxCells = (double)planetCount * PLANET_PLACEMENT_MAX_CELLS_PER_PLANET;
+    if (ceil(width / cellSize) * ceil(height / cellSize) > maxCells) {
+        // Spread the level over about maxCells cells, though never with cells smaller than reach,
+        // which the level's area alone does not promise once its edges round up to whole cells.
+        cellSize = fmaxf(cellSize, (float)sqrt(((double)width * (double)height) / maxCells));
+
+        // Those partial cells at the edges can also leave a few cells too many, so grow until they fit.
+        while (ceil(width / cellSize) * ceil(height / cellSize) > maxCells) {
+            cellSize *= 1.0625f;
+        }
+    }
+
+    // Checking only a cell and its eight neighbors misses planets that are too close
+    // as soon as the cells are narrower than reach, so that must never happen.
+    if (!(cellSize >= reach)) {
+        printf("Planet placement grid cells of %.1f are narrower than the %.1f planets must keep apart.\n", cellSize, reach);
+        return false;
+    }
+
+    grid->cellSize = cellSize;
+    grid->columns = (size_t)ceilf(width / cellSize);
+    grid->rows = (size_t)ceilf(height / cellSize);
+    if (grid->columns == 0) {
+        grid->columns = 1;
+    }
+    if (grid->rows == 0) {
+        grid->rows = 1;
+    }
+
+    size_t cellCount = grid->columns * grid->rows;
+    grid->cellHeads = (size_t *)malloc(cellCount * sizeof(size_t));
+    grid->nextInCell = (size_t *)malloc(planetCount * sizeof(size_t));
+    if (grid->cellHeads == NULL || grid->nextInCell == NULL) {
+        free(grid->cellHeads);
+        free(grid->nextInCell);
+        grid->cellHeads = NULL;
+        grid->nextInCell = NULL;
+        return false;
+    }
+
+    for (size_t i = 0; i < cellCount; ++i) {
+        grid->cellHeads[i] = PLANET_PLACEMENT_GRID_EMPTY;
+    }
+    return true;
+}
+
+/**
+ * Releases the memory held by a planet placement grid.
+ * @param grid The grid to release.
+ */
+static void PlanetPlacementGridRelease(PlanetPlacementGrid *grid) {
+    free(grid->cellHeads);
+    free(grid->nextInCell);
+    grid->cellHeads = NULL;
+    grid->nextInCell = NULL;
+}
+
+/**
+ * Helper function to find the column and row of the grid cell containing a position.
+ * Positions outside the grid are treated as being in the nearest cell on its edge.
+ * @param grid The grid.
+ * @param position The position.
+ * @param outColumn Receives the column of the cell.
+ * @param outRow Receives the row of the cell.
+ */
+static void PlanetPlacementGridLocate(const PlanetPlacementGrid *grid, Vec2 position, size_t *outColumn, size_t *outRow) {
+    float column = floorf(position.x / grid->cellSize);
+    float row = floorf(position.y / grid->cellSize);
+    *outColumn = column <= 0.0f ? 0 : ((size_t)column >= grid->columns ? grid->columns - 1 : (size_t)column);
+    *outRow = row <= 0.0f ? 0 : ((size_t)row >= grid->rows ? grid->rows - 1 : (size_t)row);
+}
+
+/**
+ * Adds a placed planet to the grid.
+ * @param grid The grid.
+ * @param planetIndex The index of the planet in the level.
+ * @param position The position of the planet.
+ */
+static void PlanetPlacementGridInsert(PlanetPlacementGrid *grid, size_t planetIndex, Vec2 position) {
+    size_t column;
+    size_t row;
+    PlanetPlacementGridLocate(grid, position, &column, &row);
+
+    // Each cell is a linked list of planet indices, with the newest planet at the front.
+    size_t cell = row * grid->columns + column;
+    grid->nextInCell[planetIndex] = grid->cellHeads[cell];
+    grid->cellHeads[cell] = planetIndex;
+}
+
+/**
+ * Checks whether a planet of the given radius could be placed at a position
+ * without coming too close to any planet already in the grid.
+ * @param grid The grid.
+ * @param planets The level's planets, which the grid's indices refer to.
+ * @param position The position to check.
+ * @param radius The outer radius of the planet being placed.
+ * @param separationPadding The minimum gap to leave between any two planets.
+ * @return true if the position is clear, false otherwise.
+ */
+static bool PlanetPlacementGridIsClear(const PlanetPlacementGrid *grid, const Planet *planets,
+    Vec2 position, float radius, float separationPadding) {
+    size_t column;
+    size_t row;
+    PlanetPlacementGridLocate(grid, position, &column, &row);
+
+    // Only the cell the position falls in and the eight around it can hold a planet close enough to matter.
+    size_t firstColumn = column > 0 ? column - 1 : 0;
+    size_t lastColumn = column + 1 < grid->columns ? column + 1 : column;
+    size_t firstRow = row > 0 ? row - 1 : 0;
+    size_t lastRow = row + 1 < grid->rows ? row + 1 : row;
+    for (size_t y = firstRow; y <= lastRow; ++y) {
+        for (size_t x = firstColumn; x <= lastColumn; ++x) {
+            size_t index = grid->cellHeads[y * grid->columns + x];
+            while (index != PLANET_PLACEMENT_GRID_EMPTY) {
+                float minDistance = radius + PlanetGetOuterRadius(&planets[index]) + separationPadding;
+                if (Distance(position, planets[index].position) < minDistance) {
+                    return false;
+                }
+                index = grid->nextInCell[index];
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Generates a random level with the specified parameters,
+ * giving up part way through should another thread ask it to.
  * Assumes that the level pointed to by 'level' has already been configured,
  * and the factions in the level have already been created.
+ *
+ * Planets are placed in two phases. At first, each planet simply tries random positions
+ * across the whole level until one is clear, which spreads planets evenly over the map.
+ * Once the level gets crowded enough that this starts failing, the remaining planets are
+ * instead grown outward from the planets already placed, as in Bridson's Poisson-disk sampling:
+ * a placed planet is picked at random, and positions just beyond its reach are tried around it,
+ * until either one is clear or the planet is found to be boxed in, at which point it is never picked again.
+ * This packs the gaps left between planets far better than random positions ever could.
+ * Either way, nearby planets are found through a grid rather than by checking every planet placed so far,
+ * so even levels with a hundred thousand planets generate almost instantly.
+ * Only once there is truly no room left is a planet allowed to overlap others.
  * @param level A pointer to the Level object to populate.
  * @param planetCount The number of planets to generate.
  * @param factionCount The number of factions to use for generation.
@@ -164,16 +399,18 @@ static Vec2 RandomPlanetPosition(unsigned int *state, float width, float height,
  * @param width The width of the level.
  * @param height The height of the level.
  * @param seed The seed for the random number generator.
- * @return true if the level was generated successfully, false otherwise.
+ * @param cancelRequested Checked as each planet is placed; generation stops once it becomes nonzero. May be NULL.
+ * @return true if the level was generated successfully, false if it failed or was cancelled.
  */
-bool GenerateRandomLevel(Level *level,
+bool GenerateRandomLevelCancellable(Level *level,
     size_t planetCount,
     size_t factionCount,
     float minFleetCapacity,
     float maxFleetCapacity,
     float width,
     float height,
-    unsigned int seed) {
+    unsigned int seed,
+    volatile LONG *cancelRequested) {
 
     // Basic validation of parameters.
     if (level == NULL) {
@@ -196,10 +433,11 @@ bool GenerateRandomLevel(Level *level,
         return false;
     }
 
-    // Now we can fill in the level dimensions and reset starship count.
+    // Now we can fill in the level dimensions and reset starship and fleet counts.
     level->width = width;
     level->height = height;
     level->starshipCount = 0;
+    level->fleetCount = 0;
     
     // Used for random number generation.
     // If seed is zero, we use a default seed for reproducibility.
@@ -210,7 +448,37 @@ bool GenerateRandomLevel(Level *level,
 
     // Minimum separation padding between planets.
     const float separationPadding = 25.0f;
+
+    // No planet can be larger than one at the maximum fleet capacity,
+    // so no two planets can be too close while further apart than twice its radius plus the padding.
+    Planet largestPlanet = CreatePlanet(Vec2Zero(), maxFleetCapacity, NULL);
+    float reach = 2.0f * PlanetGetOuterRadius(&largestPlanet) + separationPadding;
+
+    PlanetPlacementGrid grid;
+    if (!PlanetPlacementGridInit(&grid, width, height, reach, planetCount)) {
+        printf("Failed to set up the planet placement grid.\n");
+        return false;
+    }
+
+    // The planets still worth growing new planets out from, once the level gets crowded.
+    size_t *activePlanets = (size_t *)malloc(planetCount * sizeof(size_t));
+    if (activePlanets == NULL) {
+        printf("Failed to allocate the planet placement list.\n");
+        PlanetPlacementGridRelease(&grid);
+        return false;
+    }
+    size_t activeCount = 0;
+    bool crowded = false;
+    size_t overlappingCount = 0;
+
+    bool cancelled = false;
     for (size_t i = 0; i < planetCount; ++i) {
+        // Stop as soon as whoever asked for this level no longer wants it.
+        if (cancelRequested != NULL && *cancelRequested != 0) {
+            cancelled = true;
+            break;
+        }
+
         // Create a planet with random fleet capacity within the range [minFleetCapacity, maxFleetCapacity].
         float capacity = RandomRange(&state, minFleetCapacity, maxFleetCapacity);
         Planet planet = CreatePlanet(Vec2Zero(), capacity, NULL);
@@ -222,30 +490,69 @@ bool GenerateRandomLevel(Level *level,
         if (i < factionCount) {
             planet.maxFleetCapacity = (minFleetCapacity + maxFleetCapacity) / 2.0f;
         }
+        float radius = PlanetGetOuterRadius(&planet);
 
         // Attempt to place the planet without overlapping existing planets.
         bool placed = false;
 
-        // We try up to 64 times to find a non-overlapping position.
-        for (int attempts = 0; attempts < 64 && !placed; ++attempts) {
-            Vec2 candidate = RandomPlanetPosition(&state, width, height, PlanetGetOuterRadius(&planet));
-            placed = true;
-            for (size_t j = 0; j < i; ++j) {
-                float minDistance = PlanetGetOuterRadius(&planet) + PlanetGetOuterRadius(&level->planets[j]) + separationPadding;
-                if (Distance(candidate, level->planets[j].position) < minDistance) {
-                    placed = false;
-                    break;
+        // While the level has room to spare, we try up to 64 random positions anywhere on it.
+        if (!crowded) {
+            for (int attempts = 0; attempts < PLANET_PLACEMENT_RANDOM_ATTEMPTS && !placed; ++attempts) {
+                Vec2 candidate = RandomPlanetPosition(&state, width, height, radius);
+                if (PlanetPlacementGridIsClear(&grid, level->planets, candidate, radius, separationPadding)) {
+                    planet.position = candidate;
+                    placed = true;
                 }
             }
-            if (placed) {
-                planet.position = candidate;
+
+            // If even that fails, free space has become scarce, so from now on
+            // we grow planets out from every planet placed so far instead.
+            if (!placed) {
+                crowded = true;
+                for (size_t j = 0; j < i; ++j) {
+                    activePlanets[j] = j;
+                }
+                activeCount = i;
+            }
+        }
+
+        while (!placed && activeCount > 0) {
+            size_t activeSlot = NextRandom(&state) % activeCount;
+            const Planet *origin = &level->planets[activePlanets[activeSlot]];
+
+            // Try positions in a ring around the origin planet, from just far enough away to
+            // twice that, so that a clear position is as snug against the origin as it can be.
+            float minDistance = PlanetGetOuterRadius(origin) + radius + separationPadding;
+            for (int attempts = 0; attempts < PLANET_PLACEMENT_RING_ATTEMPTS && !placed; ++attempts) {
+                float angle = RandomRange(&state, 0.0f, 2.0f * (float)M_PI);
+                float distance = RandomRange(&state, minDistance, 2.0f * minDistance);
+
+                // Clients lay the level out from the same seed and must land every planet on exactly
+                // the same bits as the server did, so the offset is found with SimSinCos rather than cosf and sinf.
+                float sine;
+                float cosine;
+                SimSinCos(angle, &sine, &cosine);
+                Vec2 offset = {cosine * distance, sine * distance};
+                Vec2 candidate = Vec2Add(origin->position, offset);
+                if (PlanetPositionInBounds(candidate, width, height, radius)
+                    && PlanetPlacementGridIsClear(&grid, level->planets, candidate, radius, separationPadding)) {
+                    planet.position = candidate;
+                    placed = true;
+                }
+            }
+
+            // The origin planet is boxed in, so there is no point trying around it again.
+            if (!placed) {
+                activePlanets[activeSlot] = activePlanets[activeCount - 1];
+                activeCount--;
             }
         }
 
         if (!placed) {
-            // If we failed to place the planet after many attempts,
+            // If there is no room left anywhere,
             // we just place it anyway, potentially overlapping.
-            planet.position = RandomPlanetPosition(&state, width, height, PlanetGetOuterRadius(&planet));
+            planet.position = RandomPlanetPosition(&state, width, height, radius);
+            overlappingCount++;
         }
 
         // For the first factionCount planets, assign each to a different faction.
@@ -256,11 +563,62 @@ bool GenerateRandomLevel(Level *level,
         planet.claimant = NULL;
         planet.owner = (i < factionCount) ? &level->factions[i] : NULL;
         level->planets[i] = planet;
+
+        PlanetPlacementGridInsert(&grid, i, planet.position);
+        if (crowded && placed) {
+            activePlanets[activeCount++] = i;
+        }
+    }
+
+    if (!cancelled && overlappingCount > 0) {
+        printf("Level too crowded: %zu of %zu planets overlap others.\n", overlappingCount, planetCount);
     }
 
+    free(activePlanets);
+    PlanetPlacementGridRelease(&grid);
+    if (cancelled) {
+        return false;
+    }
     return true;
 }
 
+/**
+ * Generates a random level with the specified parameters.
+ * Assumes that the level pointed to by 'level' has already been configured,
+ * and the factions in the level have already been created.
+ * See GenerateRandomLevelCancellable for how planets are placed.
+ * @param level A pointer to the Level object to populate.
+ * @param planetCount The number of planets to generate.
+ * @param factionCount The number of factions to use for generation.
+ *                     Not used to actually generate factions since they are 
+ *                     assumed to already exist; instead, it is used to ensure
+ *                     for validation and to balance starting planet capacities.
+ * @param minFleetCapacity The minimum fleet capacity for generated planets.
+ * @param maxFleetCapacity The maximum fleet capacity for generated planets.
+ * @param width The width of the level.
+ * @param height The height of the level.
+ * @param seed The seed for the random number generator.
+ * @return true if the level was generated successfully, false otherwise.
+ */
+bool GenerateRandomLevel(Level *level,
+    size_t planetCount,
+    size_t factionCount,
+    float minFleetCapacity,
+    float maxFleetCapacity,
+    float width,
+    float height,
+    unsigned int seed) {
+    return GenerateRandomLevelCancellable(level,
+        planetCount,
+        factionCount,
+        minFleetCapacity,
+        maxFleetCapacity,
+        width,
+        height,
+        seed,
+        NULL);
+}
+
 /**
  * Generates a random level with the specified parameters.
  * Assumes that the level pointed to by 'level' has not been configured yet.
@@ -349,3 +707,104 @@ bool GenerateRandomLevelWithFactions(Level *level,
         height,
         state);
 }
+
+/**
+ * Runs the determinism replay: a scripted match which depends on nothing but the DETERMINISM_REPLAY settings
+ * in Utilities/gameUtilities.c, hashing the level's state as it goes (see LevelComputeStateHash).
+ * Every build of the game must produce exactly the same hashes, whatever compiler, flags or math library
+ * it was built with, since otherwise a server and its clients built differently would drift apart during a match.
+ * Normally each hash is checked against the expected one recorded alongside the settings,
+ * and the replay stops at the first that differs. When the simulation is changed on purpose,
+ * the replay is instead run to record the new hashes, which it prints ready to be pasted over the old ones.
+ * @param record true to print the hashes for recording rather than check them.
+ * @param outFinalHash Where to write the state hash at the end of the replay. May be NULL.
+ * @return true if the replay ran to the end with every hash as expected (or was recording),
+ *         false if the level could not be generated or a hash differed.
+ */
+bool RunDeterminismReplay(bool record, uint64_t *outFinalHash) {
+    Level level;
+    LevelInit(&level);
+
+    if (!GenerateRandomLevelWithFactions(&level,
+        DETERMINISM_REPLAY_PLANET_COUNT,
+        DETERMINISM_REPLAY_FACTION_COUNT,
+        DETERMINISM_REPLAY_MIN_FLEET_CAPACITY,
+        DETERMINISM_REPLAY_MAX_FLEET_CAPACITY,
+        DETERMINISM_REPLAY_WIDTH,
+        DETERMINISM_REPLAY_HEIGHT,
+        DETERMINISM_REPLAY_SEED)) {
+        printf("Failed to generate the determinism replay level.\n");
+        LevelRelease(&level);
+        return false;
+    }
+
+    // Every hash is kept, so that when recording they can be printed in the order they appear in the source.
+    uint64_t stateHashes[DETERMINISM_REPLAY_TICKS / DETERMINISM_REPLAY_HASH_INTERVAL];
+    bool matched = true;
+    uint64_t layoutHash = LevelComputeLayoutHash(&level);
+    if (!record && layoutHash != DETERMINISM_REPLAY_EXPECTED_LAYOUT_HASH) {
+        printf("Determinism replay failed: the level was laid out with hash %016llx, expected %016llx.\n",
+            (unsigned long long)layoutHash, (unsigned long long)DETERMINISM_REPLAY_EXPECTED_LAYOUT_HASH);
+        matched = false;
+    }
+
+    // The launches are scripted from their own random number generator,
+    // separate from the one spawning starships, just as orders and spawns are separate in a real match.
+    unsigned int orderState = DETERMINISM_REPLAY_SEED;
+    unsigned int shipSpawnState = DETERMINISM_REPLAY_SEED ^ 0xA5A5A5A5u;
+
+    for (uint32_t tick = 1; matched && tick <= DETERMINISM_REPLAY_TICKS; ++tick) {
+        if (tick % DETERMINISM_REPLAY_LAUNCH_INTERVAL == 0u) {
+            // Pick a random planet to launch from, and another to send the fleet to.
+            // Unowned origins are simply skipped, which keeps the script just as deterministic.
+            Planet *origin = &level.planets[NextRandom(&orderState) % level.planetCount];
+            Planet *destination = &level.planets[NextRandom(&orderState) % level.planetCount];
+            if (origin->owner != NULL && origin != destination) {
+                PlanetSendFleet(origin, destination, &level, &shipSpawnState);
+            }
+        }
+
+        LevelUpdate(&level, DETERMINISM_REPLAY_TIME_STEP);
+
+        if (tick % DETERMINISM_REPLAY_HASH_INTERVAL == 0u) {
+            uint32_t hashIndex = tick / DETERMINISM_REPLAY_HASH_INTERVAL - 1u;
+            uint64_t stateHash = LevelComputeStateHash(&level);
+            uint64_t expectedHash = DETERMINISM_REPLAY_EXPECTED_HASHES[hashIndex];
+            stateHashes[hashIndex] = stateHash;
+            if (!record && stateHash != expectedHash) {
+                // Stop at the first difference, since everything after it differs as well.
+                printf("Determinism replay failed at tick %u: state hash %016llx, expected %016llx.\n",
+                    tick, (unsigned long long)stateHash, (unsigned long long)expectedHash);
+                matched = false;
+            }
+        }
+    }
+
+    uint64_t finalHash = LevelComputeStateHash(&level);
+    if (record) {
+        // Printed just as the expected hashes are written in the source, ready to be pasted over them.
+        printf("#define DETERMINISM_REPLAY_EXPECTED_LAYOUT_HASH 0x%016llXull\n", (unsigned long long)layoutHash);
+        printf("#define DETERMINISM_REPLAY_EXPECTED_FINAL_HASH 0x%016llXull\n", (unsigned long long)finalHash);
+        printf("static const uint64_t DETERMINISM_REPLAY_EXPECTED_HASHES[DETERMINISM_REPLAY_TICKS / DETERMINISM_REPLAY_HASH_INTERVAL] = {\n");
+        for (uint32_t i = 0; i < DETERMINISM_REPLAY_TICKS / DETERMINISM_REPLAY_HASH_INTERVAL; ++i) {
+            printf("    0x%016llXull%s\n", (unsigned long long)stateHashes[i],
+                i + 1u < DETERMINISM_REPLAY_TICKS / DETERMINISM_REPLAY_HASH_INTERVAL ? "," : "");
+        }
+        printf("};\n");
+    } else if (matched && finalHash != DETERMINISM_REPLAY_EXPECTED_FINAL_HASH) {
+        printf("Determinism replay failed at the end: state hash %016llx, expected %016llx.\n",
+            (unsigned long long)finalHash, (unsigned long long)DETERMINISM_REPLAY_EXPECTED_FINAL_HASH);
+        matched = false;
+    }
+
+    if (matched && !record) {
+        printf("Determinism replay passed: all %u ticks matched the expected state hashes.\n", DETERMINISM_REPLAY_TICKS);
+    }
+
+    if (outFinalHash != NULL) {
+        *outFinalHash = finalHash;
+    }
+
+    LevelRelease(&level);
+    return matched;
+}
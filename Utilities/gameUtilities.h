@@ -59,6 +59,34 @@ bool GenerateRandomLevel(Level *level,
     float height,
     unsigned int seed);
 
+/**
+ * Generates a random level with the specified parameters, exactly as GenerateRandomLevel does,
+ * but giving up part way through should another thread ask it to.
+ * Assumes that the level pointed to by 'level' has already been configured,
+ * and the factions in the level have already been created.
+ * @param level A pointer to the Level object to populate.
+ * @param planetCount The number of planets to generate.
+ * @param factionCount The number of factions to generate.
+ *                     Only used to validate that there are enough factions
+ *                     and that each faction can be assigned a starting planet.
+ * @param minFleetCapacity The minimum fleet capacity for generated planets.
+ * @param maxFleetCapacity The maximum fleet capacity for generated planets.
+ * @param width The width of the level.
+ * @param height The height of the level.
+ * @param seed The seed for the random number generator.
+ * @param cancelRequested Checked as each planet is placed; generation stops once it becomes nonzero. May be NULL.
+ * @return true if the level was generated successfully, false if it failed or was cancelled.
+ */
+bool GenerateRandomLevelCancellable(Level *level,
+    size_t planetCount,
+    size_t factionCount,
+    float minFleetCapacity,
+    float maxFleetCapacity,
+    float width,
+    float height,
+    unsigned int seed,
+    volatile LONG *cancelRequested);
+
 /**
  * Generates a random level with the specified parameters.
  * Assumes that the level pointed to by 'level' has not been configured yet.
@@ -108,4 +136,19 @@ unsigned int NextRandom(unsigned int *state);
  */
 float RandomRange(unsigned int *state, float minValue, float maxValue);
 
+/**
+ * Runs the determinism replay: a scripted match which depends on nothing but the DETERMINISM_REPLAY settings
+ * in Utilities/gameUtilities.c, hashing the level's state as it goes (see LevelComputeStateHash).
+ * Every build of the game must produce exactly the same hashes, whatever compiler, flags or math library
+ * it was built with, since otherwise a server and its clients built differently would drift apart during a match.
+ * Normally each hash is checked against the expected one recorded alongside the settings,
+ * and the replay stops at the first that differs. When the simulation is changed on purpose,
+ * the replay is instead run to record the new hashes, which it prints ready to be pasted over the old ones.
+ * @param record true to print the hashes for recording rather than check them.
+ * @param outFinalHash Where to write the state hash at the end of the replay. May be NULL.
+ * @return true if the replay ran to the end with every hash as expected (or was recording),
+ *         false if the level could not be generated or a hash differed.
+ */
+bool RunDeterminismReplay(bool record, uint64_t *outFinalHash);
+
 #endif // _GAME_UTILITIES_H_
@@ -0,0 +1,94 @@
+/**
+ * Implementation of the level snapshot utilities.
+ * The client simulates its level on one thread and draws it on another,
+ * and these functions are how the latest state of the level makes it from one to the other.
+ * @file Utilities/levelSnapshotUtilities.c
+ * @author abmize
+ */
+#include "Utilities/levelSnapshotUtilities.h"
+
+/**
+ * Initializes a level snapshot buffer with no published snapshot.
+ * @param buffer Pointer to the buffer to initialize.
+ * @return true if the buffer was initialized, false otherwise.
+ */
+bool LevelSnapshotBufferInitialize(LevelSnapshotBuffer *buffer) {
+    if (buffer == NULL) {
+        return false;
+    }
+
+    memset(buffer, 0, sizeof(*buffer));
+    LevelInit(&buffer->snapshots[0]);
+    LevelInit(&buffer->snapshots[1]);
+    InitializeCriticalSection(&buffer->lock);
+    buffer->initialized = true;
+    return true;
+}
+
+/**
+ * Publishes a snapshot of the given level, replacing the previously published one.
+ * Must only ever be called from one thread at a time.
+ * @param buffer Pointer to the buffer to publish into.
+ * @param level Pointer to the level to take a snapshot of, or NULL if there is no level to draw.
+ * @param ticks The performance counter value of the tick the level is at.
+ */
+void LevelSnapshotBufferPublish(LevelSnapshotBuffer *buffer, const Level *level, int64_t ticks) {
+    if (buffer == NULL || !buffer->initialized) {
+        return;
+    }
+
+    // Only the publishing thread ever changes frontIndex, so reading it here without the lock is safe,
+    // and nobody else touches the back snapshot, so we can take our time filling it in.
+    int backIndex = 1 - buffer->frontIndex;
+    bool valid = level != NULL && LevelCopyState(&buffer->snapshots[backIndex], level);
+    buffer->valid[backIndex] = valid;
+    buffer->ticks[backIndex] = ticks;
+
+    // The swap itself is the only part the drawing thread could be in the middle of reading.
+    EnterCriticalSection(&buffer->lock);
+    buffer->frontIndex = backIndex;
+    LeaveCriticalSection(&buffer->lock);
+}
+
+/**
+ * Copies the most recently published snapshot into the given level.
+ * The destination keeps its render caches as long as the snapshot is of the same level,
+ * see LevelCopyState for details.
+ * @param buffer Pointer to the buffer to copy from.
+ * @param destination Pointer to the level to copy into. Must have been initialized.
+ * @param outTicks Receives the performance counter value of the snapshot's tick. May be NULL.
+ * @return true if a snapshot was copied, false if there is none or copying failed.
+ */
+bool LevelSnapshotBufferAcquire(LevelSnapshotBuffer *buffer, Level *destination, int64_t *outTicks) {
+    if (buffer == NULL || !buffer->initialized || destination == NULL) {
+        return false;
+    }
+
+    // Holding the lock keeps the publisher from swapping the front snapshot out
+    // (and then writing over it) while we are still copying from it.
+    EnterCriticalSection(&buffer->lock);
+    int frontIndex = buffer->frontIndex;
+    bool copied = buffer->valid[frontIndex] && LevelCopyState(destination, &buffer->snapshots[frontIndex]);
+    if (copied && outTicks != NULL) {
+        *outTicks = buffer->ticks[frontIndex];
+    }
+    LeaveCriticalSection(&buffer->lock);
+
+    return copied;
+}
+
+/**
+ * Releases the snapshots and lock held by a level snapshot buffer.
+ * No other thread may be using the buffer when this is called.
+ * @param buffer Pointer to the buffer to release.
+ */
+void LevelSnapshotBufferRelease(LevelSnapshotBuffer *buffer) {
+    if (buffer == NULL || !buffer->initialized) {
+        return;
+    }
+
+    LevelRelease(&buffer->snapshots[0]);
+    LevelRelease(&buffer->snapshots[1]);
+    DeleteCriticalSection(&buffer->lock);
+    buffer->initialized = false;
+}
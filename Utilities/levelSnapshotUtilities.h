@@ -0,0 +1,69 @@
+/**
+ * Header file for the level snapshot utilities.
+ * A level snapshot buffer hands copies of a level from the thread simulating it
+ * to the thread drawing it, without either thread having to wait on the other
+ * for longer than it takes to copy a level.
+ * @file Utilities/levelSnapshotUtilities.h
+ * @author abmize
+ */
+#ifndef _LEVEL_SNAPSHOT_UTILITIES_H_
+#define _LEVEL_SNAPSHOT_UTILITIES_H_
+
+#include <windows.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Objects/level.h"
+
+// A pair of level snapshots, one published and one being written.
+// The simulating thread copies its level into the back snapshot whenever it finishes a tick,
+// then swaps it to the front. The drawing thread only ever copies out of the front snapshot.
+// Since the back snapshot belongs to the simulating thread alone, the lock is only held
+// while swapping the two and while copying out of the front one.
+// valid is false for a snapshot holding no level, such as while in the menus,
+// and ticks is the performance counter value of the tick the snapshot was taken at.
+typedef struct LevelSnapshotBuffer {
+    CRITICAL_SECTION lock;
+    bool initialized;
+    Level snapshots[2];
+    bool valid[2];
+    int64_t ticks[2];
+    int frontIndex;
+} LevelSnapshotBuffer;
+
+/**
+ * Initializes a level snapshot buffer with no published snapshot.
+ * @param buffer Pointer to the buffer to initialize.
+ * @return true if the buffer was initialized, false otherwise.
+ */
+bool LevelSnapshotBufferInitialize(LevelSnapshotBuffer *buffer);
+
+/**
+ * Publishes a snapshot of the given level, replacing the previously published one.
+ * Must only ever be called from one thread at a time.
+ * @param buffer Pointer to the buffer to publish into.
+ * @param level Pointer to the level to take a snapshot of, or NULL if there is no level to draw.
+ * @param ticks The performance counter value of the tick the level is at.
+ */
+void LevelSnapshotBufferPublish(LevelSnapshotBuffer *buffer, const Level *level, int64_t ticks);
+
+/**
+ * Copies the most recently published snapshot into the given level.
+ * The destination keeps its render caches as long as the snapshot is of the same level,
+ * see LevelCopyState for details.
+ * @param buffer Pointer to the buffer to copy from.
+ * @param destination Pointer to the level to copy into. Must have been initialized.
+ * @param outTicks Receives the performance counter value of the snapshot's tick. May be NULL.
+ * @return true if a snapshot was copied, false if there is none or copying failed.
+ */
+bool LevelSnapshotBufferAcquire(LevelSnapshotBuffer *buffer, Level *destination, int64_t *outTicks);
+
+/**
+ * Releases the snapshots and lock held by a level snapshot buffer.
+ * No other thread may be using the buffer when this is called.
+ * @param buffer Pointer to the buffer to release.
+ */
+void LevelSnapshotBufferRelease(LevelSnapshotBuffer *buffer);
+
+#endif // _LEVEL_SNAPSHOT_UTILITIES_H_
@@ -0,0 +1,379 @@
+/**
+ * Implementation of the map file utilities.
+ * See mapFileUtilities.h for a description of the map file format.
+ * @file Utilities/mapFileUtilities.c
+ * @author abmize
+ */
+#include "Utilities/mapFileUtilities.h"
+
+/**
+ * Helper function to round a byte offset up to the next section boundary.
+ * @param offset The offset to round up.
+ * @return The smallest multiple of MAP_FILE_SECTION_ALIGNMENT not less than offset.
+ */
+static uint64_t MapFileAlignOffset(uint64_t offset) {
+    return (offset + (MAP_FILE_SECTION_ALIGNMENT - 1u)) & ~(uint64_t)(MAP_FILE_SECTION_ALIGNMENT - 1u);
+}
+
+/**
+ * Helper function to check that a section of count elements of elementSize bytes,
+ * starting at the given offset, is aligned and lies entirely within a file of the given size.
+ * @param offset The offset of the section.
+ * @param count The number of elements in the section.
+ * @param elementSize The size of each element in bytes.
+ * @param fileSize The size of the file in bytes.
+ * @return true if the section is aligned and fits in the file, false otherwise.
+ */
+static bool MapFileSectionFits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize) {
+    if (offset % MAP_FILE_SECTION_ALIGNMENT != 0u || offset > fileSize) {
+        return false;
+    }
+
+    // Divide rather than multiply, so a huge count cannot overflow its way past the check.
+    return count <= (fileSize - offset) / elementSize;
+}
+
+/**
+ * Computes the hash used to identify a map, a 64-bit FNV-1a hash of the given bytes.
+ * Never returns 0, which is kept to mean "no map".
+ * @param data The bytes to hash.
+ * @param size The number of bytes to hash.
+ * @return The hash of the bytes.
+ */
+uint64_t MapFileHash(const void *data, size_t size) {
+    // FNV-1a: for each byte, xor it in and multiply by the FNV prime.
+    // The offset basis and prime are the standard 64-bit ones.
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash != 0u ? hash : 1u;
+}
+
+/**
+ * Checks that the given bytes make up a valid map file of a version this code can read.
+ * @param data The bytes of the map file.
+ * @param size The number of bytes.
+ * @return true if the map file is valid, false otherwise.
+ */
+bool MapFileValidate(const void *data, size_t size) {
+    if (data == NULL || size < sizeof(MapFileHeader)) {
+        return false;
+    }
+
+    const MapFileHeader *header = (const MapFileHeader *)data;
+    if (header->magic != MAP_FILE_MAGIC || header->version != MAP_FILE_VERSION
+        || header->headerSize < sizeof(MapFileHeader) || header->headerSize > size) {
+        return false;
+    }
+
+    // The same limits the lobby puts on generated levels: positive, finite bounds and at least one planet.
+    if (!isfinite(header->width) || !isfinite(header->height) || header->width <= 0.0f || header->height <= 0.0f
+        || header->planetCount == 0u) {
+        return false;
+    }
+
+    if (!MapFileSectionFits(header->planetsOffset, header->planetCount, sizeof(MapFilePlanet), size)
+        || !MapFileSectionFits(header->startSlotsOffset, header->startSlotCount, sizeof(uint32_t), size)) {
+        return false;
+    }
+
+    const MapFilePlanet *planets = (const MapFilePlanet *)((const uint8_t *)data + header->planetsOffset);
+    for (uint32_t i = 0; i < header->planetCount; ++i) {
+        if (!isfinite(planets[i].position.x) || !isfinite(planets[i].position.y)
+            || !isfinite(planets[i].maxFleetCapacity) || planets[i].maxFleetCapacity <= 0.0f) {
+            return false;
+        }
+    }
+
+    // Every start slot must name a real planet, and no two factions may start on the same one.
+    const uint32_t *startSlots = (const uint32_t *)((const uint8_t *)data + header->startSlotsOffset);
+    for (uint32_t i = 0; i < header->startSlotCount; ++i) {
+        if (startSlots[i] >= header->planetCount) {
+            return false;
+        }
+        for (uint32_t j = 0; j < i; ++j) {
+            if (startSlots[j] == startSlots[i]) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Opens and memory-maps a map file, validating it and computing its hash.
+ * @param path The path of the map file.
+ * @param outMap Receives the open map. Left closed if opening fails.
+ * @return true if the map was opened, false otherwise.
+ */
+bool MapFileOpen(const char *path, MapFile *outMap) {
+    if (outMap == NULL) {
+        return false;
+    }
+
+    memset(outMap, 0, sizeof(*outMap));
+    if (path == NULL || path[0] == '\0') {
+        return false;
+    }
+
+    // The file is only ever read, and others may read it at the same time,
+    // for instance the lobby preview worker opening the same map.
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(MapFileHeader)
+        || (uint64_t)fileSize.QuadPart > (uint64_t)SIZE_MAX) {
+        CloseHandle(file);
+        return false;
+    }
+
+    // Map the whole file read-only. The view starts on a page boundary,
+    // which is what keeps the aligned sections aligned in memory.
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return false;
+    }
+
+    const uint8_t *data = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    size_t size = (size_t)fileSize.QuadPart;
+    if (!MapFileValidate(data, size)) {
+        printf("Map file %s is not a valid version %u map.\n", path, MAP_FILE_VERSION);
+        UnmapViewOfFile(data);
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    outMap->data = data;
+    outMap->size = size;
+    outMap->hash = MapFileHash(data, size);
+    outMap->header = (const MapFileHeader *)data;
+    outMap->planets = (const MapFilePlanet *)(data + outMap->header->planetsOffset);
+    outMap->startSlots = (const uint32_t *)(data + outMap->header->startSlotsOffset);
+    outMap->fileHandle = file;
+    outMap->mappingHandle = mapping;
+    return true;
+}
+
+/**
+ * Closes a map opened with MapFileOpen. Safe to call on a map that is already closed,
+ * or was zero-initialized and never opened.
+ * @param map The map to close.
+ */
+void MapFileClose(MapFile *map) {
+    if (map == NULL) {
+        return;
+    }
+
+    if (map->data != NULL) {
+        UnmapViewOfFile(map->data);
+    }
+    if (map->mappingHandle != NULL) {
+        CloseHandle(map->mappingHandle);
+    }
+    if (map->fileHandle != NULL && map->fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(map->fileHandle);
+    }
+
+    memset(map, 0, sizeof(*map));
+}
+
+/**
+ * Lays a map out in a level, the map file equivalent of GenerateRandomLevel.
+ * Assumes that the level has already been configured with exactly as many planets as the map has,
+ * and that the factions in the level have already been created.
+ * Faction i starts on the planet in start slot i, with a full fleet, and every other planet is unowned.
+ * @param map The map to lay out.
+ * @param level The level to lay it out in.
+ * @param factionCount The number of factions to give a start slot to.
+ * @return true if the map was laid out, false if it does not fit the level or has too few start slots.
+ */
+bool MapFileApplyToLevel(const MapFile *map, Level *level, size_t factionCount) {
+    if (map == NULL || map->header == NULL || level == NULL) {
+        return false;
+    }
+
+    const MapFileHeader *header = map->header;
+    if (level->planetCount != (size_t)header->planetCount || factionCount > level->factionCount
+        || factionCount > (size_t)header->startSlotCount) {
+        return false;
+    }
+
+    level->width = header->width;
+    level->height = header->height;
+    level->starshipCount = 0;
+    level->fleetCount = 0;
+    level->mapHash = map->hash;
+
+    // The planet records are read straight out of the mapped file, one pass, no parsing.
+    for (size_t i = 0; i < level->planetCount; ++i) {
+        Planet planet = CreatePlanet(map->planets[i].position, map->planets[i].maxFleetCapacity, NULL);
+        planet.currentFleetSize = 0.0f;
+        planet.claimant = NULL;
+        planet.owner = NULL;
+        level->planets[i] = planet;
+    }
+
+    // Just like a generated level, each faction starts with one planet, at full fleet capacity.
+    for (size_t i = 0; i < factionCount; ++i) {
+        Planet *start = &level->planets[map->startSlots[i]];
+        start->owner = &level->factions[i];
+        start->currentFleetSize = start->maxFleetCapacity;
+    }
+
+    return true;
+}
+
+/**
+ * Helper function to write bytes to a file, removing the file again should writing fail part way through.
+ * @param path The path of the file to write.
+ * @param data The bytes to write.
+ * @param size The number of bytes.
+ * @return true if the file was written, false otherwise.
+ */
+static bool MapFileWriteWholeFile(const char *path, const void *data, size_t size) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("Failed to open %s for writing.\n", path);
+        return false;
+    }
+
+    bool written = fwrite(data, 1, size, file) == size;
+    if (fclose(file) != 0) {
+        written = false;
+    }
+
+    // A half written map would only be rejected later, so do not leave one lying around.
+    if (!written) {
+        printf("Failed to write %s.\n", path);
+        remove(path);
+    }
+    return written;
+}
+
+/**
+ * Writes a level's layout out as a map file.
+ * Each faction's start slot is the first planet it owns, so this is best done right as a match starts.
+ * @param level The level to write out.
+ * @param path The path of the map file to write.
+ * @return true if the map file was written, false otherwise.
+ */
+bool MapFileWriteLevel(const Level *level, const char *path) {
+    if (level == NULL || path == NULL || level->planetCount == 0 || level->planetCount > UINT32_MAX) {
+        return false;
+    }
+
+    // Find each faction's start slot, stopping at the first faction without a planet,
+    // since faction i always takes start slot i.
+    uint32_t *startSlots = (uint32_t *)malloc(sizeof(uint32_t) * (level->factionCount > 0 ? level->factionCount : 1u));
+    if (startSlots == NULL) {
+        return false;
+    }
+    size_t startSlotCount = 0;
+    for (size_t f = 0; f < level->factionCount; ++f) {
+        bool found = false;
+        for (size_t i = 0; i < level->planetCount && !found; ++i) {
+            if (level->planets[i].owner == &level->factions[f]) {
+                startSlots[startSlotCount++] = (uint32_t)i;
+                found = true;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+
+    // Lay the file out exactly as described in the header: header, planets, start slots, each aligned.
+    uint64_t planetsOffset = MapFileAlignOffset(sizeof(MapFileHeader));
+    uint64_t startSlotsOffset = MapFileAlignOffset(planetsOffset + (uint64_t)level->planetCount * sizeof(MapFilePlanet));
+    uint64_t totalSize = startSlotsOffset + (uint64_t)startSlotCount * sizeof(uint32_t);
+    if (totalSize > (uint64_t)SIZE_MAX) {
+        free(startSlots);
+        return false;
+    }
+
+    // calloc so the padding between sections and the reserved fields are all zero.
+    uint8_t *buffer = (uint8_t *)calloc(1, (size_t)totalSize);
+    if (buffer == NULL) {
+        free(startSlots);
+        return false;
+    }
+
+    MapFileHeader *header = (MapFileHeader *)buffer;
+    header->magic = MAP_FILE_MAGIC;
+    header->version = MAP_FILE_VERSION;
+    header->headerSize = (uint32_t)sizeof(MapFileHeader);
+    header->width = level->width;
+    header->height = level->height;
+    header->planetCount = (uint32_t)level->planetCount;
+    header->startSlotCount = (uint32_t)startSlotCount;
+    header->planetsOffset = planetsOffset;
+    header->startSlotsOffset = startSlotsOffset;
+
+    MapFilePlanet *planets = (MapFilePlanet *)(buffer + planetsOffset);
+    for (size_t i = 0; i < level->planetCount; ++i) {
+        planets[i].position = level->planets[i].position;
+        planets[i].maxFleetCapacity = level->planets[i].maxFleetCapacity;
+    }
+    if (startSlotCount > 0) {
+        memcpy(buffer + startSlotsOffset, startSlots, startSlotCount * sizeof(uint32_t));
+    }
+    free(startSlots);
+
+    bool written = MapFileWriteWholeFile(path, buffer, (size_t)totalSize);
+    free(buffer);
+    return written;
+}
+
+/**
+ * Writes the bytes of a map file, as received from elsewhere, to a file.
+ * @param path The path of the map file to write.
+ * @param data The bytes of the map file.
+ * @param size The number of bytes.
+ * @return true if the map file was written, false otherwise.
+ */
+bool MapFileWriteBytes(const char *path, const void *data, size_t size) {
+    if (path == NULL || data == NULL || size == 0) {
+        return false;
+    }
+
+    return MapFileWriteWholeFile(path, data, size);
+}
+
+/**
+ * Builds the path a map with the given hash is kept at in MAP_FILE_CACHE_DIRECTORY,
+ * creating the directory if it does not exist yet.
+ * @param hash The hash of the map.
+ * @param outPath Receives the path.
+ * @param outPathSize The size of outPath in bytes.
+ * @return true if the path was built, false otherwise.
+ */
+bool MapFileGetCachePath(uint64_t hash, char *outPath, size_t outPathSize) {
+    if (outPath == NULL || outPathSize == 0) {
+        return false;
+    }
+
+    // Failing because the directory already exists is exactly what we want.
+    if (!CreateDirectoryA(MAP_FILE_CACHE_DIRECTORY, NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+        return false;
+    }
+
+    int written = snprintf(outPath, outPathSize, "%s\\%016llx%s", MAP_FILE_CACHE_DIRECTORY,
+        (unsigned long long)hash, MAP_FILE_EXTENSION);
+    return written > 0 && (size_t)written < outPathSize;
+}
@@ -0,0 +1,165 @@
+/**
+ * Header file for the map file utilities.
+ * A map file holds a curated level layout: its bounds, every planet's position and fleet capacity,
+ * and the planets factions start on (their start slots), so that a level need not come from
+ * a seed fed to GenerateRandomLevel.
+ *
+ * The format is laid out to be memory-mapped and read in place, without any parsing:
+ * 1. A MapFileHeader at the very start of the file.
+ * 2. planetCount MapFilePlanet records, starting at planetsOffset.
+ * 3. startSlotCount 32-bit planet indices, starting at startSlotsOffset.
+ * Both offsets are multiples of MAP_FILE_SECTION_ALIGNMENT, so once the file is mapped
+ * (which always starts on a page boundary) the planet records are a properly aligned array
+ * which is used directly as the level's planet layout.
+ * All values are little-endian, which is what every machine the game runs on uses anyway.
+ *
+ * Maps are identified by a hash of the whole file, so that a client which already has a map
+ * (kept in MAP_FILE_CACHE_DIRECTORY, named after its hash) never needs it sent again.
+ * Should the format ever change, MAP_FILE_VERSION must be bumped, and older versions either
+ * converted on load or rejected.
+ * @file Utilities/mapFileUtilities.h
+ * @author abmize
+ */
+#ifndef _MAP_FILE_UTILITIES_H_
+#define _MAP_FILE_UTILITIES_H_
+
+#include <windows.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Objects/level.h"
+#include "Objects/planet.h"
+#include "Objects/vec2.h"
+
+// The first four bytes of every map file, "LYWM" when read as text.
+#define MAP_FILE_MAGIC 0x4D57594Cu
+
+// The version of the map format written by this code, and the only one it reads.
+#define MAP_FILE_VERSION 1u
+
+// Every section of a map file starts at a multiple of this many bytes.
+#define MAP_FILE_SECTION_ALIGNMENT 16u
+
+// Directory, relative to the working directory, where maps received from a server are kept.
+#define MAP_FILE_CACHE_DIRECTORY "maps"
+
+// Extension given to map files.
+#define MAP_FILE_EXTENSION ".lywmap"
+
+#pragma pack(push, 1)
+
+// The header found at the start of every map file.
+typedef struct MapFileHeader {
+    uint32_t magic; /* Always MAP_FILE_MAGIC. */
+    uint32_t version; /* Always MAP_FILE_VERSION. */
+    uint32_t headerSize; /* Size of this header in bytes, so later versions can grow it. */
+    uint32_t flags; /* Reserved for later versions, always 0 for now. */
+    float width; /* Width of the level. */
+    float height; /* Height of the level. */
+    uint32_t planetCount; /* Number of planet records. */
+    uint32_t startSlotCount; /* Number of start slots, and therefore the most factions the map can hold. */
+    uint64_t planetsOffset; /* Offset in bytes from the start of the file to the planet records. */
+    uint64_t startSlotsOffset; /* Offset in bytes from the start of the file to the start slots. */
+} MapFileHeader;
+
+// A single planet of a map, as stored in the file.
+// Only what never changes during a match is stored; ownership and fleets come from the start slots.
+typedef struct MapFilePlanet {
+    Vec2 position;
+    float maxFleetCapacity;
+    uint32_t reserved; /* Pads the record to 16 bytes, always 0 for now. */
+} MapFilePlanet;
+
+#pragma pack(pop)
+
+// An open map file. Everything points straight into the mapped file,
+// so it stays valid only until the map is closed.
+typedef struct MapFile {
+    const uint8_t *data; /* The whole file. */
+    size_t size; /* Size of the whole file in bytes. */
+    uint64_t hash; /* Hash of the whole file, see MapFileHash. */
+    const MapFileHeader *header;
+    const MapFilePlanet *planets; /* header->planetCount planet records. */
+    const uint32_t *startSlots; /* header->startSlotCount planet indices, in faction order. */
+    HANDLE fileHandle;
+    HANDLE mappingHandle;
+} MapFile;
+
+/**
+ * Computes the hash used to identify a map, a 64-bit FNV-1a hash of the given bytes.
+ * Never returns 0, which is kept to mean "no map".
+ * @param data The bytes to hash.
+ * @param size The number of bytes to hash.
+ * @return The hash of the bytes.
+ */
+uint64_t MapFileHash(const void *data, size_t size);
+
+/**
+ * Checks that the given bytes make up a valid map file of a version this code can read.
+ * @param data The bytes of the map file.
+ * @param size The number of bytes.
+ * @return true if the map file is valid, false otherwise.
+ */
+bool MapFileValidate(const void *data, size_t size);
+
+/**
+ * Opens and memory-maps a map file, validating it and computing its hash.
+ * @param path The path of the map file.
+ * @param outMap Receives the open map. Left closed if opening fails.
+ * @return true if the map was opened, false otherwise.
+ */
+bool MapFileOpen(const char *path, MapFile *outMap);
+
+/**
+ * Closes a map opened with MapFileOpen. Safe to call on a map that is already closed,
+ * or was zero-initialized and never opened.
+ * @param map The map to close.
+ */
+void MapFileClose(MapFile *map);
+
+/**
+ * Lays a map out in a level, the map file equivalent of GenerateRandomLevel.
+ * Assumes that the level has already been configured with exactly as many planets as the map has,
+ * and that the factions in the level have already been created.
+ * Faction i starts on the planet in start slot i, with a full fleet, and every other planet is unowned.
+ * @param map The map to lay out.
+ * @param level The level to lay it out in.
+ * @param factionCount The number of factions to give a start slot to.
+ * @return true if the map was laid out, false if it does not fit the level or has too few start slots.
+ */
+bool MapFileApplyToLevel(const MapFile *map, Level *level, size_t factionCount);
+
+/**
+ * Writes a level's layout out as a map file.
+ * Each faction's start slot is the first planet it owns, so this is best done right as a match starts.
+ * @param level The level to write out.
+ * @param path The path of the map file to write.
+ * @return true if the map file was written, false otherwise.
+ */
+bool MapFileWriteLevel(const Level *level, const char *path);
+
+/**
+ * Writes the bytes of a map file, as received from elsewhere, to a file.
+ * @param path The path of the map file to write.
+ * @param data The bytes of the map file.
+ * @param size The number of bytes.
+ * @return true if the map file was written, false otherwise.
+ */
+bool MapFileWriteBytes(const char *path, const void *data, size_t size);
+
+/**
+ * Builds the path a map with the given hash is kept at in MAP_FILE_CACHE_DIRECTORY,
+ * creating the directory if it does not exist yet.
+ * @param hash The hash of the map.
+ * @param outPath Receives the path.
+ * @param outPathSize The size of outPath in bytes.
+ * @return true if the path was built, false otherwise.
+ */
+bool MapFileGetCachePath(uint64_t hash, char *outPath, size_t outPathSize);
+
+#endif // _MAP_FILE_UTILITIES_H_
@@ -419,28 +419,99 @@ void BroadcastLobbyState(SOCKET sock, Player *players, size_t playerCount, const
     }
 }
 
+/**
+ * Broadcasts a lobby delta packet, carrying only the lobby slots that changed, to all connected players.
+ * @param sock The socket to use for sending.
+ * @param players The array of players to send the delta to.
+ * @param playerCount The number of players in the array.
+ * @param delta The lobby delta header to send.
+ * @param slots Array of changed slot info entries with length delta->slotCount.
+ */
+void BroadcastLobbyDelta(SOCKET sock, Player *players, size_t playerCount, const LevelLobbyDeltaPacket *delta, const LevelLobbySlotInfo *slots) {
+    // Basic validation of input pointers.
+    if (players == NULL || delta == NULL || playerCount == 0 || (slots == NULL && delta->slotCount > 0)) {
+        return;
+    }
+
+    // Calculate the total packet size (header + changed slots).
+    size_t headerSize = sizeof(*delta);
+    size_t slotsSize = (size_t)delta->slotCount * sizeof(LevelLobbySlotInfo);
+    size_t packetSize = headerSize + slotsSize;
+    if (packetSize > (size_t)INT_MAX) {
+        printf("Lobby delta packet too large to send (size=%zu).\n", packetSize);
+        return;
+    }
+
+    // Every player gets the same delta, so the packet is only put together once.
+    uint8_t *buffer = (uint8_t *)malloc(packetSize);
+    if (buffer == NULL) {
+        printf("Failed to allocate lobby delta packet buffer.\n");
+        return;
+    }
+    memcpy(buffer, delta, headerSize);
+    if (slotsSize > 0) {
+        memcpy(buffer + headerSize, slots, slotsSize);
+    }
+
+    for (size_t i = 0; i < playerCount; ++i) {
+        int result = sendto(sock,
+            (const char *)buffer,
+            (int)packetSize,
+            0,
+            (SOCKADDR *)&players[i].address,
+            (int)sizeof(players[i].address));
+
+        // Report any send errors.
+        if (result == SOCKET_ERROR) {
+            printf("lobby delta sendto failed: %d\n", WSAGetLastError());
+        }
+    }
+
+    free(buffer);
+}
+
 /**
  * Broadcasts a start game packet to all connected players
- * so their clients can transition from the lobby to the active game state.
+ * so their clients can transition from the lobby to the active game state,
+ * laying the starting level out themselves rather than being sent all of it.
  * @param sock The socket to use for sending.
  * @param players The array of players to send the packet to.
  * @param playerCount The number of players in the array.
+ * @param header The start game packet header, with the settings the level was laid out with filled in.
+ * @param level The starting level, whose factions are sent along as the roster.
  */
-void BroadcastStartGame(SOCKET sock, Player *players, size_t playerCount) {
+void BroadcastStartGame(SOCKET sock, Player *players, size_t playerCount, const LevelStartGamePacket *header, const Level *level) {
     // Basic validation of input pointers.
-    if (players == NULL || playerCount == 0) {
+    if (players == NULL || playerCount == 0 || header == NULL || level == NULL) {
         return;
     }
 
-    // Create the start game packet.
-    LevelStartGamePacket packet = {0};
-    packet.type = LEVEL_PACKET_TYPE_START_GAME;
+    // Calculate the total packet size (header + faction roster).
+    size_t headerSize = sizeof(*header);
+    size_t rosterSize = level->factionCount * sizeof(LevelPacketFactionInfo);
+    size_t packetSize = headerSize + rosterSize;
+    if (packetSize > (size_t)INT_MAX) {
+        printf("Start game packet too large to send (size=%zu).\n", packetSize);
+        return;
+    }
+
+    // Create the start game packet, the same for every player.
+    uint8_t *buffer = (uint8_t *)malloc(packetSize);
+    if (buffer == NULL) {
+        printf("Failed to allocate start game packet buffer.\n");
+        return;
+    }
+    memcpy(buffer, header, headerSize);
+    LevelStartGamePacket *packet = (LevelStartGamePacket *)buffer;
+    packet->type = LEVEL_PACKET_TYPE_START_GAME;
+    packet->factionCount = (uint32_t)level->factionCount;
+    LevelWriteFactionInfo(level, (LevelPacketFactionInfo *)(buffer + headerSize));
 
     // Iterate over all players and send them the start game packet.
     for (size_t i = 0; i < playerCount; ++i) {
         int result = sendto(sock,
-            (const char *)&packet,
-            (int)sizeof(packet),
+            (const char *)buffer,
+            (int)packetSize,
             0,
             (SOCKADDR *)&players[i].address,
             (int)sizeof(players[i].address));
@@ -450,6 +521,67 @@ void BroadcastStartGame(SOCKET sock, Player *players, size_t playerCount) {
             printf("start game sendto failed: %d\n", WSAGetLastError());
         }
     }
+
+    free(buffer);
+}
+
+/**
+ * Sends a run of chunks of a map file to a specific player, in answer to their map request.
+ * Chunks past the end of the map are skipped, and at most LEVEL_MAP_MAX_CHUNKS_PER_REQUEST are sent.
+ * @param player The player to send the chunks to.
+ * @param sock The socket to use for sending.
+ * @param map The map file to send chunks of.
+ * @param firstChunk The index of the first chunk to send.
+ * @param chunkCount The number of chunks to send.
+ */
+void SendMapChunksToPlayer(Player *player, SOCKET sock, const MapFile *map, uint32_t firstChunk, uint32_t chunkCount) {
+    // Basic validation of input pointers.
+    if (player == NULL || map == NULL || map->data == NULL || map->size > UINT32_MAX) {
+        return;
+    }
+
+    // Whatever the client asked for, a single request never gets more than this many chunks,
+    // so a tiny request packet can never be turned into a flood of data.
+    if (chunkCount > LEVEL_MAP_MAX_CHUNKS_PER_REQUEST) {
+        chunkCount = LEVEL_MAP_MAX_CHUNKS_PER_REQUEST;
+    }
+
+    // One packet's worth of buffer, reused for every chunk.
+    uint8_t buffer[sizeof(LevelMapChunkPacket) + LEVEL_MAP_CHUNK_SIZE];
+    LevelMapChunkPacket *packet = (LevelMapChunkPacket *)buffer;
+    packet->type = LEVEL_PACKET_TYPE_MAP_CHUNK;
+    packet->mapHash = map->hash;
+    packet->mapSize = (uint32_t)map->size;
+
+    size_t chunkTotal = (map->size + LEVEL_MAP_CHUNK_SIZE - 1u) / LEVEL_MAP_CHUNK_SIZE;
+    for (uint32_t n = 0; n < chunkCount; ++n) {
+        size_t chunkIndex = (size_t)firstChunk + n;
+        if (chunkIndex >= chunkTotal) {
+            break;
+        }
+
+        // The chunks are copied straight out of the mapped file; only the last one may be short.
+        size_t offset = chunkIndex * LEVEL_MAP_CHUNK_SIZE;
+        size_t length = map->size - offset;
+        if (length > LEVEL_MAP_CHUNK_SIZE) {
+            length = LEVEL_MAP_CHUNK_SIZE;
+        }
+        packet->chunkIndex = (uint32_t)chunkIndex;
+        packet->length = (uint32_t)length;
+        memcpy(packet->data, map->data + offset, length);
+
+        int result = sendto(sock,
+            (const char *)buffer,
+            (int)(sizeof(LevelMapChunkPacket) + length),
+            0,
+            (SOCKADDR *)&player->address,
+            (int)sizeof(player->address));
+
+        if (result == SOCKET_ERROR) {
+            printf("map chunk sendto failed: %d\n", WSAGetLastError());
+            return;
+        }
+    }
 }
 
 /**
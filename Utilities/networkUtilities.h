@@ -17,6 +17,7 @@
 #include <stdlib.h>
 
 #include "Objects/level.h"
+#include "Utilities/mapFileUtilities.h"
 
 typedef struct Level Level;
 typedef struct Player Player;
@@ -149,14 +150,38 @@ void SendLobbyStateToPlayer(Player *player, SOCKET sock, const LevelLobbyStatePa
  */
 void BroadcastLobbyState(SOCKET sock, Player *players, size_t playerCount, const LevelLobbyStatePacket *state, const LevelLobbySlotInfo *slots);
 
+/**
+ * Broadcasts a lobby delta packet, carrying only the lobby slots that changed, to all connected players.
+ * @param sock The socket to use for sending.
+ * @param players The array of players to send the delta to.
+ * @param playerCount The number of players in the array.
+ * @param delta The lobby delta header to send.
+ * @param slots Array of changed slot info entries with length delta->slotCount.
+ */
+void BroadcastLobbyDelta(SOCKET sock, Player *players, size_t playerCount, const LevelLobbyDeltaPacket *delta, const LevelLobbySlotInfo *slots);
+
 /**
  * Broadcasts a start game packet to all connected players
- * so their clients can transition from the lobby to the active game state.
+ * so their clients can transition from the lobby to the active game state,
+ * laying the starting level out themselves rather than being sent all of it.
  * @param sock The socket to use for sending.
  * @param players The array of players to send the packet to.
  * @param playerCount The number of players in the array.
+ * @param header The start game packet header, with the settings the level was laid out with filled in.
+ * @param level The starting level, whose factions are sent along as the roster.
+ */
+void BroadcastStartGame(SOCKET sock, Player *players, size_t playerCount, const LevelStartGamePacket *header, const Level *level);
+
+/**
+ * Sends a run of chunks of a map file to a specific player, in answer to their map request.
+ * Chunks past the end of the map are skipped, and at most LEVEL_MAP_MAX_CHUNKS_PER_REQUEST are sent.
+ * @param player The player to send the chunks to.
+ * @param sock The socket to use for sending.
+ * @param map The map file to send chunks of.
+ * @param firstChunk The index of the first chunk to send.
+ * @param chunkCount The number of chunks to send.
  */
-void BroadcastStartGame(SOCKET sock, Player *players, size_t playerCount);
+void SendMapChunksToPlayer(Player *player, SOCKET sock, const MapFile *map, uint32_t firstChunk, uint32_t chunkCount);
 
 /**
  * Sends a targeted disconnect packet to reject a join attempt with a reason.
@@ -125,6 +125,7 @@ bool OpenGLInitializeForWindow(OpenGLContext *context, HWND windowHandle) {
     context->height = height;
     context->fontEntryCount = 0;
     ZeroMemory(context->fontEntries, sizeof(context->fontEntries));
+    ZeroMemory(context->fontIndex, sizeof(context->fontIndex));
 
     // Set the initial projection matrix based on the window size
     if (width > 0 && height > 0) {
@@ -153,15 +154,16 @@ void OpenGLShutdownForWindow(OpenGLContext *context, HWND windowHandle) {
     // Delete the OpenGL rendering context and release the device context
     if (context->renderContext != NULL) {
 
-        // Delete any font display lists created for this context.
+        // Delete any font atlas textures created for this context.
         for (size_t i = 0; i < context->fontEntryCount; ++i) {
-            if (context->fontEntries[i].listBase != 0) {
-                glDeleteLists(context->fontEntries[i].listBase, 96);
-                context->fontEntries[i].listBase = 0;
+            if (context->fontEntries[i].texture != 0) {
+                glDeleteTextures(1, &context->fontEntries[i].texture);
+                context->fontEntries[i].texture = 0;
             }
         }
         context->fontEntryCount = 0;
         ZeroMemory(context->fontEntries, sizeof(context->fontEntries));
+        ZeroMemory(context->fontIndex, sizeof(context->fontIndex));
 
         // Turn off the current rendering context
         // wglMakeCurrent(NULL, NULL) disassociates the current rendering context from the device context.
@@ -245,9 +247,201 @@ static bool OpenGLFontsEqual(const LOGFONTA *lhs, const LOGFONTA *rhs) {
 }
 
 /**
- * Acquires an OpenGL font display list for the specified font properties.
- * If a matching font already exists in the context, its display list base is returned.
- * Otherwise, a new font is created and its display list base is returned.
+ * Computes a hash of a LOGFONTA structure, used to find font entries in the font index.
+ * This is the FNV-1a hash over the structure's bytes, which is fine here
+ * since the structures are always zeroed before being filled in.
+ * @param logFont Pointer to the LOGFONTA structure to hash.
+ * @return The hash of the structure.
+ */
+static uint32_t OpenGLHashFont(const LOGFONTA *logFont) {
+    const uint8_t *bytes = (const uint8_t *)logFont;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(LOGFONTA); ++i) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Helper function to rasterize every printable ASCII character of a font into a glyph atlas texture.
+ * Characters are laid out in rows, left to right, in a texture whose sides are powers of two,
+ * as OpenGL 1.1 requires. The glyphs are drawn white on black by GDI into a bitmap in memory,
+ * and the brightness of each pixel becomes the alpha of the texture.
+ * @param context Pointer to the OpenGLContext structure.
+ * @param font The GDI font to rasterize.
+ * @param entry Pointer to the font entry receiving the texture and glyph metrics.
+ * @return true on success, false otherwise.
+ */
+static bool OpenGLBuildFontAtlas(OpenGLContext *context, HFONT font, OpenGLFontEntry *entry) {
+    // We draw into a memory device context compatible with the window's,
+    // so that nothing we do here ever shows up on screen.
+    HDC memoryDC = CreateCompatibleDC(context->deviceContext);
+    if (memoryDC == NULL) {
+        return false;
+    }
+
+    HFONT oldFont = (HFONT)SelectObject(memoryDC, font);
+
+    // The text metrics tell us how tall every character cell is,
+    // and how far down in it the baseline sits.
+    TEXTMETRICA metrics;
+    if (!GetTextMetricsA(memoryDC, &metrics)) {
+        SelectObject(memoryDC, oldFont);
+        DeleteDC(memoryDC);
+        return false;
+    }
+
+    int padding = OPENGL_FONT_GLYPH_PADDING;
+    int cellHeight = (int)metrics.tmHeight + padding * 2;
+
+    // Measure every character, and find the smallest square-ish atlas they all fit in.
+    int advances[OPENGL_FONT_CHAR_COUNT];
+    for (int i = 0; i < OPENGL_FONT_CHAR_COUNT; ++i) {
+        char character = (char)(OPENGL_FONT_FIRST_CHAR + i);
+        SIZE size;
+        advances[i] = GetTextExtentPoint32A(memoryDC, &character, 1, &size) ? (int)size.cx : 0;
+    }
+
+    int atlasWidth = 64;
+    int atlasHeight = 0;
+    while (atlasWidth <= OPENGL_FONT_MAX_ATLAS_SIZE) {
+        int penX = 0;
+        int rowCount = 1;
+        bool fits = true;
+        for (int i = 0; i < OPENGL_FONT_CHAR_COUNT; ++i) {
+            int cellWidth = advances[i] + padding * 2;
+            if (cellWidth > atlasWidth) {
+                fits = false;
+                break;
+            }
+            if (penX + cellWidth > atlasWidth) {
+                penX = 0;
+                rowCount++;
+            }
+            penX += cellWidth;
+        }
+
+        // Round the height up to a power of two as well.
+        atlasHeight = 1;
+        while (atlasHeight < rowCount * cellHeight) {
+            atlasHeight *= 2;
+        }
+
+        if (fits && atlasHeight <= atlasWidth) {
+            break;
+        }
+        atlasWidth *= 2;
+    }
+
+    if (atlasWidth > OPENGL_FONT_MAX_ATLAS_SIZE) {
+        SelectObject(memoryDC, oldFont);
+        DeleteDC(memoryDC);
+        return false;
+    }
+
+    // A DIB section is a bitmap whose pixels we can read directly once GDI has drawn into it.
+    // A negative height makes it top-down, so rows are in the same order as our texture rows.
+    BITMAPINFO bitmapInfo;
+    ZeroMemory(&bitmapInfo, sizeof(bitmapInfo));
+    bitmapInfo.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bitmapInfo.bmiHeader.biWidth = atlasWidth;
+    bitmapInfo.bmiHeader.biHeight = -atlasHeight;
+    bitmapInfo.bmiHeader.biPlanes = 1;
+    bitmapInfo.bmiHeader.biBitCount = 32;
+    bitmapInfo.bmiHeader.biCompression = BI_RGB;
+
+    void *bits = NULL;
+    HBITMAP bitmap = CreateDIBSection(memoryDC, &bitmapInfo, DIB_RGB_COLORS, &bits, NULL, 0);
+    uint8_t *alpha = (uint8_t *)malloc((size_t)atlasWidth * (size_t)atlasHeight);
+    if (bitmap == NULL || bits == NULL || alpha == NULL) {
+        if (bitmap != NULL) {
+            DeleteObject(bitmap);
+        }
+        free(alpha);
+        SelectObject(memoryDC, oldFont);
+        DeleteDC(memoryDC);
+        return false;
+    }
+
+    HBITMAP oldBitmap = (HBITMAP)SelectObject(memoryDC, bitmap);
+    memset(bits, 0, (size_t)atlasWidth * (size_t)atlasHeight * 4);
+    SetTextColor(memoryDC, RGB(255, 255, 255));
+    SetBkMode(memoryDC, TRANSPARENT);
+
+    // Draw every character into its cell, and remember where that cell is.
+    int penX = 0;
+    int penY = 0;
+    for (int i = 0; i < OPENGL_FONT_CHAR_COUNT; ++i) {
+        char character = (char)(OPENGL_FONT_FIRST_CHAR + i);
+        int cellWidth = advances[i] + padding * 2;
+        if (penX + cellWidth > atlasWidth) {
+            penX = 0;
+            penY += cellHeight;
+        }
+
+        TextOutA(memoryDC, penX + padding, penY + padding, &character, 1);
+
+        OpenGLGlyph *glyph = &entry->glyphs[i];
+        glyph->width = (float)cellWidth;
+        glyph->height = (float)cellHeight;
+        glyph->advance = (float)advances[i];
+        glyph->u0 = (float)penX / (float)atlasWidth;
+        glyph->v0 = (float)penY / (float)atlasHeight;
+        glyph->u1 = (float)(penX + cellWidth) / (float)atlasWidth;
+        glyph->v1 = (float)(penY + cellHeight) / (float)atlasHeight;
+
+        penX += cellWidth;
+    }
+
+    // Make sure GDI has actually finished drawing before we read the pixels.
+    GdiFlush();
+
+    // The text was drawn in white, so any one of the color channels holds the coverage.
+    // Anti-aliasing gives the edges in-between values, which become partial alpha.
+    const uint8_t *pixels = (const uint8_t *)bits;
+    for (size_t p = 0; p < (size_t)atlasWidth * (size_t)atlasHeight; ++p) {
+        const uint8_t *pixel = &pixels[p * 4];
+        alpha[p] = (uint8_t)(((unsigned int)pixel[0] + pixel[1] + pixel[2]) / 3u);
+    }
+
+    SelectObject(memoryDC, oldBitmap);
+    DeleteObject(bitmap);
+    SelectObject(memoryDC, oldFont);
+    DeleteDC(memoryDC);
+
+    // Upload the coverage as an alpha-only texture.
+    // Nearest filtering keeps the text as crisp as the old bitmap fonts,
+    // since glyphs are always drawn at exactly their rasterized size.
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    if (texture == 0) {
+        free(alpha);
+        return false;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, atlasWidth, atlasHeight, 0, GL_ALPHA, GL_UNSIGNED_BYTE, alpha);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    free(alpha);
+
+    entry->texture = texture;
+    entry->atlasWidth = atlasWidth;
+    entry->atlasHeight = atlasHeight;
+    entry->ascent = (float)metrics.tmAscent;
+    return true;
+}
+
+/**
+ * Acquires an OpenGL glyph atlas for the specified font properties.
+ * If a matching font already exists in the context, it is found through a hash of its properties
+ * and returned straight away. Otherwise, a new font is created, every printable ASCII character
+ * is rasterized once into a single texture, and the new entry is returned.
  * Fails if the maximum number of font entries has been reached, or if there is some other error.
  * See https://learn.microsoft.com/en-us/windows/win32/api/wingdi/ns-wingdi-logfonta for
  * details on the LOGFONTA structure and its fields.
@@ -263,6 +457,9 @@ static bool OpenGLFontsEqual(const LOGFONTA *lhs, const LOGFONTA *rhs) {
  * Furthermore, it is limited to a small character set, 
  * so Extended or Unicode characters are often out of the question. 
  * 
+ * Since every glyph is a quad sampling the same texture, any amount of text in
+ * one font can be drawn with a single draw call through the render batch.
+ * 
  * @param context Pointer to the OpenGLContext structure.
  * @param height Height of the font.
  * @param width Width of the font.
@@ -278,15 +475,15 @@ static bool OpenGLFontsEqual(const LOGFONTA *lhs, const LOGFONTA *rhs) {
  * @param quality Output quality.
  * @param pitchAndFamily Family and pitch of the font.
  * @param faceName Typeface name.
- * @return The base display list ID for the acquired font, or 0 on failure.
+ * @return A pointer to the font entry holding the glyph atlas, or NULL on failure.
  */
-GLuint OpenGLAcquireFont(OpenGLContext *context, uint32_t height, uint32_t width, uint32_t escapement, uint32_t orientation,
+const OpenGLFontEntry *OpenGLAcquireFont(OpenGLContext *context, uint32_t height, uint32_t width, uint32_t escapement, uint32_t orientation,
     uint32_t weight, uint8_t italic, uint8_t underline, uint8_t strikeOut, uint8_t charSet, uint8_t outputPrecision,
     uint8_t clipPrecision, uint8_t quality, uint8_t pitchAndFamily, const char *faceName) {
 
     // Basic validation of input pointers.
     if (context == NULL || context->deviceContext == NULL) {
-        return 0;
+        return NULL;
     }
 
     // Taken from the Windows API documentation for LOGFONTA:
@@ -339,11 +536,17 @@ GLuint OpenGLAcquireFont(OpenGLContext *context, uint32_t height, uint32_t width
     }
 
     // Now we check if a matching font already exists in the context.
-    for (size_t i = 0; i < context->fontEntryCount; ++i) {
-        if (OpenGLFontsEqual(&context->fontEntries[i].logFont, &desiredFont)) {
-            // If such a font exists, return its display list base.
-            return context->fontEntries[i].listBase;
+    // The font index is a hash table, so rather than comparing against every entry,
+    // we only look at the slots starting from where this font's hash lands.
+    uint32_t mask = OPENGL_FONT_INDEX_SIZE - 1;
+    uint32_t slot = OpenGLHashFont(&desiredFont) & mask;
+    while (context->fontIndex[slot] != 0) {
+        OpenGLFontEntry *existing = &context->fontEntries[context->fontIndex[slot] - 1];
+        if (OpenGLFontsEqual(&existing->logFont, &desiredFont)) {
+            // If such a font exists, return it.
+            return existing;
         }
+        slot = (slot + 1) & mask;
     }
 
     // Otherwise, we need to create a new font.
@@ -351,7 +554,7 @@ GLuint OpenGLAcquireFont(OpenGLContext *context, uint32_t height, uint32_t width
     // But to create a new font, we first need to check if we have space
     // in the fontEntries array.
     if (context->fontEntryCount >= OPENGL_MAX_FONT_ENTRIES) {
-        return 0;
+        return NULL;
     }
 
     // Now that we know we have enough space, we can create the font.
@@ -360,69 +563,27 @@ GLuint OpenGLAcquireFont(OpenGLContext *context, uint32_t height, uint32_t width
     // Note that at this point, this is a logical font, not yet associated with any device context.
     HFONT font = CreateFontIndirectA(&desiredFont);
     if (font == NULL) {
-        return 0;
-    }
-
-    // The logical font still needs a few things done to it before we can use it for OpenGL rendering.
-    // Such as...
-
-    // ... generating a set of display lists for the font characters.
-    // This display list base will be returned to the caller.
-    // The values 32 to 127 (96 characters) correspond to the printable ASCII characters.
-    GLuint listBase = glGenLists(96);
-    if (listBase == 0) {
-        DeleteObject(font);
-        return 0;
+        return NULL;
     }
 
-    // The font still needs...
-
-    // ... to be selected into the device context.
-    // This makes the font the current font for the device context,
-    // allowing us to create bitmaps for the font characters, 
-    // bitmaps which... 
-
-    // From https://learn.microsoft.com/en-us/windows/win32/api/wingdi/nf-wingdi-selectobject,
-    // the arguments for SelectObject are:
-    // HDC hdc: Handle to the device context.
-    // HGDIOBJ hgdiobj: Handle to the object to be selected (in this case, the font).
-    // Since we are selecting a new font, SelectObject returns the handle to the previous font,
-    // which we need to save so we can restore it later.
-    
-    HFONT oldFont = (HFONT)SelectObject(context->deviceContext, font);
-
-    // ... wglUseFontBitmapsA creates here. These bitmaps are stored in the generated display lists,
-    // and are used by OpenGL to render text. By taking something like a simple char, or a string,
-    // and calling the appropriate display list, OpenGL can render the corresponding character(s)
-    // for those characters to the screen by utilizing those characters as the index into the display list.
-
-    // From https://learn.microsoft.com/en-us/windows/win32/api/wingdi/nf-wingdi-wglusefontbitmapsa,
-    // the arguments for wglUseFontBitmapsA are:
-    // HDC hdc: Handle to the device context.
-    // DWORD first: The first character to create a bitmap for (32 = space character).
-    // DWORD count: The number of characters to create bitmaps for (96 = characters 32 to 127).
-    // DWORD listBase: The starting index of the display lists to store the bitmaps in.
-    if (!wglUseFontBitmapsA(context->deviceContext, 32, 96, listBase)) {
-        glDeleteLists(listBase, 96);
-        listBase = 0;
-    }
+    // The logical font then gets every one of its characters rasterized into a glyph atlas.
+    // We do this once here, and from then on drawing text is just drawing textured quads.
+    OpenGLFontEntry *entry = &context->fontEntries[context->fontEntryCount];
+    ZeroMemory(entry, sizeof(*entry));
+    bool built = OpenGLBuildFontAtlas(context, font, entry);
 
-    // Now that we have created the font bitmaps, we can restore the previous font
-    // in the device context, and delete the logical font object, as it is no longer needed.
-    SelectObject(context->deviceContext, oldFont);
+    // The logical font object is no longer needed either way.
     DeleteObject(font);
 
-    // If something went wrong during wglUseFontBitmapsA, we clean up and return 0.
-    if (listBase == 0) {
-        return 0;
+    if (!built) {
+        return NULL;
     }
 
-    // Finally, we store the new font entry in the context's fontEntries array.
-    context->fontEntries[context->fontEntryCount].logFont = desiredFont;
-    context->fontEntries[context->fontEntryCount].listBase = listBase;
-
-    // And increment the font entry count.
+    // Finally, we store the new font entry in the context's fontEntries array,
+    // and record it in the slot we found empty in the font index.
+    entry->logFont = desiredFont;
     context->fontEntryCount++;
+    context->fontIndex[slot] = (uint8_t)context->fontEntryCount;
 
-    return listBase;
+    return entry;
 }
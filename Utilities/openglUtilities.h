@@ -14,19 +14,53 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
+// The first character and number of characters rasterized for each font.
+// The values 32 to 127 (96 characters) correspond to the printable ASCII characters.
+#define OPENGL_FONT_FIRST_CHAR 32
+#define OPENGL_FONT_CHAR_COUNT 96
+
+// Empty pixels left around every glyph in a font atlas,
+// so that neighbouring glyphs never bleed into each other.
+#define OPENGL_FONT_GLYPH_PADDING 1
+
+// Largest width and height, in pixels, of a single font atlas texture.
+// Even a 64 pixel tall font fits all of its glyphs into a 1024 by 1024 texture.
+#define OPENGL_FONT_MAX_ATLAS_SIZE 2048
+
+// Where a single character lives within its font's atlas, and how to place it.
+// width and height are the size of the glyph's cell in pixels, padding included.
+// The cell's top-left corner goes at (pen x - padding, baseline - ascent - padding),
+// after which the pen moves right by advance pixels.
+// u0, v0, u1 and v1 are the cell's texture coordinates within the atlas.
+typedef struct OpenGLGlyph {
+    float width;
+    float height;
+    float advance;
+    float u0;
+    float v0;
+    float u1;
+    float v1;
+} OpenGLGlyph;
+
 // Structure to hold OpenGL font entry information.
-// We keep track of the LOGFONT used to create the font
-// and the base display list ID for rendering characters.
+// We keep track of the LOGFONT used to create the font,
+// and the glyph atlas it was rasterized into.
 // The LOGFONTA structure defines the attributes of a font,
 // such as height, width, weight, italicization, and typeface name
 // among other properties.
-/// The listBase is the starting index of a contiguous block of OpenGL display lists
-/// that represent the glyphs for this font.
+// The atlas is a single texture holding every character of the font side by side,
+// so that any amount of text in this font can be drawn from one texture.
+// ascent is the distance in pixels from the top of a character cell down to the baseline.
 typedef struct OpenGLFontEntry {
     LOGFONTA logFont;
-    GLuint listBase;
+    GLuint texture;
+    int atlasWidth;
+    int atlasHeight;
+    float ascent;
+    OpenGLGlyph glyphs[OPENGL_FONT_CHAR_COUNT];
 } OpenGLFontEntry;
 
 // Maximum number of font entries we can store in the OpenGL context.
@@ -38,12 +72,19 @@ typedef struct OpenGLFontEntry {
 // the number of fonts is only limited by available memory.
 #define OPENGL_MAX_FONT_ENTRIES 64
 
+// Number of slots in the hash index used to find font entries.
+// Kept at twice the maximum number of entries and a power of two,
+// so lookups stay short and the slot can be found with a mask.
+#define OPENGL_FONT_INDEX_SIZE 128
+
 // Structure to hold OpenGL context information for a window.
 // We need to keep track of the device context and rendering context,
 // as well as any shared resources like font display lists.
 // This structure also has the current width and height of the rendering area.
 // The fontEntryCount keeps track of how many font entries are currently stored
 // in the fontEntries array.
+// fontIndex is an open addressing hash table over the font entries, keyed by their LOGFONT,
+// holding the index of an entry plus one, or 0 for an empty slot.
 typedef struct OpenGLContext {
     HDC deviceContext;
     HGLRC renderContext;
@@ -51,6 +92,7 @@ typedef struct OpenGLContext {
     int height;
     size_t fontEntryCount;
     OpenGLFontEntry fontEntries[OPENGL_MAX_FONT_ENTRIES];
+    uint8_t fontIndex[OPENGL_FONT_INDEX_SIZE];
 } OpenGLContext;
 
 /**
@@ -79,9 +121,10 @@ void OpenGLShutdownForWindow(OpenGLContext *context, HWND windowHandle);
 void OpenGLUpdateProjection(OpenGLContext *context, int width, int height);
 
 /**
- * Acquires an OpenGL font display list for the specified font properties.
- * If a matching font already exists in the context, its display list base is returned.
- * Otherwise, a new font is created and its display list base is returned.
+ * Acquires an OpenGL glyph atlas for the specified font properties.
+ * If a matching font already exists in the context, it is found through a hash of its properties
+ * and returned straight away. Otherwise, a new font is created, every printable ASCII character
+ * is rasterized once into a single texture, and the new entry is returned.
  * Fails if the maximum number of font entries has been reached, or if there is some other error.
  * See https://learn.microsoft.com/en-us/windows/win32/api/wingdi/ns-wingdi-logfonta for
  * details on the LOGFONTA structure and its fields.
@@ -97,6 +140,9 @@ void OpenGLUpdateProjection(OpenGLContext *context, int width, int height);
  * Furthermore, it is limited to a small character set, 
  * so Extended or Unicode characters are often out of the question. 
  * 
+ * Since every glyph is a quad sampling the same texture, any amount of text in
+ * one font can be drawn with a single draw call through the render batch.
+ * 
  * @param context Pointer to the OpenGLContext structure.
  * @param height Height of the font.
  * @param width Width of the font.
@@ -112,9 +158,9 @@ void OpenGLUpdateProjection(OpenGLContext *context, int width, int height);
  * @param quality Output quality.
  * @param pitchAndFamily Family and pitch of the font.
  * @param faceName Typeface name.
- * @return The base display list ID for the acquired font, or 0 on failure.
+ * @return A pointer to the font entry holding the glyph atlas, or NULL on failure.
  */
-GLuint OpenGLAcquireFont(OpenGLContext *context, uint32_t height, uint32_t width, uint32_t escapement, uint32_t orientation,
+const OpenGLFontEntry *OpenGLAcquireFont(OpenGLContext *context, uint32_t height, uint32_t width, uint32_t escapement, uint32_t orientation,
     uint32_t weight, uint8_t italic, uint8_t underline, uint8_t strikeOut, uint8_t charSet, uint8_t outputPrecision,
     uint8_t clipPrecision, uint8_t quality, uint8_t pitchAndFamily, const char *faceName);
 
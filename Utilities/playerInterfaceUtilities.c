@@ -50,16 +50,14 @@ bool PlayerSelectionReset(PlayerSelectionState *state, size_t planetCount) {
     // If planetCount is zero, simply set fields to zero and return,
     // as there are no planets to select and thus no buffer is needed.
     if (planetCount == 0) {
-        state->selectedPlanets = NULL;
         state->capacity = 0;
         state->count = 0;
         return true;
     }
    
-    // Otherwise, allocate a new selection buffer, appropriately sized
+    // Otherwise, allocate a new selection bitset, appropriately sized
     // to be able to hold up to planetCount selections.
-    state->selectedPlanets = (bool *)calloc(planetCount, sizeof(bool));
-    if (state->selectedPlanets == NULL) {
+    if (!BitsetResize(&state->selectedPlanets, planetCount)) {
         state->capacity = 0;
         state->count = 0;
         printf("Failed to allocate selection buffer.\n");
@@ -85,13 +83,13 @@ void PlayerSelectionClear(PlayerSelectionState *state) {
     }
 
     // If there is no selection buffer, nothing to clear.
-    if (state->selectedPlanets == NULL || state->capacity == 0) {
+    if (state->selectedPlanets.words == NULL || state->capacity == 0) {
         state->count = 0;
         return;
     }
 
-    // Otherwise, clear all selections by simply setting all booleans to false (0).
-    memset(state->selectedPlanets, 0, state->capacity * sizeof(bool));
+    // Otherwise, clear all selections by simply clearing every bit, 64 planets at a time.
+    BitsetClearAll(&state->selectedPlanets);
 
     // Reset the count of selected planets to zero.
     state->count = 0;
@@ -108,7 +106,7 @@ void PlayerSelectionClear(PlayerSelectionState *state) {
  */
 bool PlayerSelectionToggle(PlayerSelectionState *state, size_t index, bool additive) {
     // Basic validation of input parameters.
-    if (state == NULL || state->selectedPlanets == NULL || index >= state->capacity) {
+    if (state == NULL || state->selectedPlanets.words == NULL || index >= state->capacity) {
         return false;
     }
 
@@ -117,7 +115,7 @@ bool PlayerSelectionToggle(PlayerSelectionState *state, size_t index, bool addit
     if (!additive) {
         // In the special case where the planet is already the only selected one,
         // we can simply clear the selection and return early.
-        if (state->selectedPlanets[index] && state->count == 1) {
+        if (BitsetTest(&state->selectedPlanets, index) && state->count == 1) {
             PlayerSelectionClear(state);
             return true;
         }
@@ -126,13 +124,13 @@ bool PlayerSelectionToggle(PlayerSelectionState *state, size_t index, bool addit
 
     // Toggle the selection state of the specified planet,
     // and update the count of selected planets accordingly.
-    if (state->selectedPlanets[index]) {
-        state->selectedPlanets[index] = false;
+    if (BitsetTest(&state->selectedPlanets, index)) {
+        BitsetAssign(&state->selectedPlanets, index, false);
         if (state->count > 0) {
             state->count -= 1;
         }
     } else {
-        state->selectedPlanets[index] = true;
+        BitsetAssign(&state->selectedPlanets, index, true);
         state->count += 1;
     }
 
@@ -151,8 +149,7 @@ void PlayerSelectionFree(PlayerSelectionState *state) {
 
     // Free the selection buffer if it exists,
     // and reset all fields to zero/null.
-    free(state->selectedPlanets);
-    state->selectedPlanets = NULL;
+    BitsetFree(&state->selectedPlanets);
     state->capacity = 0;
     state->count = 0;
 }
@@ -166,12 +163,12 @@ void PlayerSelectionFree(PlayerSelectionState *state) {
  */
 bool PlayerSelectionSet(PlayerSelectionState *state, size_t index, bool selected) {
     // Basic validation of input parameters.
-    if (state == NULL || state->selectedPlanets == NULL || index >= state->capacity) {
+    if (state == NULL || state->selectedPlanets.words == NULL || index >= state->capacity) {
         return false;
     }
 
     // If the planet is already in the desired state, nothing to do.
-    bool current = state->selectedPlanets[index];
+    bool current = BitsetTest(&state->selectedPlanets, index);
     if (current == selected) {
         return true;
     }
@@ -179,7 +176,7 @@ bool PlayerSelectionSet(PlayerSelectionState *state, size_t index, bool selected
     // Otherwise, set the selection state and 
     // increment/decrement the count of selected planets
     // accordingly.
-    state->selectedPlanets[index] = selected;
+    BitsetAssign(&state->selectedPlanets, index, selected);
     if (selected) {
         state->count += 1;
     } else if (state->count > 0) {
@@ -207,7 +204,7 @@ bool PlayerSelectionSelectOwned(PlayerSelectionState *state,
     }
 
     // If there is no selection buffer, nothing can be selected.
-    if (state->selectedPlanets == NULL || state->capacity == 0) {
+    if (state->selectedPlanets.words == NULL || state->capacity == 0) {
         return false;
     }
 
@@ -225,13 +222,24 @@ bool PlayerSelectionSelectOwned(PlayerSelectionState *state,
     // Limit the iteration to the smaller of the level's planet count
     // or the selection state's capacity to avoid out-of-bounds access.
     size_t limit = level->planetCount < state->capacity ? level->planetCount : state->capacity;
-    for (size_t i = 0; i < limit; ++i) {
-        if (PlayerCanControlPlanet(owner, &level->planets[i])) {
-            PlayerSelectionSet(state, i, true);
-            processed += 1;
+
+    // Ownership has to be checked planet by planet, but the results are gathered
+    // into a whole word of the selection at a time and merged in with a single OR.
+    for (size_t wordStart = 0; wordStart < limit; wordStart += BITSET_WORD_BITS) {
+        size_t wordEnd = wordStart + BITSET_WORD_BITS < limit ? wordStart + BITSET_WORD_BITS : limit;
+        uint64_t mask = 0ull;
+        for (size_t i = wordStart; i < wordEnd; ++i) {
+            if (PlayerCanControlPlanet(owner, &level->planets[i])) {
+                mask |= 1ull << (i - wordStart);
+                processed += 1;
+            }
         }
+        state->selectedPlanets.words[wordStart / BITSET_WORD_BITS] |= mask;
     }
 
+    // Some of those planets may have been selected already, so the count is taken afresh.
+    state->count = BitsetPopCount(&state->selectedPlanets);
+
     // Return true if at least one owned planet was processed.
     return processed > 0;
 }
@@ -249,54 +257,20 @@ bool PlayerControlGroupsReset(PlayerControlGroups *groups, size_t planetCount) {
         return false;
     }
 
-    // If planetCount is zero, free all existing buffers and set capacity to zero.
-    if (planetCount == 0) {
-        for (size_t i = 0; i < PLAYER_MAX_CONTROL_GROUPS; ++i) {
-            free(groups->groups[i]);
-            groups->groups[i] = NULL;
-        }
-        groups->capacity = 0;
-        return true;
-    }
-
-    // Otherwise, if the capacity is changing, reallocate all buffers.
-    if (groups->capacity != planetCount) {
-
-        // For each control group, free any existing buffer.
-        for (size_t i = 0; i < PLAYER_MAX_CONTROL_GROUPS; ++i) {
-            free(groups->groups[i]);
-            groups->groups[i] = NULL;
-        }
-
-        // For each control group, allocate a new buffer
-        // sized to hold planetCount booleans.
-        for (size_t i = 0; i < PLAYER_MAX_CONTROL_GROUPS; ++i) {
-            groups->groups[i] = (bool *)calloc(planetCount, sizeof(bool));
-
-            // If any allocation fails, free all previously allocated buffers
-            // and set capacity to zero before returning failure.
-            if (groups->groups[i] == NULL) {
-                printf("Failed to allocate control group buffer :(.\n");
-                for (size_t j = 0; j <= i; ++j) {
-                    free(groups->groups[j]);
-                    groups->groups[j] = NULL;
-                }
-                groups->capacity = 0;
-                return false;
-            }
-        }
-
-        // Mark the control groups as being able to track planetCount planets.
-        groups->capacity = planetCount;
-        return true;
-    }
-
-    // If the capacity is unchanged, simply clear all existing buffers.
+    // Resize each control group's bitset to hold planetCount planets, which also clears it.
+    // A planetCount of zero simply frees all existing bitsets.
     for (size_t i = 0; i < PLAYER_MAX_CONTROL_GROUPS; ++i) {
-        if (groups->groups[i] != NULL) {
-            memset(groups->groups[i], 0, planetCount * sizeof(bool));
+        // If any allocation fails, free all the bitsets
+        // and set capacity to zero before returning failure.
+        if (!BitsetResize(&groups->groups[i], planetCount)) {
+            printf("Failed to allocate control group buffer :(.\n");
+            PlayerControlGroupsFree(groups);
+            return false;
         }
     }
+
+    // Mark the control groups as being able to track planetCount planets.
+    groups->capacity = planetCount;
     return true;
 }
 
@@ -312,8 +286,7 @@ void PlayerControlGroupsFree(PlayerControlGroups *groups) {
 
     // Free each control group buffer if it exists,
     for (size_t i = 0; i < PLAYER_MAX_CONTROL_GROUPS; ++i) {
-        free(groups->groups[i]);
-        groups->groups[i] = NULL;
+        BitsetFree(&groups->groups[i]);
     }
 
     // Reset capacity to zero.
@@ -337,26 +310,13 @@ bool PlayerControlGroupsOverwrite(PlayerControlGroups *groups,
     }
 
     // If the control group buffer does not exist, cannot overwrite.
-    if (groups->capacity == 0 || groups->groups[groupIndex] == NULL) {
+    if (groups->capacity == 0 || groups->groups[groupIndex].words == NULL) {
         return false;
     }
 
-    // Clear the existing control group selection by setting all booleans to false (0).
-    memset(groups->groups[groupIndex], 0, groups->capacity * sizeof(bool));
-
-    // If there is no selection buffer, nothing to add.
-    // So the control group is now empty.
-    if (selection->selectedPlanets == NULL || selection->capacity == 0) {
-        return true;
-    }
-
-    // Iterate through the selection and copy selected planets into the control group.
-    size_t limit = selection->capacity < groups->capacity ? selection->capacity : groups->capacity;
-    for (size_t i = 0; i < limit; ++i) {
-        if (selection->selectedPlanets[i]) {
-            groups->groups[groupIndex][i] = true;
-        }
-    }
+    // Copy the selection into the control group a whole word at a time.
+    // If there is no selection buffer, the control group is simply left empty.
+    BitsetCopy(&groups->groups[groupIndex], &selection->selectedPlanets);
     return true;
 }
 
@@ -377,25 +337,17 @@ bool PlayerControlGroupsAdd(PlayerControlGroups *groups,
     }
 
     // If the control group buffer does not exist, cannot add to it.
-    if (groups->capacity == 0 || groups->groups[groupIndex] == NULL) {
+    if (groups->capacity == 0 || groups->groups[groupIndex].words == NULL) {
         return false;
     }
 
     // If there is no selection buffer, nothing to add.
-    if (selection->selectedPlanets == NULL || selection->capacity == 0) {
+    if (selection->selectedPlanets.words == NULL || selection->capacity == 0) {
         return true;
     }
 
-    // Iterate through the selection and copy selected planets into the control group.
-    // A more efficient approach might find some way to efficiently extract out only planets
-    // not already in the control group, and then iterate over only those, but this function
-    // is hardly going to be a performance bottleneck in practice even with this simple approach.
-    size_t limit = selection->capacity < groups->capacity ? selection->capacity : groups->capacity;
-    for (size_t i = 0; i < limit; ++i) {
-        if (selection->selectedPlanets[i]) {
-            groups->groups[groupIndex][i] = true;
-        }
-    }
+    // The control group becomes the union of itself and the selection, 64 planets per OR.
+    BitsetUnion(&groups->groups[groupIndex], &selection->selectedPlanets);
     return true;
 }
 
@@ -427,11 +379,11 @@ bool PlayerControlGroupsApply(const PlayerControlGroups *groups,
         return false;
     }
 
-    if (groups->capacity == 0 || groups->groups[groupIndex] == NULL) {
+    if (groups->capacity == 0 || groups->groups[groupIndex].words == NULL) {
         return false;
     }
 
-    if (selection->selectedPlanets == NULL || selection->capacity == 0) {
+    if (selection->selectedPlanets.words == NULL || selection->capacity == 0) {
         return false;
     }
 
@@ -440,13 +392,13 @@ bool PlayerControlGroupsApply(const PlayerControlGroups *groups,
         PlayerSelectionClear(selection);
     }
 
-    // Iterate through the specified control group and add owned planets to the selection.
+    // Iterate through only the planets in the specified control group,
+    // skipping past empty stretches of the group a word at a time,
+    // and add the ones we can control to the selection.
+    const Bitset *group = &groups->groups[groupIndex];
     size_t limit = level->planetCount < groups->capacity ? level->planetCount : groups->capacity;
     size_t selectedCount = 0;
-    for (size_t i = 0; i < limit; ++i) {
-        if (!groups->groups[groupIndex][i]) {
-            continue;
-        }
+    for (size_t i = BitsetNextSet(group, 0); i < limit; i = BitsetNextSet(group, i + 1)) {
         if (!PlayerCanControlPlanet(owner, &level->planets[i])) {
             continue;
         }
@@ -484,7 +436,7 @@ bool PlayerSendMoveOrder(const PlayerSelectionState *state,
     }
 
     // Ensure there are selected planets to send a move order for.
-    if (state->selectedPlanets == NULL || state->capacity == 0) {
+    if (state->selectedPlanets.words == NULL || state->capacity == 0) {
         return false;
     }
 
@@ -505,21 +457,20 @@ bool PlayerSendMoveOrder(const PlayerSelectionState *state,
     // Populate the origin planet indices from the selection state.
     int32_t *indices = packet->originPlanetIndices;
 
-    // We iterate through the selection state and collect the indices
-    // of the selected planets into the packet, also keeping track of how many we write
+    // We iterate through the set bits of the selection and write their indices
+    // straight into the packet, also keeping track of how many we write
     // so we can set the originCount field correctly.
+    const Bitset *selected = &state->selectedPlanets;
     size_t writeIndex = 0;
-    for (size_t i = 0; i < state->capacity; ++i) {
-        if (state->selectedPlanets[i]) {
-            // if we somehow exceed the expected origin count,
-            // we abort to avoid buffer overflows.
-            if (writeIndex >= originCount) {
-                free(packet);
-                printf("Selection state mismatch detected.\n");
-                return false;
-            }
-            indices[writeIndex++] = (int32_t)i;
+    for (size_t i = BitsetNextSet(selected, 0); i < state->capacity; i = BitsetNextSet(selected, i + 1)) {
+        // if we somehow exceed the expected origin count,
+        // we abort to avoid buffer overflows.
+        if (writeIndex >= originCount) {
+            free(packet);
+            printf("Selection state mismatch detected.\n");
+            return false;
         }
+        indices[writeIndex++] = (int32_t)i;
     }
 
     // Set the actual origin count in the packet header.
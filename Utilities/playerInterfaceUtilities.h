@@ -16,12 +16,13 @@
 #include <stdio.h>
 
 #include "Objects/level.h"
+#include "Utilities/bitsetUtilities.h"
 
 // Structure to hold the player's current selection state.
-// Contains a dynamic array of booleans indicating selected planets,
+// Contains a bitset of the selected planets' indices,
 // as well as capacity and count of selected planets, which helps manage the selection.
 typedef struct PlayerSelectionState {
-    bool *selectedPlanets;
+    Bitset selectedPlanets;
     size_t capacity;
     size_t count;
 } PlayerSelectionState;
@@ -31,10 +32,10 @@ typedef struct PlayerSelectionState {
 #define PLAYER_MAX_CONTROL_GROUPS 10
 
 // Structure to hold the player's control groups.
-// Each control group is a dynamic array of booleans indicating selected planets.
+// Each control group is a bitset of the indices of the planets in it.
 // The capacity indicates how many planets can be tracked by each control group.
 typedef struct PlayerControlGroups {
-    bool *groups[PLAYER_MAX_CONTROL_GROUPS];
+    Bitset groups[PLAYER_MAX_CONTROL_GROUPS];
     size_t capacity;
 } PlayerControlGroups;
 
@@ -0,0 +1,139 @@
+/**
+ * Implementation of the profiler overlay utilities.
+ * Both executables toggle the overlay with F3 and draw it over everything else.
+ * @file Utilities/profilerOverlayUtilities.c
+ * @author abmize
+ */
+#include "Utilities/profilerOverlayUtilities.h"
+
+// Color of each zone in the graph and legend, in the order of the ProfilerZone enum.
+static const float zoneColors[PROFILER_ZONE_COUNT][4] = {
+    {0.95f, 0.60f, 0.20f, 0.90f}, // Network
+    {0.90f, 0.30f, 0.30f, 0.90f}, // Level Update
+    {0.85f, 0.35f, 0.75f, 0.90f}, // AI
+    {0.95f, 0.85f, 0.30f, 0.90f}, // Snapshot
+    {0.30f, 0.75f, 0.95f, 0.90f}, // Planets
+    {0.40f, 0.90f, 0.60f, 0.90f}, // Trails
+    {0.25f, 0.55f, 0.95f, 0.90f}, // Ships
+    {0.60f, 0.60f, 0.95f, 0.90f}, // Submit
+    {0.85f, 0.85f, 0.85f, 0.90f}, // UI
+    {0.50f, 0.50f, 0.50f, 0.90f}  // Swap Buffers
+};
+
+/**
+ * Helper function to add a solid rectangle to the render batch as two triangles.
+ * @param x1 The x-coordinate of one corner of the rectangle.
+ * @param y1 The y-coordinate of one corner of the rectangle.
+ * @param x2 The x-coordinate of the opposite corner of the rectangle.
+ * @param y2 The y-coordinate of the opposite corner of the rectangle.
+ * @param color The RGBA color of the rectangle.
+ */
+static void AddRectangle(float x1, float y1, float x2, float y2, const float color[4]) {
+    RenderBatchVertex *vertices = RenderBatchReserve(RENDER_BATCH_PRIMITIVE_TRIANGLES, 6);
+    if (vertices == NULL) {
+        return;
+    }
+
+    const float corners[6][2] = {{x1, y1}, {x2, y1}, {x2, y2}, {x1, y1}, {x2, y2}, {x1, y2}};
+    for (size_t i = 0; i < 6; ++i) {
+        vertices[i].x = corners[i][0];
+        vertices[i].y = corners[i][1];
+        vertices[i].color[0] = color[0];
+        vertices[i].color[1] = color[1];
+        vertices[i].color[2] = color[2];
+        vertices[i].color[3] = color[3];
+    }
+}
+
+/**
+ * Draws the profiler overlay with its top left corner at the given screen coordinates.
+ * Draws through the render batch in screen space, so the modelview matrix must be the identity.
+ * @param context The OpenGL context, used for drawing text.
+ * @param x The x-coordinate of the overlay's left edge.
+ * @param y The y-coordinate of the overlay's top edge.
+ */
+void ProfilerDrawOverlay(OpenGLContext *context, float x, float y) {
+    if (context == NULL) {
+        return;
+    }
+
+    // Kept static as the history is rather large to put on the stack every frame.
+    static ProfilerFrameTimings frames[PROFILER_FRAME_HISTORY];
+    size_t frameCount = ProfilerCopyFrames(frames, PROFILER_FRAME_HISTORY);
+    ProfilerFrameStatistics statistics;
+    bool haveStatistics = ProfilerComputeFrameStatistics(&statistics);
+
+    // A translucent panel behind everything, so the overlay stays readable over the game.
+    float panelColor[4] = {0.05f, 0.05f, 0.08f, 0.75f};
+    float outlineColor[4] = {1.0f, 1.0f, 1.0f, 0.35f};
+    DrawOutlinedRectangle(x, y, x + PROFILER_OVERLAY_WIDTH, y + PROFILER_OVERLAY_HEIGHT, outlineColor, panelColor);
+
+    // The graph sits along the top of the panel, with the newest frame on the right.
+    float graphLeft = x + 8.0f;
+    float graphRight = x + PROFILER_OVERLAY_WIDTH - 8.0f;
+    float graphBottom = y + 8.0f + PROFILER_OVERLAY_GRAPH_HEIGHT;
+    float barWidth = (graphRight - graphLeft) / (float)PROFILER_FRAME_HISTORY;
+    float pixelsPerMillisecond = PROFILER_OVERLAY_GRAPH_HEIGHT / PROFILER_OVERLAY_GRAPH_MILLISECONDS;
+
+    RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ALPHA);
+    for (size_t i = 0; i < frameCount; ++i) {
+        const ProfilerFrameTimings *frame = &frames[i];
+        float barLeft = graphRight - (float)(frameCount - i) * barWidth;
+        float barRight = barLeft + barWidth;
+
+        // The part of the frame no zone accounts for is drawn first, as a faint bar the height of the whole frame,
+        // and the zones are then stacked on top of each other from the bottom up.
+        float frameHeight = fminf(frame->frameMilliseconds * pixelsPerMillisecond, PROFILER_OVERLAY_GRAPH_HEIGHT);
+        float untrackedColor[4] = {1.0f, 1.0f, 1.0f, 0.12f};
+        AddRectangle(barLeft, graphBottom - frameHeight, barRight, graphBottom, untrackedColor);
+
+        float stackBottom = graphBottom;
+        for (size_t zone = 0; zone < PROFILER_ZONE_COUNT; ++zone) {
+            float height = frame->zoneMilliseconds[zone] * pixelsPerMillisecond;
+            if (height <= 0.0f) {
+                continue;
+            }
+
+            // Stop at the top of the graph rather than drawing over the legend.
+            float stackTop = fmaxf(stackBottom - height, graphBottom - PROFILER_OVERLAY_GRAPH_HEIGHT);
+            AddRectangle(barLeft, stackTop, barRight, stackBottom, zoneColors[zone]);
+            stackBottom = stackTop;
+        }
+    }
+
+    // A guide line at the target frame time.
+    float targetY = graphBottom - PROFILER_OVERLAY_TARGET_MILLISECONDS * pixelsPerMillisecond;
+    float targetColor[4] = {1.0f, 1.0f, 1.0f, 0.5f};
+    AddRectangle(graphLeft, targetY, graphRight, targetY + 1.0f, targetColor);
+
+    // Below the graph, the frame percentiles and one legend line per zone.
+    float textColor[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    float textSize = 14.0f;
+    float lineAdvance = textSize + 2.0f;
+    float textY = graphBottom + 22.0f;
+    float legendY = textY + textSize + 4.0f;
+    char line[128];
+
+    // The colored squares of the legend go in before any text, since switching between
+    // plain and textured geometry means another draw call each time.
+    for (size_t zone = 0; zone < PROFILER_ZONE_COUNT; ++zone) {
+        float swatchY = legendY + (float)zone * lineAdvance;
+        AddRectangle(x + 8.0f, swatchY - 10.0f, x + 18.0f, swatchY, zoneColors[zone]);
+    }
+
+    if (haveStatistics) {
+        snprintf(line, sizeof(line), "Frame  p50 %6.2f ms  p99 %6.2f ms  (%zu frames)",
+            statistics.frameP50, statistics.frameP99, statistics.frameCount);
+    } else {
+        snprintf(line, sizeof(line), "Frame  no frames recorded yet");
+    }
+    DrawScreenText(context, line, x + 8.0f, textY, textSize, textSize / 2, textColor);
+
+    for (size_t zone = 0; zone < PROFILER_ZONE_COUNT; ++zone) {
+        snprintf(line, sizeof(line), "%-12s p50 %6.2f ms  p99 %6.2f ms",
+            ProfilerGetZoneName((ProfilerZone)zone),
+            haveStatistics ? statistics.zoneP50[zone] : 0.0f,
+            haveStatistics ? statistics.zoneP99[zone] : 0.0f);
+        DrawScreenText(context, line, x + 24.0f, legendY + (float)zone * lineAdvance, textSize, textSize / 2, textColor);
+    }
+}
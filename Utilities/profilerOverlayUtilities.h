@@ -0,0 +1,41 @@
+/**
+ * Header file for the profiler overlay utilities.
+ * Draws the frame timings gathered by the profiler as a stacked bar graph,
+ * one bar per frame and one color per zone, along with median and 99th percentile timings.
+ * @file Utilities/profilerOverlayUtilities.h
+ * @author abmize
+ */
+#ifndef _PROFILER_OVERLAY_UTILITIES_H_
+#define _PROFILER_OVERLAY_UTILITIES_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "Utilities/profilerUtilities.h"
+#include "Utilities/openglUtilities.h"
+#include "Utilities/renderUtilities.h"
+#include "Utilities/renderBatchUtilities.h"
+
+// Frame time, in milliseconds, that reaches the top of the graph.
+// Twice the length of a frame at 60 frames per second, so a frame that misses vsync is obvious.
+#define PROFILER_OVERLAY_GRAPH_MILLISECONDS 33.3f
+
+// Frame time, in milliseconds, at which a guide line is drawn across the graph.
+#define PROFILER_OVERLAY_TARGET_MILLISECONDS 16.7f
+
+// Size of the overlay in pixels. The graph takes up the top part, and the legend the rest.
+#define PROFILER_OVERLAY_WIDTH 480.0f
+#define PROFILER_OVERLAY_GRAPH_HEIGHT 120.0f
+#define PROFILER_OVERLAY_HEIGHT 330.0f
+
+/**
+ * Draws the profiler overlay with its top left corner at the given screen coordinates.
+ * Draws through the render batch in screen space, so the modelview matrix must be the identity.
+ * @param context The OpenGL context, used for drawing text.
+ * @param x The x-coordinate of the overlay's left edge.
+ * @param y The y-coordinate of the overlay's top edge.
+ */
+void ProfilerDrawOverlay(OpenGLContext *context, float x, float y);
+
+#endif // _PROFILER_OVERLAY_UTILITIES_H_
@@ -0,0 +1,357 @@
+/**
+ * Implementation of the CPU profiler utilities.
+ * Zones are timed with the high-resolution performance counter.
+ * Each finished zone adds its time to the frame in progress and is kept as a trace event,
+ * both under a lock, since zones are timed on more than one thread.
+ * @file Utilities/profilerUtilities.c
+ * @author abmize
+ */
+#include "Utilities/profilerUtilities.h"
+
+// Whether ProfilerInitialize has been called (and ProfilerShutdown has not).
+static bool profilerInitialized = false;
+
+// Guards everything below, as zones may end on any thread.
+static CRITICAL_SECTION profilerLock;
+
+// Frequency of the performance counter, used to convert ticks to milliseconds.
+static int64_t profilerFrequency = 1;
+
+// Performance counter value at initialization. Trace timestamps are relative to this.
+static int64_t profilerStartTicks = 0;
+
+// Performance counter value at which the frame in progress started.
+static int64_t frameStartTicks = 0;
+
+// Time spent so far in each zone during the frame in progress, in ticks.
+static int64_t frameZoneTicks[PROFILER_ZONE_COUNT];
+
+// Ring buffer of the most recent frames' timings.
+// frameHistoryNext is where the next frame goes, and frameHistoryCount how many are valid.
+static ProfilerFrameTimings frameHistory[PROFILER_FRAME_HISTORY];
+static size_t frameHistoryNext = 0;
+static size_t frameHistoryCount = 0;
+
+// Ring buffer of the most recent zone events, kept for trace export.
+static ProfilerTraceEvent traceEvents[PROFILER_TRACE_CAPACITY];
+static size_t traceEventNext = 0;
+static size_t traceEventCount = 0;
+
+// Display names of the zones, in the order of the ProfilerZone enum.
+static const char *const zoneNames[PROFILER_ZONE_COUNT] = {
+    "Network",
+    "Level Update",
+    "AI",
+    "Snapshot",
+    "Planets",
+    "Trails",
+    "Ships",
+    "Submit",
+    "UI",
+    "Swap Buffers"
+};
+
+/**
+ * Helper function to keep an event for trace export, overwriting the oldest one if full.
+ * Must be called with the profiler lock held.
+ * @param zone The zone of the event, or PROFILER_ZONE_COUNT for a whole frame.
+ * @param startTicks Performance counter value at which the event started.
+ * @param durationTicks How long the event lasted, in ticks.
+ */
+static void RecordTraceEvent(uint32_t zone, int64_t startTicks, int64_t durationTicks) {
+    ProfilerTraceEvent *event = &traceEvents[traceEventNext];
+    event->startTicks = startTicks;
+    event->durationTicks = durationTicks;
+    event->threadId = (uint32_t)GetCurrentThreadId();
+    event->zone = zone;
+
+    traceEventNext = (traceEventNext + 1) % PROFILER_TRACE_CAPACITY;
+    if (traceEventCount < PROFILER_TRACE_CAPACITY) {
+        traceEventCount += 1;
+    }
+}
+
+/**
+ * Helper function to convert a number of performance counter ticks to milliseconds.
+ * @param ticks The number of ticks.
+ * @return The number of milliseconds.
+ */
+static float TicksToMilliseconds(int64_t ticks) {
+    return (float)((double)ticks * 1000.0 / (double)profilerFrequency);
+}
+
+/**
+ * Initializes the profiler and starts its first frame.
+ * Must be called before any other profiler function, and before any thread that uses it is started.
+ * @return true if the profiler was initialized, false otherwise.
+ */
+bool ProfilerInitialize(void) {
+    if (profilerInitialized) {
+        return true;
+    }
+
+    profilerFrequency = GetTickFrequency();
+    if (profilerFrequency <= 0) {
+        profilerFrequency = 1;
+    }
+
+    InitializeCriticalSection(&profilerLock);
+    profilerStartTicks = GetTicks();
+    frameStartTicks = profilerStartTicks;
+    memset(frameZoneTicks, 0, sizeof(frameZoneTicks));
+    frameHistoryNext = 0;
+    frameHistoryCount = 0;
+    traceEventNext = 0;
+    traceEventCount = 0;
+    profilerInitialized = true;
+    return true;
+}
+
+/**
+ * Shuts the profiler down. No thread may use the profiler once this is called.
+ */
+void ProfilerShutdown(void) {
+    if (!profilerInitialized) {
+        return;
+    }
+
+    DeleteCriticalSection(&profilerLock);
+    profilerInitialized = false;
+}
+
+/**
+ * Enters a zone. The zone is timed until the returned marker is passed to ProfilerEnd.
+ * @param zone The zone being entered.
+ * @return The marker for the zone.
+ */
+ProfilerMarker ProfilerBegin(ProfilerZone zone) {
+    ProfilerMarker marker;
+    marker.zone = zone;
+    marker.startTicks = GetTicks();
+    return marker;
+}
+
+/**
+ * Leaves a zone entered with ProfilerBegin, recording how long it took.
+ * @param marker The marker returned by ProfilerBegin.
+ */
+void ProfilerEnd(const ProfilerMarker *marker) {
+    if (!profilerInitialized || marker == NULL || (int)marker->zone < 0 || marker->zone >= PROFILER_ZONE_COUNT) {
+        return;
+    }
+
+    // Read the counter before taking the lock, so waiting on it is not counted as part of the zone.
+    int64_t endTicks = GetTicks();
+    int64_t durationTicks = endTicks - marker->startTicks;
+    if (durationTicks < 0) {
+        durationTicks = 0;
+    }
+
+    EnterCriticalSection(&profilerLock);
+    frameZoneTicks[marker->zone] += durationTicks;
+    RecordTraceEvent((uint32_t)marker->zone, marker->startTicks, durationTicks);
+    LeaveCriticalSection(&profilerLock);
+}
+
+/**
+ * Ends the current frame, adding its timings to the frame history, and starts the next one.
+ * Should be called exactly once per frame, by the thread that draws the frames.
+ */
+void ProfilerEndFrame(void) {
+    if (!profilerInitialized) {
+        return;
+    }
+
+    int64_t endTicks = GetTicks();
+
+    EnterCriticalSection(&profilerLock);
+
+    // Move the frame in progress into the history, converting to milliseconds on the way.
+    ProfilerFrameTimings *frame = &frameHistory[frameHistoryNext];
+    frame->frameMilliseconds = TicksToMilliseconds(endTicks - frameStartTicks);
+    for (size_t i = 0; i < PROFILER_ZONE_COUNT; ++i) {
+        frame->zoneMilliseconds[i] = TicksToMilliseconds(frameZoneTicks[i]);
+    }
+    frameHistoryNext = (frameHistoryNext + 1) % PROFILER_FRAME_HISTORY;
+    if (frameHistoryCount < PROFILER_FRAME_HISTORY) {
+        frameHistoryCount += 1;
+    }
+
+    // The frame itself is kept as a trace event too, so zones can be seen against the frames they fell in.
+    RecordTraceEvent(PROFILER_ZONE_COUNT, frameStartTicks, endTicks - frameStartTicks);
+
+    // And the next frame starts from nothing.
+    memset(frameZoneTicks, 0, sizeof(frameZoneTicks));
+    frameStartTicks = endTicks;
+
+    LeaveCriticalSection(&profilerLock);
+}
+
+/**
+ * Retrieves the display name of a zone.
+ * @param zone The zone.
+ * @return The name of the zone, or "Frame" for PROFILER_ZONE_COUNT.
+ */
+const char *ProfilerGetZoneName(ProfilerZone zone) {
+    if ((int)zone < 0 || zone >= PROFILER_ZONE_COUNT) {
+        return "Frame";
+    }
+    return zoneNames[zone];
+}
+
+/**
+ * Copies the frame history, oldest frame first.
+ * @param outFrames Array receiving the frames.
+ * @param maxFrames The number of frames outFrames can hold.
+ * @return The number of frames copied.
+ */
+size_t ProfilerCopyFrames(ProfilerFrameTimings *outFrames, size_t maxFrames) {
+    if (!profilerInitialized || outFrames == NULL || maxFrames == 0) {
+        return 0;
+    }
+
+    EnterCriticalSection(&profilerLock);
+
+    // If asked for fewer frames than we have, the most recent ones are the interesting ones.
+    size_t count = frameHistoryCount < maxFrames ? frameHistoryCount : maxFrames;
+    size_t first = (frameHistoryNext + PROFILER_FRAME_HISTORY - count) % PROFILER_FRAME_HISTORY;
+    for (size_t i = 0; i < count; ++i) {
+        outFrames[i] = frameHistory[(first + i) % PROFILER_FRAME_HISTORY];
+    }
+
+    LeaveCriticalSection(&profilerLock);
+    return count;
+}
+
+/**
+ * Comparison function for qsort, ordering floats from smallest to largest.
+ * @param a Pointer to the first float.
+ * @param b Pointer to the second float.
+ * @return Negative if a is smaller, positive if b is smaller, zero if equal.
+ */
+static int CompareFloats(const void *a, const void *b) {
+    float left = *(const float *)a;
+    float right = *(const float *)b;
+    return (left > right) - (left < right);
+}
+
+/**
+ * Helper function to find a percentile of a set of values using the nearest-rank method,
+ * meaning the smallest value that at least the given fraction of all values are less than or equal to.
+ * Sorts the values in place.
+ * @param values The values. Sorted by this function.
+ * @param count The number of values. Must be at least one.
+ * @param fraction The percentile as a fraction, such as 0.99 for the 99th percentile.
+ * @return The percentile.
+ */
+static float ComputePercentile(float *values, size_t count, float fraction) {
+    qsort(values, count, sizeof(float), CompareFloats);
+    size_t rank = (size_t)ceilf(fraction * (float)count);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > count) {
+        rank = count;
+    }
+    return values[rank - 1];
+}
+
+/**
+ * Computes the median and 99th percentile frame and zone timings over the frame history.
+ * Uses buffers of its own to sort in, so must only be called from one thread at a time.
+ * @param outStatistics Receives the statistics.
+ * @return true if there was at least one frame to compute statistics over, false otherwise.
+ */
+bool ProfilerComputeFrameStatistics(ProfilerFrameStatistics *outStatistics) {
+    if (outStatistics == NULL) {
+        return false;
+    }
+
+    memset(outStatistics, 0, sizeof(*outStatistics));
+
+    // Work on a copy, so the lock is not held while sorting.
+    static ProfilerFrameTimings frames[PROFILER_FRAME_HISTORY];
+    static float values[PROFILER_FRAME_HISTORY];
+    size_t count = ProfilerCopyFrames(frames, PROFILER_FRAME_HISTORY);
+    if (count == 0) {
+        return false;
+    }
+
+    outStatistics->frameCount = count;
+
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = frames[i].frameMilliseconds;
+    }
+    outStatistics->frameP50 = ComputePercentile(values, count, 0.5f);
+    outStatistics->frameP99 = ComputePercentile(values, count, 0.99f);
+
+    for (size_t zone = 0; zone < PROFILER_ZONE_COUNT; ++zone) {
+        for (size_t i = 0; i < count; ++i) {
+            values[i] = frames[i].zoneMilliseconds[zone];
+        }
+        outStatistics->zoneP50[zone] = ComputePercentile(values, count, 0.5f);
+        outStatistics->zoneP99[zone] = ComputePercentile(values, count, 0.99f);
+    }
+
+    return true;
+}
+
+/**
+ * Writes every kept zone event to a file in the Chrome trace event format.
+ * @param path The path of the file to write.
+ * @return true if the file was written, false otherwise.
+ */
+bool ProfilerWriteChromeTrace(const char *path) {
+    if (!profilerInitialized || path == NULL) {
+        return false;
+    }
+
+    // Copy the events out first, oldest first, so that nobody waits on the lock while we write the file.
+    EnterCriticalSection(&profilerLock);
+    size_t count = traceEventCount;
+    ProfilerTraceEvent *events = NULL;
+    if (count > 0) {
+        events = (ProfilerTraceEvent *)malloc(sizeof(ProfilerTraceEvent) * count);
+        if (events != NULL) {
+            size_t first = (traceEventNext + PROFILER_TRACE_CAPACITY - count) % PROFILER_TRACE_CAPACITY;
+            for (size_t i = 0; i < count; ++i) {
+                events[i] = traceEvents[(first + i) % PROFILER_TRACE_CAPACITY];
+            }
+        }
+    }
+    LeaveCriticalSection(&profilerLock);
+
+    if (count > 0 && events == NULL) {
+        return false;
+    }
+
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        free(events);
+        return false;
+    }
+
+    // Each event is a "complete" event (ph X), which has a start time and a duration,
+    // both in microseconds. Events on different threads show up on separate rows.
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < count; ++i) {
+        const ProfilerTraceEvent *event = &events[i];
+        double startMicroseconds = (double)(event->startTicks - profilerStartTicks) * 1000000.0 / (double)profilerFrequency;
+        double durationMicroseconds = (double)event->durationTicks * 1000000.0 / (double)profilerFrequency;
+        fprintf(file, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%lu}%s\n",
+            ProfilerGetZoneName((ProfilerZone)event->zone),
+            event->zone >= PROFILER_ZONE_COUNT ? "frame" : "zone",
+            startMicroseconds,
+            durationMicroseconds,
+            (unsigned long)event->threadId,
+            i + 1 < count ? "," : "");
+    }
+    fprintf(file, "]}\n");
+
+    bool written = ferror(file) == 0;
+    if (fclose(file) != 0) {
+        written = false;
+    }
+    free(events);
+    return written;
+}
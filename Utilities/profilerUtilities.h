@@ -0,0 +1,144 @@
+/**
+ * Header file for the CPU profiler utilities.
+ * The profiler times named zones of each frame (network, simulation, drawing and so on),
+ * keeps the last few seconds of those timings around for the on-screen overlay,
+ * and keeps every individual zone as an event which can be written out as a Chrome trace
+ * (open chrome://tracing or https://ui.perfetto.dev and load the file).
+ * Nothing in here depends on a window or OpenGL, so the same markers work without either;
+ * drawing the timings is left to profilerOverlayUtilities.
+ * @file Utilities/profilerUtilities.h
+ * @author abmize
+ */
+#ifndef _PROFILER_UTILITIES_H_
+#define _PROFILER_UTILITIES_H_
+
+#include <windows.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Utilities/gameUtilities.h"
+
+// Number of frames of timings kept for the overlay and its percentiles.
+// At 60 frames per second this is the last four seconds.
+#define PROFILER_FRAME_HISTORY 240
+
+// Number of zone events kept for trace export. Once full, the oldest events are overwritten.
+// With around ten zones a frame this covers the last couple of minutes at 60 frames per second.
+#define PROFILER_TRACE_CAPACITY 65536
+
+// The zones of a frame that are timed.
+// Zones may be timed on any thread; their time counts toward whichever frame is in progress.
+typedef enum ProfilerZone {
+    PROFILER_ZONE_NETWORK = 0,
+    PROFILER_ZONE_LEVEL_UPDATE,
+    PROFILER_ZONE_AI,
+    PROFILER_ZONE_SNAPSHOT,
+    PROFILER_ZONE_DRAW_PLANETS,
+    PROFILER_ZONE_DRAW_TRAILS,
+    PROFILER_ZONE_DRAW_SHIPS,
+    PROFILER_ZONE_DRAW_SUBMIT,
+    PROFILER_ZONE_DRAW_UI,
+    PROFILER_ZONE_SWAP_BUFFERS,
+    PROFILER_ZONE_COUNT
+} ProfilerZone;
+
+// A zone that has been entered but not yet left.
+// Returned by ProfilerBegin and handed back to ProfilerEnd.
+// Nothing is recorded until ProfilerEnd, so a marker that is never ended is simply forgotten.
+typedef struct ProfilerMarker {
+    ProfilerZone zone;
+    int64_t startTicks;
+} ProfilerMarker;
+
+// How long a single frame took, both in total and in each zone, in milliseconds.
+// The zones need not add up to the total, since not all of a frame is covered by zones,
+// and zones timed on other threads may overlap with those on the frame's own thread.
+typedef struct ProfilerFrameTimings {
+    float frameMilliseconds;
+    float zoneMilliseconds[PROFILER_ZONE_COUNT];
+} ProfilerFrameTimings;
+
+// Median and 99th percentile timings over the frame history, in milliseconds.
+typedef struct ProfilerFrameStatistics {
+    size_t frameCount;
+    float frameP50;
+    float frameP99;
+    float zoneP50[PROFILER_ZONE_COUNT];
+    float zoneP99[PROFILER_ZONE_COUNT];
+} ProfilerFrameStatistics;
+
+// A single timed zone (or, with zone set to PROFILER_ZONE_COUNT, a whole frame) kept for trace export.
+typedef struct ProfilerTraceEvent {
+    int64_t startTicks;
+    int64_t durationTicks;
+    uint32_t threadId;
+    uint32_t zone;
+} ProfilerTraceEvent;
+
+/**
+ * Initializes the profiler and starts its first frame.
+ * Must be called before any other profiler function, and before any thread that uses it is started.
+ * @return true if the profiler was initialized, false otherwise.
+ */
+bool ProfilerInitialize(void);
+
+/**
+ * Shuts the profiler down. No thread may use the profiler once this is called.
+ */
+void ProfilerShutdown(void);
+
+/**
+ * Enters a zone. The zone is timed until the returned marker is passed to ProfilerEnd.
+ * @param zone The zone being entered.
+ * @return The marker for the zone.
+ */
+ProfilerMarker ProfilerBegin(ProfilerZone zone);
+
+/**
+ * Leaves a zone entered with ProfilerBegin, recording how long it took.
+ * @param marker The marker returned by ProfilerBegin.
+ */
+void ProfilerEnd(const ProfilerMarker *marker);
+
+/**
+ * Ends the current frame, adding its timings to the frame history, and starts the next one.
+ * Should be called exactly once per frame, by the thread that draws the frames.
+ */
+void ProfilerEndFrame(void);
+
+/**
+ * Retrieves the display name of a zone.
+ * @param zone The zone.
+ * @return The name of the zone, or "Frame" for PROFILER_ZONE_COUNT.
+ */
+const char *ProfilerGetZoneName(ProfilerZone zone);
+
+/**
+ * Copies the frame history, oldest frame first.
+ * @param outFrames Array receiving the frames.
+ * @param maxFrames The number of frames outFrames can hold.
+ * @return The number of frames copied.
+ */
+size_t ProfilerCopyFrames(ProfilerFrameTimings *outFrames, size_t maxFrames);
+
+/**
+ * Computes the median and 99th percentile frame and zone timings over the frame history.
+ * Uses buffers of its own to sort in, so must only be called from one thread at a time.
+ * @param outStatistics Receives the statistics.
+ * @return true if there was at least one frame to compute statistics over, false otherwise.
+ */
+bool ProfilerComputeFrameStatistics(ProfilerFrameStatistics *outStatistics);
+
+/**
+ * Writes every kept zone event to a file in the Chrome trace event format.
+ * @param path The path of the file to write.
+ * @return true if the file was written, false otherwise.
+ */
+bool ProfilerWriteChromeTrace(const char *path);
+
+#endif // _PROFILER_UTILITIES_H_
@@ -0,0 +1,620 @@
+/**
+ * Implementation of the render batch utilities.
+ * Rather than sending each vertex to OpenGL individually with glVertex2f,
+ * the drawing helpers write their vertices into a single CPU-side array.
+ * That array is handed to OpenGL in one glDrawArrays call whenever the
+ * render state (primitive type, blending or line width) has to change,
+ * or when someone explicitly asks for a flush.
+ * Vertex arrays are part of OpenGL 1.1, so this works on any driver
+ * that could already run the immediate mode code.
+ * @file Utilities/renderBatchUtilities.c
+ * @author abmize
+ */
+#include "Utilities/renderBatchUtilities.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// --- Static state ---
+
+// The pending vertices waiting to be submitted.
+// Kept static since the batch is shared by every drawing helper
+// and lives for the whole lifetime of the program.
+static RenderBatchVertex batchVertices[RENDER_BATCH_MAX_VERTICES];
+
+// Number of pending vertices in batchVertices.
+static size_t batchVertexCount = 0;
+
+// The pending textured vertices waiting to be submitted.
+// At most one of batchVertices and batchTexturedVertices holds anything at a time,
+// which is what keeps text and untextured geometry drawn in the order they were added.
+static RenderBatchTexturedVertex batchTexturedVertices[RENDER_BATCH_MAX_TEXTURED_VERTICES];
+
+// Number of pending vertices in batchTexturedVertices.
+static size_t batchTexturedVertexCount = 0;
+
+// The texture the pending textured vertices sample.
+static GLuint batchTexture = 0;
+
+// The primitive type of the pending vertices.
+static RenderBatchPrimitive batchPrimitive = RENDER_BATCH_PRIMITIVE_TRIANGLES;
+
+// The blending mode the pending vertices will be drawn with.
+static RenderBatchBlendMode batchBlendMode = RENDER_BATCH_BLEND_NONE;
+
+// The line width pending line primitives will be drawn with.
+static float batchLineWidth = 1.0f;
+
+// The color used by solid-color helpers such as DrawFilledCircle.
+static float batchColor[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+// Counters accumulated since the last RenderBatchBeginFrame.
+static RenderBatchStats batchStats = {0};
+
+// The recording currently receiving vertices, or NULL when drawing live.
+static RenderBatchRecording *activeRecording = NULL;
+
+// A bucket of geometry collected during a sorted pass,
+// holding everything added with one particular render state.
+typedef struct RenderBatchSortedBucket {
+    RenderBatchLayer layer;
+    RenderBatchBlendMode blendMode;
+    float lineWidth;
+    RenderBatchRecording geometry;
+} RenderBatchSortedBucket;
+
+// The buckets of the current sorted pass.
+// Their vertex arrays are kept between passes so they only have to grow once.
+static RenderBatchSortedBucket sortedBuckets[RENDER_BATCH_MAX_SORTED_BUCKETS];
+
+// Number of buckets in use by the current sorted pass.
+static size_t sortedBucketCount = 0;
+
+// The bucket most recently added to, checked first since consecutive
+// geometry almost always shares the same state.
+static size_t lastSortedBucket = 0;
+
+// Whether a sorted pass is in progress.
+static bool sortedPassActive = false;
+
+// The layer subsequently added geometry is tagged with.
+static RenderBatchLayer batchLayer = RENDER_BATCH_LAYER_WORLD;
+
+/**
+ * Helper function to submit an array of vertices to OpenGL
+ * using the batch's current blend mode and line width.
+ * @param primitive The primitive type of the vertices.
+ * @param vertices The vertices to draw.
+ * @param vertexCount The number of vertices to draw.
+ */
+static void SubmitVertices(RenderBatchPrimitive primitive, const RenderBatchVertex *vertices, size_t vertexCount) {
+    // Apply the blending mode the vertices were recorded with.
+    if (batchBlendMode == RENDER_BATCH_BLEND_ALPHA) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    } else if (batchBlendMode == RENDER_BATCH_BLEND_ADDITIVE) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    }
+
+    GLenum mode = GL_TRIANGLES;
+    if (primitive == RENDER_BATCH_PRIMITIVE_LINES) {
+        mode = GL_LINES;
+        glLineWidth(batchLineWidth);
+    }
+
+    // Vertex arrays let OpenGL read all the vertices straight out of our array.
+    // The stride tells OpenGL how many bytes to skip to get from one vertex
+    // to the next, since positions and colors are interleaved.
+    GLsizei stride = (GLsizei)sizeof(RenderBatchVertex);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, stride, &vertices[0].x);
+    glColorPointer(4, GL_FLOAT, stride, vertices[0].color);
+    glDrawArrays(mode, 0, (GLsizei)vertexCount);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    // Keep the frame counters up to date.
+    batchStats.drawCalls += 1;
+    batchStats.vertexCount += vertexCount;
+
+    // Restore the default state the rest of the code expects,
+    // matching what the immediate mode helpers used to leave behind.
+    if (batchBlendMode != RENDER_BATCH_BLEND_NONE) {
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDisable(GL_BLEND);
+    }
+
+    if (mode == GL_LINES) {
+        glLineWidth(1.0f);
+    }
+}
+
+/**
+ * Helper function to submit the pending textured vertices to OpenGL.
+ * Textured vertices are always drawn with alpha blending,
+ * with the texture modulated by the vertex colors.
+ */
+static void SubmitTexturedVertices(void) {
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, batchTexture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Same idea as in SubmitVertices, just with texture coordinates interleaved as well.
+    GLsizei stride = (GLsizei)sizeof(RenderBatchTexturedVertex);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, stride, &batchTexturedVertices[0].x);
+    glTexCoordPointer(2, GL_FLOAT, stride, &batchTexturedVertices[0].u);
+    glColorPointer(4, GL_FLOAT, stride, batchTexturedVertices[0].color);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)batchTexturedVertexCount);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    batchStats.drawCalls += 1;
+    batchStats.vertexCount += batchTexturedVertexCount;
+
+    // Leave texturing and blending off, as the rest of the code expects.
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_BLEND);
+
+    batchTexturedVertexCount = 0;
+}
+
+/**
+ * Resets the per-frame counters.
+ * Should be called once at the start of every rendered frame.
+ */
+void RenderBatchBeginFrame(void) {
+    batchStats.drawCalls = 0;
+    batchStats.vertexCount = 0;
+}
+
+/**
+ * Sets the color used by the solid-color drawing helpers
+ * (DrawCircle, DrawFilledCircle and DrawRing).
+ * Replaces the glColor call those helpers previously relied on.
+ * @param color The RGBA color to use. NULL is ignored.
+ */
+void RenderBatchSetColor(const float color[4]) {
+    if (color == NULL) {
+        return;
+    }
+
+    batchColor[0] = color[0];
+    batchColor[1] = color[1];
+    batchColor[2] = color[2];
+    batchColor[3] = color[3];
+}
+
+/**
+ * Retrieves the color most recently set with RenderBatchSetColor.
+ * @param outColor An array of 4 floats to receive the RGBA color.
+ */
+void RenderBatchGetColor(float outColor[4]) {
+    if (outColor == NULL) {
+        return;
+    }
+
+    outColor[0] = batchColor[0];
+    outColor[1] = batchColor[1];
+    outColor[2] = batchColor[2];
+    outColor[3] = batchColor[3];
+}
+
+/**
+ * Sets the blending mode applied to subsequently added geometry.
+ * Pending geometry is flushed first if the mode actually changes.
+ * @param mode The blending mode to use.
+ */
+void RenderBatchSetBlendMode(RenderBatchBlendMode mode) {
+    // Setting the same mode again is free, which is what lets
+    // many objects drawn with the same blending share one draw call.
+    // Recordings do not carry blend state, so requests made while recording are ignored.
+    if (mode == batchBlendMode || activeRecording != NULL) {
+        return;
+    }
+
+    // During a sorted pass the mode only decides which bucket geometry goes into,
+    // so there is nothing pending to flush.
+    if (sortedPassActive) {
+        batchBlendMode = mode;
+        return;
+    }
+
+    // The pending geometry was meant to be drawn with the old mode,
+    // so it has to go out before we switch.
+    RenderBatchFlush();
+    batchBlendMode = mode;
+}
+
+/**
+ * Sets the line width applied to subsequently added line primitives.
+ * Pending lines are flushed first if the width actually changes.
+ * @param width The line width in pixels.
+ */
+void RenderBatchSetLineWidth(float width) {
+    if (width == batchLineWidth || activeRecording != NULL) {
+        return;
+    }
+
+    if (sortedPassActive) {
+        batchLineWidth = width;
+        return;
+    }
+
+    // Line width only matters for lines, so triangles can stay pending.
+    if (batchPrimitive == RENDER_BATCH_PRIMITIVE_LINES) {
+        RenderBatchFlush();
+    }
+    batchLineWidth = width;
+}
+
+/**
+ * Helper function to reserve vertices in a recording,
+ * growing its array by doubling (starting from 256 vertices) as needed.
+ * @param recording The recording to reserve vertices in.
+ * @param primitive The primitive type the vertices belong to.
+ * @param vertexCount The number of vertices to reserve.
+ * @return A pointer to the reserved vertices, or NULL on failure.
+ */
+static RenderBatchVertex *ReserveRecordingVertices(RenderBatchRecording *recording,
+    RenderBatchPrimitive primitive, size_t vertexCount) {
+    // A recording can only hold a single primitive type.
+    if (vertexCount == 0 || primitive != recording->primitive) {
+        return NULL;
+    }
+
+    size_t required = recording->vertexCount + vertexCount;
+    if (required > recording->vertexCapacity) {
+        size_t newCapacity = recording->vertexCapacity == 0 ? 256 : recording->vertexCapacity * 2;
+        while (newCapacity < required) {
+            newCapacity *= 2;
+        }
+
+        RenderBatchVertex *resized = (RenderBatchVertex *)realloc(recording->vertices,
+            newCapacity * sizeof(RenderBatchVertex));
+        if (resized == NULL) {
+            return NULL;
+        }
+
+        recording->vertices = resized;
+        recording->vertexCapacity = newCapacity;
+    }
+
+    RenderBatchVertex *vertices = &recording->vertices[recording->vertexCount];
+    recording->vertexCount = required;
+    return vertices;
+}
+
+/**
+ * Helper function to draw every bucket collected during the current sorted pass,
+ * layer by layer, and empty them afterwards.
+ * The blend mode and line width current before the call are restored afterwards.
+ */
+static void DrawSortedBuckets(void) {
+    RenderBatchBlendMode savedBlendMode = batchBlendMode;
+    float savedLineWidth = batchLineWidth;
+
+    // There are only a handful of layers and buckets,
+    // so walking the buckets once per layer is cheaper than actually sorting them.
+    for (int layer = 0; layer < RENDER_BATCH_LAYER_COUNT; ++layer) {
+        for (size_t i = 0; i < sortedBucketCount; ++i) {
+            RenderBatchSortedBucket *bucket = &sortedBuckets[i];
+            if ((int)bucket->layer != layer || bucket->geometry.vertexCount == 0) {
+                continue;
+            }
+
+            batchBlendMode = bucket->blendMode;
+            batchLineWidth = bucket->lineWidth;
+            SubmitVertices(bucket->geometry.primitive, bucket->geometry.vertices, bucket->geometry.vertexCount);
+            bucket->geometry.vertexCount = 0;
+        }
+    }
+
+    sortedBucketCount = 0;
+    lastSortedBucket = 0;
+    batchBlendMode = savedBlendMode;
+    batchLineWidth = savedLineWidth;
+}
+
+/**
+ * Helper function to find the sorted pass bucket matching the current render state
+ * and the given primitive type, creating it if it does not exist yet.
+ * @param primitive The primitive type of the geometry being added.
+ * @return A pointer to the matching bucket.
+ */
+static RenderBatchSortedBucket *FindSortedBucket(RenderBatchPrimitive primitive) {
+    // Line width has no effect on triangles, so it should not split them into separate buckets.
+    float lineWidth = primitive == RENDER_BATCH_PRIMITIVE_LINES ? batchLineWidth : 1.0f;
+
+    // Check the bucket we used last time first, then all the others.
+    for (size_t n = 0; n <= sortedBucketCount; ++n) {
+        size_t i = n == 0 ? lastSortedBucket : n - 1;
+        if (i >= sortedBucketCount) {
+            continue;
+        }
+
+        RenderBatchSortedBucket *bucket = &sortedBuckets[i];
+        if (bucket->layer == batchLayer && bucket->blendMode == batchBlendMode &&
+            bucket->geometry.primitive == primitive && bucket->lineWidth == lineWidth) {
+            lastSortedBucket = i;
+            return bucket;
+        }
+    }
+
+    // Out of buckets, so draw what we have so far and start over.
+    // This only costs us some extra state changes, everything still gets drawn.
+    if (sortedBucketCount == RENDER_BATCH_MAX_SORTED_BUCKETS) {
+        DrawSortedBuckets();
+    }
+
+    RenderBatchSortedBucket *bucket = &sortedBuckets[sortedBucketCount];
+    bucket->layer = batchLayer;
+    bucket->blendMode = batchBlendMode;
+    bucket->lineWidth = lineWidth;
+    bucket->geometry.primitive = primitive;
+    bucket->geometry.vertexCount = 0;
+    lastSortedBucket = sortedBucketCount;
+    sortedBucketCount++;
+    return bucket;
+}
+
+/**
+ * Reserves space for vertexCount vertices of the given primitive type.
+ * The caller must write exactly vertexCount vertices through the returned pointer.
+ * Pending geometry is flushed first if the primitive type changes
+ * or if there is not enough room left in the batch.
+ * @param primitive The primitive type the vertices belong to.
+ * @param vertexCount The number of vertices to reserve. For triangles this
+ *                    must be a multiple of 3, for lines a multiple of 2.
+ * @return A pointer to the reserved vertices, or NULL if the request can never fit.
+ */
+RenderBatchVertex *RenderBatchReserve(RenderBatchPrimitive primitive, size_t vertexCount) {
+    // While recording, vertices go into the recording's own growable array instead.
+    if (activeRecording != NULL) {
+        return ReserveRecordingVertices(activeRecording, primitive, vertexCount);
+    }
+
+    // During a sorted pass, vertices go into the bucket for the current render state.
+    if (sortedPassActive) {
+        return ReserveRecordingVertices(&FindSortedBucket(primitive)->geometry, primitive, vertexCount);
+    }
+
+    // A request larger than the whole batch can never be satisfied.
+    if (vertexCount == 0 || vertexCount > RENDER_BATCH_MAX_VERTICES) {
+        return NULL;
+    }
+
+    // Any pending text has to be drawn before geometry added after it.
+    if (batchTexturedVertexCount > 0) {
+        RenderBatchFlush();
+    }
+
+    // Triangles and lines cannot share a glDrawArrays call.
+    if (primitive != batchPrimitive) {
+        RenderBatchFlush();
+        batchPrimitive = primitive;
+    }
+
+    // Make room if the new vertices would overflow the batch.
+    if (batchVertexCount + vertexCount > RENDER_BATCH_MAX_VERTICES) {
+        RenderBatchFlush();
+    }
+
+    RenderBatchVertex *vertices = &batchVertices[batchVertexCount];
+    batchVertexCount += vertexCount;
+    return vertices;
+}
+
+/**
+ * Reserves space for vertexCount textured triangle vertices sampling the given texture.
+ * The caller must write exactly vertexCount vertices through the returned pointer.
+ * Textured triangles are always drawn with alpha blending.
+ * Pending geometry is flushed first if it is not textured, uses a different texture,
+ * or if there is not enough room left in the batch.
+ * Textured geometry cannot be recorded or sorted, so this fails during a recording or a sorted pass.
+ * @param texture The OpenGL texture the vertices sample.
+ * @param vertexCount The number of vertices to reserve. Must be a multiple of 3.
+ * @return A pointer to the reserved vertices, or NULL if the request cannot be satisfied.
+ */
+RenderBatchTexturedVertex *RenderBatchReserveTextured(GLuint texture, size_t vertexCount) {
+    if (activeRecording != NULL || sortedPassActive || texture == 0 ||
+        vertexCount == 0 || vertexCount > RENDER_BATCH_MAX_TEXTURED_VERTICES) {
+        return NULL;
+    }
+
+    // Untextured geometry added earlier, text using another texture,
+    // or a full batch all have to be drawn first.
+    if (batchVertexCount > 0 || (batchTexturedVertexCount > 0 && texture != batchTexture) ||
+        batchTexturedVertexCount + vertexCount > RENDER_BATCH_MAX_TEXTURED_VERTICES) {
+        RenderBatchFlush();
+    }
+
+    batchTexture = texture;
+    RenderBatchTexturedVertex *vertices = &batchTexturedVertices[batchTexturedVertexCount];
+    batchTexturedVertexCount += vertexCount;
+    return vertices;
+}
+
+/**
+ * Submits all pending geometry to OpenGL with a single glDrawArrays call.
+ * Must be called before any code issues OpenGL commands of its own that
+ * depend on draw order or on the current matrices, such as glPopMatrix.
+ * After flushing, blending is disabled and the line width is reset to 1.
+ */
+void RenderBatchFlush(void) {
+    if (batchTexturedVertexCount > 0) {
+        SubmitTexturedVertices();
+    }
+
+    // Nothing pending means nothing to do.
+    if (batchVertexCount == 0) {
+        return;
+    }
+
+    SubmitVertices(batchPrimitive, batchVertices, batchVertexCount);
+    batchVertexCount = 0;
+}
+
+/**
+ * Starts redirecting batched vertices into the given recording instead of the live batch.
+ * Any previous contents of the recording are discarded, but its memory is reused.
+ * While recording, blend mode and line width requests are ignored;
+ * whoever draws the recording decides the state it is drawn with.
+ * @param recording The recording to fill.
+ * @param primitive The primitive type every recorded vertex must use.
+ * @return true if recording started, false if a recording is already in progress.
+ */
+bool RenderBatchBeginRecording(RenderBatchRecording *recording, RenderBatchPrimitive primitive) {
+    if (recording == NULL || activeRecording != NULL) {
+        return false;
+    }
+
+    recording->vertexCount = 0;
+    recording->primitive = primitive;
+    activeRecording = recording;
+    return true;
+}
+
+/**
+ * Stops redirecting batched vertices into the current recording.
+ */
+void RenderBatchEndRecording(void) {
+    activeRecording = NULL;
+}
+
+/**
+ * Draws a previously filled recording using the current blend mode and line width.
+ * Recordings are copied into the live batch so they can share a draw call
+ * with neighbouring geometry. Copying is far cheaper than tessellating again.
+ * Only recordings too large to ever fit in the batch are drawn straight from their own memory.
+ * @param recording The recording to draw.
+ */
+void RenderBatchDrawRecording(const RenderBatchRecording *recording) {
+    if (recording == NULL || recording->vertices == NULL || recording->vertexCount == 0) {
+        return;
+    }
+
+    // Recordings that fit join the live batch like any other geometry.
+    // During a sorted pass every recording fits, since buckets grow as needed.
+    if (sortedPassActive || recording->vertexCount <= RENDER_BATCH_MAX_VERTICES) {
+        RenderBatchVertex *vertices = RenderBatchReserve(recording->primitive, recording->vertexCount);
+        if (vertices != NULL) {
+            memcpy(vertices, recording->vertices, recording->vertexCount * sizeof(RenderBatchVertex));
+        }
+        return;
+    }
+
+    // Anything bigger gets a draw call of its own, straight from the recording.
+    // The live batch has to go first so the draw order is preserved.
+    RenderBatchFlush();
+    SubmitVertices(recording->primitive, recording->vertices, recording->vertexCount);
+}
+
+/**
+ * Releases the memory held by a recording.
+ * @param recording The recording to release.
+ */
+void RenderBatchRecordingRelease(RenderBatchRecording *recording) {
+    if (recording == NULL) {
+        return;
+    }
+
+    // Never leave the batch writing into memory we are about to free.
+    if (activeRecording == recording) {
+        activeRecording = NULL;
+    }
+
+    free(recording->vertices);
+    recording->vertices = NULL;
+    recording->vertexCount = 0;
+    recording->vertexCapacity = 0;
+}
+
+/**
+ * Sets the layer subsequently added geometry is tagged with.
+ * Only has an effect during a sorted pass.
+ * @param layer The layer to use.
+ */
+void RenderBatchSetLayer(RenderBatchLayer layer) {
+    if (layer < RENDER_BATCH_LAYER_WORLD || layer >= RENDER_BATCH_LAYER_COUNT) {
+        return;
+    }
+
+    batchLayer = layer;
+}
+
+/**
+ * Retrieves the layer most recently set with RenderBatchSetLayer.
+ * @return The current layer.
+ */
+RenderBatchLayer RenderBatchGetLayer(void) {
+    return batchLayer;
+}
+
+/**
+ * Starts a sorted pass.
+ * Until RenderBatchEndSortedPass is called, geometry is not drawn in the order it is added,
+ * but collected into one bucket per render state (layer, blend mode, primitive and line width).
+ * Ending the pass then draws every bucket once, layer by layer, so each state is set once per pass
+ * no matter how many objects switch back and forth between states.
+ * Within a layer, buckets are drawn in the order their state was first used.
+ * Code drawing during a sorted pass must not issue OpenGL commands of its own.
+ * @return true if the pass started, false if a sorted pass is already in progress.
+ */
+bool RenderBatchBeginSortedPass(void) {
+    if (sortedPassActive) {
+        return false;
+    }
+
+    // Whatever was added before the pass has to be drawn before anything in it.
+    RenderBatchFlush();
+
+    sortedBucketCount = 0;
+    lastSortedBucket = 0;
+    sortedPassActive = true;
+    return true;
+}
+
+/**
+ * Ends the current sorted pass, drawing everything collected during it.
+ * The layer is reset to RENDER_BATCH_LAYER_WORLD.
+ */
+void RenderBatchEndSortedPass(void) {
+    if (!sortedPassActive) {
+        return;
+    }
+
+    sortedPassActive = false;
+    DrawSortedBuckets();
+    batchLayer = RENDER_BATCH_LAYER_WORLD;
+}
+
+/**
+ * Releases the memory held by the sorted pass buckets.
+ * Should be called once when the program shuts down.
+ */
+void RenderBatchRelease(void) {
+    sortedPassActive = false;
+    sortedBucketCount = 0;
+    lastSortedBucket = 0;
+
+    for (size_t i = 0; i < RENDER_BATCH_MAX_SORTED_BUCKETS; ++i) {
+        RenderBatchRecordingRelease(&sortedBuckets[i].geometry);
+    }
+}
+
+/**
+ * Retrieves the counters accumulated since the last RenderBatchBeginFrame.
+ * @return The per-frame draw call and vertex counters.
+ */
+RenderBatchStats RenderBatchGetStats(void) {
+    return batchStats;
+}
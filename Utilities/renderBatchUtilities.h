@@ -0,0 +1,241 @@
+/**
+ * Header file for the render batch utilities.
+ * The render batch collects colored triangles and lines on the CPU
+ * and submits them to OpenGL in large vertex arrays, rather than
+ * issuing one glVertex call per vertex in immediate mode.
+ * @file Utilities/renderBatchUtilities.h
+ * @author abmize
+ */
+#ifndef _RENDER_BATCH_UTILITIES_H_
+#define _RENDER_BATCH_UTILITIES_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "Utilities/openglUtilities.h"
+
+// Maximum number of vertices the batch holds before it is forced to flush.
+// 65536 vertices of 24 bytes each is 1.5 MB, which comfortably holds
+// the background, every planet and a few hundred ships in a single submission.
+#define RENDER_BATCH_MAX_VERTICES 65536
+
+// Maximum number of textured vertices the batch holds before it is forced to flush.
+// Textured vertices are only used for text, and 16384 of them is over 2700 characters.
+#define RENDER_BATCH_MAX_TEXTURED_VERTICES 16384
+
+// The kinds of primitives the batch can accumulate.
+// Strips, fans and loops are all expanded into these independent primitives
+// so that consecutive shapes can share a single draw call.
+typedef enum RenderBatchPrimitive {
+    RENDER_BATCH_PRIMITIVE_TRIANGLES = 0,
+    RENDER_BATCH_PRIMITIVE_LINES = 1
+} RenderBatchPrimitive;
+
+// The blending modes used by the game's drawing code.
+// NONE draws opaque geometry, ALPHA is standard transparency
+// (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) and ADDITIVE adds light
+// on top of whatever is already drawn (GL_SRC_ALPHA, GL_ONE).
+typedef enum RenderBatchBlendMode {
+    RENDER_BATCH_BLEND_NONE = 0,
+    RENDER_BATCH_BLEND_ALPHA = 1,
+    RENDER_BATCH_BLEND_ADDITIVE = 2
+} RenderBatchBlendMode;
+
+// The layers geometry can be tagged with during a sorted pass.
+// Layers are drawn in the order listed here, so anything in a later layer
+// ends up on top of everything in an earlier one.
+// Geometry drawn outside of a sorted pass ignores its layer and is drawn in submission order.
+typedef enum RenderBatchLayer {
+    RENDER_BATCH_LAYER_WORLD = 0,
+    RENDER_BATCH_LAYER_TRAILS = 1,
+    RENDER_BATCH_LAYER_SELECTION = 2,
+    RENDER_BATCH_LAYER_SHIP_GLOWS = 3,
+    RENDER_BATCH_LAYER_SHIPS = 4,
+    RENDER_BATCH_LAYER_COUNT = 5
+} RenderBatchLayer;
+
+// Maximum number of distinct render states (layer, blend mode, primitive and line width)
+// a single sorted pass can hold before it has to draw what it has collected early.
+// A frame only ever uses a handful, so this is plenty.
+#define RENDER_BATCH_MAX_SORTED_BUCKETS 32
+
+// A single batched vertex: a 2D position followed by an RGBA color.
+// Position and color are interleaved so one array feeds both
+// glVertexPointer and glColorPointer.
+typedef struct RenderBatchVertex {
+    float x;
+    float y;
+    float color[4];
+} RenderBatchVertex;
+
+// A single batched textured vertex: a 2D position, a texture coordinate and an RGBA color.
+// The color is multiplied with the texture, so a texture holding only alpha
+// (such as a glyph atlas) takes on the color of its vertices.
+typedef struct RenderBatchTexturedVertex {
+    float x;
+    float y;
+    float u;
+    float v;
+    float color[4];
+} RenderBatchTexturedVertex;
+
+// A recording of batched vertices kept around so it can be drawn again later
+// without recomputing them. Used to cache geometry that rarely changes.
+// vertices is owned by the recording and released with RenderBatchRecordingRelease.
+// All vertices in a recording share the same primitive type.
+typedef struct RenderBatchRecording {
+    RenderBatchVertex *vertices;
+    size_t vertexCount;
+    size_t vertexCapacity;
+    RenderBatchPrimitive primitive;
+} RenderBatchRecording;
+
+// Per-frame counters describing how much work was submitted to OpenGL.
+// drawCalls is the number of glDrawArrays calls made by the batch,
+// and vertexCount is the total number of vertices those calls submitted.
+typedef struct RenderBatchStats {
+    size_t drawCalls;
+    size_t vertexCount;
+} RenderBatchStats;
+
+/**
+ * Resets the per-frame counters.
+ * Should be called once at the start of every rendered frame.
+ */
+void RenderBatchBeginFrame(void);
+
+/**
+ * Sets the color used by the solid-color drawing helpers
+ * (DrawCircle, DrawFilledCircle and DrawRing).
+ * Replaces the glColor call those helpers previously relied on.
+ * @param color The RGBA color to use. NULL is ignored.
+ */
+void RenderBatchSetColor(const float color[4]);
+
+/**
+ * Retrieves the color most recently set with RenderBatchSetColor.
+ * @param outColor An array of 4 floats to receive the RGBA color.
+ */
+void RenderBatchGetColor(float outColor[4]);
+
+/**
+ * Sets the blending mode applied to subsequently added geometry.
+ * Pending geometry is flushed first if the mode actually changes.
+ * @param mode The blending mode to use.
+ */
+void RenderBatchSetBlendMode(RenderBatchBlendMode mode);
+
+/**
+ * Sets the line width applied to subsequently added line primitives.
+ * Pending lines are flushed first if the width actually changes.
+ * @param width The line width in pixels.
+ */
+void RenderBatchSetLineWidth(float width);
+
+/**
+ * Reserves space for vertexCount vertices of the given primitive type.
+ * The caller must write exactly vertexCount vertices through the returned pointer.
+ * Pending geometry is flushed first if the primitive type changes
+ * or if there is not enough room left in the batch.
+ * @param primitive The primitive type the vertices belong to.
+ * @param vertexCount The number of vertices to reserve. For triangles this
+ *                    must be a multiple of 3, for lines a multiple of 2.
+ * @return A pointer to the reserved vertices, or NULL if the request can never fit.
+ */
+RenderBatchVertex *RenderBatchReserve(RenderBatchPrimitive primitive, size_t vertexCount);
+
+/**
+ * Reserves space for vertexCount textured triangle vertices sampling the given texture.
+ * The caller must write exactly vertexCount vertices through the returned pointer.
+ * Textured triangles are always drawn with alpha blending.
+ * Pending geometry is flushed first if it is not textured, uses a different texture,
+ * or if there is not enough room left in the batch.
+ * Textured geometry cannot be recorded or sorted, so this fails during a recording or a sorted pass.
+ * @param texture The OpenGL texture the vertices sample.
+ * @param vertexCount The number of vertices to reserve. Must be a multiple of 3.
+ * @return A pointer to the reserved vertices, or NULL if the request cannot be satisfied.
+ */
+RenderBatchTexturedVertex *RenderBatchReserveTextured(GLuint texture, size_t vertexCount);
+
+/**
+ * Submits all pending geometry to OpenGL with a single glDrawArrays call.
+ * Must be called before any code issues OpenGL commands of its own that
+ * depend on draw order or on the current matrices, such as glPopMatrix.
+ * After flushing, blending is disabled and the line width is reset to 1.
+ */
+void RenderBatchFlush(void);
+
+/**
+ * Starts redirecting batched vertices into the given recording instead of the live batch.
+ * Any previous contents of the recording are discarded, but its memory is reused.
+ * While recording, blend mode and line width requests are ignored;
+ * whoever draws the recording decides the state it is drawn with.
+ * @param recording The recording to fill.
+ * @param primitive The primitive type every recorded vertex must use.
+ * @return true if recording started, false if a recording is already in progress.
+ */
+bool RenderBatchBeginRecording(RenderBatchRecording *recording, RenderBatchPrimitive primitive);
+
+/**
+ * Stops redirecting batched vertices into the current recording.
+ */
+void RenderBatchEndRecording(void);
+
+/**
+ * Draws a previously filled recording using the current blend mode and line width.
+ * Recordings are copied into the live batch so they can share a draw call
+ * with neighbouring geometry. Copying is far cheaper than tessellating again.
+ * Only recordings too large to ever fit in the batch are drawn straight from their own memory.
+ * @param recording The recording to draw.
+ */
+void RenderBatchDrawRecording(const RenderBatchRecording *recording);
+
+/**
+ * Releases the memory held by a recording.
+ * @param recording The recording to release.
+ */
+void RenderBatchRecordingRelease(RenderBatchRecording *recording);
+
+/**
+ * Sets the layer subsequently added geometry is tagged with.
+ * Only has an effect during a sorted pass.
+ * @param layer The layer to use.
+ */
+void RenderBatchSetLayer(RenderBatchLayer layer);
+
+/**
+ * Retrieves the layer most recently set with RenderBatchSetLayer.
+ * @return The current layer.
+ */
+RenderBatchLayer RenderBatchGetLayer(void);
+
+/**
+ * Starts a sorted pass.
+ * Until RenderBatchEndSortedPass is called, geometry is not drawn in the order it is added,
+ * but collected into one bucket per render state (layer, blend mode, primitive and line width).
+ * Ending the pass then draws every bucket once, layer by layer, so each state is set once per pass
+ * no matter how many objects switch back and forth between states.
+ * Within a layer, buckets are drawn in the order their state was first used.
+ * Code drawing during a sorted pass must not issue OpenGL commands of its own.
+ * @return true if the pass started, false if a sorted pass is already in progress.
+ */
+bool RenderBatchBeginSortedPass(void);
+
+/**
+ * Ends the current sorted pass, drawing everything collected during it.
+ * The layer is reset to RENDER_BATCH_LAYER_WORLD.
+ */
+void RenderBatchEndSortedPass(void);
+
+/**
+ * Releases the memory held by the sorted pass buckets.
+ * Should be called once when the program shuts down.
+ */
+void RenderBatchRelease(void);
+
+/**
+ * Retrieves the counters accumulated since the last RenderBatchBeginFrame.
+ * @return The per-frame draw call and vertex counters.
+ */
+RenderBatchStats RenderBatchGetStats(void);
+
+#endif // _RENDER_BATCH_UTILITIES_H_
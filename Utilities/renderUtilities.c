@@ -6,9 +6,164 @@
  */
 #include "Utilities/renderUtilities.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+// Lazily built unit circle tables, indexed by segment count.
+// Each table holds segments + 1 interleaved (cos, sin) pairs, one per vertex
+// around the circle, with the last pair landing back on angle zero.
+// Every circle the game draws uses one of at most MAX_CIRCLE_SEGMENTS
+// segment counts, so caching them means cosf and sinf are only evaluated
+// once per vertex for the lifetime of the program instead of once per vertex per frame.
+static float *unitCircleTables[MAX_CIRCLE_SEGMENTS + 1] = {0};
+
+// The current detail scale, see RenderSetDetailScale.
+static float detailScale = 1.0f;
+
+// Recently drawn text, already laid out into glyph quads, indexed by a hash of the text,
+// font and line spacing. See AcquireTextLayout.
+static TextLayout textLayoutCache[TEXT_LAYOUT_CACHE_SIZE];
+
+// The font most recently used by DrawScreenText, along with the context and size it was acquired for.
+static const OpenGLFontEntry *lastTextFont = NULL;
+static const OpenGLContext *lastTextContext = NULL;
+static uint32_t lastTextHeight = 0;
+static uint32_t lastTextWidth = 0;
+
+/**
+ * Sets the detail scale used when choosing how many segments to tessellate shapes with.
+ * This should be the number of screen pixels per world unit (the camera zoom) while the
+ * world is being drawn, and 1.0 otherwise. Values above 1.0 are treated as 1.0,
+ * since zooming in never needs more detail than drawing at full size.
+ * @param scale The detail scale to use.
+ */
+void RenderSetDetailScale(float scale) {
+    if (!(scale > 0.0f) || scale >= 1.0f) {
+        detailScale = 1.0f;
+        return;
+    }
+
+    // Snap upwards so we never draw with less detail than asked for.
+    detailScale = ceilf(scale * DETAIL_SCALE_STEPS) / DETAIL_SCALE_STEPS;
+}
+
+/**
+ * Retrieves the detail scale set with RenderSetDetailScale.
+ * @return The current detail scale, between 0 and 1.
+ */
+float RenderGetDetailScale(void) {
+    return detailScale;
+}
+
+/**
+ * Scales a segment count intended for full detail down by the current detail scale.
+ * Never returns fewer than MIN_DETAIL_SEGMENTS nor more than fullSegments.
+ * @param fullSegments The number of segments to use at full detail.
+ * @return The number of segments to use at the current detail scale.
+ */
+int ComputeDetailSegments(int fullSegments) {
+    if (fullSegments <= MIN_DETAIL_SEGMENTS) {
+        return fullSegments;
+    }
+
+    int segments = (int)ceilf((float)fullSegments * detailScale);
+    if (segments < MIN_DETAIL_SEGMENTS) {
+        segments = MIN_DETAIL_SEGMENTS;
+    }
+    if (segments > fullSegments) {
+        segments = fullSegments;
+    }
+    return segments;
+}
+
+/**
+ * Retrieves the unit circle table for the given number of segments,
+ * building it the first time it is asked for.
+ * Entry i of the table holds cos and sin of (i / segments) * 2 * pi
+ * at indices 2 * i and 2 * i + 1, for i from 0 to segments inclusive.
+ * The angles are computed exactly the way the drawing helpers used to compute them,
+ * so circles drawn from the table are identical to the ones drawn before.
+ * @param segments The number of segments, between 3 and MAX_CIRCLE_SEGMENTS.
+ * @return A pointer to the table, or NULL if segments is out of range or allocation failed.
+ */
+const float *GetUnitCircleTable(int segments) {
+    if (segments < 3 || segments > MAX_CIRCLE_SEGMENTS) {
+        return NULL;
+    }
+
+    // Already built, which is the common case.
+    if (unitCircleTables[segments] != NULL) {
+        return unitCircleTables[segments];
+    }
+
+    float *table = (float *)malloc(sizeof(float) * 2 * ((size_t)segments + 1));
+    if (table == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i <= segments; ++i) {
+        float angle = (float)i / (float)segments * 2.0f * (float)M_PI;
+        table[2 * i] = cosf(angle);
+        table[2 * i + 1] = sinf(angle);
+    }
+
+    unitCircleTables[segments] = table;
+    return table;
+}
+
+/**
+ * Helper function to clamp a requested segment count
+ * to the largest one we keep a unit circle table for.
+ * @param segments The requested number of segments.
+ * @return The number of segments to actually draw with.
+ */
+static int ClampCircleSegments(int segments) {
+    if (segments > MAX_CIRCLE_SEGMENTS) {
+        return MAX_CIRCLE_SEGMENTS;
+    }
+    return segments;
+}
+
+/**
+ * Helper function to write a single vertex into a reserved batch slot.
+ * @param vertex The batch vertex to write.
+ * @param x The x-coordinate of the vertex.
+ * @param y The y-coordinate of the vertex.
+ * @param color The RGBA color of the vertex.
+ */
+static void WriteBatchVertex(RenderBatchVertex *vertex, float x, float y, const float color[4]) {
+    vertex->x = x;
+    vertex->y = y;
+    vertex->color[0] = color[0];
+    vertex->color[1] = color[1];
+    vertex->color[2] = color[2];
+    vertex->color[3] = color[3];
+}
+
+/**
+ * Helper function to fill in a single textured batch vertex.
+ * @param vertex The vertex to fill in.
+ * @param x The x-coordinate of the vertex.
+ * @param y The y-coordinate of the vertex.
+ * @param u The horizontal texture coordinate of the vertex.
+ * @param v The vertical texture coordinate of the vertex.
+ * @param color The RGBA color of the vertex.
+ */
+static void WriteTexturedVertex(RenderBatchTexturedVertex *vertex, float x, float y, float u, float v, const float color[4]) {
+    vertex->x = x;
+    vertex->y = y;
+    vertex->u = u;
+    vertex->v = v;
+    vertex->color[0] = color[0];
+    vertex->color[1] = color[1];
+    vertex->color[2] = color[2];
+    vertex->color[3] = color[3];
+}
+
 /**
  * Draws a hollow circle using OpenGL.
  * This method essentially approximates a circle by drawing a polygon with many sides.
+ * The circle is drawn in the color last set with RenderBatchSetColor.
  * @param cx The x-coordinate of the center of the circle.
  * @param cy The y-coordinate of the center of the circle.
  * @param radius The radius of the circle.
@@ -16,40 +171,57 @@
  * @param thickness The thickness of the circle outline.
  */
 void DrawCircle(float cx, float cy, float radius, int segments, float thickness) {
+    if (segments < 3) {
+        return;
+    }
+
+    // Look up the precomputed cosines and sines for this many segments.
+    segments = ClampCircleSegments(segments);
+    const float *unitCircle = GetUnitCircleTable(segments);
+    if (unitCircle == NULL) {
+        return;
+    }
 
     // Set the line width for drawing the circle
-    glLineWidth(thickness);
+    RenderBatchSetLineWidth(thickness);
 
-    // Begin drawing a line loop
-    // An OpenGL line loop connects a series of vertices with lines,
+    // A line loop connects a series of vertices with lines,
     // and then connects the last vertex back to the first.
-    glBegin(GL_LINE_LOOP);
+    // The batch only understands independent lines, so each
+    // segment of the loop becomes its own pair of vertices.
+    RenderBatchVertex *vertices = RenderBatchReserve(RENDER_BATCH_PRIMITIVE_LINES, (size_t)segments * 2);
+    if (vertices == NULL) {
+        return;
+    }
 
-    // Calculate and specify each vertex of the circle
-    for (int i = 0; i < segments; ++i) {
+    float color[4];
+    RenderBatchGetColor(color);
 
-        // Angle of the line segment
-        float angle = (float)i / (float)segments * 2.0f * (float)M_PI;
+    // Calculate each vertex of the circle.
+    // We carry the previous vertex along so every point is only computed once.
+    float previousX = cx + radius;
+    float previousY = cy;
+    for (int i = 1; i <= segments; ++i) {
 
         // Calculate the x and y coordinates of the vertex
         // which lies on the circumference of the circle
-        float x = cx + cosf(angle) * radius;
-        float y = cy + sinf(angle) * radius;
-
-        // Specify the vertex to OpenGL
-        // This adds the vertex to the current drawing primitive (the line loop)
-        glVertex2f(x, y);
+        float x = cx + unitCircle[2 * i] * radius;
+        float y = cy + unitCircle[2 * i + 1] * radius;
+
+        // The segment runs from the previous vertex to this one.
+        WriteBatchVertex(vertices++, previousX, previousY, color);
+        WriteBatchVertex(vertices++, x, y, color);
+        previousX = x;
+        previousY = y;
     }
 
-    // End the line loop
-    glEnd();
-
     // Reset the line width to default (1.0f)
-    glLineWidth(1.0f);
+    RenderBatchSetLineWidth(1.0f);
 }
 
 /**
  * Draws a filled circle using OpenGL.
+ * The circle is drawn in the color last set with RenderBatchSetColor.
  * @param cx The x-coordinate of the center of the circle.
  * @param cy The y-coordinate of the center of the circle.
  * @param radius The radius of the circle.
@@ -60,21 +232,39 @@ void DrawFilledCircle(float cx, float cy, float radius, int segments) {
         return;
     }
 
+    segments = ClampCircleSegments(segments);
+    const float *unitCircle = GetUnitCircleTable(segments);
+    if (unitCircle == NULL) {
+        return;
+    }
+
     // A triangle fan is a series of connected triangles
     // that share a common central vertex.
     // This is ideal for drawing filled circles,
     // as we can use the center of the circle as the common vertex,
     // and then create triangles that extend out to the circumference.
     // Each subtriangle is formed by the center vertex and two consecutive vertices on the circle's edge.
-    glBegin(GL_TRIANGLE_FAN);
-    glVertex2f(cx, cy);
-    for (int i = 0; i <= segments; ++i) {
-        float angle = (float)i / (float)segments * 2.0f * (float)M_PI;
-        float x = cx + cosf(angle) * radius;
-        float y = cy + sinf(angle) * radius;
-        glVertex2f(x, y);
+    // Since the batch only holds independent triangles, we write out
+    // every triangle of the fan explicitly.
+    RenderBatchVertex *vertices = RenderBatchReserve(RENDER_BATCH_PRIMITIVE_TRIANGLES, (size_t)segments * 3);
+    if (vertices == NULL) {
+        return;
+    }
+
+    float color[4];
+    RenderBatchGetColor(color);
+
+    float previousX = cx + radius;
+    float previousY = cy;
+    for (int i = 1; i <= segments; ++i) {
+        float x = cx + unitCircle[2 * i] * radius;
+        float y = cy + unitCircle[2 * i + 1] * radius;
+        WriteBatchVertex(vertices++, cx, cy, color);
+        WriteBatchVertex(vertices++, previousX, previousY, color);
+        WriteBatchVertex(vertices++, x, y, color);
+        previousX = x;
+        previousY = y;
     }
-    glEnd();
 
     // The line width does not need to be reset here since we did not change it.
 }
@@ -86,6 +276,7 @@ void DrawFilledCircle(float cx, float cy, float radius, int segments) {
  * is easy to line up with an existing object, like a planet's outer radius.
  * Were this done with DrawCircle, the outer edge could be slightly off since line thickness could
  * cause the outermost edge to extend beyond the intended radius.
+ * The ring is drawn in the color last set with RenderBatchSetColor.
  * @param cx The x-coordinate of the center of the ring.
  * @param cy The y-coordinate of the center of the ring.
  * @param innerRadius The inner radius of the ring.
@@ -97,29 +288,10 @@ void DrawRing(float cx, float cy, float innerRadius, float outerRadius, int segm
         return;
     }
 
-    // We use a triangle strip to draw the ring.
-    // A triangle strip is a series of connected triangles
-    // where each triangle shares vertices with the previous one.
-    // This is efficient for drawing shapes like rings,
-    // as we can define the outer and inner edges of the ring
-    // and let OpenGL connect them with triangles.
-    // Each pair of vertices defines a quad segment of the ring,
-    // which is made up of two triangles.
-    glBegin(GL_TRIANGLE_STRIP);
-    for (int i = 0; i <= segments; ++i) {
-        float angle = (float)i / (float)segments * 2.0f * (float)M_PI;
-        float cosAngle = cosf(angle);
-        float sinAngle = sinf(angle);
-
-        float outerX = cx + cosAngle * outerRadius;
-        float outerY = cy + sinAngle * outerRadius;
-        float innerX = cx + cosAngle * innerRadius;
-        float innerY = cy + sinAngle * innerRadius;
-
-        glVertex2f(outerX, outerY);
-        glVertex2f(innerX, innerY);
-    }
-    glEnd();
+    // A solid ring is just a gradient ring whose inner and outer colors match.
+    float color[4];
+    RenderBatchGetColor(color);
+    DrawRadialGradientRing(cx, cy, innerRadius, outerRadius, segments, color, color);
 
     // The line width does not need to be reset here since we did not change it.
 }
@@ -149,7 +321,7 @@ void DrawFeatheredRing(float cx, float cy, float innerRadius, float outerRadius,
     // If no feathering is requested, draw a standard ring.
     float alpha = color[3];
     if (featherWidth <= 0.0f || alpha <= 0.0f) {
-        glColor4fv(color);
+        RenderBatchSetColor(color);
         DrawRing(cx, cy, innerRadius, outerRadius, segments);
         return;
     }
@@ -174,9 +346,10 @@ void DrawFeatheredRing(float cx, float cy, float innerRadius, float outerRadius,
     float outerFadeStart = outerRadius - clampedFeather;
     float outerFadeEnd = outerRadius;
 
-    // Enable blending for smooth transparency transitions.
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    // Use alpha blending for smooth transparency transitions.
+    // The batch restores the default (disabled) blending state itself when it flushes,
+    // so there is no matching cleanup call at the end of this function.
+    RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ALPHA);
 
     // Draw the inner feathered section
     float opaqueColor[4] = {color[0], color[1], color[2], alpha};
@@ -194,12 +367,9 @@ void DrawFeatheredRing(float cx, float cy, float innerRadius, float outerRadius,
 
     // If there is a solid section between innerFadeEnd and outerFadeStart, draw that
     if (outerFadeStart > innerFadeEnd) {
-        glColor4fv(color);
+        RenderBatchSetColor(color);
         DrawRing(cx, cy, innerFadeEnd, outerFadeStart, segments);
     }
-
-    // Cleanup: disable blending to restore OpenGL state.
-    glDisable(GL_BLEND);
 }
 
 /**
@@ -221,35 +391,67 @@ void DrawRadialGradientRing(float cx, float cy, float innerRadius, float outerRa
         return;
     }
 
-    // Render a triangle strip that alternates between the outer and inner radii.
-    // Each segment contributes two vertices: one on the outer ring with the outer color,
-    // and one on the inner ring with the inner color. This produces a smooth radial gradient.
-    glBegin(GL_TRIANGLE_STRIP);
-    for (int i = 0; i <= segments; ++i) {
-        // Solve for the angle around the circle
-        float angle = (float)i / (float)segments * 2.0f * (float)M_PI;
-        float cosAngle = cosf(angle);
-        float sinAngle = sinf(angle);
+    segments = ClampCircleSegments(segments);
+    const float *unitCircle = GetUnitCircleTable(segments);
+    if (unitCircle == NULL) {
+        return;
+    }
+
+    // Each segment of the ring is a quad between two consecutive angles,
+    // with two corners on the outer radius (outer color) and two on the inner radius (inner color).
+    // The color interpolation across each quad produces a smooth radial gradient.
+    // When the inner radius is zero, both inner corners land on the center,
+    // so one of the two triangles would have no area and we skip it,
+    // which leaves a plain fan of triangles around the center.
+    bool isDisc = innerRadius <= 0.0f;
+    size_t verticesPerSegment = isDisc ? 3 : 6;
+    RenderBatchVertex *vertices = RenderBatchReserve(RENDER_BATCH_PRIMITIVE_TRIANGLES,
+        (size_t)segments * verticesPerSegment);
+    if (vertices == NULL) {
+        return;
+    }
 
-        // Now we find the outer vertex position and color
+    // Start with the vertices at angle zero.
+    float previousOuterX = cx + outerRadius;
+    float previousOuterY = cy;
+    float previousInnerX = cx + innerRadius;
+    float previousInnerY = cy;
+
+    for (int i = 1; i <= segments; ++i) {
+        // Look up the direction of this angle around the circle
+        float cosAngle = unitCircle[2 * i];
+        float sinAngle = unitCircle[2 * i + 1];
+
+        // Now we find the outer and inner vertex positions
         float outerX = cx + cosAngle * outerRadius;
         float outerY = cy + sinAngle * outerRadius;
-        glColor4fv(outerColor);
-        glVertex2f(outerX, outerY);
-
-        // And find the inner vertex position and color
         float innerX = cx + cosAngle * innerRadius;
         float innerY = cy + sinAngle * innerRadius;
-        glColor4fv(innerColor);
-        glVertex2f(innerX, innerY);
+
+        // First triangle: previous outer, previous inner, current outer.
+        WriteBatchVertex(vertices++, previousOuterX, previousOuterY, outerColor);
+        WriteBatchVertex(vertices++, previousInnerX, previousInnerY, innerColor);
+        WriteBatchVertex(vertices++, outerX, outerY, outerColor);
+
+        // Second triangle: previous inner, current inner, current outer.
+        if (!isDisc) {
+            WriteBatchVertex(vertices++, previousInnerX, previousInnerY, innerColor);
+            WriteBatchVertex(vertices++, innerX, innerY, innerColor);
+            WriteBatchVertex(vertices++, outerX, outerY, outerColor);
+        }
+
+        previousOuterX = outerX;
+        previousOuterY = outerY;
+        previousInnerX = innerX;
+        previousInnerY = innerY;
     }
-    glEnd();
 }
 
 /**
  * Computes the number of segments to use for drawing a circle of the given radius.
  * This helps ensure that circles are drawn smoothly regardless of their size.
- * Specifically, this formula aims for approximately 1.5 units of arc length per segment.
+ * Specifically, this formula aims for approximately 1.5 units of arc length per segment,
+ * measured on screen using the current detail scale.
  * @param radius The radius of the circle.
  * @return The computed number of segments for the circle.
  */
@@ -263,7 +465,9 @@ int ComputeCircleSegments(float radius) {
     }
 
     // Calculate circumference = 2 * pi * r
-    float circumference = absRadius * 2.0f * (float)M_PI;
+    // We measure it on screen rather than in the world, by way of the detail scale,
+    // so circles seen from far away are not tessellated finer than the pixels they cover.
+    float circumference = absRadius * detailScale * 2.0f * (float)M_PI;
 
     // And then determine segments such that each segment covers about 1.5 units of arc length.
     int segments = (int)ceilf(circumference / 1.5f);
@@ -312,10 +516,15 @@ void DrawFeatheredFilledInCircle(float cx, float cy, float radius, float feather
         clampedFeather = radius;
     }
 
+    // Everything here is drawn with alpha blending. For the solid part this gives
+    // exactly the same result as drawing without blending whenever the color is opaque,
+    // and it lets the whole circle (and its neighbours) share one batch.
+    RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ALPHA);
+
     // Draw the solid inner circle (non-feathered part).
     float innerRadius = radius - clampedFeather;
     if (innerRadius > 0.0f) {
-        glColor4fv(color);
+        RenderBatchSetColor(color);
         DrawFilledCircle(cx, cy, innerRadius, segments);
     } else {
         innerRadius = 0.0f;
@@ -324,7 +533,7 @@ void DrawFeatheredFilledInCircle(float cx, float cy, float radius, float feather
     // If no feathering is requested, we are done.
     if (clampedFeather <= 0.0f) {
         if (innerRadius <= 0.0f) {
-            glColor4fv(color);
+            RenderBatchSetColor(color);
             DrawFilledCircle(cx, cy, radius, segments);
         }
         return;
@@ -333,10 +542,7 @@ void DrawFeatheredFilledInCircle(float cx, float cy, float radius, float feather
     // Otherwise, draw the feathered edge as a radial gradient ring.
     float innerColor[4] = {color[0], color[1], color[2], color[3]};
     float outerColor[4] = {color[0], color[1], color[2], 0.0f};
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     DrawRadialGradientRing(cx, cy, innerRadius, radius, segments, innerColor, outerColor);
-    glDisable(GL_BLEND);
 }
 
 /**
@@ -357,21 +563,19 @@ void DrawBackgroundGradient(int width, int height) {
     float halfHeight = (float)height * 0.5f;
     float radius = sqrtf(halfWidth * halfWidth + halfHeight * halfHeight) * 1.05f;
 
-    // Enable blending for smooth transparency transitions.
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    // Use alpha blending for smooth transparency transitions.
+    RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ALPHA);
 
     DrawRadialGradientRing(centerX, centerY, 0.0f, radius, 128,
         (float[4])BACKGROUND_GRADIENT_INNER_COLOR, (float[4])BACKGROUND_GRADIENT_OUTER_COLOR);
-
-    // Disable blending after drawing the gradient.
-    glDisable(GL_BLEND);
 }
 
 /**
  * Helper function to draw an outlined rectangle using
  * the given outline and fill colors at the specified coordinates.
  * Helpful for drawing the selection box during box selection.
+ * The rectangle is drawn through the render batch without any transform of its own,
+ * so it is meant for screen space, where the modelview matrix is the identity.
  * @param x1 The x-coordinate of one corner of the box.
  * @param y1 The y-coordinate of one corner of the box.
  * @param x2 The x-coordinate of the opposite corner of the box.
@@ -382,53 +586,194 @@ void DrawBackgroundGradient(int width, int height) {
 void DrawOutlinedRectangle(float x1, float y1, float x2, float y2,
     const float outlineColor[4], const float fillColor[4]) {
 
-        // Like glPushAttrib/glPopAttrib, glPushMatrix/glPopMatrix
-        // allow us to save and restore the current OpenGL state.
-        glPushMatrix();
-
-        // We use the identity matrix as our modelview matrix
-        // since we do not want to do any weird transformations to
-        // our selection box; it's just a box.
-        glLoadIdentity();
-
-        // glPushAttrib tells OpenGL to save the current state of certain attributes,
-        // in this case, the enable state and color buffer state.
-        // This is done in order to modify these states for our drawing operations
-        // without permanently changing the global OpenGL state.
-        // Think of it like how when you write assembly code, you push registers onto the stack
-        // before modifying them, and then pop them back to restore their original values.
-        glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        // Draw the filled rectangle first
-        glColor4fv(fillColor);
-        glBegin(GL_QUADS);
-        glVertex2f(x1, y1);
-        glVertex2f(x2, y1);
-        glVertex2f(x2, y2);
-        glVertex2f(x1, y2);
-        glEnd();
-
-        // Draw the outline of the rectangle
-        glColor4fv(outlineColor);
-        glBegin(GL_LINE_LOOP);
-        glVertex2f(x1, y1);
-        glVertex2f(x2, y1);
-        glVertex2f(x2, y2);
-        glVertex2f(x1, y2);
-        glEnd();
-
-        // glPopAttrib restores the previously saved OpenGL state.
-        glPopAttrib();
-
-        // glPopMatrix restores the previous matrix state.
-        glPopMatrix();
+        // Basic validation of parameters.
+        if (outlineColor == NULL || fillColor == NULL) {
+            return;
+        }
+
+        // The rectangle goes through the render batch like everything else,
+        // so a menu full of panels and labels does not need a draw call per rectangle.
+        // Both parts are alpha blended, so translucent fills show what is beneath them.
+        RenderBatchSetBlendMode(RENDER_BATCH_BLEND_ALPHA);
+
+        // Draw the filled rectangle first, as two triangles.
+        RenderBatchVertex *fill = RenderBatchReserve(RENDER_BATCH_PRIMITIVE_TRIANGLES, 6);
+        if (fill != NULL) {
+            WriteBatchVertex(&fill[0], x1, y1, fillColor);
+            WriteBatchVertex(&fill[1], x2, y1, fillColor);
+            WriteBatchVertex(&fill[2], x2, y2, fillColor);
+            WriteBatchVertex(&fill[3], x1, y1, fillColor);
+            WriteBatchVertex(&fill[4], x2, y2, fillColor);
+            WriteBatchVertex(&fill[5], x1, y2, fillColor);
+        }
+
+        // Then the outline of the rectangle, as four separate lines.
+        RenderBatchSetLineWidth(1.0f);
+        RenderBatchVertex *outline = RenderBatchReserve(RENDER_BATCH_PRIMITIVE_LINES, 8);
+        if (outline != NULL) {
+            WriteBatchVertex(&outline[0], x1, y1, outlineColor);
+            WriteBatchVertex(&outline[1], x2, y1, outlineColor);
+            WriteBatchVertex(&outline[2], x2, y1, outlineColor);
+            WriteBatchVertex(&outline[3], x2, y2, outlineColor);
+            WriteBatchVertex(&outline[4], x2, y2, outlineColor);
+            WriteBatchVertex(&outline[5], x1, y2, outlineColor);
+            WriteBatchVertex(&outline[6], x1, y2, outlineColor);
+            WriteBatchVertex(&outline[7], x1, y1, outlineColor);
+        }
+    }
+
+/**
+ * Computes the hash used to find a text layout in the layout cache.
+ * This is the FNV-1a hash over the text, mixed with the font and line spacing.
+ * @param font The font the text is laid out with.
+ * @param lineAdvance The distance between consecutive lines in pixels.
+ * @param text The null-terminated string of text.
+ * @param outLength Receives the length of the text.
+ * @return The hash of the layout key.
+ */
+static uint32_t HashTextLayoutKey(const OpenGLFontEntry *font, float lineAdvance, const char *text, size_t *outLength) {
+    uint32_t hash = 2166136261u;
+    size_t length = 0;
+    for (const char *c = text; *c != '\0'; ++c, ++length) {
+        hash ^= (uint8_t)*c;
+        hash *= 16777619u;
+    }
+
+    uint32_t lineBits;
+    memcpy(&lineBits, &lineAdvance, sizeof(lineBits));
+    hash ^= (uint32_t)(uintptr_t)font;
+    hash *= 16777619u;
+    hash ^= lineBits;
+    hash *= 16777619u;
+
+    *outLength = length;
+    return hash;
+}
+
+/**
+ * Helper function to lay out text in the given font, relative to the start of its first baseline.
+ * Each printable character becomes a quad in the font's glyph atlas;
+ * spaces and characters the atlas does not hold only move the pen (or nothing at all).
+ * @param layout Pointer to the layout to fill. Its glyph array is grown as needed.
+ * @param font The font to lay the text out with.
+ * @param text The null-terminated string of text.
+ * @param length The length of the text.
+ * @param lineAdvance The distance between consecutive lines in pixels.
+ * @return true on success, false on allocation failure.
+ */
+static bool BuildTextLayout(TextLayout *layout, const OpenGLFontEntry *font, const char *text, size_t length, float lineAdvance) {
+    // Every character could become a glyph, so that is how much room we need at most.
+    if (length > layout->glyphCapacity) {
+        TextLayoutGlyph *resized = (TextLayoutGlyph *)realloc(layout->glyphs, length * sizeof(TextLayoutGlyph));
+        if (resized == NULL) {
+            return false;
+        }
+        layout->glyphs = resized;
+        layout->glyphCapacity = length;
+    }
+
+    char *textCopy = (char *)realloc(layout->text, length + 1);
+    if (textCopy == NULL) {
+        return false;
+    }
+    memcpy(textCopy, text, length + 1);
+    layout->text = textCopy;
+
+    float penX = 0.0f;
+    float lineY = 0.0f;
+    size_t glyphCount = 0;
+    float padding = (float)OPENGL_FONT_GLYPH_PADDING;
+
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char character = (unsigned char)text[i];
+
+        // Newlines start the next line, moving down by the font pixel height.
+        if (character == '\n') {
+            penX = 0.0f;
+            lineY += lineAdvance;
+            continue;
+        }
+
+        // The atlas only holds printable ASCII, just like the old display lists did.
+        if (character < OPENGL_FONT_FIRST_CHAR || character >= OPENGL_FONT_FIRST_CHAR + OPENGL_FONT_CHAR_COUNT) {
+            continue;
+        }
+
+        const OpenGLGlyph *glyph = &font->glyphs[character - OPENGL_FONT_FIRST_CHAR];
+
+        // Spaces have nothing to draw, only a distance to move.
+        if (character != ' ') {
+            TextLayoutGlyph *out = &layout->glyphs[glyphCount++];
+            out->x0 = penX - padding;
+            out->y0 = lineY - font->ascent - padding;
+            out->x1 = out->x0 + glyph->width;
+            out->y1 = out->y0 + glyph->height;
+            out->u0 = glyph->u0;
+            out->v0 = glyph->v0;
+            out->u1 = glyph->u1;
+            out->v1 = glyph->v1;
+        }
+
+        penX += glyph->advance;
     }
 
+    layout->glyphCount = glyphCount;
+    return true;
+}
+
+/**
+ * Helper function to find the layout of some text in the layout cache,
+ * laying it out and storing it there if it is not cached yet.
+ * The cache is direct mapped: every key has exactly one slot it can live in,
+ * and a different key landing in the same slot simply replaces it.
+ * @param font The font the text is laid out with.
+ * @param text The null-terminated string of text.
+ * @param lineAdvance The distance between consecutive lines in pixels.
+ * @return A pointer to the layout, or NULL on failure.
+ */
+static const TextLayout *AcquireTextLayout(const OpenGLFontEntry *font, const char *text, float lineAdvance) {
+    size_t length = 0;
+    uint32_t hash = HashTextLayoutKey(font, lineAdvance, text, &length);
+    TextLayout *layout = &textLayoutCache[hash & (TEXT_LAYOUT_CACHE_SIZE - 1)];
+
+    // Comparing the hash first means we almost never have to compare the strings of a different layout.
+    if (layout->valid && layout->hash == hash && layout->font == font && layout->lineAdvance == lineAdvance &&
+        layout->length == length && memcmp(layout->text, text, length) == 0) {
+        return layout;
+    }
+
+    layout->valid = false;
+    if (!BuildTextLayout(layout, font, text, length, lineAdvance)) {
+        return NULL;
+    }
+
+    layout->hash = hash;
+    layout->font = font;
+    layout->lineAdvance = lineAdvance;
+    layout->length = length;
+    layout->valid = true;
+    return layout;
+}
+
+/**
+ * Releases the memory held by the text layout cache.
+ * Should be called once when the program shuts down.
+ */
+void RenderReleaseTextCache(void) {
+    for (size_t i = 0; i < TEXT_LAYOUT_CACHE_SIZE; ++i) {
+        free(textLayoutCache[i].glyphs);
+        free(textLayoutCache[i].text);
+    }
+    memset(textLayoutCache, 0, sizeof(textLayoutCache));
+    lastTextFont = NULL;
+}
+
 /**
  * Renders text directly onto the screen at the specified coordinates.
  * with the specified font height, width, and color.
+ * The text is drawn as quads from the font's glyph atlas through the render batch,
+ * so consecutive calls sharing a font are drawn together in a single draw call.
+ * The text is drawn in screen coordinates, so the modelview matrix must be the identity.
  * @param context The OpenGL context containing rendering information.
  * @param text The null-terminated string of text to render.
  * @param x The x-coordinate on the screen to start rendering the text.
@@ -475,27 +820,44 @@ void DrawScreenText(OpenGLContext *context, const char *text, float x, float y,
     if (fontPixelWidth < 0.0f) {
         fontPixelWidth = 0.0f;
     }
+    uint32_t roundedWidth = (uint32_t)(fontPixelWidth + 0.5f);
+
+    // Most text on screen uses the same one or two sizes over and over,
+    // so we remember the font from last time and only go looking for it when the size changes.
+    const OpenGLFontEntry *font = lastTextFont;
+    if (font == NULL || lastTextContext != context || lastTextHeight != roundedHeight || lastTextWidth != roundedWidth) {
+        // We have a dedicated helper function OpenGLAcquireFont which can create or retrieve
+        // a font glyph atlas based on the specified font parameters.
+        font = OpenGLAcquireFont(context,
+            -1 * roundedHeight, // Height of font. This is negative to indicate character height rather than cell height
+            roundedWidth, // Width of font. 0 means default width based on height.
+            0, // Angle of escapement. Escapement is the angle between the baseline of a character and the x-axis of the device.
+            0, // Orientation angle. This is the angle between the baseline of a character and the x-axis of the device.
+            FW_NORMAL,  // Font weight. FW_NORMAL is normal weight.
+            FALSE,  // Italic attribute option
+            FALSE,  // Underline attribute option
+            FALSE,  // Strikeout attribute option
+            ANSI_CHARSET,  // Character set identifier
+            OUT_TT_PRECIS,  // Output precision. TT means TrueType.
+            CLIP_DEFAULT_PRECIS,  // Clipping precision
+            ANTIALIASED_QUALITY,  // Output quality
+            FF_DONTCARE | DEFAULT_PITCH, // Family and pitch of the font (don't care about family, default pitch)
+            "Consolas"); // Typeface name
+
+        // A NULL font indicates failure to acquire the font.
+        if (font == NULL) {
+            return;
+        }
+
+        lastTextFont = font;
+        lastTextContext = context;
+        lastTextHeight = roundedHeight;
+        lastTextWidth = roundedWidth;
+    }
 
-    // We have a dedicated helper function OpenGLAcquireFont which can create or retrieve
-    // a font display list based on the specified font parameters.
-    GLuint listBase = OpenGLAcquireFont(context, 
-        -1 * roundedHeight, // Height of font. This is negative to indicate character height rather than cell height
-        (uint32_t)(fontPixelWidth + 0.5f), // Width of font. 0 means default width based on height.
-        0, // Angle of escapement. Escapement is the angle between the baseline of a character and the x-axis of the device.
-        0, // Orientation angle. This is the angle between the baseline of a character and the x-axis of the device.
-        FW_NORMAL,  // Font weight. FW_NORMAL is normal weight.
-        FALSE,  // Italic attribute option
-        FALSE,  // Underline attribute option
-        FALSE,  // Strikeout attribute option
-        ANSI_CHARSET,  // Character set identifier
-        OUT_TT_PRECIS,  // Output precision. TT means TrueType.
-        CLIP_DEFAULT_PRECIS,  // Clipping precision
-        ANTIALIASED_QUALITY,  // Output quality
-        FF_DONTCARE | DEFAULT_PITCH, // Family and pitch of the font (don't care about family, default pitch)
-        "Consolas"); // Typeface name
-        
-    // A listBase of 0 indicates failure to acquire the font.
-    if (listBase == 0) {
+    // Fetch the quads making up this text, laying it out only if we have not seen it recently.
+    const TextLayout *layout = AcquireTextLayout(font, text, fontPixelHeight);
+    if (layout == NULL || layout->glyphCount == 0) {
         return;
     }
 
@@ -505,74 +867,38 @@ void DrawScreenText(OpenGLContext *context, const char *text, float x, float y,
     float defaultColor[4] = {1.0f, 1.0f, 1.0f, 1.0f};
     const float *finalColor = color != NULL ? color : defaultColor;
 
-    // We save the current OpenGL state before modifying it for text rendering.
-    glPushAttrib(GL_CURRENT_BIT | GL_LIST_BIT | GL_ENABLE_BIT);
-
-    // We disable texturing and lighting to ensure the text is rendered correctly
-    // without any unwanted effects (this is UI text, as opposed to some sort of 
-    // text being rendered into some game world scene).
-
-    glDisable(GL_TEXTURE_2D);
-    glDisable(GL_LIGHTING);
-    
-    // Apply the desired text color.
-    glColor4fv(finalColor);
-
-    // We subtract 32 from the list base because
-    // the first 32 ASCII characters are non-printable control characters,
-    // and as such our font from OpenGLAcquireFont does not include them.
-    glListBase(listBase - 32);
-
-    // Will make any subsequent matrix operations affect the modelview matrix.
-    glMatrixMode(GL_MODELVIEW);
-
-    // Save the current matrix state.
-    glPushMatrix();
-    
-    // Load the identity matrix to reset any previous transformations.
-    glLoadIdentity();
-
-    // Now we render the text line by line, handling newlines appropriately.
-    
-    // The starting y-coordinate for the first line of text.
-    float lineY = y;
-    const char *lineStart = text;
-
-    // Loop through each line in the text until we reach the null terminator.
-    while (*lineStart != '\0') {
-        
-        // We find the end of the current line by searching for a newline character,
-        // and then once we know the line length, we can render that line.
-        const char *lineEnd = strchr(lineStart, '\n');
-        if (lineEnd == NULL) {
-            // If no newline is found, the line goes until the end of the string.
-            lineEnd = lineStart + strlen(lineStart);
+    // Glyphs are drawn at exactly the size they were rasterized at,
+    // so snapping the origin to a whole pixel keeps them as crisp as the old bitmap fonts.
+    float originX = floorf(x + 0.5f);
+    float originY = floorf(y + 0.5f);
+
+    // Two triangles per glyph. Very long text is split over several reservations
+    // so that it never asks for more than the batch can hold at once.
+    size_t maxGlyphsPerReserve = RENDER_BATCH_MAX_TEXTURED_VERTICES / 6;
+    for (size_t first = 0; first < layout->glyphCount; first += maxGlyphsPerReserve) {
+        size_t count = layout->glyphCount - first;
+        if (count > maxGlyphsPerReserve) {
+            count = maxGlyphsPerReserve;
         }
 
-        // Determine the length of the current line.
-        size_t lineLength = (size_t)(lineEnd - lineStart);
-
-        // Render the current line at the specified (x, lineY) position.
-        glRasterPos2f(x, lineY);
-        if (lineLength > 0) {
-            // The glCallLists function executes a list of display lists.
-            // Here, we use it to render each character in the current line.
-            glCallLists((GLsizei)lineLength, GL_UNSIGNED_BYTE, lineStart);
+        RenderBatchTexturedVertex *vertices = RenderBatchReserveTextured(font->texture, count * 6);
+        if (vertices == NULL) {
+            return;
         }
 
-        // If we reached the end of the string, we are done.
-        if (*lineEnd == '\0') {
-            break;
+        for (size_t i = 0; i < count; ++i) {
+            const TextLayoutGlyph *glyph = &layout->glyphs[first + i];
+            float x0 = originX + glyph->x0;
+            float y0 = originY + glyph->y0;
+            float x1 = originX + glyph->x1;
+            float y1 = originY + glyph->y1;
+
+            WriteTexturedVertex(vertices++, x0, y0, glyph->u0, glyph->v0, finalColor);
+            WriteTexturedVertex(vertices++, x1, y0, glyph->u1, glyph->v0, finalColor);
+            WriteTexturedVertex(vertices++, x1, y1, glyph->u1, glyph->v1, finalColor);
+            WriteTexturedVertex(vertices++, x0, y0, glyph->u0, glyph->v0, finalColor);
+            WriteTexturedVertex(vertices++, x1, y1, glyph->u1, glyph->v1, finalColor);
+            WriteTexturedVertex(vertices++, x0, y1, glyph->u0, glyph->v1, finalColor);
         }
-
-        // Move to the start of the next line,
-        // and adjust the y-coordinate for the next line 
-        // based on the font pixel height.
-        lineStart = lineEnd + 1;
-        lineY += fontPixelHeight;
     }
-
-    // Reset OpenGL state to what it was before rendering the text.
-    glPopMatrix();
-    glPopAttrib();
 }
@@ -8,7 +8,9 @@
 
 #include <stdint.h>
 #include <math.h>
+#include <stdbool.h>
 #include "openglUtilities.h"
+#include "Utilities/renderBatchUtilities.h"
 
 // Type Definitions
 typedef struct {
@@ -28,6 +30,44 @@ typedef struct {
 // Maximum number of segments to use when drawing circles to avoid excessive detail.
 #define MAX_CIRCLE_SEGMENTS 256
 
+// Fewest segments a shape may be reduced to by ComputeDetailSegments.
+#define MIN_DETAIL_SEGMENTS 8
+
+// The detail scale is snapped up to a multiple of 1 / DETAIL_SCALE_STEPS,
+// so that slowly zooming does not change segment counts (and invalidate cached geometry) every frame.
+#define DETAIL_SCALE_STEPS 16.0f
+
+// Number of slots in the text layout cache. Must be a power of two.
+// The menus draw at most a few dozen distinct strings a frame, so this rarely evicts anything.
+#define TEXT_LAYOUT_CACHE_SIZE 256
+
+// A single glyph quad of laid out text, relative to the start of the text's first baseline.
+typedef struct TextLayoutGlyph {
+    float x0;
+    float y0;
+    float x1;
+    float y1;
+    float u0;
+    float v0;
+    float u1;
+    float v1;
+} TextLayoutGlyph;
+
+// A string laid out into glyph quads in one particular font and line spacing,
+// kept in a cache so that text drawn every frame is only laid out once.
+// text is a copy of the string the layout was made from, used to confirm cache hits.
+typedef struct TextLayout {
+    bool valid;
+    uint32_t hash;
+    const OpenGLFontEntry *font;
+    float lineAdvance;
+    char *text;
+    size_t length;
+    TextLayoutGlyph *glyphs;
+    size_t glyphCount;
+    size_t glyphCapacity;
+} TextLayout;
+
 // Color of the background (RGBA)
 #define BACKGROUND_COLOR_R 0.3f
 #define BACKGROUND_COLOR_G 0.25f
@@ -41,8 +81,42 @@ typedef struct {
 #define BACKGROUND_GRADIENT_OUTER_COLOR {BACKGROUND_COLOR_R, BACKGROUND_COLOR_G, BACKGROUND_COLOR_B, 1.0f}
 
 
+/**
+ * Sets the detail scale used when choosing how many segments to tessellate shapes with.
+ * This should be the number of screen pixels per world unit (the camera zoom) while the
+ * world is being drawn, and 1.0 otherwise. Values above 1.0 are treated as 1.0,
+ * since zooming in never needs more detail than drawing at full size.
+ * @param scale The detail scale to use.
+ */
+void RenderSetDetailScale(float scale);
+
+/**
+ * Retrieves the detail scale set with RenderSetDetailScale.
+ * @return The current detail scale, between 0 and 1.
+ */
+float RenderGetDetailScale(void);
+
+/**
+ * Scales a segment count intended for full detail down by the current detail scale.
+ * Never returns fewer than MIN_DETAIL_SEGMENTS nor more than fullSegments.
+ * @param fullSegments The number of segments to use at full detail.
+ * @return The number of segments to use at the current detail scale.
+ */
+int ComputeDetailSegments(int fullSegments);
+
+/**
+ * Retrieves the unit circle table for the given number of segments,
+ * building it the first time it is asked for.
+ * Entry i of the table holds cos and sin of (i / segments) * 2 * pi
+ * at indices 2 * i and 2 * i + 1, for i from 0 to segments inclusive.
+ * @param segments The number of segments, between 3 and MAX_CIRCLE_SEGMENTS.
+ * @return A pointer to the table, or NULL if segments is out of range or allocation failed.
+ */
+const float *GetUnitCircleTable(int segments);
+
 /**
  * Draws a hollow circle using OpenGL.
+ * The circle is drawn in the color last set with RenderBatchSetColor.
  * @param cx The x-coordinate of the center of the circle.
  * @param cy The y-coordinate of the center of the circle.
  * @param radius The radius of the circle.
@@ -53,6 +127,7 @@ void DrawCircle(float cx, float cy, float radius, int segments, float thickness)
 
 /**
  * Draws a filled circle using OpenGL.
+ * The circle is drawn in the color last set with RenderBatchSetColor.
  * @param cx The x-coordinate of the center of the circle.
  * @param cy The y-coordinate of the center of the circle.
  * @param radius The radius of the circle.
@@ -67,6 +142,7 @@ void DrawFilledCircle(float cx, float cy, float radius, int segments);
  * is easy to line up with an existing object, like a planet's outer radius.
  * Were this done with DrawCircle, the outer edge could be slightly off since line thickness could
  * cause the outermost edge to extend beyond the intended radius.
+ * The ring is drawn in the color last set with RenderBatchSetColor.
  * @param cx The x-coordinate of the center of the ring.
  * @param cy The y-coordinate of the center of the ring.
  * @param innerRadius The inner radius of the ring.
@@ -117,7 +193,8 @@ void DrawFeatheredFilledInCircle(float cx, float cy, float radius, float feather
 /**
  * Computes the number of segments to use for drawing a circle of the given radius.
  * This helps ensure that circles are drawn smoothly regardless of their size.
- * Specifically, this formula aims for approximately 1.5 units of arc length per segment.
+ * Specifically, this formula aims for approximately 1.5 units of arc length per segment,
+ * measured on screen using the current detail scale.
  * @param radius The radius of the circle.
  * @return The computed number of segments for the circle.
  */
@@ -134,6 +211,8 @@ void DrawBackgroundGradient(int width, int height);
  * Helper function to draw an outlined rectangle using
  * the given outline and fill colors at the specified coordinates.
  * Helpful for drawing the selection box during box selection.
+ * The rectangle is drawn through the render batch without any transform of its own,
+ * so it is meant for screen space, where the modelview matrix is the identity.
  * @param x1 The x-coordinate of one corner of the box.
  * @param y1 The y-coordinate of one corner of the box.
  * @param x2 The x-coordinate of the opposite corner of the box.
@@ -144,9 +223,18 @@ void DrawBackgroundGradient(int width, int height);
 void DrawOutlinedRectangle(float x1, float y1, float x2, float y2,
     const float outlineColor[4], const float fillColor[4]);
 
+/**
+ * Releases the memory held by the text layout cache.
+ * Should be called once when the program shuts down.
+ */
+void RenderReleaseTextCache(void);
+
 /**
  * Renders text directly onto the screen at the specified coordinates.
  * with the specified font height, width, and color.
+ * The text is drawn as quads from the font's glyph atlas through the render batch,
+ * so consecutive calls sharing a font are drawn together in a single draw call.
+ * The text is drawn in screen coordinates, so the modelview matrix must be the identity.
  * @param context The OpenGL context containing rendering information.
  * @param text The null-terminated string of text to render.
  * @param x The x-coordinate on the screen to start rendering the text.
@@ -0,0 +1,288 @@
+/**
+ * Implementation of the simulation math utilities.
+ * Everything here works on the bits of its floats with integer arithmetic,
+ * which behaves the same on every compiler and every processor,
+ * and the float it finally returns is assembled from those bits or converted
+ * from an integer with a single, exactly defined rounding.
+ * @file Utilities/simMathUtilities.c
+ * @author abmize
+ */
+#include "Utilities/simMathUtilities.h"
+
+// 2^64 / (2 * pi), rounded down, split into its high and low 32 bits.
+// Multiplying an angle by this turns radians into a fraction of a full turn with 64 bits after the point.
+#define SIM_MATH_TURN_SCALE_HIGH 0x28BE60DBull
+#define SIM_MATH_TURN_SCALE_LOW 0x9391054Aull
+
+// The number of fractional bits in the fixed point numbers the sine is evaluated with.
+// A quarter turn of phase is also 2^30, so the phase within a quadrant is already in this format.
+#define SIM_MATH_FIXED_BITS 30
+#define SIM_MATH_FIXED_ONE (1ull << SIM_MATH_FIXED_BITS)
+
+// Angles smaller in magnitude than 2^-12 radians have a sine which rounds to the angle itself,
+// and a cosine which rounds to 1, so those are returned directly.
+// This is the biased exponent such angles have at most.
+#define SIM_MATH_SMALL_ANGLE_EXPONENT (127 - 13)
+
+// The coefficients of the Taylor series of sin(pi / 2 * x), (pi / 2)^k / k! for odd k from 1 to 15,
+// in fixed point with SIM_MATH_FIXED_BITS fractional bits.
+// Over 0 <= x <= 1, the terms left out add up to less than 1e-11, well below the fixed point precision.
+static const uint64_t SIM_MATH_SINE_COEFFICIENTS[8] = {
+    1686629713ull, 693598668ull, 85569306ull, 5026995ull, 172272ull, 3864ull, 61ull, 1ull
+};
+
+/**
+ * Reads the bits of a float as an integer.
+ * @param value The float to read.
+ * @return The bits of the float.
+ */
+static uint32_t SimFloatToBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/**
+ * Builds a float from its bits.
+ * @param bits The bits of the float.
+ * @return The float with those bits.
+ */
+static float SimBitsToFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * Computes the square root of a float, correctly rounded to the nearest float,
+ * which is also what IEEE 754 requires of sqrtf, so the two agree wherever sqrtf is correct.
+ * @param value The value to take the square root of.
+ * @return The square root of value. The square root of a negative value is NaN,
+ *         and those of 0, -0, infinity and NaN are themselves.
+ */
+float SimSqrt(float value) {
+    uint32_t bits = SimFloatToBits(value);
+    uint32_t exponentBits = (bits >> 23) & 0xFFu;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+
+    // 0, -0, infinity and NaN are their own square roots.
+    if ((bits & 0x7FFFFFFFu) == 0u || bits == 0x7F800000u || (exponentBits == 0xFFu && mantissa != 0u)) {
+        return value;
+    }
+
+    // Anything else below 0, including negative infinity, has no square root.
+    if ((bits & 0x80000000u) != 0u) {
+        return SimBitsToFloat(0x7FC00000u);
+    }
+
+    // Split the value into a 24 bit integer mantissa and a power of two, value = mantissa * 2^(exponent - 23),
+    // shifting up the mantissa of a subnormal value until it has its leading bit where a normal one would.
+    int32_t exponent;
+    if (exponentBits == 0u) {
+        exponent = 1 - 127;
+        while ((mantissa & 0x800000u) == 0u) {
+            mantissa <<= 1;
+            exponent--;
+        }
+    } else {
+        mantissa |= 0x800000u;
+        exponent = (int32_t)exponentBits - 127;
+    }
+
+    // The power of two only has an exact square root if it is even, so make it so.
+    if ((exponent & 1) != 0) {
+        mantissa <<= 1;
+        exponent--;
+    }
+
+    // Scale the mantissa up to somewhere between 2^46 and 2^48, so that its integer square root
+    // has exactly 24 bits, as many as the mantissa of the result.
+    // Then value = radicand * 2^(exponent - 46), and its square root is sqrt(radicand) * 2^((exponent - 46) / 2).
+    uint64_t radicand = (uint64_t)mantissa << 23;
+
+    // Take the integer square root one bit at a time, from the top down.
+    // Afterwards, root is the square root rounded down, and remainder is radicand - root^2.
+    uint64_t remainder = radicand;
+    uint64_t root = 0u;
+    uint64_t bit = 1ull << 46;
+    while (bit > remainder) {
+        bit >>= 2;
+    }
+    while (bit != 0u) {
+        if (remainder >= root + bit) {
+            remainder -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    // Round to nearest. The true square root is past root + 1/2 exactly when
+    // radicand > (root + 1/2)^2 = root^2 + root + 1/4, that is, when remainder > root.
+    // It can never be exactly halfway, so there are no ties to break.
+    if (remainder > root) {
+        root++;
+    }
+
+    // Put the float together. Rounding up may have carried root to 2^24,
+    // in which case the carry goes into the exponent field, which is just what it should do.
+    uint32_t resultBits = ((uint32_t)(exponent / 2 + 127) << 23) + ((uint32_t)root - 0x800000u);
+    return SimBitsToFloat(resultBits);
+}
+
+/**
+ * Converts an angle into a phase, the fraction of a full turn it makes, as a 32 bit integer.
+ * A full turn is 2^32, so the phase wraps around exactly as the angle does,
+ * and each quarter turn is 2^30, with the quadrant in the top two bits.
+ * @param bits The bits of the angle in radians, which must be finite.
+ * @return The phase of the angle, rounded down to the nearest 2^-32 of a turn.
+ */
+static uint32_t SimAngleToPhase(uint32_t bits) {
+    uint32_t exponentBits = (bits >> 23) & 0xFFu;
+    uint64_t mantissa = bits & 0x7FFFFFu;
+    int32_t exponent;
+    if (exponentBits == 0u) {
+        exponent = 1 - 127;
+    } else {
+        mantissa |= 0x800000u;
+        exponent = (int32_t)exponentBits - 127;
+    }
+
+    // The angle is mantissa * 2^(exponent - 23), so its phase is mantissa * 2^(exponent - 23) * 2^32 / (2 * pi),
+    // which is mantissa * scale * 2^(exponent - 55) with scale = 2^64 / (2 * pi).
+    // Multiply out mantissa * scale exactly, as a 128 bit integer split into its high and low 64 bits.
+    uint64_t lowProduct = mantissa * SIM_MATH_TURN_SCALE_LOW;
+    uint64_t highProduct = mantissa * SIM_MATH_TURN_SCALE_HIGH;
+    uint64_t low = lowProduct + (highProduct << 32);
+    uint64_t high = (highProduct >> 32) + (low < lowProduct ? 1u : 0u);
+
+    // Then shift it into place. Only the low 32 bits are wanted, since whole turns do not change the phase.
+    int32_t shift = 55 - exponent;
+    uint64_t phase;
+    if (shift >= 128) {
+        phase = 0u;
+    } else if (shift >= 64) {
+        phase = high >> (shift - 64);
+    } else if (shift > 0) {
+        phase = (low >> shift) | (high << (64 - shift));
+    } else if (shift > -32) {
+        phase = low << -shift;
+    } else {
+        phase = 0u;
+    }
+
+    // A negative angle turns the other way.
+    if ((bits & 0x80000000u) != 0u) {
+        return 0u - (uint32_t)phase;
+    }
+    return (uint32_t)phase;
+}
+
+/**
+ * Computes the sine of a phase in fixed point, with SIM_MATH_FIXED_BITS fractional bits.
+ * The sine is only evaluated over the first quadrant, from 0 to a quarter turn,
+ * and the other three are reflections of it: the second runs the first backwards,
+ * and the third and fourth are the first two negated.
+ * @param phase The phase, where a full turn is 2^32.
+ * @return The sine of the phase in fixed point, from -2^30 to 2^30.
+ */
+static int32_t SimPhaseSine(uint32_t phase) {
+    uint32_t quadrant = phase >> SIM_MATH_FIXED_BITS;
+    uint64_t x = phase & (uint32_t)(SIM_MATH_FIXED_ONE - 1u);
+    if ((quadrant & 1u) != 0u) {
+        x = SIM_MATH_FIXED_ONE - x;
+    }
+
+    // Evaluate x * (c1 - x^2 * (c3 - x^2 * (c5 - ...))), from the innermost term out,
+    // always in this order. Each coefficient is larger than the next times x^2,
+    // so nothing ever goes below 0 and all of it can be done in unsigned integers.
+    uint64_t xSquared = (x * x) >> SIM_MATH_FIXED_BITS;
+    uint64_t sum = SIM_MATH_SINE_COEFFICIENTS[7];
+    for (int i = 6; i >= 0; --i) {
+        sum = SIM_MATH_SINE_COEFFICIENTS[i] - ((xSquared * sum) >> SIM_MATH_FIXED_BITS);
+    }
+    uint64_t sine = (x * sum) >> SIM_MATH_FIXED_BITS;
+
+    // The rounding of the coefficients may overshoot 1 by a hair at the top of the quadrant.
+    if (sine > SIM_MATH_FIXED_ONE) {
+        sine = SIM_MATH_FIXED_ONE;
+    }
+
+    if ((quadrant & 2u) != 0u) {
+        return -(int32_t)sine;
+    }
+    return (int32_t)sine;
+}
+
+/**
+ * Converts a fixed point number, with SIM_MATH_FIXED_BITS fractional bits, into a float.
+ * @param value The fixed point number.
+ * @return The number as a float.
+ */
+static float SimFixedToFloat(int32_t value) {
+    // Converting the integer rounds once, to nearest, and scaling by a power of two is exact.
+    return (float)value * (1.0f / (float)SIM_MATH_FIXED_ONE);
+}
+
+/**
+ * Computes the sine of an angle.
+ * For angles within a few thousand radians of 0, the result is within 5e-8 of the true sine,
+ * and it is the same on every build whatever the angle.
+ * @param angle The angle in radians. Infinity and NaN are treated as 0.
+ * @return The sine of the angle.
+ */
+float SimSin(float angle) {
+    float sine;
+    float cosine;
+    SimSinCos(angle, &sine, &cosine);
+    return sine;
+}
+
+/**
+ * Computes the cosine of an angle.
+ * For angles within a few thousand radians of 0, the result is within 5e-8 of the true cosine,
+ * and it is the same on every build whatever the angle.
+ * @param angle The angle in radians. Infinity and NaN are treated as 0.
+ * @return The cosine of the angle.
+ */
+float SimCos(float angle) {
+    float sine;
+    float cosine;
+    SimSinCos(angle, &sine, &cosine);
+    return cosine;
+}
+
+/**
+ * Computes both the sine and the cosine of an angle,
+ * giving exactly the same results as SimSin and SimCos but reducing the angle only once.
+ * @param angle The angle in radians. Infinity and NaN are treated as 0.
+ * @param outSin Where to write the sine of the angle.
+ * @param outCos Where to write the cosine of the angle.
+ */
+void SimSinCos(float angle, float *outSin, float *outCos) {
+    // Basic validation of output pointers.
+    if (outSin == NULL || outCos == NULL) {
+        return;
+    }
+
+    uint32_t bits = SimFloatToBits(angle);
+    uint32_t exponentBits = (bits >> 23) & 0xFFu;
+
+    if (exponentBits == 0xFFu) {
+        *outSin = 0.0f;
+        *outCos = 1.0f;
+        return;
+    }
+
+    if (exponentBits <= SIM_MATH_SMALL_ANGLE_EXPONENT) {
+        *outSin = angle;
+        *outCos = 1.0f;
+        return;
+    }
+
+    // The cosine is the sine a quarter turn further on.
+    uint32_t phase = SimAngleToPhase(bits);
+    *outSin = SimFixedToFloat(SimPhaseSine(phase));
+    *outCos = SimFixedToFloat(SimPhaseSine(phase + (uint32_t)SIM_MATH_FIXED_ONE));
+}
@@ -0,0 +1,59 @@
+/**
+ * Header file for the simulation math utilities.
+ * The server and every client run the same simulation side by side, and only stay in step
+ * if each of them computes exactly the same bits from the same inputs.
+ * Basic float arithmetic (+, -, *, /) is pinned down exactly by IEEE 754, so it does,
+ * as long as the compiler neither keeps extra precision nor fuses a multiply and an add
+ * into one instruction (see CFLAGS in the Makefile).
+ * The math library is another matter: sqrtf, sinf and cosf are free to differ in their last bit
+ * from one compiler, library version or set of flags to the next, and those tiny differences
+ * add up over a match until the server and its clients disagree.
+ * These functions stand in for them wherever the simulation needs them, and are built
+ * out of integer arithmetic only, so they give the same bits on every build.
+ * @file Utilities/simMathUtilities.h
+ * @author abmize
+ */
+#ifndef _SIM_MATH_UTILITIES_H_
+#define _SIM_MATH_UTILITIES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Computes the square root of a float, correctly rounded to the nearest float,
+ * which is also what IEEE 754 requires of sqrtf, so the two agree wherever sqrtf is correct.
+ * @param value The value to take the square root of.
+ * @return The square root of value. The square root of a negative value is NaN,
+ *         and those of 0, -0, infinity and NaN are themselves.
+ */
+float SimSqrt(float value);
+
+/**
+ * Computes the sine of an angle.
+ * For angles within a few thousand radians of 0, the result is within 5e-8 of the true sine,
+ * and it is the same on every build whatever the angle.
+ * @param angle The angle in radians. Infinity and NaN are treated as 0.
+ * @return The sine of the angle.
+ */
+float SimSin(float angle);
+
+/**
+ * Computes the cosine of an angle.
+ * For angles within a few thousand radians of 0, the result is within 5e-8 of the true cosine,
+ * and it is the same on every build whatever the angle.
+ * @param angle The angle in radians. Infinity and NaN are treated as 0.
+ * @return The cosine of the angle.
+ */
+float SimCos(float angle);
+
+/**
+ * Computes both the sine and the cosine of an angle,
+ * giving exactly the same results as SimSin and SimCos but reducing the angle only once.
+ * @param angle The angle in radians. Infinity and NaN are treated as 0.
+ * @param outSin Where to write the sine of the angle.
+ * @param outCos Where to write the cosine of the angle.
+ */
+void SimSinCos(float angle, float *outSin, float *outCos);
+
+#endif // _SIM_MATH_UTILITIES_H_
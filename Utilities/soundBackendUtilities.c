@@ -0,0 +1,376 @@
+/**
+ * Implementation of the sound backends.
+ * Each backend keeps its state in statics of its own, since there is only ever one mixer to feed.
+ * @file Utilities/soundBackendUtilities.c
+ * @author abmize
+ */
+#include "Utilities/soundBackendUtilities.h"
+
+// --- Null backend ---
+
+/**
+ * Opens the null backend, which has nothing to open.
+ * @param self Pointer to the SoundBackend instance.
+ * @param sampleRate Unused.
+ * @param wakeEvent Unused.
+ * @param outputPath Unused.
+ * @return Always true.
+ */
+static bool NullBackendOpen(SoundBackend *self, unsigned int sampleRate, HANDLE wakeEvent, const char *outputPath) {
+    (void)self;
+    (void)sampleRate;
+    (void)wakeEvent;
+    (void)outputPath;
+    return true;
+}
+
+/**
+ * The null backend never wants any output.
+ * @param self Pointer to the SoundBackend instance.
+ * @return Always NULL.
+ */
+static int16_t *NullBackendAcquireBuffer(SoundBackend *self) {
+    (void)self;
+    return NULL;
+}
+
+/**
+ * Discards a buffer. Never actually called, since the null backend never hands out buffers.
+ * @param self Pointer to the SoundBackend instance.
+ * @param buffer Unused.
+ */
+static void NullBackendSubmitBuffer(SoundBackend *self, int16_t *buffer) {
+    (void)self;
+    (void)buffer;
+}
+
+/**
+ * Closes the null backend, which has nothing to close.
+ * @param self Pointer to the SoundBackend instance.
+ */
+static void NullBackendClose(SoundBackend *self) {
+    (void)self;
+}
+
+SoundBackend SOUND_NULL_BACKEND = {
+    "Null",
+    false,
+    NullBackendOpen,
+    NullBackendAcquireBuffer,
+    NullBackendSubmitBuffer,
+    NullBackendClose
+};
+
+// --- waveOut backend ---
+
+// The output device, and the ring of buffers kept queued up on it.
+static HWAVEOUT waveOutHandle = NULL;
+static int16_t waveOutBuffers[SOUND_BACKEND_WAVE_OUT_BUFFER_COUNT][SOUND_BACKEND_BUFFER_SAMPLES];
+static WAVEHDR waveOutHeaders[SOUND_BACKEND_WAVE_OUT_BUFFER_COUNT];
+static bool waveOutPrepared[SOUND_BACKEND_WAVE_OUT_BUFFER_COUNT];
+static bool waveOutSubmitted[SOUND_BACKEND_WAVE_OUT_BUFFER_COUNT];
+
+/**
+ * Opens the default Windows audio device and prepares the ring of buffers.
+ * @param self Pointer to the SoundBackend instance.
+ * @param sampleRate The number of samples per second the mixer will produce.
+ * @param wakeEvent The event the device signals whenever it finishes playing a buffer.
+ * @param outputPath Unused.
+ * @return true if the device was opened, false otherwise.
+ */
+static bool WaveOutBackendOpen(SoundBackend *self, unsigned int sampleRate, HANDLE wakeEvent, const char *outputPath) {
+    (void)self;
+    (void)outputPath;
+
+    // Describe the output format to the Windows wave output device.
+    // A WAVEFORMATEX structure describes the audio format.
+    // https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/ns-mmeapi-waveformatex
+    WAVEFORMATEX format = {0};
+    format.wFormatTag = WAVE_FORMAT_PCM;
+    format.nChannels = 1;
+    format.nSamplesPerSec = sampleRate;
+    format.wBitsPerSample = 16;
+    format.nBlockAlign = (format.nChannels * format.wBitsPerSample) / 8;
+    format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+
+    // waveOutOpen opens the default waveform output device.
+    // Documentation for waveOutOpen: https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/nf-mmeapi-waveoutopen
+    // It has the following arguments:
+    // 1. Pointer to an HWAVEOUT handle that receives the device handle.
+    // 2. Device identifier (WAVE_MAPPER selects the default device).
+    // 3. Pointer to a WAVEFORMATEX structure that describes the desired format.
+    // 4. Callback, here the event the device should signal whenever it finishes a buffer.
+    // 5. Instance data (not used here, so we pass 0).
+    // 6. Flags (CALLBACK_EVENT says the callback argument is an event handle).
+    waveOutHandle = NULL;
+    MMRESULT openResult = waveOutOpen(&waveOutHandle, WAVE_MAPPER, &format, (DWORD_PTR)wakeEvent, 0, CALLBACK_EVENT);
+    if (openResult != MMSYSERR_NOERROR || waveOutHandle == NULL) {
+        waveOutHandle = NULL;
+        return false;
+    }
+
+    // A WAVEHDR structure describes one audio buffer to play.
+    // https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/ns-mmeapi-wavehdr
+    // Each buffer is prepared once up front and then reused for as long as the device is open.
+    // waveOutPrepareHeader: https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/nf-mmeapi-waveoutprepareheader
+    for (size_t i = 0; i < SOUND_BACKEND_WAVE_OUT_BUFFER_COUNT; ++i) {
+        memset(&waveOutHeaders[i], 0, sizeof(waveOutHeaders[i]));
+        waveOutHeaders[i].lpData = (LPSTR)waveOutBuffers[i];
+        waveOutHeaders[i].dwBufferLength = (DWORD)sizeof(waveOutBuffers[i]);
+        waveOutPrepared[i] = waveOutPrepareHeader(waveOutHandle, &waveOutHeaders[i], sizeof(waveOutHeaders[i])) == MMSYSERR_NOERROR;
+        waveOutSubmitted[i] = false;
+    }
+    return true;
+}
+
+/**
+ * Retrieves a buffer the device is not holding on to: one never submitted,
+ * or one it has flagged as done playing.
+ * @param self Pointer to the SoundBackend instance.
+ * @return An empty buffer, or NULL if every buffer is still queued on the device.
+ */
+static int16_t *WaveOutBackendAcquireBuffer(SoundBackend *self) {
+    (void)self;
+    for (size_t i = 0; i < SOUND_BACKEND_WAVE_OUT_BUFFER_COUNT; ++i) {
+        if (!waveOutPrepared[i] || (waveOutSubmitted[i] && (waveOutHeaders[i].dwFlags & WHDR_DONE) == 0u)) {
+            continue;
+        }
+
+        // Until it is submitted again, the buffer belongs to the mixer.
+        waveOutSubmitted[i] = false;
+        return waveOutBuffers[i];
+    }
+    return NULL;
+}
+
+/**
+ * Queues a filled buffer on the device, which plays it after any already queued.
+ * @param self Pointer to the SoundBackend instance.
+ * @param buffer The filled buffer.
+ */
+static void WaveOutBackendSubmitBuffer(SoundBackend *self, int16_t *buffer) {
+    (void)self;
+    for (size_t i = 0; i < SOUND_BACKEND_WAVE_OUT_BUFFER_COUNT; ++i) {
+        if (waveOutBuffers[i] != buffer) {
+            continue;
+        }
+
+        // waveOutWrite hands the buffer to the device.
+        // https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/nf-mmeapi-waveoutwrite
+        waveOutSubmitted[i] = waveOutWrite(waveOutHandle, &waveOutHeaders[i], sizeof(waveOutHeaders[i])) == MMSYSERR_NOERROR;
+        return;
+    }
+}
+
+/**
+ * Stops playback, releases the buffers, and closes the device.
+ * @param self Pointer to the SoundBackend instance.
+ */
+static void WaveOutBackendClose(SoundBackend *self) {
+    (void)self;
+    if (waveOutHandle == NULL) {
+        return;
+    }
+
+    // waveOutReset stops playback and marks every queued buffer as done,
+    // so they can all be unprepared straight away.
+    // https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/nf-mmeapi-waveoutreset
+    waveOutReset(waveOutHandle);
+
+    // https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/nf-mmeapi-waveoutunprepareheader
+    // waveOutUnprepareHeader releases the resources allocated during preparation.
+    // You can't just reuse or release a buffer while it is still prepared,
+    // since the audio system may still be using it until unpreparation is done.
+    for (size_t i = 0; i < SOUND_BACKEND_WAVE_OUT_BUFFER_COUNT; ++i) {
+        if (waveOutPrepared[i]) {
+            waveOutUnprepareHeader(waveOutHandle, &waveOutHeaders[i], sizeof(waveOutHeaders[i]));
+            waveOutPrepared[i] = false;
+        }
+        waveOutSubmitted[i] = false;
+    }
+
+    // https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/nf-mmeapi-waveoutclose
+    // waveOutClose closes the waveform output device.
+    // If the output device is not closed the audio system may leak resources
+    // or behave unpredictably, perhaps not letting a future call to waveOutOpen succeed.
+    waveOutClose(waveOutHandle);
+    waveOutHandle = NULL;
+}
+
+SoundBackend SOUND_WAVE_OUT_BACKEND = {
+    "waveOut",
+    true,
+    WaveOutBackendOpen,
+    WaveOutBackendAcquireBuffer,
+    WaveOutBackendSubmitBuffer,
+    WaveOutBackendClose
+};
+
+// --- WAV file backend ---
+
+// Size in bytes of the header at the start of a plain PCM WAV file.
+#define WAV_FILE_HEADER_SIZE 44u
+
+// The file being written, along with how much has been written to it
+// and when writing started, so the file can be kept in step with the clock.
+static FILE *wavFile = NULL;
+static unsigned int wavFileSampleRate = 0;
+static uint64_t wavFileSamplesWritten = 0;
+static DWORD wavFileStartMs = 0;
+static int16_t wavFileBuffer[SOUND_BACKEND_BUFFER_SAMPLES];
+
+/**
+ * Writes a 32-bit value to a file in little-endian byte order, as the WAV format expects.
+ * @param file The file to write to.
+ * @param value The value to write.
+ */
+static void WavFileWriteUint32(FILE *file, uint32_t value) {
+    unsigned char bytes[4] = {
+        (unsigned char)(value & 0xFFu),
+        (unsigned char)((value >> 8) & 0xFFu),
+        (unsigned char)((value >> 16) & 0xFFu),
+        (unsigned char)((value >> 24) & 0xFFu)
+    };
+    fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+/**
+ * Writes a 16-bit value to a file in little-endian byte order, as the WAV format expects.
+ * @param file The file to write to.
+ * @param value The value to write.
+ */
+static void WavFileWriteUint16(FILE *file, uint16_t value) {
+    unsigned char bytes[2] = {
+        (unsigned char)(value & 0xFFu),
+        (unsigned char)((value >> 8) & 0xFFu)
+    };
+    fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+/**
+ * Writes the header of a mono 16-bit PCM WAV file.
+ * A WAV file is a RIFF file holding a "fmt " chunk describing the format,
+ * followed by a "data" chunk holding the samples themselves.
+ * @param file The file to write to, positioned at its start.
+ * @param sampleRate The number of samples per second.
+ * @param dataBytes The size in bytes of the sample data that follows the header.
+ */
+static void WavFileWriteHeader(FILE *file, unsigned int sampleRate, uint32_t dataBytes) {
+    fwrite("RIFF", 1, 4, file);
+    WavFileWriteUint32(file, WAV_FILE_HEADER_SIZE - 8u + dataBytes);
+    fwrite("WAVE", 1, 4, file);
+
+    fwrite("fmt ", 1, 4, file);
+    WavFileWriteUint32(file, 16u);                        // Size of the rest of the fmt chunk.
+    WavFileWriteUint16(file, 1u);                         // PCM.
+    WavFileWriteUint16(file, 1u);                         // Mono.
+    WavFileWriteUint32(file, sampleRate);
+    WavFileWriteUint32(file, sampleRate * sizeof(int16_t)); // Bytes per second.
+    WavFileWriteUint16(file, sizeof(int16_t));            // Bytes per sample across all channels.
+    WavFileWriteUint16(file, 16u);                        // Bits per sample.
+
+    fwrite("data", 1, 4, file);
+    WavFileWriteUint32(file, dataBytes);
+}
+
+/**
+ * Creates the WAV file and writes a header for it. The sizes in the header
+ * are only filled in properly once the file is closed.
+ * @param self Pointer to the SoundBackend instance.
+ * @param sampleRate The number of samples per second the mixer will produce.
+ * @param wakeEvent Unused, since there is no device to signal it.
+ * @param outputPath The path of the WAV file to write.
+ * @return true if the file was created, false otherwise.
+ */
+static bool WavFileBackendOpen(SoundBackend *self, unsigned int sampleRate, HANDLE wakeEvent, const char *outputPath) {
+    (void)self;
+    (void)wakeEvent;
+    if (outputPath == NULL || outputPath[0] == '\0') {
+        return false;
+    }
+
+    wavFile = fopen(outputPath, "wb");
+    if (wavFile == NULL) {
+        return false;
+    }
+
+    WavFileWriteHeader(wavFile, sampleRate, 0u);
+    wavFileSampleRate = sampleRate;
+    wavFileSamplesWritten = 0;
+    wavFileStartMs = GetTickCount();
+    return true;
+}
+
+/**
+ * Retrieves a buffer for the mixer to fill, as long as the file is behind the clock.
+ * Keeping the file in step with real time means it holds exactly what would have been heard,
+ * cues landing at the same moments they would have played.
+ * @param self Pointer to the SoundBackend instance.
+ * @return The backend's buffer, or NULL if the file is already up to date.
+ */
+static int16_t *WavFileBackendAcquireBuffer(SoundBackend *self) {
+    (void)self;
+    if (wavFile == NULL) {
+        return NULL;
+    }
+
+    uint64_t elapsedMs = (uint64_t)(GetTickCount() - wavFileStartMs);
+    uint64_t samplesDue = (elapsedMs * wavFileSampleRate) / 1000u;
+    if (wavFileSamplesWritten >= samplesDue) {
+        return NULL;
+    }
+    return wavFileBuffer;
+}
+
+/**
+ * Appends a filled buffer to the WAV file.
+ * @param self Pointer to the SoundBackend instance.
+ * @param buffer The filled buffer.
+ */
+static void WavFileBackendSubmitBuffer(SoundBackend *self, int16_t *buffer) {
+    (void)self;
+    if (wavFile == NULL || buffer == NULL) {
+        return;
+    }
+
+    // Samples go out in little-endian byte order, whatever the machine's own order is.
+    unsigned char bytes[SOUND_BACKEND_BUFFER_SAMPLES * 2];
+    for (size_t i = 0; i < SOUND_BACKEND_BUFFER_SAMPLES; ++i) {
+        uint16_t sample = (uint16_t)buffer[i];
+        bytes[i * 2] = (unsigned char)(sample & 0xFFu);
+        bytes[i * 2 + 1] = (unsigned char)((sample >> 8) & 0xFFu);
+    }
+    fwrite(bytes, 1, sizeof(bytes), wavFile);
+    wavFileSamplesWritten += SOUND_BACKEND_BUFFER_SAMPLES;
+}
+
+/**
+ * Fills in the sizes in the WAV file's header and closes it.
+ * @param self Pointer to the SoundBackend instance.
+ */
+static void WavFileBackendClose(SoundBackend *self) {
+    (void)self;
+    if (wavFile == NULL) {
+        return;
+    }
+
+    // The data chunk's size is a 32-bit field, so a file may only hold a little over 13 hours at 44100 Hz.
+    uint64_t dataBytes = wavFileSamplesWritten * sizeof(int16_t);
+    if (dataBytes > UINT32_MAX - WAV_FILE_HEADER_SIZE) {
+        dataBytes = UINT32_MAX - WAV_FILE_HEADER_SIZE;
+    }
+
+    fseek(wavFile, 0, SEEK_SET);
+    WavFileWriteHeader(wavFile, wavFileSampleRate, (uint32_t)dataBytes);
+    fclose(wavFile);
+    wavFile = NULL;
+}
+
+SoundBackend SOUND_WAV_FILE_BACKEND = {
+    "WAV File",
+    true,
+    WavFileBackendOpen,
+    WavFileBackendAcquireBuffer,
+    WavFileBackendSubmitBuffer,
+    WavFileBackendClose
+};
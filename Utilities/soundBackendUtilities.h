@@ -0,0 +1,99 @@
+/**
+ * Header file for the sound backends.
+ * A sound backend is wherever the sound manager's mixed output ends up.
+ * The mixer does not care which one it is talking to; it just asks the backend for
+ * an empty buffer, fills it, and hands it back, for as long as the backend has buffers to give.
+ *
+ * There are currently three backends:
+ * 1. The null backend, which has no output at all. The sound manager does not even start
+ *    its mixer for it, so it costs nothing. Used by the server, and by anything run without audio.
+ * 2. The waveOut backend, which plays through the default Windows audio device.
+ * 3. The WAV file backend, which writes everything the mixer produces to a WAV file
+ *    in real time, so what would have been heard can be listened to or checked afterwards.
+ *
+ * Should a new backend be added, it needs its own SoundBackend instance declared here,
+ * with its functions implemented in soundBackendUtilities.c.
+ * @file Utilities/soundBackendUtilities.h
+ * @author abmize
+ */
+#ifndef _SOUND_BACKEND_UTILITIES_H_
+#define _SOUND_BACKEND_UTILITIES_H_
+
+#include <windows.h>
+#include <mmsystem.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Number of samples in each buffer a backend hands out.
+// 512 samples at 44100 Hz is a little under 12 milliseconds per buffer.
+#define SOUND_BACKEND_BUFFER_SAMPLES 512
+
+// Number of buffers the waveOut backend keeps in its ring, so there is always
+// one buffer playing while the others wait in line or are being filled.
+// With four, a cue starts playing at most a few dozen milliseconds after it is posted.
+#define SOUND_BACKEND_WAVE_OUT_BUFFER_COUNT 4
+
+/**
+ * Represents an abstract sound backend.
+ * All sound backends have a name, and say whether they produce any output at all.
+ * A backend that produces no output is never opened, and none of its functions are ever called.
+ *
+ * All sound backends output mono 16-bit PCM, and must implement functions to open the output,
+ * hand out empty buffers of SOUND_BACKEND_BUFFER_SAMPLES samples, take filled buffers back,
+ * and close the output. Apart from the name and producesOutput, everything is only ever
+ * touched by the sound manager's mixer thread.
+ */
+typedef struct SoundBackend {
+    const char *name; /** Identifier for the sound backend */
+    bool producesOutput; /** false if the backend discards everything, in which case there is no point mixing for it */
+
+    /**
+     * Opens the backend's output.
+     * @param self Pointer to the SoundBackend instance.
+     * @param sampleRate The number of samples per second the mixer will produce.
+     * @param wakeEvent An event the backend should signal whenever a buffer becomes free, if it can.
+     * @param outputPath Where the backend should write to, for backends that write to a file. May be NULL otherwise.
+     * @return true if the output was opened, false otherwise.
+     */
+    bool (*open)(struct SoundBackend *self, unsigned int sampleRate, HANDLE wakeEvent, const char *outputPath);
+
+    /**
+     * Retrieves an empty buffer for the mixer to fill.
+     * @param self Pointer to the SoundBackend instance.
+     * @return A buffer of SOUND_BACKEND_BUFFER_SAMPLES samples, or NULL if the backend wants no more output just yet.
+     */
+    int16_t *(*acquireBuffer)(struct SoundBackend *self);
+
+    /**
+     * Hands a filled buffer, previously returned by acquireBuffer, back to the backend for output.
+     * @param self Pointer to the SoundBackend instance.
+     * @param buffer The filled buffer.
+     */
+    void (*submitBuffer)(struct SoundBackend *self, int16_t *buffer);
+
+    /**
+     * Closes the backend's output, releasing everything opened by open.
+     * @param self Pointer to the SoundBackend instance.
+     */
+    void (*close)(struct SoundBackend *self);
+} SoundBackend;
+
+/**
+ * The null sound backend, which discards all output.
+ */
+extern SoundBackend SOUND_NULL_BACKEND;
+
+/**
+ * The waveOut sound backend, which plays through the default Windows audio device.
+ */
+extern SoundBackend SOUND_WAVE_OUT_BACKEND;
+
+/**
+ * The WAV file sound backend, which writes all output to the WAV file given as the output path.
+ */
+extern SoundBackend SOUND_WAV_FILE_BACKEND;
+
+#endif // _SOUND_BACKEND_UTILITIES_H_
@@ -1,6 +1,9 @@
 /**
  * Implementation of sound manager utilities.
  * Uses lightweight Windows-generated tones so no asset files are required.
+ * All playback goes through a single long-lived mixer thread which feeds a sound backend,
+ * and gameplay code hands it cues through a lock-free queue.
+ * Every variation of every cue is rendered once up front, so nothing is synthesized while the game runs.
  * Keeping all sound logic centralized allows for easy swapping of backends later.
  * @file Utilities/soundManagerUtilities.c
  * @author abmize
@@ -9,8 +12,8 @@
 #include "Utilities/soundManagerUtilities.h"
 
 #include <windows.h>
-#include <mmsystem.h>
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
@@ -31,23 +34,72 @@ typedef struct SoundToneStep {
 // steps points to an array of SoundToneStep.
 // stepCount is the number of steps in the array.
 // cooldownMs is the minimum time between plays of this sequence.
-// lastPlayedMs tracks when the sequence was last played.
+// lastPlayedMs tracks when the sequence was last played, as a tick count.
+// It is only ever changed with a compare-and-swap, see SoundManagerClaimCooldown.
 typedef struct SoundToneSequence {
     const SoundToneStep *steps;
     size_t stepCount;
     DWORD cooldownMs;
-    DWORD lastPlayedMs;
+    volatile LONG lastPlayedMs;
 } SoundToneSequence;
 
-// Describes a playback request with optional ownership of step data.
-// steps points to an array of SoundToneStep.
-// stepCount is the number of steps in the array.
-// ownsSteps indicates if this struct owns the steps array and should free it.
-typedef struct SoundTonePlayback {
-    SoundToneStep *steps;
-    size_t stepCount;
-    bool ownsSteps;
-} SoundTonePlayback;
+// The kinds of cue the sound manager can play.
+// Each kind has a bank of pre-rendered variations, see SoundManagerBuildCueBanks.
+typedef enum SoundCueKind {
+    SOUND_CUE_SHIP_IMPACT = 0,
+    SOUND_CUE_PLANET_CAPTURED,
+    SOUND_CUE_KIND_COUNT
+} SoundCueKind;
+
+// Describes a request to play a cue, as posted to the mixer.
+// kind picks the bank the cue comes from, and variation picks the slot within that bank.
+// gain scales the cue's loudness, so that many impacts at once can sound bigger than one.
+typedef struct SoundCue {
+    SoundCueKind kind;
+    size_t variation;
+    float gain;
+} SoundCue;
+
+// A single pre-rendered variation of a cue, as mono 16-bit PCM at full volume.
+// samples is NULL if the variation could not be rendered.
+typedef struct SoundCueVariant {
+    int16_t *samples;
+    size_t sampleCount;
+} SoundCueVariant;
+
+// Every pre-rendered variation of one kind of cue.
+typedef struct SoundCueBank {
+    SoundCueVariant *variants;
+    size_t variantCount;
+} SoundCueBank;
+
+// Number of cues that may be waiting for the mixer at once. Must be a power of two.
+// Cues posted while the queue is full are dropped, which at this size only happens
+// if the mixer has stalled, and then an extra blip of sound is the least of our problems.
+#define SOUND_CUE_QUEUE_CAPACITY 64
+
+// A single slot of the cue queue.
+// sequence tells producers and the consumer whose turn it is to use the slot, see SoundManagerPostCue.
+typedef struct SoundCueQueueCell {
+    volatile LONG sequence;
+    SoundCue cue;
+} SoundCueQueueCell;
+
+// A cue that the mixer is in the middle of playing.
+// samples points at the cue's pre-rendered PCM in its bank, sampleCount is its length in samples,
+// cursor is how many of those samples have been mixed into the output so far,
+// and gain is how loud the cue was asked to play.
+typedef struct SoundVoice {
+    const int16_t *samples;
+    size_t sampleCount;
+    size_t cursor;
+    float gain;
+} SoundVoice;
+
+// Longest the mixer sleeps between checks on its backend, in milliseconds.
+// Backends that play through a device wake the mixer as soon as a buffer is free,
+// so this only paces backends that cannot, such as the WAV file backend.
+#define SOUND_MIXER_WAIT_MS 20u
 
 // --- Static state ---
 
@@ -69,9 +121,43 @@ static bool reverbEnabled = false;
 static float reverbDelayMs = 240.0f;
 static float reverbDecay = 0.15f;
 
+// The cue queue, through which any thread hands cues to the mixer thread without taking a lock.
+// Producers claim slots by advancing cueQueueEnqueuePosition, and only the mixer thread
+// ever reads cueQueueDequeuePosition, so it needs no protection at all.
+static SoundCueQueueCell cueQueue[SOUND_CUE_QUEUE_CAPACITY];
+static volatile LONG cueQueueEnqueuePosition = 0;
+static LONG cueQueueDequeuePosition = 0;
+
+// The mixer thread, which owns the output device and every voice, and the event it sleeps on.
+// The output device signals the event each time it finishes playing a buffer.
+static HANDLE mixerThread = NULL;
+static HANDLE mixerWakeEvent = NULL;
+
+// Set to ask the mixer thread to stop.
+static volatile LONG mixerStopRequested = 0;
+
+// Where the mixer's output goes, and the output path handed to the backend when it is opened.
+static SoundBackend *activeBackend = NULL;
+static char backendOutputPath[MAX_PATH] = {0};
+
+// Voices currently being mixed. Only ever touched by the mixer thread.
+static SoundVoice *mixerVoices = NULL;
+static size_t mixerVoiceCount = 0;
+static size_t mixerVoiceCapacity = 0;
+
+// The pre-rendered cue banks, one per kind of cue.
+// Built by SoundManagerInitialize, and from then on only touched by the mixer thread,
+// which rebuilds them whenever the reverb settings change.
+static SoundCueBank cueBanks[SOUND_CUE_KIND_COUNT];
+
+// Bumped whenever the settings the cue banks are rendered with change. Guarded by the sound lock.
+static LONG cueBankRevision = 0;
+
 // RNG state used to vary musical choices while keeping them deterministic.
-static uint32_t soundRngState = 0u;
-static bool soundRngSeeded = false;
+// It is not guarded by the sound lock, since cues are chosen on whichever thread plays them,
+// so it is only ever advanced with a compare-and-swap (see SoundManagerNextRandom).
+// 0 means it has not been seeded yet.
+static volatile LONG soundRngState = 0;
 
 // Audio format constants for synthesized output.
 // The PCM format explained: Basically, if sound is some sort of combination
@@ -113,6 +199,14 @@ static const DWORD SOUND_RELEASE_MS = 50u;
 // helps avoid abrupt cutoffs that can cause clicks.
 static const DWORD SOUND_TAIL_FADE_MS = 80u;
 
+// The tone phasor (see SoundKernelAddRampedTone) is nudged back to unit length
+// after every this many samples, long before its drift could ever be heard.
+#define SOUND_PHASOR_RENORMALIZE_INTERVAL 256u
+
+// Reverb used by SoundManagerBenchmarkSynthesis, a typical setting so the echo pass has real work to do.
+static const float SOUND_BENCHMARK_REVERB_DELAY_MS = 20.0f;
+static const float SOUND_BENCHMARK_REVERB_DECAY = 0.3f;
+
 // Chromatic scale (C) offers maximum variety while we keep step sizes small for softness.
 // These sounds are used to generate the random ship sound effects.
 // Modern Western tuning usually uses 12-tone equal temperament (12-TET).
@@ -153,22 +247,6 @@ static void SoundManagerEnsureLock(void) {
     }
 }
 
-/**
- * Ensures the RNG has a non-zero seed so randomized tones vary per session.
- * We seed lazily to avoid extra OS calls when audio is never used. 
- */
-static void SoundManagerEnsureRngSeed(void) {
-    if (!soundRngSeeded) {
-        // Tick-based seeding is adequate for audio variation without extra dependencies.
-        soundRngState = (uint32_t)GetTickCount();
-        if (soundRngState == 0u) {
-            // We avoid a zero seed so the LCG does not degenerate.
-            soundRngState = 0xA5A5A5A5u;
-        }
-        soundRngSeeded = true;
-    }
-}
-
 /**
  * Advances the RNG state and returns the next value.
  * Implements the following recurrence relation:
@@ -180,14 +258,32 @@ static void SoundManagerEnsureRngSeed(void) {
  * Since we are using unsigned int, the modulus operation is implicit due to overflow.
  * The constants a and c were found on the Internet and Wikipedia's page on LCGs
  * says they come from ranqd1.
+ * The state is seeded lazily, the first time a value is needed, to avoid extra OS calls when audio is never used.
+ * Any thread may call this: the state is advanced with a compare-and-swap, like the cooldowns,
+ * so two threads asking at once each get a value of their own rather than corrupting the state.
  * @return The next pseudo-random value.
  */
 static uint32_t SoundManagerNextRandom(void) {
-    SoundManagerEnsureRngSeed();
+    for (;;) {
+        LONG observed = soundRngState;
+        uint32_t state = (uint32_t)observed;
+        if (state == 0u) {
+            // Tick-based seeding is adequate for audio variation without extra dependencies.
+            // We avoid a zero seed so the LCG does not degenerate.
+            state = (uint32_t)GetTickCount();
+            if (state == 0u) {
+                state = 0xA5A5A5A5u;
+            }
+        }
+
+        // LCG parameters balance period with fast computation.
+        uint32_t next = (state * 1664525u) + 1013904223u;
 
-    // LCG parameters balance period with fast computation.
-    soundRngState = (soundRngState * 1664525u) + 1013904223u;
-    return soundRngState;
+        // Should another thread have advanced the state in the meantime, try again from its value.
+        if (InterlockedCompareExchange(&soundRngState, (LONG)next, observed) == observed) {
+            return next;
+        }
+    }
 }
 
 /**
@@ -235,356 +331,723 @@ static SoundToneSequence planetCapturedSequence = {
     0u
 };
 
+// The ship impact cue is two short notes a semitone or so apart, varied by starting note,
+// the step to the second note, and the length of each note.
+// Rather than any length at all, each note picks from a small grid of lengths,
+// so that every combination can be rendered ahead of time.
+static const int SOUND_IMPACT_OFFSETS[] = { -1, 0, 1 };
+static const DWORD SOUND_IMPACT_FIRST_DURATIONS[] = { 28u, 36u, 44u };
+static const DWORD SOUND_IMPACT_SECOND_DURATIONS[] = { 36u, 48u, 60u };
+#define SOUND_IMPACT_OFFSET_COUNT (sizeof(SOUND_IMPACT_OFFSETS) / sizeof(SOUND_IMPACT_OFFSETS[0]))
+#define SOUND_IMPACT_FIRST_DURATION_COUNT (sizeof(SOUND_IMPACT_FIRST_DURATIONS) / sizeof(SOUND_IMPACT_FIRST_DURATIONS[0]))
+#define SOUND_IMPACT_SECOND_DURATION_COUNT (sizeof(SOUND_IMPACT_SECOND_DURATIONS) / sizeof(SOUND_IMPACT_SECOND_DURATIONS[0]))
+
+// How much louder the impact cue gets each time the number of ships arriving at once doubles,
+// and the loudest it may get. A lone ship plays at a gain of 1.
+static const float SOUND_IMPACT_GAIN_PER_DOUBLING = 0.2f;
+static const float SOUND_IMPACT_MAX_GAIN = 2.0f;
+
 // --- Internal helpers ---
 
 /**
- * Plays a tone sequence on a background thread so gameplay remains responsive.
- * @param param Pointer to a SoundToneSequence describing the tone steps.
- * @return Thread exit code (unused).
+ * Adds a sine tone to a buffer, shaped by a linear ramp from one gain to another.
+ * Rather than calling sinf for every sample, the tone is generated with a phasor:
+ * a point on the unit circle which is rotated by the tone's phase increment each sample,
+ * so that its y-coordinate traces out the sine wave with only a few multiplies and adds.
+ * Rounding makes the point slowly drift off the circle, so every so often it is nudged back on.
+ * @param output The buffer to add the tone to.
+ * @param sampleCount The number of samples to add.
+ * @param phasorCos In: the x-coordinate of the phasor at the first sample. Out: at the sample after the last.
+ * @param phasorSin In: the y-coordinate of the phasor at the first sample. Out: at the sample after the last.
+ * @param rotationCos Cosine of the phase increment per sample.
+ * @param rotationSin Sine of the phase increment per sample.
+ * @param gain The gain at the first sample.
+ * @param gainStep How much the gain changes from one sample to the next.
  */
-static DWORD WINAPI SoundManagerPlaySequenceThread(LPVOID param) {
-    SoundTonePlayback *playback = (SoundTonePlayback *)param;
-    if (playback == NULL || playback->steps == NULL || playback->stepCount == 0u) {
-        return 0u;
-    }
+static void SoundKernelAddRampedTone(float *output, size_t sampleCount, float *phasorCos, float *phasorSin,
+    float rotationCos, float rotationSin, float gain, float gainStep) {
+    float c = *phasorCos;
+    float s = *phasorSin;
+
+    size_t i = 0;
+    while (i < sampleCount) {
+        size_t blockEnd = i + SOUND_PHASOR_RENORMALIZE_INTERVAL;
+        if (blockEnd > sampleCount) {
+            blockEnd = sampleCount;
+        }
 
-    // We re-check the global flag so shutdown can silence any in-flight threads.
-    if (!soundEnabled) {
-        if (playback->ownsSteps) {
-            free(playback->steps);
+        // No branches in here, just the rotation and the ramp, so the loop stays tight.
+        for (; i < blockEnd; ++i) {
+            output[i] += s * (gain + gainStep * (float)i);
+            float nextC = c * rotationCos - s * rotationSin;
+            float nextS = c * rotationSin + s * rotationCos;
+            c = nextC;
+            s = nextS;
         }
-        free(playback);
-        return 0u;
+
+        // Scale the phasor back to unit length. As it is only ever a hair off,
+        // one step of Newton's method toward 1 / sqrt(length squared) is all it takes.
+        float lengthSquared = c * c + s * s;
+        float correction = 0.5f * (3.0f - lengthSquared);
+        c *= correction;
+        s *= correction;
     }
 
-    // Snapshot tunables so a mid-playback change cannot desync the buffer math.
-    // We don't want to have a lock on the entire playback duration
-    // since that would block other sound requests.
-    // So we just grab the values we need up front, then release the lock.
-    SoundManagerEnsureLock();
-    EnterCriticalSection(&soundLock);
-    float volume = soundMasterVolume;
-    bool localReverbEnabled = reverbEnabled;
-    float localReverbDelay = reverbDelayMs;
-    float localReverbDecay = reverbDecay;
-    LeaveCriticalSection(&soundLock);
+    *phasorCos = c;
+    *phasorSin = s;
+}
 
-    // Clamp volume defensively so the mixer never produces clipping.
-    if (volume < 0.0f) {
-        volume = 0.0f;
-    } else if (volume > 1.0f) {
-        volume = 1.0f;
+/**
+ * Finishes a stretch of a rendered sequence in a single pass: mixes in the echo,
+ * applies a linear gain ramp, and converts to 16-bit PCM, saturating anything out of range.
+ * The echo is fed back, in that each sample's echo comes from the already echoed sample before it,
+ * which is why the float buffer is updated in place as well.
+ * For a stretch with no echo, pass a decay of zero (any delay at most begin will then do).
+ * @param wet The float samples, in the range [-1, 1] give or take. Updated in place with the echo mixed in.
+ * @param output The buffer receiving the 16-bit samples.
+ * @param begin The first sample of the stretch.
+ * @param end One past the last sample of the stretch.
+ * @param delaySamples How far back the echo comes from. Must be at most begin.
+ * @param decay How loud the echo is.
+ * @param gain The gain at the first sample of the stretch.
+ * @param gainStep How much the gain changes from one sample to the next.
+ */
+static void SoundKernelFinishRange(float *wet, int16_t *output, size_t begin, size_t end,
+    size_t delaySamples, float decay, float gain, float gainStep) {
+    for (size_t i = begin; i < end; ++i) {
+        float mixed = wet[i] + decay * wet[i - delaySamples];
+        wet[i] = mixed;
+
+        // Saturate rather than wrap, clamping to the range of int16_t [-2^15, 2^15-1].
+        float scaled = mixed * (gain + gainStep * (float)(i - begin)) * 32767.0f;
+        scaled = fminf(fmaxf(scaled, -32768.0f), 32767.0f);
+        output[i] = (int16_t)scaled;
+    }
+}
+
+/**
+ * Renders a sequence of tone steps into a freshly allocated mono 16-bit PCM buffer at full volume.
+ * The output depends on nothing but the arguments, so the same sequence always renders the same way.
+ * Tones are first built up in a float buffer, and then echo, tail fade, and conversion to 16-bit
+ * all happen together in one final pass over it.
+ * @param steps Pointer to the tone step array.
+ * @param stepCount Number of tone steps.
+ * @param localReverbEnabled True to mix reverb into the rendered sequence.
+ * @param localReverbDelay Delay in milliseconds before the echo is mixed in.
+ * @param localReverbDecay Linear decay factor of the echo.
+ * @param outSamples Receives the rendered buffer, which the caller must free.
+ * @param outSampleCount Receives the number of samples in the rendered buffer.
+ * @return true if the sequence was rendered, false if it was empty or allocation failed.
+ */
+static bool SoundManagerRenderSequence(const SoundToneStep *steps, size_t stepCount,
+    bool localReverbEnabled, float localReverbDelay, float localReverbDecay,
+    int16_t **outSamples, size_t *outSampleCount) {
+    if (steps == NULL || stepCount == 0u || outSamples == NULL || outSampleCount == NULL) {
+        return false;
     }
 
     // Determine total sample count so we can render into one contiguous buffer.
     size_t totalSamples = 0;
-    for (size_t i = 0; i < playback->stepCount; ++i) {
-        const SoundToneStep *step = &playback->steps[i];
+    for (size_t i = 0; i < stepCount; ++i) {
+        const SoundToneStep *step = &steps[i];
         DWORD stepMs = step->durationMs + step->pauseMs;
         totalSamples += (size_t)((SOUND_SAMPLE_RATE * (uint64_t)stepMs) / 1000u);
     }
 
     if (totalSamples == 0) {
-        return 0u;
+        return false;
     }
 
-    // Allocate a mono 16-bit PCM buffer for the sequence.
+    // Allocate a mono 16-bit PCM buffer for the sequence, and a float buffer to build it up in.
+    // The float buffer starts zeroed so silence is the default when no tone is active.
     int16_t *samples = (int16_t *)malloc(totalSamples * sizeof(int16_t));
-    if (samples == NULL) {
-        return 0u;
+    float *wet = (float *)calloc(totalSamples, sizeof(float));
+    if (samples == NULL || wet == NULL) {
+        free(samples);
+        free(wet);
+        return false;
     }
 
-    // Zero the buffer so silence is the default when no tone is active.
-    memset(samples, 0, totalSamples * sizeof(int16_t));
+    // The base amplitude keeps tones musical instead of harsh.
+    // Master volume is applied later, as the mixer plays the sequence back.
+    float amplitude = SOUND_BASE_AMPLITUDE;
+    if (localReverbEnabled) {
+        // Reserve headroom so the reverb mix does not clip and crackle.
+        float headroom = 1.0f - (localReverbDecay * SOUND_REVERB_HEADROOM);
+        if (headroom < 0.25f) {
+            headroom = 0.25f;
+        }
+        amplitude *= headroom;
+    }
 
-    // Render each tone directly into the buffer.
+    // Render each tone directly into the float buffer.
     size_t cursor = 0;
-    for (size_t i = 0; i < playback->stepCount; ++i) {
-        const SoundToneStep *step = &playback->steps[i];
-        DWORD toneSamples = (DWORD)((SOUND_SAMPLE_RATE * (uint64_t)step->durationMs) / 1000u);
-        DWORD pauseSamples = (DWORD)((SOUND_SAMPLE_RATE * (uint64_t)step->pauseMs) / 1000u);
+    for (size_t i = 0; i < stepCount; ++i) {
+        const SoundToneStep *step = &steps[i];
+        size_t toneSamples = (size_t)((SOUND_SAMPLE_RATE * (uint64_t)step->durationMs) / 1000u);
+        size_t pauseSamples = (size_t)((SOUND_SAMPLE_RATE * (uint64_t)step->pauseMs) / 1000u);
+        if (cursor + toneSamples > totalSamples) {
+            toneSamples = totalSamples - cursor;
+        }
 
         if (step->frequency > 0u && toneSamples > 0u) {
             float phaseIncrement = 2.0f * SOUND_PI * ((float)step->frequency / (float)SOUND_SAMPLE_RATE);
-            float phase = 0.0f;
-
-            // The base amplitude keeps tones musical instead of harsh.
-            float amplitude = SOUND_BASE_AMPLITUDE * volume;
-            if (localReverbEnabled) {
-                // Reserve headroom so the reverb mix does not clip and crackle.
-                float headroom = 1.0f - (localReverbDecay * SOUND_REVERB_HEADROOM);
-                if (headroom < 0.25f) {
-                    headroom = 0.25f;
-                }
-                amplitude *= headroom;
-            }
+            float rotationCos = cosf(phaseIncrement);
+            float rotationSin = sinf(phaseIncrement);
+
+            // The phasor starts at angle zero, where the sine wave starts.
+            float phasorCos = 1.0f;
+            float phasorSin = 0.0f;
 
             // Attack/release smoothing avoids discontinuities that cause pops.
-            DWORD attackSamples = (DWORD)((SOUND_SAMPLE_RATE * (uint64_t)SOUND_ATTACK_MS) / 1000u);
-            DWORD releaseSamples = (DWORD)((SOUND_SAMPLE_RATE * (uint64_t)SOUND_RELEASE_MS) / 1000u);
+            // Neither may take up more than half the tone, so the two can never overlap,
+            // and the tone splits cleanly into a ramp in, a steady middle, and a ramp out.
+            size_t attackSamples = (size_t)((SOUND_SAMPLE_RATE * (uint64_t)SOUND_ATTACK_MS) / 1000u);
+            size_t releaseSamples = (size_t)((SOUND_SAMPLE_RATE * (uint64_t)SOUND_RELEASE_MS) / 1000u);
             if (attackSamples * 2 > toneSamples) {
                 attackSamples = toneSamples / 2u;
             }
             if (releaseSamples * 2 > toneSamples) {
                 releaseSamples = toneSamples / 2u;
             }
+            size_t sustainSamples = toneSamples - attackSamples - releaseSamples;
+            float *tone = &wet[cursor];
 
-            for (DWORD s = 0; s < toneSamples && cursor + s < totalSamples; ++s) {
-                float envelope = 1.0f;
-                if (attackSamples > 0u && s < attackSamples) {
-                    // We ramp in to avoid an abrupt jump from silence.
-                    envelope = (float)s / (float)attackSamples;
-                } else if (releaseSamples > 0u && s + releaseSamples >= toneSamples) {
-                    // We ramp out to avoid cutting mid-wave.
-                    envelope = (float)(toneSamples - s) / (float)releaseSamples;
-                }
-
-                // Calculate the sample value and write it to the buffer.
-                // We clamp to the range of int16_t [-2^15, 2^15-1] to avoid overflow.
-
-                float sample = sinf(phase) * amplitude * envelope;
-                int32_t scaled = (int32_t)(sample * 32767.0f);
-                if (scaled > 32767) {
-                    scaled = 32767;
-                } else if (scaled < -32768) {
-                    scaled = -32768;
-                }
-                samples[cursor + s] = (int16_t)scaled;
-                phase += phaseIncrement;
-                if (phase > 2.0f * SOUND_PI) {
-                    phase -= 2.0f * SOUND_PI;
-                }
+            // We ramp in to avoid an abrupt jump from silence.
+            if (attackSamples > 0u) {
+                SoundKernelAddRampedTone(tone, attackSamples, &phasorCos, &phasorSin, rotationCos, rotationSin,
+                    0.0f, amplitude / (float)attackSamples);
+            }
+            SoundKernelAddRampedTone(tone + attackSamples, sustainSamples, &phasorCos, &phasorSin,
+                rotationCos, rotationSin, amplitude, 0.0f);
+            // We ramp out to avoid cutting mid-wave.
+            if (releaseSamples > 0u) {
+                SoundKernelAddRampedTone(tone + attackSamples + sustainSamples, releaseSamples, &phasorCos, &phasorSin,
+                    rotationCos, rotationSin, amplitude, -amplitude / (float)releaseSamples);
             }
         }
 
         // Advance by tone + pause to leave natural spacing between steps.
-        cursor += (size_t)toneSamples + (size_t)pauseSamples;
+        cursor += toneSamples + pauseSamples;
         if (cursor >= totalSamples) {
             break;
         }
     }
 
-    // Apply a lightweight reverb by mixing a delayed copy of the buffer.
+    // Work out the lightweight reverb, which mixes in a delayed copy of the sequence.
+    size_t delaySamples = 0;
+    float decay = 0.0f;
     if (localReverbEnabled && localReverbDecay > 0.0f) {
         if (localReverbDelay < 1.0f) {
             localReverbDelay = 1.0f;
         }
-        if (localReverbDecay > 1.0f) {
-            localReverbDecay = 1.0f;
+        decay = localReverbDecay > 1.0f ? 1.0f : localReverbDecay;
+        delaySamples = (size_t)((SOUND_SAMPLE_RATE * (uint64_t)localReverbDelay) / 1000u);
+        if (delaySamples == 0 || delaySamples >= totalSamples) {
+            delaySamples = 0;
+            decay = 0.0f;
         }
+    }
+
+    // And the fade of the tail to silence, so the buffer never cuts off mid-wave.
+    size_t tailFadeSamples = (size_t)((SOUND_SAMPLE_RATE * (uint64_t)SOUND_TAIL_FADE_MS) / 1000u);
+    size_t fadeStart = totalSamples;
+    if (tailFadeSamples > 0u && tailFadeSamples < totalSamples) {
+        fadeStart = totalSamples - tailFadeSamples;
+    }
+
+    // Now the final pass. The buffer is cut into stretches wherever the echo starts or the fade begins,
+    // so that within each stretch every sample is treated exactly the same and the loop needs no branches.
+    size_t echoStart = decay > 0.0f ? delaySamples : totalSamples;
+    size_t boundaries[4] = {0, echoStart < fadeStart ? echoStart : fadeStart, echoStart < fadeStart ? fadeStart : echoStart, totalSamples};
+    for (size_t b = 0; b < 3; ++b) {
+        size_t begin = boundaries[b];
+        size_t end = boundaries[b + 1];
+        if (begin >= end) {
+            continue;
+        }
+
+        bool echoing = begin >= echoStart;
+        bool fading = begin >= fadeStart;
+        float gain = fading ? (float)(totalSamples - begin) / (float)tailFadeSamples : 1.0f;
+        float gainStep = fading ? -1.0f / (float)tailFadeSamples : 0.0f;
+        SoundKernelFinishRange(wet, samples, begin, end, echoing ? delaySamples : 0u, echoing ? decay : 0.0f, gain, gainStep);
+    }
+
+    free(wet);
+    *outSamples = samples;
+    *outSampleCount = totalSamples;
+    return true;
+}
+
+/**
+ * Computes which slot of the ship impact bank holds a given combination of notes.
+ * @param startIndex Index of the first note in SOUND_CHROMATIC_FREQS.
+ * @param offsetIndex Index of the step to the second note in SOUND_IMPACT_OFFSETS.
+ * @param firstDurationIndex Index of the first note's length in SOUND_IMPACT_FIRST_DURATIONS.
+ * @param secondDurationIndex Index of the second note's length in SOUND_IMPACT_SECOND_DURATIONS.
+ * @return The variation index.
+ */
+static size_t SoundManagerImpactVariation(size_t startIndex, size_t offsetIndex, size_t firstDurationIndex, size_t secondDurationIndex) {
+    return ((startIndex * SOUND_IMPACT_OFFSET_COUNT + offsetIndex) * SOUND_IMPACT_FIRST_DURATION_COUNT + firstDurationIndex)
+        * SOUND_IMPACT_SECOND_DURATION_COUNT + secondDurationIndex;
+}
+
+/**
+ * Releases every pre-rendered cue variation.
+ * Must not be called while the mixer thread could be playing from the banks.
+ */
+static void SoundManagerReleaseCueBanks(void) {
+    for (size_t kind = 0; kind < SOUND_CUE_KIND_COUNT; ++kind) {
+        SoundCueBank *bank = &cueBanks[kind];
+        for (size_t i = 0; i < bank->variantCount; ++i) {
+            free(bank->variants[i].samples);
+        }
+        free(bank->variants);
+        bank->variants = NULL;
+        bank->variantCount = 0;
+    }
+}
+
+/**
+ * Allocates a bank with room for the given number of variations, all initially empty.
+ * @param bank Pointer to the bank to allocate.
+ * @param variantCount Number of variations the bank holds.
+ * @return true if the bank was allocated, false otherwise.
+ */
+static bool SoundManagerAllocateCueBank(SoundCueBank *bank, size_t variantCount) {
+    bank->variants = (SoundCueVariant *)calloc(variantCount, sizeof(SoundCueVariant));
+    if (bank->variants == NULL) {
+        bank->variantCount = 0;
+        return false;
+    }
+    bank->variantCount = variantCount;
+    return true;
+}
 
-        size_t delaySamples = (size_t)((SOUND_SAMPLE_RATE * (uint64_t)localReverbDelay) / 1000u);
-        if (delaySamples > 0 && delaySamples < totalSamples) {
-            for (size_t i = delaySamples; i < totalSamples; ++i) {
-                int32_t mixed = samples[i] + (int32_t)(samples[i - delaySamples] * localReverbDecay);
-                if (mixed > 32767) {
-                    mixed = 32767;
-                } else if (mixed < -32768) {
-                    mixed = -32768;
+/**
+ * Fills in the two tone steps of one ship impact variation.
+ * @param startIndex Index of the first note in the chromatic scale.
+ * @param offsetIndex Index into SOUND_IMPACT_OFFSETS of the step to the second note.
+ * @param firstDurationIndex Index into SOUND_IMPACT_FIRST_DURATIONS of the first note's length.
+ * @param secondDurationIndex Index into SOUND_IMPACT_SECOND_DURATIONS of the second note's length.
+ * @param outSteps Receives the two tone steps.
+ */
+static void SoundManagerImpactSteps(size_t startIndex, size_t offsetIndex, size_t firstDurationIndex,
+    size_t secondDurationIndex, SoundToneStep outSteps[2]) {
+    // The second note stays within the scale, so the edges of the scale repeat a note.
+    int nextIndex = (int)startIndex + SOUND_IMPACT_OFFSETS[offsetIndex];
+    if (nextIndex < 0) {
+        nextIndex = 0;
+    } else if (nextIndex >= (int)SOUND_CHROMATIC_COUNT) {
+        nextIndex = (int)SOUND_CHROMATIC_COUNT - 1;
+    }
+
+    outSteps[0].frequency = SOUND_CHROMATIC_FREQS[startIndex];
+    outSteps[0].durationMs = SOUND_IMPACT_FIRST_DURATIONS[firstDurationIndex];
+    outSteps[0].pauseMs = 6u;
+    outSteps[1].frequency = SOUND_CHROMATIC_FREQS[nextIndex];
+    outSteps[1].durationMs = SOUND_IMPACT_SECOND_DURATIONS[secondDurationIndex];
+    outSteps[1].pauseMs = 0u;
+}
+
+/**
+ * Renders every variation of every cue ahead of time, so that playing a cue
+ * is only a matter of mixing samples that already exist.
+ * Any existing banks are released first. Must not be called while the mixer thread
+ * could be playing from the banks, unless called by the mixer thread itself.
+ * @return The cue bank revision the banks were rendered for.
+ */
+static LONG SoundManagerBuildCueBanks(void) {
+    // Snapshot tunables so a mid-build change cannot leave the banks half one way and half another.
+    SoundManagerEnsureLock();
+    EnterCriticalSection(&soundLock);
+    bool localReverbEnabled = reverbEnabled;
+    float localReverbDelay = reverbDelayMs;
+    float localReverbDecay = reverbDecay;
+    LONG revision = cueBankRevision;
+    LeaveCriticalSection(&soundLock);
+
+    SoundManagerReleaseCueBanks();
+
+    // Every combination of starting note, step, and note lengths for the ship impact.
+    SoundCueBank *impactBank = &cueBanks[SOUND_CUE_SHIP_IMPACT];
+    size_t impactCount = SOUND_CHROMATIC_COUNT * SOUND_IMPACT_OFFSET_COUNT
+        * SOUND_IMPACT_FIRST_DURATION_COUNT * SOUND_IMPACT_SECOND_DURATION_COUNT;
+    if (SoundManagerAllocateCueBank(impactBank, impactCount)) {
+        for (size_t start = 0; start < SOUND_CHROMATIC_COUNT; ++start) {
+            for (size_t offset = 0; offset < SOUND_IMPACT_OFFSET_COUNT; ++offset) {
+                for (size_t first = 0; first < SOUND_IMPACT_FIRST_DURATION_COUNT; ++first) {
+                    for (size_t second = 0; second < SOUND_IMPACT_SECOND_DURATION_COUNT; ++second) {
+                        SoundToneStep steps[2];
+                        SoundManagerImpactSteps(start, offset, first, second, steps);
+
+                        SoundCueVariant *variant = &impactBank->variants[SoundManagerImpactVariation(start, offset, first, second)];
+                        if (!SoundManagerRenderSequence(steps, 2u, localReverbEnabled, localReverbDelay, localReverbDecay,
+                                &variant->samples, &variant->sampleCount)) {
+                            variant->samples = NULL;
+                            variant->sampleCount = 0;
+                        }
+                    }
                 }
-                samples[i] = (int16_t)mixed;
             }
         }
     }
 
-    // Fade the tail to silence so the buffer never cuts off mid-wave.
-    DWORD tailFadeSamples = (DWORD)((SOUND_SAMPLE_RATE * (uint64_t)SOUND_TAIL_FADE_MS) / 1000u);
-    if (tailFadeSamples > 0u && tailFadeSamples < totalSamples) {
-        size_t fadeStart = totalSamples - tailFadeSamples;
-        for (size_t i = fadeStart; i < totalSamples; ++i) {
-            float t = (float)(totalSamples - i) / (float)tailFadeSamples;
-            int32_t scaled = (int32_t)((float)samples[i] * t);
-            if (scaled > 32767) {
-                scaled = 32767;
-            } else if (scaled < -32768) {
-                scaled = -32768;
-            }
-            samples[i] = (int16_t)scaled;
+    // The capture fanfare only comes in the one variation.
+    SoundCueBank *capturedBank = &cueBanks[SOUND_CUE_PLANET_CAPTURED];
+    if (SoundManagerAllocateCueBank(capturedBank, 1u)) {
+        SoundCueVariant *variant = &capturedBank->variants[0];
+        if (!SoundManagerRenderSequence(planetCapturedSequence.steps, planetCapturedSequence.stepCount,
+                localReverbEnabled, localReverbDelay, localReverbDecay, &variant->samples, &variant->sampleCount)) {
+            variant->samples = NULL;
+            variant->sampleCount = 0;
         }
     }
 
-    // Prepare and submit the buffer to the Windows wave output device.
-    // A WAVEFORMATEX structure describes the audio format.
-    // https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/ns-mmeapi-waveformatex
-    WAVEFORMATEX format = {0};
-    format.wFormatTag = WAVE_FORMAT_PCM;
-    format.nChannels = 1;
-    format.nSamplesPerSec = SOUND_SAMPLE_RATE;
-    format.wBitsPerSample = 16;
-    format.nBlockAlign = (format.nChannels * format.wBitsPerSample) / 8;
-    format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
-
-    // An HWAVEOUT handle represents the output device.
-    HWAVEOUT waveOutHandle = NULL;
-
-    // An MMRESULT indicates success or failure of multimedia functions.
-    // waveOutOpen opens the default waveform output device.
-    // Documentation for waveOutOpen: https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/nf-mmeapi-waveoutopen
-    // It has the following arguments:
-    // 1. Pointer to an HWAVEOUT handle that receives the device handle.
-    // 2. Device identifier (WAVE_MAPPER selects the default device).
-    // 3. Pointer to a WAVEFORMATEX structure that describes the desired format.
-    // 4. Callback (not used here, so we pass 0 and CALLBACK_NULL).
-    // 5. Instance data (not used here, so we pass 0).
-    // 6. Flags (CALLBACK_NULL indicates no callback mechanism).
-
-    MMRESULT openResult = waveOutOpen(&waveOutHandle, WAVE_MAPPER, &format, 0, 0, CALLBACK_NULL);
-    if (openResult != MMSYSERR_NOERROR || waveOutHandle == NULL) {
-        free(samples);
-        return 0u;
+    return revision;
+}
+
+/**
+ * Empties the cue queue, readying every slot for the first round of producers.
+ * Must only be called while the mixer thread is not running.
+ */
+static void SoundManagerResetCueQueue(void) {
+    for (LONG i = 0; i < SOUND_CUE_QUEUE_CAPACITY; ++i) {
+        cueQueue[i].sequence = i;
     }
+    cueQueueEnqueuePosition = 0;
+    cueQueueDequeuePosition = 0;
+}
 
-    // A WAVEHDR structure describes the audio buffer to play.
-    // https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/ns-mmeapi-wavehdr
-    WAVEHDR header = {0};
-    header.lpData = (LPSTR)samples;
-    header.dwBufferLength = (DWORD)(totalSamples * sizeof(int16_t));
-
-    // waveOutPrepareHeader prepares the buffer for playback.
-    // https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/nf-mmeapi-waveoutprepareheader
-    // It returns MMSYSERR_NOERROR on success.
-    // It takes the following arguments:
-    // 1. The HWAVEOUT handle representing the output device.
-    // 2. Pointer to the WAVEHDR structure describing the buffer.
-    // 3. Size of the WAVEHDR structure.
-    if (waveOutPrepareHeader(waveOutHandle, &header, sizeof(header)) == MMSYSERR_NOERROR) {
-        // https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/nf-mmeapi-waveoutwrite
-        // waveOutWrite submits the buffer for playback.
-        // It returns MMSYSERR_NOERROR on success.
-        // It takes the following arguments:
-        // 1. The HWAVEOUT handle representing the output device.
-        // 2. Pointer to the WAVEHDR structure describing the buffer.
-        // 3. Size of the WAVEHDR structure.
-
-        // In terms of actually playing the sound, that will happen asynchronously,
-        // although it is triggered by this call.
-        if (waveOutWrite(waveOutHandle, &header, sizeof(header)) == MMSYSERR_NOERROR) {
-            // Wait for playback to finish so we can safely release the buffer.
-            while (soundEnabled && (header.dwFlags & WHDR_DONE) == 0u) {
-                Sleep(1u);
+/**
+ * Hands a cue to the mixer thread. Safe to call from any number of threads at once,
+ * and never blocks, allocates, or takes a lock.
+ *
+ * The queue is a bounded ring in which every slot carries a sequence number.
+ * A slot whose sequence equals a producer's claimed position is free for that producer to fill,
+ * and once filled its sequence is bumped by one, which is exactly the position the consumer
+ * is waiting for. After the consumer reads the slot it bumps the sequence by a full lap
+ * of the ring, handing the slot back to whichever producer claims that position next.
+ * Producers race for positions with a compare-and-swap, so each position goes to exactly one of them.
+ * @param cue Pointer to the cue to post.
+ * @return true if the cue was queued, false if the queue was full.
+ */
+static bool SoundManagerPostCue(const SoundCue *cue) {
+    SoundCueQueueCell *cell = NULL;
+    LONG position = cueQueueEnqueuePosition;
+
+    for (;;) {
+        cell = &cueQueue[(uint32_t)position & (SOUND_CUE_QUEUE_CAPACITY - 1)];
+        LONG sequence = cell->sequence;
+        MemoryBarrier();
+
+        // Differences are taken in unsigned arithmetic so the positions may wrap around safely.
+        int32_t difference = (int32_t)((uint32_t)sequence - (uint32_t)position);
+        if (difference == 0) {
+            // The slot is free for this position, so try to claim the position for ourselves.
+            if (InterlockedCompareExchange(&cueQueueEnqueuePosition, position + 1, position) == position) {
+                break;
             }
+        } else if (difference < 0) {
+            // The consumer has not emptied this slot since the last lap, so the queue is full.
+            return false;
         }
 
-        // https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/nf-mmeapi-waveoutunprepareheader
-        // waveOutUnprepareHeader cleans up the buffer after playback.
-        // It's important to call this since it releases resources allocated during preparation.
-        // You can't just call free on the buffer directly after playback because the audio system
-        // may still be using it until unpreparation is done.
-        // It takes the following arguments:
-        // 1. The HWAVEOUT handle representing the output device.
-        // 2. Pointer to the WAVEHDR structure describing the buffer.
-        // 3. Size of the WAVEHDR structure.
-        waveOutUnprepareHeader(waveOutHandle, &header, sizeof(header));
+        // Another producer got there first, so try again at the latest position.
+        position = cueQueueEnqueuePosition;
     }
 
-    // https://learn.microsoft.com/en-us/windows/win32/api/mmeapi/nf-mmeapi-waveoutclose
-    // waveOutClose closes the waveform output device.
-    // If the output device is not closed (for instance we return out of this function sloppily,
-    // the audio system may leak resources or behave unpredictably, perhaps not letting 
-    // a future call to waveOutOpen succeed.
-    // It takes the following argument:
-    // 1. The HWAVEOUT handle representing the output device.
+    cell->cue = *cue;
 
-    waveOutClose(waveOutHandle);
-    free(samples);
+    // The cue must be fully written before the consumer can see the slot as filled.
+    MemoryBarrier();
+    cell->sequence = position + 1;
+    return true;
+}
 
-    // Release any owned step data after playback finishes.
-    if (playback->ownsSteps) {
-        free(playback->steps);
+/**
+ * Takes the oldest cue off the cue queue. Must only be called from the mixer thread.
+ * @param outCue Receives the cue.
+ * @return true if a cue was taken, false if the queue was empty.
+ */
+static bool SoundManagerTakeCue(SoundCue *outCue) {
+    SoundCueQueueCell *cell = &cueQueue[(uint32_t)cueQueueDequeuePosition & (SOUND_CUE_QUEUE_CAPACITY - 1)];
+    LONG sequence = cell->sequence;
+    MemoryBarrier();
+
+    // The slot is only ready once its producer has bumped the sequence past our position.
+    int32_t difference = (int32_t)((uint32_t)sequence - (uint32_t)(cueQueueDequeuePosition + 1));
+    if (difference < 0) {
+        return false;
     }
-    free(playback);
 
-    return 0u;
+    *outCue = cell->cue;
+
+    // Hand the slot back to the producers, one full lap of the ring later.
+    MemoryBarrier();
+    cell->sequence = cueQueueDequeuePosition + SOUND_CUE_QUEUE_CAPACITY;
+    cueQueueDequeuePosition++;
+    return true;
 }
 
 /**
- * Starts playback for a set of steps and handles thread ownership.
- * @param steps Pointer to the tone step array.
- * @param stepCount Number of tone steps.
- * @param ownsSteps True if the array should be freed after playback.
+ * Adds every waiting cue to the voices being mixed.
+ * Must only be called from the mixer thread.
  */
-static void SoundManagerStartPlayback(SoundToneStep *steps, size_t stepCount, bool ownsSteps) {
-    SoundTonePlayback *playback = (SoundTonePlayback *)malloc(sizeof(SoundTonePlayback));
-    if (playback == NULL) {
-        if (ownsSteps) {
-            free(steps);
+static void SoundManagerStartQueuedVoices(void) {
+    SoundCue cue;
+    while (SoundManagerTakeCue(&cue)) {
+        // Cues that arrive after shutdown has begun are simply dropped.
+        if (!soundEnabled || (int)cue.kind < 0 || cue.kind >= SOUND_CUE_KIND_COUNT) {
+            continue;
         }
-        return;
+
+        // Variations that failed to render are skipped rather than played as silence.
+        const SoundCueBank *bank = &cueBanks[cue.kind];
+        if (cue.variation >= bank->variantCount || bank->variants[cue.variation].samples == NULL) {
+            continue;
+        }
+        const SoundCueVariant *variant = &bank->variants[cue.variation];
+
+        // Ensure there is room for another voice, doubling the capacity as needed.
+        if (mixerVoiceCount == mixerVoiceCapacity) {
+            size_t newCapacity = mixerVoiceCapacity == 0 ? 8 : mixerVoiceCapacity * 2;
+            SoundVoice *resized = (SoundVoice *)realloc(mixerVoices, newCapacity * sizeof(SoundVoice));
+            if (resized == NULL) {
+                continue;
+            }
+            mixerVoices = resized;
+            mixerVoiceCapacity = newCapacity;
+        }
+
+        SoundVoice *voice = &mixerVoices[mixerVoiceCount];
+        voice->samples = variant->samples;
+        voice->sampleCount = variant->sampleCount;
+        voice->cursor = 0;
+        voice->gain = cue.gain;
+        mixerVoiceCount++;
+    }
+}
+
+/**
+ * Mixes the next stretch of every active voice into an output buffer,
+ * retiring any voice that has played to its end.
+ * Must only be called from the mixer thread.
+ * @param output The buffer to fill.
+ * @param sampleCount The number of samples to fill it with.
+ * @param volume The master volume to scale the mix by.
+ */
+static void SoundManagerMixVoices(int16_t *output, size_t sampleCount, float volume) {
+    // Voices are summed at a higher precision first, so that two loud voices
+    // saturate at the end rather than wrapping around partway through.
+    int32_t mix[SOUND_BACKEND_BUFFER_SAMPLES];
+    if (sampleCount > SOUND_BACKEND_BUFFER_SAMPLES) {
+        sampleCount = SOUND_BACKEND_BUFFER_SAMPLES;
+    }
+    memset(mix, 0, sampleCount * sizeof(int32_t));
+
+    size_t v = 0;
+    while (v < mixerVoiceCount) {
+        SoundVoice *voice = &mixerVoices[v];
+        size_t remaining = voice->sampleCount - voice->cursor;
+        size_t count = remaining < sampleCount ? remaining : sampleCount;
+        for (size_t i = 0; i < count; ++i) {
+            mix[i] += (int32_t)((float)voice->samples[voice->cursor + i] * voice->gain);
+        }
+        voice->cursor += count;
+
+        // A finished voice is swapped with the last one, so the voice now at v still needs mixing.
+        // Its samples belong to the cue bank, so there is nothing to free.
+        if (voice->cursor >= voice->sampleCount) {
+            mixerVoices[v] = mixerVoices[mixerVoiceCount - 1];
+            mixerVoiceCount--;
+            continue;
+        }
+        ++v;
     }
 
-    playback->steps = steps;
-    playback->stepCount = stepCount;
-    playback->ownsSteps = ownsSteps;
-
-    // Use a detached thread so the main loop never blocks on audio timing.
-    // https://learn.microsoft.com/en-us/windows/win32/api/processthreadsapi/nf-processthreadsapi-createthread
-    // Compared to Posix threads, Windows threads are a bit different.
-    // The equivalent pthread call here would be something like:
-    // pthread_t thread;
-    // pthread_create(&thread, NULL, SoundManagerPlaySequenceThread, playback);
-    // pthread_detach(thread);
-    // But Windows uses HANDLEs to represent threads,
-    // and we can simply close the handle immediately after creation to detach it.
-    // This allows the thread to run independently without requiring a join later.
-    // Moreover, it takes more arguments than pthread_create:
-    // Specifically the arguments are:
-    // 1. Security attributes (NULL means default).
-    // 2. Stack size (0 means default).
-    // 3. Pointer to the thread function.
-    // 4. Pointer to the parameter to pass to the thread function.
-    // 5. Creation flags (0 means the thread runs immediately).
-    // 6. Pointer to receive the thread identifier (NULL means we don't care).
-
-    HANDLE threadHandle = CreateThread(NULL, 0u, SoundManagerPlaySequenceThread, playback, 0u, NULL);
-    if (threadHandle != NULL) {
-        CloseHandle(threadHandle);
-    } else {
-        // If we cannot spawn the thread, we clean up immediately to avoid leaks.
-        if (ownsSteps) {
-            free(steps);
+    for (size_t i = 0; i < sampleCount; ++i) {
+        int32_t scaled = (int32_t)((float)mix[i] * volume);
+        if (scaled > 32767) {
+            scaled = 32767;
+        } else if (scaled < -32768) {
+            scaled = -32768;
         }
-        free(playback);
+        output[i] = (int16_t)scaled;
     }
 }
 
 /**
- * Attempts to play a sequence while honoring its cooldown.
- * @param sequence Pointer to the sequence to play.
+ * Runs the mixer for as long as the sound manager is initialized.
+ * The mixer keeps one output device open for its whole life, and keeps it fed with a ring of
+ * small buffers. Whenever the device finishes with a buffer, the mixer starts any newly posted
+ * cues, mixes the next stretch of every active voice into that buffer, and hands it back.
+ * When nothing is playing it simply feeds the device silence.
+ * @param param Unused.
+ * @return Thread exit code (unused).
  */
-static void SoundManagerTryPlaySequence(SoundToneSequence *sequence) {
-    if (!soundEnabled || sequence == NULL) {
+static DWORD WINAPI SoundManagerMixerThread(LPVOID param) {
+    (void)param;
+
+    // Without any output there is nothing to mix for, such as when there is no audio device,
+    // so playback is switched off and cues are dropped from here on, as with the null backend.
+    if (!activeBackend->open(activeBackend, SOUND_SAMPLE_RATE, mixerWakeEvent, backendOutputPath)) {
+        soundEnabled = false;
+        return 0u;
+    }
+
+    // The banks were built by SoundManagerInitialize, so note which settings they were built for.
+    EnterCriticalSection(&soundLock);
+    LONG builtRevision = cueBankRevision;
+    LeaveCriticalSection(&soundLock);
+
+    while (InterlockedCompareExchange(&mixerStopRequested, 0, 0) == 0) {
+        // Snapshot tunables once per pass, which is plenty often for changes to be heard right away.
+        EnterCriticalSection(&soundLock);
+        float volume = soundMasterVolume;
+        LONG revision = cueBankRevision;
+        LeaveCriticalSection(&soundLock);
+
+        // Should the reverb settings have changed, render the banks again.
+        // Any voice still playing points into the old banks, so those are cut short;
+        // at a few dozen milliseconds long, nobody will miss them.
+        if (revision != builtRevision) {
+            mixerVoiceCount = 0;
+            builtRevision = SoundManagerBuildCueBanks();
+        }
+
+        SoundManagerStartQueuedVoices();
+
+        // Fill every buffer the backend is ready to take.
+        int16_t *buffer = NULL;
+        while ((buffer = activeBackend->acquireBuffer(activeBackend)) != NULL) {
+            SoundManagerMixVoices(buffer, SOUND_BACKEND_BUFFER_SAMPLES, volume);
+            activeBackend->submitBuffer(activeBackend, buffer);
+        }
+
+        // Sleep until the backend frees up a buffer (or we are asked to stop).
+        // Backends without a device to signal the event are simply checked on again after the timeout.
+        WaitForSingleObject(mixerWakeEvent, SOUND_MIXER_WAIT_MS);
+    }
+
+    activeBackend->close(activeBackend);
+
+    // Release the voice list. The samples belong to the cue banks, which outlive the mixer.
+    free(mixerVoices);
+    mixerVoices = NULL;
+    mixerVoiceCount = 0;
+    mixerVoiceCapacity = 0;
+
+    return 0u;
+}
+
+/**
+ * Posts a pre-rendered cue to the mixer for playback.
+ * @param kind The kind of cue to play.
+ * @param variation The slot of the cue's bank to play.
+ * @param gain How loud to play the cue, where 1 is as rendered.
+ */
+static void SoundManagerStartPlayback(SoundCueKind kind, size_t variation, float gain) {
+    if (mixerThread == NULL) {
         return;
     }
 
+    SoundCue cue;
+    cue.kind = kind;
+    cue.variation = variation;
+    cue.gain = gain;
+
+    // A full queue means the mixer is far behind, in which case dropping the cue is the right call.
+    SoundManagerPostCue(&cue);
+}
+
+/**
+ * Checks whether a sequence's cooldown has passed, and if so, starts it over.
+ * Uses a compare-and-swap rather than the sound lock, so that gameplay code
+ * never has to wait on the sound manager to find out whether to play something.
+ * Should two threads race for the same cooldown, exactly one of them wins.
+ * @param sequence Pointer to the sequence whose cooldown to claim.
+ * @return true if the cooldown had passed and now belongs to the caller, false otherwise.
+ */
+static bool SoundManagerClaimCooldown(SoundToneSequence *sequence) {
     DWORD now = GetTickCount();
-    bool shouldPlay = false;
+    LONG lastPlayed = sequence->lastPlayedMs;
 
-    SoundManagerEnsureLock();
-    EnterCriticalSection(&soundLock);
     // Cooldown exists so rapid collisions do not overwhelm the player with sound.
-    if (sequence->lastPlayedMs == 0u || (now - sequence->lastPlayedMs) >= sequence->cooldownMs) {
-        sequence->lastPlayedMs = now;
-        shouldPlay = true;
+    if (lastPlayed != 0 && (now - (DWORD)lastPlayed) < sequence->cooldownMs) {
+        return false;
+    }
+    return InterlockedCompareExchange(&sequence->lastPlayedMs, (LONG)now, lastPlayed) == lastPlayed;
+}
+
+/**
+ * Attempts to play a sequence while honoring its cooldown.
+ * @param sequence Pointer to the sequence whose cooldown to honor.
+ * @param kind The kind of cue the sequence was pre-rendered as.
+ * @param gain How loud to play the cue, where 1 is as rendered.
+ */
+static void SoundManagerTryPlaySequence(SoundToneSequence *sequence, SoundCueKind kind, float gain) {
+    if (!soundEnabled || sequence == NULL) {
+        return;
     }
-    LeaveCriticalSection(&soundLock);
 
-    if (!shouldPlay) {
+    if (!SoundManagerClaimCooldown(sequence)) {
         return;
     }
 
-    // We pass static steps without ownership because the sequence owns them.
-    SoundManagerStartPlayback((SoundToneStep *)sequence->steps, sequence->stepCount, false);
+    // The sequence was rendered in a single variation when the banks were built.
+    SoundManagerStartPlayback(kind, 0u, gain);
 }
 
 /**
- * Initializes the sound manager and enables playback.
- * This also prepares a synchronization primitive used for throttling.
+ * Initializes the sound manager and enables playback through the given backend.
+ * This also prepares a synchronization primitive used for throttling,
+ * and starts the mixer thread which owns the backend from here on.
+ * A backend that produces no output (or none at all) leaves playback disabled,
+ * without a mixer thread or any cues rendered, so that sound costs nothing.
+ * @param backend The backend to play through, or NULL for none.
+ * @param outputPath Where the backend should write to, for backends that write to a file. May be NULL otherwise.
  */
-void SoundManagerInitialize(void) {
+void SoundManagerInitialize(SoundBackend *backend, const char *outputPath) {
     SoundManagerEnsureLock();
+    if (mixerThread != NULL) {
+        return;
+    }
+
+    if (backend == NULL || !backend->producesOutput) {
+        soundEnabled = false;
+        return;
+    }
+
+    activeBackend = backend;
+    backendOutputPath[0] = '\0';
+    if (outputPath != NULL) {
+        snprintf(backendOutputPath, sizeof(backendOutputPath), "%s", outputPath);
+    }
 
-    // We only need to flip the flag because the lock is already ensured.
+    SoundManagerResetCueQueue();
+    mixerStopRequested = 0;
+
+    // Render every cue up front, so the mixer never has to synthesize anything while the game runs.
+    SoundManagerBuildCueBanks();
+
+    // An auto-reset event, so each wake-up from the device is consumed by the wait it ends.
+    mixerWakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (mixerWakeEvent == NULL) {
+        SoundManagerReleaseCueBanks();
+        return;
+    }
+
+    // Playback must be enabled before the mixer starts, or it would drop the first cues.
     soundEnabled = true;
+    mixerThread = CreateThread(NULL, 0u, SoundManagerMixerThread, NULL, 0u, NULL);
+    if (mixerThread == NULL) {
+        soundEnabled = false;
+        CloseHandle(mixerWakeEvent);
+        mixerWakeEvent = NULL;
+        SoundManagerReleaseCueBanks();
+    }
 }
 
 /**
@@ -594,6 +1057,23 @@ void SoundManagerInitialize(void) {
 void SoundManagerShutdown(void) {
     soundEnabled = false;
 
+    // Ask the mixer to stop, wake it in case it is asleep, and wait for it to close the device.
+    if (mixerThread != NULL) {
+        InterlockedExchange(&mixerStopRequested, 1);
+        SetEvent(mixerWakeEvent);
+        WaitForSingleObject(mixerThread, INFINITE);
+        CloseHandle(mixerThread);
+        mixerThread = NULL;
+    }
+    if (mixerWakeEvent != NULL) {
+        CloseHandle(mixerWakeEvent);
+        mixerWakeEvent = NULL;
+    }
+
+    // With the mixer gone, nothing is playing from the banks any more.
+    SoundManagerReleaseCueBanks();
+    activeBackend = NULL;
+
     if (soundLockInitialized) {
         DeleteCriticalSection(&soundLock);
         soundLockInitialized = false;
@@ -601,55 +1081,40 @@ void SoundManagerShutdown(void) {
 }
 
 /**
- * Plays the cure for when a starship collides with a planet.
+ * Plays a single cue for any number of starships colliding with a planet at once.
+ * The more ships, the louder the cue, though it levels off well before it could drown everything else out.
  * This uses a cooldown to avoid audio overload during big battles.
+ * @param impactCount How many starships arrived.
  */
-void SoundManagerPlayShipImpact(void) {
-    // We reuse the impact cooldown but generate new pitches per impact.
-    DWORD now = GetTickCount();
-    bool shouldPlay = false;
-
-    SoundManagerEnsureLock();
-    EnterCriticalSection(&soundLock);
-    // Cooldown avoids a wall of tones during large-scale collisions.
-    if (shipImpactSequence.lastPlayedMs == 0u || (now - shipImpactSequence.lastPlayedMs) >= shipImpactSequence.cooldownMs) {
-        shipImpactSequence.lastPlayedMs = now;
-        shouldPlay = true;
+void SoundManagerPlayShipImpacts(size_t impactCount) {
+    if (impactCount == 0 || !soundEnabled) {
+        return;
     }
-    LeaveCriticalSection(&soundLock);
 
-    if (!shouldPlay || !soundEnabled) {
+    // We reuse the impact cooldown but generate new pitches per impact.
+    // Cooldown avoids a wall of tones during large-scale collisions.
+    if (!SoundManagerClaimCooldown(&shipImpactSequence)) {
         return;
     }
 
-    // Build a tiny melodic fragment from a chromatic scale while keeping steps small.
-    SoundToneStep *steps = (SoundToneStep *)malloc(2u * sizeof(SoundToneStep));
-    if (steps == NULL) {
-        return;
+    // Every doubling of the ship count makes the cue a little louder, up to a limit.
+    float gain = 1.0f + SOUND_IMPACT_GAIN_PER_DOUBLING * log2f((float)impactCount);
+    if (gain > SOUND_IMPACT_MAX_GAIN) {
+        gain = SOUND_IMPACT_MAX_GAIN;
     }
 
+    // Pick a tiny melodic fragment from a chromatic scale while keeping steps small.
+    // Every fragment was rendered ahead of time, so all that is left is to pick one.
     int startIndex = SoundManagerRandomRange(0, (int)SOUND_CHROMATIC_COUNT - 1);
     // Smaller step offsets keep the chromatic palette from feeling too harsh.
-    int offset = SoundManagerRandomRange(-1, 1);
-    int nextIndex = startIndex + offset;
-    if (nextIndex < 0) {
-        nextIndex = 0;
-    } else if (nextIndex >= (int)SOUND_CHROMATIC_COUNT) {
-        nextIndex = (int)SOUND_CHROMATIC_COUNT - 1;
-    }
+    int offsetIndex = SoundManagerRandomRange(0, (int)SOUND_IMPACT_OFFSET_COUNT - 1);
 
     // Small timing variation keeps the sequence lively without sounding chaotic.
-    DWORD firstDuration = (DWORD)SoundManagerRandomRange(28, 44);
-    DWORD secondDuration = (DWORD)SoundManagerRandomRange(36, 60);
+    int firstDurationIndex = SoundManagerRandomRange(0, (int)SOUND_IMPACT_FIRST_DURATION_COUNT - 1);
+    int secondDurationIndex = SoundManagerRandomRange(0, (int)SOUND_IMPACT_SECOND_DURATION_COUNT - 1);
 
-    steps[0].frequency = SOUND_CHROMATIC_FREQS[startIndex];
-    steps[0].durationMs = firstDuration;
-    steps[0].pauseMs = 6u;
-    steps[1].frequency = SOUND_CHROMATIC_FREQS[nextIndex];
-    steps[1].durationMs = secondDuration;
-    steps[1].pauseMs = 0u;
-
-    SoundManagerStartPlayback(steps, 2u, true);
+    SoundManagerStartPlayback(SOUND_CUE_SHIP_IMPACT, SoundManagerImpactVariation((size_t)startIndex,
+        (size_t)offsetIndex, (size_t)firstDurationIndex, (size_t)secondDurationIndex), gain);
 }
 
 /**
@@ -657,7 +1122,7 @@ void SoundManagerPlayShipImpact(void) {
  * This is kept separate for easy swapping of celebratory audio.
  */
 void SoundManagerPlayPlanetCaptured(void) {
-    SoundManagerTryPlaySequence(&planetCapturedSequence);
+    SoundManagerTryPlaySequence(&planetCapturedSequence, SOUND_CUE_PLANET_CAPTURED, 1.0f);
 }
 
 /**
@@ -706,5 +1171,77 @@ void SoundManagerSetReverb(bool enabled, float delayMs, float decay) {
     reverbDelayMs = delayMs;
     reverbDecay = decay;
 
+    // The cue banks have the reverb baked in, so they need rendering again.
+    cueBankRevision++;
+
     LeaveCriticalSection(&soundLock);
 }
+
+/**
+ * Measures how quickly cues can be rendered, by rendering every ship impact variation
+ * and the capture fanfare over and over, straight into memory, until the requested
+ * amount of audio has been produced. Nothing is played and the cue banks are left alone,
+ * so this may be called whether or not the sound manager has been initialized.
+ * @param seconds How many seconds of audio to render.
+ * @param withReverb True to render with the reverb applied, false to render dry.
+ * @param outResult Receives the measurements.
+ * @return true if the benchmark ran, false if rendering failed or the arguments were invalid.
+ */
+bool SoundManagerBenchmarkSynthesis(float seconds, bool withReverb, SoundSynthesisBenchmark *outResult) {
+    if (outResult == NULL || seconds <= 0.0f) {
+        return false;
+    }
+
+    memset(outResult, 0, sizeof(*outResult));
+    uint64_t targetSamples = (uint64_t)((double)seconds * (double)SOUND_SAMPLE_RATE);
+    size_t impactCount = SOUND_CHROMATIC_COUNT * SOUND_IMPACT_OFFSET_COUNT
+        * SOUND_IMPACT_FIRST_DURATION_COUNT * SOUND_IMPACT_SECOND_DURATION_COUNT;
+
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER start;
+    LARGE_INTEGER end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+
+    // Go round every impact variation, with the fanfare slotted in after the last of them,
+    // the same mix of cues SoundManagerBuildCueBanks renders.
+    uint64_t renderedSamples = 0;
+    size_t cueIndex = 0;
+    while (renderedSamples < targetSamples) {
+        SoundToneStep impactSteps[2];
+        const SoundToneStep *steps = planetCapturedSequence.steps;
+        size_t stepCount = planetCapturedSequence.stepCount;
+        if (cueIndex < impactCount) {
+            size_t second = cueIndex % SOUND_IMPACT_SECOND_DURATION_COUNT;
+            size_t first = (cueIndex / SOUND_IMPACT_SECOND_DURATION_COUNT) % SOUND_IMPACT_FIRST_DURATION_COUNT;
+            size_t offset = (cueIndex / (SOUND_IMPACT_SECOND_DURATION_COUNT * SOUND_IMPACT_FIRST_DURATION_COUNT))
+                % SOUND_IMPACT_OFFSET_COUNT;
+            size_t startIndex = cueIndex / (SOUND_IMPACT_SECOND_DURATION_COUNT * SOUND_IMPACT_FIRST_DURATION_COUNT
+                * SOUND_IMPACT_OFFSET_COUNT);
+            SoundManagerImpactSteps(startIndex, offset, first, second, impactSteps);
+            steps = impactSteps;
+            stepCount = 2u;
+        }
+
+        int16_t *samples = NULL;
+        size_t sampleCount = 0;
+        if (!SoundManagerRenderSequence(steps, stepCount, withReverb, SOUND_BENCHMARK_REVERB_DELAY_MS,
+                SOUND_BENCHMARK_REVERB_DECAY, &samples, &sampleCount)) {
+            return false;
+        }
+        free(samples);
+
+        renderedSamples += sampleCount;
+        cueIndex = (cueIndex + 1) % (impactCount + 1);
+    }
+
+    QueryPerformanceCounter(&end);
+
+    outResult->samplesRendered = renderedSamples;
+    outResult->elapsedSeconds = (double)(end.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+    if (outResult->elapsedSeconds > 0.0) {
+        outResult->samplesPerSecond = (double)renderedSamples / outResult->elapsedSeconds;
+        outResult->realTimeFactor = outResult->samplesPerSecond / (double)SOUND_SAMPLE_RATE;
+    }
+    return true;
+}
@@ -9,12 +9,30 @@
 #define _SOUND_MANAGER_UTILITIES_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Utilities/soundBackendUtilities.h"
+
+// The results of a run of SoundManagerBenchmarkSynthesis.
+typedef struct SoundSynthesisBenchmark {
+    uint64_t samplesRendered; /** How many samples were rendered in total */
+    double elapsedSeconds; /** How long rendering them took, in seconds */
+    double samplesPerSecond; /** How many samples were rendered per second */
+    double realTimeFactor; /** How many times faster than real time rendering was, so 1 is just barely keeping up */
+} SoundSynthesisBenchmark;
 
 /**
- * Initializes the sound manager and enables playback.
- * This sets up any OS resources required by the current sound backend.
+ * Initializes the sound manager and enables playback through the given backend.
+ * This opens the backend's output and starts the mixer thread that feeds it,
+ * so that playing a cue afterwards never creates a thread or opens a device.
+ * A backend that produces no output (or none at all) leaves playback disabled,
+ * without a mixer thread or any cues rendered, so that sound costs nothing.
+ * Should the backend fail to open, playback is likewise disabled.
+ * @param backend The backend to play through, or NULL for none.
+ * @param outputPath Where the backend should write to, for backends that write to a file. May be NULL otherwise.
  */
-void SoundManagerInitialize(void);
+void SoundManagerInitialize(SoundBackend *backend, const char *outputPath);
 
 /**
  * Shuts down the sound manager and disables playback.
@@ -23,10 +41,13 @@ void SoundManagerInitialize(void);
 void SoundManagerShutdown(void);
 
 /**
- * Plays a soft cue when a starship collides with a planet.
+ * Plays a soft cue when starships collide with a planet.
+ * Any number of ships arriving together get a single cue, played louder the more there are.
  * The manager throttles this sound to avoid overwhelming the audio mix.
+ * Never blocks or takes a lock, so it is safe to call from the simulation.
+ * @param impactCount How many starships arrived.
  */
-void SoundManagerPlayShipImpact(void);
+void SoundManagerPlayShipImpacts(size_t impactCount);
 
 /**
  * Plays a gentle cue when a planet changes ownership.
@@ -44,10 +65,23 @@ void SoundManagerSetVolume(float volume);
 /**
  * Configures a lightweight reverb (echo) applied to generated tones.
  * When disabled, the reverb path is bypassed to keep CPU usage minimal.
+ * Since reverb is baked into the pre-rendered cues, changing it renders them all again,
+ * so this is best called once at startup rather than mid-game.
  * @param enabled True to enable reverb, false to disable.
  * @param delayMs Delay in milliseconds before the echo is mixed in.
  * @param decay Linear decay factor in the range [0.0, 1.0].
  */
 void SoundManagerSetReverb(bool enabled, float delayMs, float decay);
 
+/**
+ * Measures how quickly cues can be rendered, by rendering every cue variation over and over
+ * straight into memory until the requested amount of audio has been produced.
+ * Nothing is played, so this may be called whether or not the sound manager has been initialized.
+ * @param seconds How many seconds of audio to render.
+ * @param withReverb True to render with a typical reverb applied, false to render dry.
+ * @param outResult Receives the measurements.
+ * @return true if the benchmark ran, false if rendering failed or the arguments were invalid.
+ */
+bool SoundManagerBenchmarkSynthesis(float seconds, bool withReverb, SoundSynthesisBenchmark *outResult);
+
 #endif // _SOUND_MANAGER_UTILITIES_H_
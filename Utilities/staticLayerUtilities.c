@@ -0,0 +1,402 @@
+/**
+ * Implementation of the static layer utilities.
+ * OpenGL 1.1 has no way to draw straight into a texture, but it can copy
+ * part of the frame being drawn into one with glCopyTexSubImage2D.
+ * So whenever part of the layer needs drawing again, we draw it into the back buffer
+ * (clipped to just that part with the scissor test), copy it into the layer's texture,
+ * and then draw the whole texture over the view as usual.
+ * @file Utilities/staticLayerUtilities.c
+ * @author abmize
+ */
+#include "Utilities/staticLayerUtilities.h"
+
+#include "Objects/level.h"
+
+/**
+ * Initializes a static layer to an empty state.
+ * @param layer Pointer to the layer to initialize.
+ */
+void StaticLayerInit(StaticLayer *layer) {
+    if (layer == NULL) {
+        return;
+    }
+
+    memset(layer, 0, sizeof(*layer));
+}
+
+/**
+ * Marks the whole layer as needing to be drawn again,
+ * and moves every planet back to being drawn live.
+ * @param layer Pointer to the layer to invalidate.
+ */
+void StaticLayerInvalidate(StaticLayer *layer) {
+    if (layer == NULL) {
+        return;
+    }
+
+    layer->valid = false;
+    layer->dirty = false;
+    layer->bakedPlanetCount = 0;
+    if (layer->planetStates != NULL) {
+        memset(layer->planetStates, 0, layer->planetCount * sizeof(StaticLayerPlanetState));
+    }
+}
+
+/**
+ * Helper function to make sure the layer has planet states for the given level.
+ * A different level (or the same level after it was reconfigured) starts over with every planet live.
+ * @param layer Pointer to the layer.
+ * @param level Pointer to the level being drawn.
+ * @return true on success, false on allocation failure.
+ */
+static bool StaticLayerEnsurePlanetStates(StaticLayer *layer, const Level *level) {
+    if (layer->planets == level->planets && layer->planetCount == level->planetCount) {
+        return true;
+    }
+
+    StaticLayerPlanetState *states = NULL;
+    if (level->planetCount > 0) {
+        states = (StaticLayerPlanetState *)realloc(layer->planetStates,
+            level->planetCount * sizeof(StaticLayerPlanetState));
+        if (states == NULL) {
+            return false;
+        }
+    } else {
+        free(layer->planetStates);
+    }
+
+    layer->planetStates = states;
+    layer->planets = level->planets;
+    layer->planetCount = level->planetCount;
+    StaticLayerInvalidate(layer);
+    return true;
+}
+
+/**
+ * Helper function to make sure the layer's texture is at least as large as the view.
+ * Creating a new texture means the layer has to be drawn again from scratch.
+ * @param layer Pointer to the layer.
+ * @param viewWidth The width of the view in pixels.
+ * @param viewHeight The height of the view in pixels.
+ * @return true on success, false if the texture could not be created.
+ */
+static bool StaticLayerEnsureTexture(StaticLayer *layer, int viewWidth, int viewHeight) {
+    // OpenGL 1.1 only supports textures whose sides are powers of two.
+    int textureWidth = 1;
+    while (textureWidth < viewWidth) {
+        textureWidth *= 2;
+    }
+    int textureHeight = 1;
+    while (textureHeight < viewHeight) {
+        textureHeight *= 2;
+    }
+
+    if (layer->texture != 0 && layer->textureWidth == textureWidth && layer->textureHeight == textureHeight) {
+        return true;
+    }
+
+    if (layer->texture != 0) {
+        glDeleteTextures(1, &layer->texture);
+        layer->texture = 0;
+    }
+
+    glGenTextures(1, &layer->texture);
+    if (layer->texture == 0) {
+        return false;
+    }
+
+    // The texture starts out without any contents, as everything in it is copied in from the frame.
+    // Nearest filtering, since every texel lines up exactly with a pixel of the view.
+    glBindTexture(GL_TEXTURE_2D, layer->texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureWidth, textureHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    layer->textureWidth = textureWidth;
+    layer->textureHeight = textureHeight;
+    layer->valid = false;
+    return true;
+}
+
+/**
+ * Helper function to grow the layer's dirty rectangle to include the given rectangle.
+ * @param layer Pointer to the layer.
+ * @param minX The left edge of the rectangle in screen pixels.
+ * @param minY The top edge of the rectangle in screen pixels.
+ * @param maxX The right edge of the rectangle in screen pixels.
+ * @param maxY The bottom edge of the rectangle in screen pixels.
+ */
+static void StaticLayerMarkDirty(StaticLayer *layer, float minX, float minY, float maxX, float maxY) {
+    if (!layer->dirty) {
+        layer->dirty = true;
+        layer->dirtyMinX = minX;
+        layer->dirtyMinY = minY;
+        layer->dirtyMaxX = maxX;
+        layer->dirtyMaxY = maxY;
+        return;
+    }
+
+    layer->dirtyMinX = fminf(layer->dirtyMinX, minX);
+    layer->dirtyMinY = fminf(layer->dirtyMinY, minY);
+    layer->dirtyMaxX = fmaxf(layer->dirtyMaxX, maxX);
+    layer->dirtyMaxY = fmaxf(layer->dirtyMaxY, maxY);
+}
+
+/**
+ * Helper function to mark the screen region covered by a planet as dirty.
+ * The region covers both how the planet looks now and how it looked when its render cache
+ * was last built, since a planet losing ships also shrinks, and what it used to cover must go too.
+ * @param layer Pointer to the layer.
+ * @param planet Pointer to the planet.
+ * @param cache Pointer to the planet's render cache.
+ * @param camera Pointer to the camera the level is viewed through.
+ */
+static void StaticLayerMarkPlanetDirty(StaticLayer *layer, const Planet *planet,
+    const PlanetRenderCache *cache, const CameraState *camera) {
+    float radius = PlanetGetVisualRadius(planet);
+    if (cache->valid) {
+        Planet previous = *planet;
+        previous.currentFleetSize = cache->currentFleetSize;
+        previous.maxFleetCapacity = cache->maxFleetCapacity;
+        radius = fmaxf(radius, PlanetGetVisualRadius(&previous));
+    }
+
+    float screenX = (planet->position.x - camera->position.x) * camera->zoom;
+    float screenY = (planet->position.y - camera->position.y) * camera->zoom;
+    float screenRadius = radius * camera->zoom + STATIC_LAYER_DIRTY_PADDING;
+    StaticLayerMarkDirty(layer, screenX - screenRadius, screenY - screenRadius,
+        screenX + screenRadius, screenY + screenRadius);
+}
+
+/**
+ * Helper function to draw the dirty part of the layer again and copy it into the layer's texture.
+ * @param layer Pointer to the layer.
+ * @param level Pointer to the level being drawn.
+ * @param camera Pointer to the camera the level is viewed through.
+ * @param visiblePlanets The indices of the visible planets, or NULL for the first visiblePlanetCount planets.
+ * @param visiblePlanetCount The number of visible planets.
+ */
+static void StaticLayerRepaint(StaticLayer *layer, Level *level, const CameraState *camera,
+    const size_t *visiblePlanets, size_t visiblePlanetCount) {
+    // Snap the dirty rectangle outwards to whole pixels, and keep it within the view.
+    int x0 = (int)floorf(fmaxf(layer->dirtyMinX, 0.0f));
+    int y0 = (int)floorf(fmaxf(layer->dirtyMinY, 0.0f));
+    int x1 = (int)ceilf(fminf(layer->dirtyMaxX, (float)layer->viewWidth));
+    int y1 = (int)ceilf(fminf(layer->dirtyMaxY, (float)layer->viewHeight));
+    layer->dirty = false;
+    if (x1 <= x0 || y1 <= y0) {
+        return;
+    }
+
+    // OpenGL measures window coordinates from the bottom left, while we measure from the top left.
+    int glY = layer->viewHeight - y1;
+    int width = x1 - x0;
+    int height = y1 - y0;
+
+    // Only the dirty part of the back buffer is touched,
+    // so everything we draw here is clipped to it with the scissor test.
+    RenderBatchFlush();
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x0, glY, width, height);
+
+    // The background, exactly as it would be drawn without the layer.
+    glClearColor(BACKGROUND_COLOR_R, BACKGROUND_COLOR_G, BACKGROUND_COLOR_B, BACKGROUND_COLOR_A);
+    glClear(GL_COLOR_BUFFER_BIT);
+    DrawBackgroundGradient(layer->viewWidth, layer->viewHeight);
+
+    // Then every baked planet that reaches into the dirty region, through the camera.
+    float worldMinX = camera->position.x + (float)x0 / camera->zoom;
+    float worldMinY = camera->position.y + (float)y0 / camera->zoom;
+    float worldMaxX = camera->position.x + (float)x1 / camera->zoom;
+    float worldMaxY = camera->position.y + (float)y1 / camera->zoom;
+
+    glPushMatrix();
+    glScalef(camera->zoom, camera->zoom, 1.0f);
+    glTranslatef(-camera->position.x, -camera->position.y, 0.0f);
+
+    for (size_t n = 0; n < visiblePlanetCount; ++n) {
+        size_t i = visiblePlanets != NULL ? visiblePlanets[n] : n;
+        if (!layer->planetStates[i].baked) {
+            continue;
+        }
+
+        const Planet *planet = &level->planets[i];
+        float radius = PlanetGetVisualRadius(planet);
+        if (planet->position.x + radius < worldMinX || planet->position.x - radius > worldMaxX ||
+            planet->position.y + radius < worldMinY || planet->position.y - radius > worldMaxY) {
+            continue;
+        }
+
+        PlanetDrawCached(planet, &level->planetRenderCaches[i]);
+    }
+
+    RenderBatchFlush();
+    glPopMatrix();
+
+    // Copy the freshly drawn region into the same place in the texture.
+    glBindTexture(GL_TEXTURE_2D, layer->texture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, x0, glY, x0, glY, width, height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glDisable(GL_SCISSOR_TEST);
+}
+
+/**
+ * Brings the static layer up to date and draws it over the whole view.
+ * Planets that have changed are moved out of the layer, planets that have settled are moved in,
+ * and only the screen regions they cover are drawn again. If the camera or view size changed,
+ * the whole layer is drawn again instead.
+ * Must be called with the modelview matrix set to the identity, outside of any sorted pass,
+ * and with the detail scale already set for the camera's zoom.
+ * On failure nothing is drawn, and the caller should draw the background and every planet itself.
+ * @param layer Pointer to the layer.
+ * @param level Pointer to the level being drawn.
+ * @param camera Pointer to the camera the level is viewed through.
+ * @param viewWidth The width of the view in pixels.
+ * @param viewHeight The height of the view in pixels.
+ * @param visiblePlanets The indices of the visible planets, or NULL for the first visiblePlanetCount planets.
+ * @param visiblePlanetCount The number of visible planets.
+ * @return true if the layer was drawn, false otherwise.
+ */
+bool StaticLayerCompose(StaticLayer *layer, struct Level *level, const CameraState *camera,
+    int viewWidth, int viewHeight, const size_t *visiblePlanets, size_t visiblePlanetCount) {
+    if (layer == NULL || level == NULL || camera == NULL || viewWidth <= 0 || viewHeight <= 0 || camera->zoom <= 0.0f) {
+        return false;
+    }
+
+    // Baking planets relies on their render caches to tell whether they changed.
+    if (level->planetRenderCaches == NULL) {
+        return false;
+    }
+
+    if (!StaticLayerEnsurePlanetStates(layer, level) || !StaticLayerEnsureTexture(layer, viewWidth, viewHeight)) {
+        return false;
+    }
+
+    // Moving or zooming the camera moves everything in the layer, so all of it has to be drawn again.
+    if (layer->viewWidth != viewWidth || layer->viewHeight != viewHeight ||
+        layer->cameraPosition.x != camera->position.x || layer->cameraPosition.y != camera->position.y ||
+        layer->cameraZoom != camera->zoom) {
+        layer->valid = false;
+        layer->viewWidth = viewWidth;
+        layer->viewHeight = viewHeight;
+        layer->cameraPosition = camera->position;
+        layer->cameraZoom = camera->zoom;
+    }
+
+    // Work out which planets move in or out of the layer this frame.
+    // A planet's render cache still holds how it looked when it was last drawn,
+    // so comparing against it tells us whether anything about it changed since.
+    for (size_t n = 0; n < visiblePlanetCount; ++n) {
+        size_t i = visiblePlanets != NULL ? visiblePlanets[n] : n;
+        if (i >= layer->planetCount) {
+            continue;
+        }
+
+        StaticLayerPlanetState *state = &layer->planetStates[i];
+        const Planet *planet = &level->planets[i];
+        const PlanetRenderCache *cache = &level->planetRenderCaches[i];
+        bool unchanged = PlanetRenderCacheMatches(planet, cache);
+
+        if (state->baked) {
+            // A baked planet that changed goes back to being drawn live,
+            // and the stale picture of it has to be removed from the layer.
+            if (!unchanged) {
+                StaticLayerMarkPlanetDirty(layer, planet, cache, camera);
+                state->baked = false;
+                state->unchangedFrames = 0;
+                layer->bakedPlanetCount--;
+            }
+        } else if (unchanged) {
+            // A live planet that has looked the same for long enough is moved into the layer.
+            state->unchangedFrames++;
+            if (state->unchangedFrames >= STATIC_LAYER_SETTLE_FRAMES) {
+                StaticLayerMarkPlanetDirty(layer, planet, cache, camera);
+                state->baked = true;
+                layer->bakedPlanetCount++;
+            }
+        } else {
+            state->unchangedFrames = 0;
+        }
+    }
+
+    // Bring the layer up to date, all of it or just the parts that changed.
+    if (!layer->valid) {
+        layer->dirty = false;
+        StaticLayerMarkDirty(layer, 0.0f, 0.0f, (float)viewWidth, (float)viewHeight);
+    }
+
+    if (layer->dirty) {
+        StaticLayerRepaint(layer, level, camera, visiblePlanets, visiblePlanetCount);
+    }
+    layer->valid = true;
+
+    // Finally, draw the whole layer over the view with a single quad.
+    // The bottom row of the texture holds the bottom row of the view,
+    // so the top of the screen samples the texture at viewHeight / textureHeight.
+    RenderBatchTexturedVertex *vertices = RenderBatchReserveTextured(layer->texture, 6);
+    if (vertices == NULL) {
+        return false;
+    }
+
+    float right = (float)viewWidth;
+    float bottom = (float)viewHeight;
+    float u1 = (float)viewWidth / (float)layer->textureWidth;
+    float vTop = (float)viewHeight / (float)layer->textureHeight;
+    float corners[6][4] = {
+        {0.0f, 0.0f, 0.0f, vTop},
+        {right, 0.0f, u1, vTop},
+        {right, bottom, u1, 0.0f},
+        {0.0f, 0.0f, 0.0f, vTop},
+        {right, bottom, u1, 0.0f},
+        {0.0f, bottom, 0.0f, 0.0f}
+    };
+
+    for (int i = 0; i < 6; ++i) {
+        vertices[i].x = corners[i][0];
+        vertices[i].y = corners[i][1];
+        vertices[i].u = corners[i][2];
+        vertices[i].v = corners[i][3];
+        vertices[i].color[0] = 1.0f;
+        vertices[i].color[1] = 1.0f;
+        vertices[i].color[2] = 1.0f;
+        vertices[i].color[3] = 1.0f;
+    }
+
+    return true;
+}
+
+/**
+ * Checks whether a planet is drawn as part of the static layer,
+ * in which case it should not also be drawn live.
+ * @param layer Pointer to the layer.
+ * @param planetIndex The index of the planet in the level.
+ * @return true if the planet is part of the layer, false if it has to be drawn live.
+ */
+bool StaticLayerIsPlanetBaked(const StaticLayer *layer, size_t planetIndex) {
+    if (layer == NULL || layer->planetStates == NULL || planetIndex >= layer->planetCount) {
+        return false;
+    }
+
+    return layer->planetStates[planetIndex].baked;
+}
+
+/**
+ * Releases the texture and memory held by a static layer.
+ * @param layer Pointer to the layer to release.
+ */
+void StaticLayerRelease(StaticLayer *layer) {
+    if (layer == NULL) {
+        return;
+    }
+
+    if (layer->texture != 0) {
+        glDeleteTextures(1, &layer->texture);
+    }
+
+    free(layer->planetStates);
+    StaticLayerInit(layer);
+}
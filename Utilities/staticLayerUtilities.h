@@ -0,0 +1,121 @@
+/**
+ * Header file for the static layer utilities.
+ * The static layer is a texture holding the parts of the game view that rarely change,
+ * namely the background gradient and every planet that has not changed in a while.
+ * It is drawn with a single quad each frame, and only the parts that actually changed
+ * are drawn again, so that only ships, trails and changing planets are drawn live.
+ * @file Utilities/staticLayerUtilities.h
+ * @author abmize
+ */
+#ifndef _STATIC_LAYER_UTILITIES_H_
+#define _STATIC_LAYER_UTILITIES_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Objects/vec2.h"
+#include "Objects/planet.h"
+#include "Utilities/cameraUtilities.h"
+#include "Utilities/renderUtilities.h"
+
+// Forward declaration in order to avoid circular dependency.
+struct Level;
+
+// Number of consecutive frames a planet has to look exactly the same
+// before it is moved from being drawn live into the static layer.
+// Planets still growing their fleet change every frame and never settle,
+// while full or unowned planets settle after about half a second.
+#define STATIC_LAYER_SETTLE_FRAMES 30
+
+// Extra pixels added around every dirty region, covering anti-aliased edges
+// and rounding between world and screen coordinates.
+#define STATIC_LAYER_DIRTY_PADDING 2.0f
+
+// What the static layer knows about a single planet.
+// baked is true if the planet is drawn into the layer rather than live,
+// and unchangedFrames counts how long a live planet has looked the same.
+typedef struct StaticLayerPlanetState {
+    bool baked;
+    uint32_t unchangedFrames;
+} StaticLayerPlanetState;
+
+// The static layer itself.
+// The texture's sides are powers of two, as OpenGL 1.1 requires, and at least as large as the view.
+// The layer is only valid for the view size and camera it was drawn with;
+// any change to those means drawing all of it again.
+// The dirty rectangle is in screen pixels, with the origin at the top left,
+// and covers everything that has to be drawn again before the layer can be used.
+// planets and planetCount identify the level the planet states belong to.
+typedef struct StaticLayer {
+    GLuint texture;
+    int textureWidth;
+    int textureHeight;
+    int viewWidth;
+    int viewHeight;
+    Vec2 cameraPosition;
+    float cameraZoom;
+    bool valid;
+    bool dirty;
+    float dirtyMinX;
+    float dirtyMinY;
+    float dirtyMaxX;
+    float dirtyMaxY;
+    const Planet *planets;
+    size_t planetCount;
+    StaticLayerPlanetState *planetStates;
+    size_t bakedPlanetCount;
+} StaticLayer;
+
+/**
+ * Initializes a static layer to an empty state.
+ * @param layer Pointer to the layer to initialize.
+ */
+void StaticLayerInit(StaticLayer *layer);
+
+/**
+ * Marks the whole layer as needing to be drawn again,
+ * and moves every planet back to being drawn live.
+ * @param layer Pointer to the layer to invalidate.
+ */
+void StaticLayerInvalidate(StaticLayer *layer);
+
+/**
+ * Brings the static layer up to date and draws it over the whole view.
+ * Planets that have changed are moved out of the layer, planets that have settled are moved in,
+ * and only the screen regions they cover are drawn again. If the camera or view size changed,
+ * the whole layer is drawn again instead.
+ * Must be called with the modelview matrix set to the identity, outside of any sorted pass,
+ * and with the detail scale already set for the camera's zoom.
+ * On failure nothing is drawn, and the caller should draw the background and every planet itself.
+ * @param layer Pointer to the layer.
+ * @param level Pointer to the level being drawn.
+ * @param camera Pointer to the camera the level is viewed through.
+ * @param viewWidth The width of the view in pixels.
+ * @param viewHeight The height of the view in pixels.
+ * @param visiblePlanets The indices of the visible planets, or NULL for the first visiblePlanetCount planets.
+ * @param visiblePlanetCount The number of visible planets.
+ * @return true if the layer was drawn, false otherwise.
+ */
+bool StaticLayerCompose(StaticLayer *layer, struct Level *level, const CameraState *camera,
+    int viewWidth, int viewHeight, const size_t *visiblePlanets, size_t visiblePlanetCount);
+
+/**
+ * Checks whether a planet is drawn as part of the static layer,
+ * in which case it should not also be drawn live.
+ * @param layer Pointer to the layer.
+ * @param planetIndex The index of the planet in the level.
+ * @return true if the planet is part of the layer, false if it has to be drawn live.
+ */
+bool StaticLayerIsPlanetBaked(const StaticLayer *layer, size_t planetIndex);
+
+/**
+ * Releases the texture and memory held by a static layer.
+ * @param layer Pointer to the layer to release.
+ */
+void StaticLayerRelease(StaticLayer *layer);
+
+#endif // _STATIC_LAYER_UTILITIES_H_